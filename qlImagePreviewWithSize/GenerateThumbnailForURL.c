@@ -199,6 +199,7 @@ OSStatus GenerateThumbnailForURL(void *thisInterface,
         config.options.use_scaling = 1;
         config.options.scaled_width = thumbnailWidth;
         config.options.scaled_height = thumbnailHeight;
+        config.options.linear_scaling = 1;
         config.output.colorspace = MODE_RGBA;
         
         if (features.has_animation) {
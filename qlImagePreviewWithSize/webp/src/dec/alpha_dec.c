@@ -164,6 +164,8 @@ static int AllocateAlphaPlane(VP8Decoder* const dec, const VP8Io* const io) {
 
 void WebPDeallocateAlphaMemory(VP8Decoder* const dec) {
   assert(dec != NULL);
+  WebPGetWorkerInterface()->End(&dec->alpha_worker_);
+  dec->alpha_mt_ = 0;
   WebPSafeFree(dec->alpha_plane_mem_);
   dec->alpha_plane_mem_ = NULL;
   dec->alpha_plane_ = NULL;
@@ -171,6 +173,85 @@ void WebPDeallocateAlphaMemory(VP8Decoder* const dec) {
   dec->alph_dec_ = NULL;
 }
 
+// Sets up dec->alph_dec_ and the alpha plane. Returns false in case of error.
+static int InitAlphaDecoder(VP8Decoder* const dec, const VP8Io* const io) {
+  dec->alph_dec_ = ALPHNew();
+  if (dec->alph_dec_ == NULL) return 0;
+  if (!AllocateAlphaPlane(dec, io)) return 0;
+  if (!ALPHInit(dec->alph_dec_, dec->alpha_data_, dec->alpha_data_size_,
+                io, dec->alpha_plane_)) {
+    return 0;
+  }
+  // if we allowed use of alpha dithering, check whether it's needed at all
+  if (dec->alph_dec_->pre_processing_ != ALPHA_PREPROCESSED_LEVELS) {
+    dec->alpha_dithering_ = 0;   // disable dithering
+  }
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+// Multi-threaded decoding.
+//
+// The alpha plane is decoded by 'alpha_worker_' in bands of ALPHA_BAND_ROWS
+// rows, one band ahead of the rows requested for output. Each request waits
+// for the band in flight, decodes any missing band directly and then queues
+// the next one.
+
+#define ALPHA_BAND_ROWS 64
+
+static int AlphaWorkerHook(void* arg1, void* arg2) {
+  VP8Decoder* const dec = (VP8Decoder*)arg1;
+  (void)arg2;
+  return ALPHDecode(dec, dec->alpha_row_, dec->alpha_num_rows_);
+}
+
+// Waits until the first 'last_row' rows (out of 'height') are decoded, and
+// queues the next band if any. Returns false in case of bitstream error.
+static int SyncAlphaRows(VP8Decoder* const dec, int last_row, int height) {
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  WebPWorker* const worker = &dec->alpha_worker_;
+  while (1) {
+    if (!winterface->Sync(worker)) return 0;
+    dec->alpha_row_ += dec->alpha_num_rows_;
+    dec->alpha_num_rows_ = 0;
+    if (dec->alpha_row_ >= height) return 1;   // all done
+    dec->alpha_num_rows_ = height - dec->alpha_row_;
+    if (dec->alph_dec_->pre_processing_ != ALPHA_PREPROCESSED_LEVELS &&
+        dec->alpha_num_rows_ > ALPHA_BAND_ROWS) {
+      dec->alpha_num_rows_ = ALPHA_BAND_ROWS;   // else, decode in one pass
+    }
+    if (dec->alpha_row_ >= last_row) {
+      winterface->Launch(worker);
+      return 1;
+    }
+    winterface->Execute(worker);   // needed right now
+  }
+}
+
+void VP8StartAlphaDecoding(VP8Decoder* const dec, const VP8Io* const io) {
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  WebPWorker* const worker = &dec->alpha_worker_;
+  assert(dec != NULL && io != NULL);
+  if (dec->mt_method_ == 0 || dec->alpha_data_ == NULL ||
+      dec->is_alpha_decoded_ || dec->alph_dec_ != NULL) {
+    return;
+  }
+  if (!InitAlphaDecoder(dec, io) || !winterface->Reset(worker)) {
+    // Errors will be reported by VP8DecompressAlphaRows(), if any.
+    WebPDeallocateAlphaMemory(dec);
+    return;
+  }
+  worker->hook = AlphaWorkerHook;
+  worker->data1 = dec;
+  worker->data2 = NULL;
+  dec->alpha_mt_ = 1;
+  dec->alpha_row_ = 0;
+  dec->alpha_num_rows_ = 0;
+  (void)SyncAlphaRows(dec, 0, io->crop_bottom);   // queue the first band
+}
+
+#undef ALPHA_BAND_ROWS
+
 //------------------------------------------------------------------------------
 // Main entry point.
 
@@ -186,19 +267,17 @@ const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
     return NULL;    // sanity check.
   }
 
-  if (!dec->is_alpha_decoded_) {
+  if (dec->alpha_mt_) {
+    if (!SyncAlphaRows(dec, row + num_rows, height)) goto Error;
+    if (dec->alpha_row_ >= height) {   // the worker is done
+      WebPGetWorkerInterface()->End(&dec->alpha_worker_);
+      dec->alpha_mt_ = 0;
+      assert(dec->is_alpha_decoded_);
+    }
+  } else if (!dec->is_alpha_decoded_) {
     if (dec->alph_dec_ == NULL) {    // Initialize decoder.
-      dec->alph_dec_ = ALPHNew();
-      if (dec->alph_dec_ == NULL) return NULL;
-      if (!AllocateAlphaPlane(dec, io)) goto Error;
-      if (!ALPHInit(dec->alph_dec_, dec->alpha_data_, dec->alpha_data_size_,
-                    io, dec->alpha_plane_)) {
-        goto Error;
-      }
-      // if we allowed use of alpha dithering, check whether it's needed at all
-      if (dec->alph_dec_->pre_processing_ != ALPHA_PREPROCESSED_LEVELS) {
-        dec->alpha_dithering_ = 0;   // disable dithering
-      } else {
+      if (!InitAlphaDecoder(dec, io)) goto Error;
+      if (dec->alph_dec_->pre_processing_ == ALPHA_PREPROCESSED_LEVELS) {
         num_rows = height - row;     // decode everything in one pass
       }
     }
@@ -206,19 +285,20 @@ const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
     assert(dec->alph_dec_ != NULL);
     assert(row + num_rows <= height);
     if (!ALPHDecode(dec, row, num_rows)) goto Error;
+  }
 
-    if (dec->is_alpha_decoded_) {   // finished?
-      ALPHDelete(dec->alph_dec_);
-      dec->alph_dec_ = NULL;
-      if (dec->alpha_dithering_ > 0) {
-        uint8_t* const alpha = dec->alpha_plane_ + io->crop_top * width
-                             + io->crop_left;
-        if (!WebPDequantizeLevels(alpha,
-                                  io->crop_right - io->crop_left,
-                                  io->crop_bottom - io->crop_top,
-                                  width, dec->alpha_dithering_)) {
-          goto Error;
-        }
+  if (!dec->alpha_mt_ && dec->is_alpha_decoded_ &&
+      dec->alph_dec_ != NULL) {   // just finished?
+    ALPHDelete(dec->alph_dec_);
+    dec->alph_dec_ = NULL;
+    if (dec->alpha_dithering_ > 0) {
+      uint8_t* const alpha = dec->alpha_plane_ + io->crop_top * width
+                           + io->crop_left;
+      if (!WebPDequantizeLevels(alpha,
+                                io->crop_right - io->crop_left,
+                                io->crop_bottom - io->crop_top,
+                                width, dec->alpha_dithering_)) {
+        goto Error;
       }
     }
   }
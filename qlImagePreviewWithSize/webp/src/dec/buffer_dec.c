@@ -24,7 +24,8 @@
 static const uint8_t kModeBpp[MODE_LAST] = {
   3, 4, 3, 4, 4, 2, 2,
   4, 4, 4, 2,    // pre-multiplied modes
-  1, 1 };
+  1, 1,
+  8, 8, 8, 8 };  // 16b modes
 
 // Check that webp_csp_mode is within the bounds of WEBP_CSP_MODE.
 // Convert to an integer to handle both the unsigned/signed enum cases
@@ -79,6 +80,9 @@ static VP8StatusCode CheckDecBuffer(const WebPDecBuffer* const buffer) {
     ok &= (size <= buf->size);
     ok &= (stride >= width * kModeBpp[mode]);
     ok &= (buf->rgba != NULL);
+    if (WebPIs16bMode(mode)) {   // the samples are accessed as uint16_t
+      ok &= !(((uintptr_t)buf->rgba | (uintptr_t)stride) & 1);
+    }
   }
   return ok ? VP8_STATUS_OK : VP8_STATUS_INVALID_PARAM;
 }
@@ -150,6 +154,18 @@ static VP8StatusCode AllocateBuffer(WebPDecBuffer* const buffer) {
   return CheckDecBuffer(buffer);
 }
 
+uint64_t WebPGetDecBufferSize(int width, int height,
+                              WEBP_CSP_MODE colorspace) {
+  uint64_t size;
+  if (width <= 0 || height <= 0 || !IsValidColorspace(colorspace)) return 0;
+  size = (uint64_t)width * kModeBpp[colorspace] * height;
+  if (!WebPIsRGBMode(colorspace)) {
+    size += 2 * (uint64_t)((width + 1) / 2) * ((height + 1) / 2);
+    if (colorspace == MODE_YUVA) size += (uint64_t)width * height;
+  }
+  return size;
+}
+
 VP8StatusCode WebPFlipBuffer(WebPDecBuffer* const buffer) {
   if (buffer == NULL) {
     return VP8_STATUS_INVALID_PARAM;
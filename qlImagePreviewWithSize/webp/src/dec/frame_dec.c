@@ -200,7 +200,13 @@ static void ReconstructRow(const VP8Decoder* const dec,
 //                 U/V, so it's 8 samples total (because of the 2x upsampling).
 static const uint8_t kFilterExtraRows[3] = { 0, 2, 8 };
 
-static void DoFilter(const VP8Decoder* const dec, int mb_x, int mb_y) {
+// Planes filtered by DoFilter(). With the complex filter, the luma and chroma
+// samples are independent, so they can be filtered by different threads.
+#define FILTER_LUMA   1
+#define FILTER_CHROMA 2
+
+static void DoFilter(const VP8Decoder* const dec, int mb_x, int mb_y,
+                     int planes) {
   const VP8ThreadContext* const ctx = &dec->thread_ctx_;
   const int cache_id = ctx->id_;
   const int y_bps = dec->cache_y_stride_;
@@ -213,6 +219,7 @@ static void DoFilter(const VP8Decoder* const dec, int mb_x, int mb_y) {
   }
   assert(limit >= 3);
   if (dec->filter_type_ == 1) {   // simple
+    assert(planes == FILTER_LUMA);
     if (mb_x > 0) {
       VP8SimpleHFilter16(y_dst, y_bps, limit + 4);
     }
@@ -226,39 +233,77 @@ static void DoFilter(const VP8Decoder* const dec, int mb_x, int mb_y) {
       VP8SimpleVFilter16i(y_dst, y_bps, limit);
     }
   } else {    // complex
-    const int uv_bps = dec->cache_uv_stride_;
-    uint8_t* const u_dst = dec->cache_u_ + cache_id * 8 * uv_bps + mb_x * 8;
-    uint8_t* const v_dst = dec->cache_v_ + cache_id * 8 * uv_bps + mb_x * 8;
     const int hev_thresh = f_info->hev_thresh_;
-    if (mb_x > 0) {
-      VP8HFilter16(y_dst, y_bps, limit + 4, ilevel, hev_thresh);
-      VP8HFilter8(u_dst, v_dst, uv_bps, limit + 4, ilevel, hev_thresh);
-    }
-    if (f_info->f_inner_) {
-      VP8HFilter16i(y_dst, y_bps, limit, ilevel, hev_thresh);
-      VP8HFilter8i(u_dst, v_dst, uv_bps, limit, ilevel, hev_thresh);
-    }
-    if (mb_y > 0) {
-      VP8VFilter16(y_dst, y_bps, limit + 4, ilevel, hev_thresh);
-      VP8VFilter8(u_dst, v_dst, uv_bps, limit + 4, ilevel, hev_thresh);
+    if (planes & FILTER_LUMA) {
+      if (mb_x > 0) {
+        VP8HFilter16(y_dst, y_bps, limit + 4, ilevel, hev_thresh);
+      }
+      if (f_info->f_inner_) {
+        VP8HFilter16i(y_dst, y_bps, limit, ilevel, hev_thresh);
+      }
+      if (mb_y > 0) {
+        VP8VFilter16(y_dst, y_bps, limit + 4, ilevel, hev_thresh);
+      }
+      if (f_info->f_inner_) {
+        VP8VFilter16i(y_dst, y_bps, limit, ilevel, hev_thresh);
+      }
     }
-    if (f_info->f_inner_) {
-      VP8VFilter16i(y_dst, y_bps, limit, ilevel, hev_thresh);
-      VP8VFilter8i(u_dst, v_dst, uv_bps, limit, ilevel, hev_thresh);
+    if (planes & FILTER_CHROMA) {
+      const int uv_bps = dec->cache_uv_stride_;
+      uint8_t* const u_dst = dec->cache_u_ + cache_id * 8 * uv_bps + mb_x * 8;
+      uint8_t* const v_dst = dec->cache_v_ + cache_id * 8 * uv_bps + mb_x * 8;
+      if (mb_x > 0) {
+        VP8HFilter8(u_dst, v_dst, uv_bps, limit + 4, ilevel, hev_thresh);
+      }
+      if (f_info->f_inner_) {
+        VP8HFilter8i(u_dst, v_dst, uv_bps, limit, ilevel, hev_thresh);
+      }
+      if (mb_y > 0) {
+        VP8VFilter8(u_dst, v_dst, uv_bps, limit + 4, ilevel, hev_thresh);
+      }
+      if (f_info->f_inner_) {
+        VP8VFilter8i(u_dst, v_dst, uv_bps, limit, ilevel, hev_thresh);
+      }
     }
   }
 }
 
-// Filter the decoded macroblock row (if needed)
-static void FilterRow(const VP8Decoder* const dec) {
+// Filters the given planes of the decoded macroblock row.
+static void FilterPlanes(const VP8Decoder* const dec, int planes) {
   int mb_x;
   const int mb_y = dec->thread_ctx_.mb_y_;
-  assert(dec->thread_ctx_.filter_row_);
   for (mb_x = dec->tl_mb_x_; mb_x < dec->br_mb_x_; ++mb_x) {
-    DoFilter(dec, mb_x, mb_y);
+    DoFilter(dec, mb_x, mb_y, planes);
+  }
+}
+
+static int FilterChroma(void* arg1, void* arg2) {
+  (void)arg2;
+  FilterPlanes((const VP8Decoder*)arg1, FILTER_CHROMA);
+  return 1;
+}
+
+// Filter the decoded macroblock row (if needed)
+static void FilterRow(const VP8Decoder* const dec) {
+  assert(dec->thread_ctx_.filter_row_);
+  if (dec->filter_type_ == 2 && dec->filter_scheduler_ != NULL) {
+    // The chroma planes are filtered by the scheduler's thread, at the same
+    // time as the luma plane.
+    WebPTaskGroup group;
+    if (WebPTaskGroupInit(&group, dec->filter_scheduler_)) {
+      WebPTaskGroupRun(&group, FilterChroma, (void*)dec, NULL);
+      FilterPlanes(dec, FILTER_LUMA);
+      WebPTaskGroupWait(&group);
+      return;
+    }
   }
+  FilterPlanes(dec, (dec->filter_type_ == 2) ? FILTER_LUMA | FILTER_CHROMA
+                                             : FILTER_LUMA);
 }
 
+#undef FILTER_LUMA
+#undef FILTER_CHROMA
+
 //------------------------------------------------------------------------------
 // Precompute the filtering strength for each segment and each i4x4/i16x16 mode.
 
@@ -651,6 +696,11 @@ static int InitThreadContext(VP8Decoder* const dec) {
     worker->hook = FinishRow;
     dec->num_caches_ =
       (dec->filter_type_ > 0) ? MT_CACHE_LINES : MT_CACHE_LINES - 1;
+    // One more thread for the chroma part of the complex filter. Without it,
+    // the whole filtering is done by 'worker'.
+    if (dec->filter_type_ == 2 && dec->filter_scheduler_ == NULL) {
+      dec->filter_scheduler_ = WebPTaskSchedulerNew(1);
+    }
   } else {
     dec->num_caches_ = ST_CACHE_LINES;
   }
@@ -673,12 +723,44 @@ int VP8GetThreadMethod(const WebPDecoderOptions* const options,
   return 0;
 }
 
-#undef MT_CACHE_LINES
-#undef ST_CACHE_LINES
-
 //------------------------------------------------------------------------------
 // Memory setup
 
+// Returns the size of the memory chunk holding all the decoding buffers.
+static uint64_t GetMemorySize(const VP8Decoder* const dec, int num_caches,
+                              int filter_type, int mt_method) {
+  const int mb_w = dec->mb_w_;
+  const size_t intra_pred_mode_size = 4 * mb_w * sizeof(uint8_t);
+  const size_t top_size = sizeof(VP8TopSamples) * mb_w;
+  const size_t mb_info_size = (mb_w + 1) * sizeof(VP8MB);
+  const size_t f_info_size =
+      (filter_type > 0) ? mb_w * (mt_method > 0 ? 2 : 1) * sizeof(VP8FInfo)
+                        : 0;
+  const size_t yuv_size = YUV_SIZE * sizeof(*dec->yuv_b_);
+  const size_t mb_data_size =
+      (mt_method == 2 ? 2 : 1) * mb_w * sizeof(*dec->mb_data_);
+  const size_t cache_height =
+      (16 * num_caches + kFilterExtraRows[filter_type]) * 3 / 2;
+  const size_t cache_size = top_size * cache_height;
+  // alpha_size is the only one that scales as width x height.
+  const uint64_t alpha_size = (dec->alpha_data_ != NULL) ?
+      (uint64_t)dec->pic_hdr_.width_ * dec->pic_hdr_.height_ : 0ULL;
+  return (uint64_t)intra_pred_mode_size
+       + top_size + mb_info_size + f_info_size
+       + yuv_size + mb_data_size
+       + cache_size + alpha_size + WEBP_ALIGN_CST;
+}
+
+uint64_t VP8GetMemorySize(const VP8Decoder* const dec, int mt_method) {
+  // The filter type is only known in VP8EnterCritical(): assume the complex
+  // filter, which needs the most extra rows.
+  return GetMemorySize(dec, (mt_method > 0) ? MT_CACHE_LINES : ST_CACHE_LINES,
+                       2, mt_method);
+}
+
+#undef MT_CACHE_LINES
+#undef ST_CACHE_LINES
+
 static int AllocateMemory(VP8Decoder* const dec) {
   const int num_caches = dec->num_caches_;
   const int mb_w = dec->mb_w_;
@@ -693,28 +775,24 @@ static int AllocateMemory(VP8Decoder* const dec) {
   const size_t yuv_size = YUV_SIZE * sizeof(*dec->yuv_b_);
   const size_t mb_data_size =
       (dec->mt_method_ == 2 ? 2 : 1) * mb_w * sizeof(*dec->mb_data_);
-  const size_t cache_height = (16 * num_caches
-                            + kFilterExtraRows[dec->filter_type_]) * 3 / 2;
-  const size_t cache_size = top_size * cache_height;
-  // alpha_size is the only one that scales as width x height.
+  const size_t cache_size = top_size * ((16 * num_caches
+                          + kFilterExtraRows[dec->filter_type_]) * 3 / 2);
   const uint64_t alpha_size = (dec->alpha_data_ != NULL) ?
       (uint64_t)dec->pic_hdr_.width_ * dec->pic_hdr_.height_ : 0ULL;
-  const uint64_t needed = (uint64_t)intra_pred_mode_size
-                        + top_size + mb_info_size + f_info_size
-                        + yuv_size + mb_data_size
-                        + cache_size + alpha_size + WEBP_ALIGN_CST;
+  const uint64_t needed =
+      GetMemorySize(dec, num_caches, dec->filter_type_, dec->mt_method_);
   uint8_t* mem;
 
   if (needed != (size_t)needed) return 0;  // check for overflow
   if (needed > dec->mem_size_) {
-    WebPSafeFree(dec->mem_);
+    WebPAllocatorFree(dec->allocator_, dec->mem_);
     dec->mem_size_ = 0;
-    dec->mem_ = WebPSafeMalloc(needed, sizeof(uint8_t));
+    dec->mem_ = WebPAllocatorMalloc(dec->allocator_, needed, sizeof(uint8_t));
     if (dec->mem_ == NULL) {
       return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
                          "no memory during frame initialization.");
     }
-    // down-cast is ok, thanks to WebPSafeMalloc() above.
+    // down-cast is ok, thanks to WebPAllocatorMalloc() above.
     dec->mem_size_ = (size_t)needed;
   }
 
@@ -19,6 +19,8 @@
 #include "src/dec/webpi_dec.h"
 #include "src/dec/vp8i_dec.h"
 #include "src/utils/utils.h"
+#include "src/webp/format_constants.h"
+#include "src/webp/mux_types.h"  // ANIMATION_FLAG
 
 // In append mode, buffer allocations increase as multiples of this value.
 // Needs to be a power of 2.
@@ -47,16 +49,21 @@ typedef enum {
 typedef enum {
   MEM_MODE_NONE = 0,
   MEM_MODE_APPEND,
-  MEM_MODE_MAP
+  MEM_MODE_MAP,
+  MEM_MODE_SEGMENTS
 } MemBufferMode;
 
 // storage for partition #0 and partial data (in a rolling fashion)
+// In segments mode, start_ and end_ are positions in input_, and buf_ only
+// holds a copy of the first buf_size_ bytes of the input, if they straddle
+// several segments.
 typedef struct {
   MemBufferMode mode_;  // Operation mode
   size_t start_;        // start location of the data to be decoded
   size_t end_;          // end location
   size_t buf_size_;     // size of the allocated buffer
   uint8_t* buf_;        // We don't own this buffer in case WebPIUpdate()
+  VP8SegmentedInput input_;   // caller's buffers, in segments mode
 
   size_t part0_size_;         // size of partition #0
   const uint8_t* part0_buf_;  // buffer to store partition #0
@@ -76,6 +83,11 @@ struct WebPIDecoder {
   size_t chunk_size_;      // Compressed VP8/VP8L size extracted from Header.
 
   int last_mb_y_;          // last row reached for intra-mode decoding
+
+  // Decoding is not attempted again before MemDataSize() reaches this value,
+  // which avoids decoding the same data over and over when it trickles in.
+  size_t resume_size_;
+  size_t token_size_;      // bytes of the single token partition read so far
 };
 
 // MB context to restore in case VP8DecodeMB() fails
@@ -203,6 +215,54 @@ static int AppendToMemBuffer(WebPIDecoder* const idec,
   return 1;
 }
 
+// Adds a caller's buffer at the end of the input, without copying it.
+static int AppendSegment(WebPIDecoder* const idec,
+                         const uint8_t* const data, size_t data_size) {
+  MemBuffer* const mem = &idec->mem_;
+  assert(mem->mode_ == MEM_MODE_SEGMENTS);
+  if (data_size > MAX_CHUNK_PAYLOAD - mem->end_) {
+    // same safeguard as in AppendToMemBuffer(), for the whole input.
+    return 0;
+  }
+  if (!VP8SegmentedInputAppend(&mem->input_, data, data_size)) return 0;
+  mem->end_ += data_size;
+  assert(mem->end_ == mem->input_.size_);
+  return 1;
+}
+
+// Returns the first 'size' bytes of the input as one buffer, copying them
+// only when they straddle several segments. Returns NULL in case of memory
+// error.
+static const uint8_t* GetInputStart(MemBuffer* const mem, size_t size) {
+  const VP8InputSegment* const first = &mem->input_.segments_[0];
+  assert(mem->mode_ == MEM_MODE_SEGMENTS);
+  assert(size > 0 && size <= mem->end_);
+  if (size <= first->size_) return first->buf_;
+  if (size > mem->buf_size_) {
+    uint8_t* const new_buf = (uint8_t*)WebPSafeMalloc(1ULL, size);
+    if (new_buf == NULL) return NULL;
+    if (mem->buf_ != NULL) memcpy(new_buf, mem->buf_, mem->buf_size_);
+    VP8SegmentedInputCopy(&mem->input_, mem->buf_size_,
+                          new_buf + mem->buf_size_, size - mem->buf_size_);
+    WebPSafeFree(mem->buf_);
+    mem->buf_ = new_buf;
+    mem->buf_size_ = size;
+  }
+  return mem->buf_;
+}
+
+// Returns the position of the next bytes to be read by 'br', a reader of the
+// data of 'mem'.
+static size_t GetReaderPosition(const MemBuffer* const mem,
+                                const VP8BitReader* const br) {
+  if (mem->mode_ == MEM_MODE_SEGMENTS) {
+    const VP8InputSegment* const segment =
+        &br->input_->segments_[br->segment_];
+    return (size_t)(segment->offset_ + (br->buf_ - segment->buf_));
+  }
+  return (size_t)(br->buf_ - mem->buf_);
+}
+
 static int RemapMemBuffer(WebPIDecoder* const idec,
                           const uint8_t* const data, size_t data_size) {
   MemBuffer* const mem = &idec->mem_;
@@ -227,6 +287,7 @@ static void InitMemBuffer(MemBuffer* const mem) {
   mem->buf_size_   = 0;
   mem->part0_buf_  = NULL;
   mem->part0_size_ = 0;
+  VP8InitSegmentedInput(&mem->input_);
 }
 
 static void ClearMemBuffer(MemBuffer* const mem) {
@@ -234,6 +295,9 @@ static void ClearMemBuffer(MemBuffer* const mem) {
   if (mem->mode_ == MEM_MODE_APPEND) {
     WebPSafeFree(mem->buf_);
     WebPSafeFree((void*)mem->part0_buf_);
+  } else if (mem->mode_ == MEM_MODE_SEGMENTS) {
+    WebPSafeFree(mem->buf_);
+    VP8ClearSegmentedInput(&mem->input_);
   }
 }
 
@@ -300,8 +364,13 @@ static void ChangeState(WebPIDecoder* const idec, DecState new_state,
   idec->state_ = new_state;
   mem->start_ += consumed_bytes;
   assert(mem->start_ <= mem->end_);
-  idec->io_.data = mem->buf_ + mem->start_;
-  idec->io_.data_size = MemDataSize(mem);
+  if (mem->mode_ == MEM_MODE_SEGMENTS) {
+    idec->io_.input = &mem->input_;
+    idec->io_.input_offset = mem->start_;
+  } else {
+    idec->io_.data = mem->buf_ + mem->start_;
+    idec->io_.data_size = MemDataSize(mem);
+  }
 }
 
 // Headers
@@ -309,13 +378,33 @@ static VP8StatusCode DecodeWebPHeaders(WebPIDecoder* const idec) {
   MemBuffer* const mem = &idec->mem_;
   const uint8_t* data = mem->buf_ + mem->start_;
   size_t curr_size = MemDataSize(mem);
+  size_t size = curr_size;
   VP8StatusCode status;
   WebPHeaderStructure headers;
 
-  headers.data = data;
-  headers.data_size = curr_size;
-  headers.have_all_data = 0;
-  status = WebPParseHeaders(&headers);
+  if (mem->mode_ == MEM_MODE_SEGMENTS) {
+    // If the headers straddle several segments, they are parsed from copies
+    // of a growing part of the input, so as to copy about their size only.
+    const size_t first_size = mem->input_.segments_[0].size_;
+    assert(mem->start_ == 0);
+    if (size > first_size) {
+      size = (first_size > mem->buf_size_) ? first_size : mem->buf_size_;
+      if (size < CHUNK_SIZE) size = CHUNK_SIZE;
+      if (size > curr_size) size = curr_size;
+    }
+  }
+  while (1) {
+    if (mem->mode_ == MEM_MODE_SEGMENTS) {
+      data = GetInputStart(mem, size);
+      if (data == NULL) return VP8_STATUS_OUT_OF_MEMORY;
+    }
+    headers.data = data;
+    headers.data_size = size;
+    headers.have_all_data = 0;
+    status = WebPParseHeaders(&headers);
+    if (status != VP8_STATUS_NOT_ENOUGH_DATA || size == curr_size) break;
+    size = (size < curr_size - size) ? 2 * size : curr_size;
+  }
   if (status == VP8_STATUS_NOT_ENOUGH_DATA) {
     return VP8_STATUS_SUSPENDED;  // We haven't found a VP8 chunk yet.
   } else if (status != VP8_STATUS_OK) {
@@ -345,8 +434,9 @@ static VP8StatusCode DecodeWebPHeaders(WebPIDecoder* const idec) {
 }
 
 static VP8StatusCode DecodeVP8FrameHeader(WebPIDecoder* const idec) {
+  uint8_t header[VP8_FRAME_HEADER_SIZE];
   const uint8_t* data = idec->mem_.buf_ + idec->mem_.start_;
-  const size_t curr_size = MemDataSize(&idec->mem_);
+  size_t curr_size = MemDataSize(&idec->mem_);
   int width, height;
   uint32_t bits;
 
@@ -354,6 +444,12 @@ static VP8StatusCode DecodeVP8FrameHeader(WebPIDecoder* const idec) {
     // Not enough data bytes to extract VP8 Frame Header.
     return VP8_STATUS_SUSPENDED;
   }
+  if (idec->mem_.mode_ == MEM_MODE_SEGMENTS) {
+    VP8SegmentedInputCopy(&idec->mem_.input_, idec->mem_.start_,
+                          header, sizeof(header));
+    data = header;
+    curr_size = sizeof(header);
+  }
   if (!VP8GetInfo(data, curr_size, idec->chunk_size_, &width, &height)) {
     return IDecError(idec, VP8_STATUS_BITSTREAM_ERROR);
   }
@@ -361,8 +457,10 @@ static VP8StatusCode DecodeVP8FrameHeader(WebPIDecoder* const idec) {
   bits = data[0] | (data[1] << 8) | (data[2] << 16);
   idec->mem_.part0_size_ = (bits >> 5) + VP8_FRAME_HEADER_SIZE;
 
-  idec->io_.data = data;
-  idec->io_.data_size = curr_size;
+  if (idec->mem_.mode_ != MEM_MODE_SEGMENTS) {
+    idec->io_.data = data;
+    idec->io_.data_size = curr_size;
+  }
   idec->state_ = STATE_VP8_PARTS0;
   return VP8_STATUS_OK;
 }
@@ -377,6 +475,14 @@ static VP8StatusCode CopyParts0Data(WebPIDecoder* const idec) {
   assert(mem->part0_buf_ == NULL);
   // the following is a format limitation, no need for runtime check:
   assert(part_size <= mem->part0_size_);
+  if (mem->mode_ == MEM_MODE_SEGMENTS) {
+    // Partition #0 is read in place: only skip it.
+    if (dec->frm_hdr_.partition_length_ == 0) {
+      return VP8_STATUS_BITSTREAM_ERROR;
+    }
+    mem->start_ = GetReaderPosition(mem, &dec->parts_[0]);
+    return VP8_STATUS_OK;
+  }
   if (part_size == 0) {   // can't have zero-size partition #0
     return VP8_STATUS_BITSTREAM_ERROR;
   }
@@ -438,6 +544,11 @@ static VP8StatusCode DecodePartition0(WebPIDecoder* const idec) {
     return IDecError(idec, dec->status_);
   }
 
+  if (dec->num_parts_minus_one_ == 0) {
+    // Only the token partition is needed from now on.
+    idec->mem_.start_ = GetReaderPosition(&idec->mem_, &dec->parts_[0]);
+  }
+
   // Note: past this point, teardown() must always be called
   // in case of error.
   idec->state_ = STATE_VP8_DATA;
@@ -448,6 +559,34 @@ static VP8StatusCode DecodePartition0(WebPIDecoder* const idec) {
   return VP8_STATUS_OK;
 }
 
+// Returns the data size to wait for before decoding the current macroblock
+// row again, from the average size of the macroblocks decoded so far. Only
+// used with a single token partition.
+static size_t GetResumeSize(const WebPIDecoder* const idec,
+                            const VP8Decoder* const dec) {
+  const size_t data_size = MemDataSize(&idec->mem_);
+  const uint64_t num_mbs = (uint64_t)dec->mb_y_ * dec->mb_w_ + dec->mb_x_;
+  // Size of the token partition, minus the bytes the bit reader may have
+  // loaded in advance.
+  const uint64_t part_size =
+      idec->chunk_size_ - idec->mem_.part0_size_ - sizeof(bit_t);
+  uint64_t resume_size = data_size + 1;
+  if (idec->chunk_size_ < idec->mem_.part0_size_ + sizeof(bit_t) ||
+      part_size <= idec->token_size_) {
+    return 0;
+  }
+  if (num_mbs > 0) {
+    const uint64_t row_size =
+        idec->token_size_ * (dec->mb_w_ - dec->mb_x_) / num_mbs;
+    if (row_size > resume_size) resume_size = row_size;
+  }
+  // Never wait for more than the rest of the partition.
+  if (resume_size > part_size - idec->token_size_) {
+    resume_size = part_size - idec->token_size_;
+  }
+  return (size_t)resume_size;
+}
+
 // Remaining partitions
 static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
   VP8Decoder* const dec = (VP8Decoder*)idec->dec_;
@@ -457,6 +596,10 @@ static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
   if (!dec->ready_) {
     return IDecError(idec, VP8_STATUS_BITSTREAM_ERROR);
   }
+  if (MemDataSize(&idec->mem_) < idec->resume_size_) {
+    return VP8_STATUS_SUSPENDED;
+  }
+  idec->resume_size_ = 0;
   for (; dec->mb_y_ < dec->mb_h_; ++dec->mb_y_) {
     if (idec->last_mb_y_ != dec->mb_y_) {
       if (!VP8ParseIntraModeRow(&dec->br_, dec)) {
@@ -485,11 +628,16 @@ static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
           }
         }
         RestoreContext(&context, dec, token_br);
+        if (dec->num_parts_minus_one_ == 0) {
+          idec->resume_size_ = GetResumeSize(idec, dec);
+        }
         return VP8_STATUS_SUSPENDED;
       }
       // Release buffer only if there is only one partition
       if (dec->num_parts_minus_one_ == 0) {
-        idec->mem_.start_ = token_br->buf_ - idec->mem_.buf_;
+        const size_t pos = GetReaderPosition(&idec->mem_, token_br);
+        idec->token_size_ += pos - idec->mem_.start_;
+        idec->mem_.start_ = pos;
         assert(idec->mem_.start_ <= idec->mem_.end_);
       }
     }
@@ -526,7 +674,7 @@ static VP8StatusCode DecodeVP8LHeader(WebPIDecoder* const idec) {
   assert(idec->is_lossless_);
 
   // Wait until there's enough data for decoding header.
-  if (curr_size < (idec->chunk_size_ >> 3)) {
+  if (curr_size < (idec->chunk_size_ >> 3) || curr_size < idec->resume_size_) {
     dec->status_ = VP8_STATUS_SUSPENDED;
     return ErrorStatusLossless(idec, dec->status_);
   }
@@ -536,8 +684,18 @@ static VP8StatusCode DecodeVP8LHeader(WebPIDecoder* const idec) {
         curr_size < idec->chunk_size_) {
       dec->status_ = VP8_STATUS_SUSPENDED;
     }
+    if (dec->status_ == VP8_STATUS_SUSPENDED ||
+        dec->status_ == VP8_STATUS_NOT_ENOUGH_DATA) {
+      // The headers are parsed again from the start: wait for a good amount
+      // of data, but not beyond the end of the chunk.
+      idec->resume_size_ = curr_size + curr_size / 2;
+      if (idec->resume_size_ > idec->chunk_size_) {
+        idec->resume_size_ = idec->chunk_size_;
+      }
+    }
     return ErrorStatusLossless(idec, dec->status_);
   }
+  idec->resume_size_ = 0;
   // Allocate/verify output buffer now.
   dec->status_ = WebPAllocateDecBuffer(io->width, io->height, params->options,
                                        output);
@@ -556,13 +714,21 @@ static VP8StatusCode DecodeVP8LData(WebPIDecoder* const idec) {
 
   // Switch to incremental decoding if we don't have all the bytes available.
   dec->incremental_ = (curr_size < idec->chunk_size_);
+  if (dec->incremental_ && curr_size < idec->resume_size_) {
+    return VP8_STATUS_SUSPENDED;
+  }
 
   if (!VP8LDecodeImage(dec)) {
     return ErrorStatusLossless(idec, dec->status_);
   }
   assert(dec->status_ == VP8_STATUS_OK || dec->status_ == VP8_STATUS_SUSPENDED);
-  return (dec->status_ == VP8_STATUS_SUSPENDED) ? dec->status_
-                                                : FinishDecoding(idec);
+  if (dec->status_ == VP8_STATUS_SUSPENDED) {
+    // Wait for as much new data as was decoded in vain, which bounds the
+    // total amount of data decoded again.
+    idec->resume_size_ = curr_size + dec->redo_size_;
+    return dec->status_;
+  }
+  return FinishDecoding(idec);
 }
 
   // Main decoding loop
@@ -664,6 +830,7 @@ WebPIDecoder* WebPIDecode(const uint8_t* data, size_t data_size,
   // Finish initialization
   if (config != NULL) {
     idec->params_.options = &config->options;
+    idec->io_.allocator = config->options.allocator;
   }
   return idec;
 }
@@ -694,7 +861,7 @@ WebPIDecoder* WebPINewRGB(WEBP_CSP_MODE csp, uint8_t* output_buffer,
   const int is_external_memory = (output_buffer != NULL) ? 1 : 0;
   WebPIDecoder* idec;
 
-  if (csp >= MODE_YUV) return NULL;
+  if (!WebPIsRGBMode(csp)) return NULL;
   if (is_external_memory == 0) {    // Overwrite parameters to sane values.
     output_buffer_size = 0;
     output_stride = 0;
@@ -820,6 +987,28 @@ VP8StatusCode WebPIUpdate(WebPIDecoder* idec,
   return IDecode(idec);
 }
 
+VP8StatusCode WebPIAppendSegment(WebPIDecoder* idec,
+                                 const uint8_t* data, size_t data_size) {
+  VP8StatusCode status;
+  if (idec == NULL || data == NULL) {
+    return VP8_STATUS_INVALID_PARAM;
+  }
+  status = IDecCheckStatus(idec);
+  if (status != VP8_STATUS_SUSPENDED) {
+    return status;
+  }
+  if (!CheckMemBufferMode(&idec->mem_, MEM_MODE_SEGMENTS)) {
+    return VP8_STATUS_INVALID_PARAM;
+  }
+  if (!AppendSegment(idec, data, data_size)) {
+    return VP8_STATUS_OUT_OF_MEMORY;
+  }
+  if (idec->mem_.end_ == 0) {
+    return VP8_STATUS_SUSPENDED;   // nothing to decode yet
+  }
+  return IDecode(idec);
+}
+
 //------------------------------------------------------------------------------
 
 static const WebPDecBuffer* GetOutputBuffer(const WebPIDecoder* const idec) {
@@ -855,7 +1044,7 @@ uint8_t* WebPIDecGetRGB(const WebPIDecoder* idec, int* last_y,
                         int* width, int* height, int* stride) {
   const WebPDecBuffer* const src = GetOutputBuffer(idec);
   if (src == NULL) return NULL;
-  if (src->colorspace >= MODE_YUV) {
+  if (!WebPIsRGBMode(src->colorspace)) {
     return NULL;
   }
 
@@ -873,7 +1062,7 @@ uint8_t* WebPIDecGetYUVA(const WebPIDecoder* idec, int* last_y,
                          int* stride, int* uv_stride, int* a_stride) {
   const WebPDecBuffer* const src = GetOutputBuffer(idec);
   if (src == NULL) return NULL;
-  if (src->colorspace < MODE_YUV) {
+  if (WebPIsRGBMode(src->colorspace)) {
     return NULL;
   }
 
@@ -906,3 +1095,241 @@ int WebPISetIOHooks(WebPIDecoder* const idec,
 
   return 1;
 }
+
+//------------------------------------------------------------------------------
+// Pull-based decoding, on top of the incremental decoder
+
+#define PULL_READ_SIZE (1 << 16)   // size of the ranges asked for image data
+
+typedef enum {
+  PULL_FILE_HEADER,   // RIFF header and first chunk (possibly VP8X)
+  PULL_CHUNK_HEADER,  // chunk headers, when looking for an animation frame
+  PULL_DATA,          // data given to the incremental decoder
+  PULL_DONE,
+  PULL_ERROR
+} PullState;
+
+struct WebPPullDecoder {
+  PullState state_;
+  VP8StatusCode status_;    // status of the error, in PULL_ERROR state
+  WebPIDecoder* idec_;
+  int frame_num_;           // frame to decode, for animations
+  int num_frames_;          // number of frames found so far
+  uint64_t pos_;            // position of header_[0], or of the next data
+  uint64_t end_;            // end of the RIFF, or of the data to decode
+  uint64_t file_size_;      // known once the end of the file was reached
+  size_t header_size_;      // number of bytes in header_
+  uint8_t header_[RIFF_HEADER_SIZE + CHUNK_HEADER_SIZE + VP8X_CHUNK_SIZE];
+};
+
+static VP8StatusCode PullError(WebPPullDecoder* const dec,
+                               VP8StatusCode status) {
+  dec->state_ = PULL_ERROR;
+  dec->status_ = status;
+  return status;
+}
+
+static VP8StatusCode NeedBytes(uint64_t offset, uint64_t size,
+                               WebPByteRange* const need) {
+  need->offset = offset;
+  need->size = (size_t)size;
+  return VP8_STATUS_SUSPENDED;
+}
+
+// Gives the next 'size' bytes of data to the incremental decoder.
+static void PullAppend(WebPPullDecoder* const dec,
+                       const uint8_t* const data, size_t size) {
+  VP8StatusCode status = VP8_STATUS_SUSPENDED;
+  if (size > dec->end_ - dec->pos_) size = (size_t)(dec->end_ - dec->pos_);
+  // The incremental decoder can't be given an empty first buffer.
+  if (size > 0) status = WebPIAppend(dec->idec_, data, size);
+  dec->pos_ += size;
+  if (status == VP8_STATUS_OK) {
+    dec->state_ = PULL_DONE;
+  } else if (status != VP8_STATUS_SUSPENDED) {
+    PullError(dec, status);
+  } else if (dec->pos_ >= dec->end_) {
+    PullError(dec, VP8_STATUS_NOT_ENOUGH_DATA);   // truncated bitstream
+  }
+}
+
+// Decides how to decode the file from its first bytes.
+static void ParseFileHeader(WebPPullDecoder* const dec) {
+  const uint8_t* const buf = dec->header_;
+  const size_t size = dec->header_size_;
+  const int is_riff = (size >= RIFF_HEADER_SIZE) && !memcmp(buf, "RIFF", 4) &&
+                      !memcmp(buf + CHUNK_HEADER_SIZE, "WEBP", 4);
+  const int is_animation =
+      is_riff && (size == sizeof(dec->header_)) &&
+      !memcmp(buf + RIFF_HEADER_SIZE, "VP8X", 4) &&
+      (GetLE32(buf + RIFF_HEADER_SIZE + CHUNK_HEADER_SIZE) & ANIMATION_FLAG);
+  dec->pos_ = 0;
+  dec->end_ = is_riff ? (uint64_t)GetLE32(buf + TAG_SIZE) + CHUNK_HEADER_SIZE
+                      : ~(uint64_t)0;
+  if (!is_animation) {
+    // The whole file is given to the incremental decoder.
+    if (dec->frame_num_ > 1) {
+      // Not an animation, unless the file is too short to tell.
+      PullError(dec, (size < sizeof(dec->header_)) ? VP8_STATUS_NOT_ENOUGH_DATA
+                                                   : VP8_STATUS_INVALID_PARAM);
+      return;
+    }
+    dec->state_ = PULL_DATA;
+    PullAppend(dec, buf, size);
+  } else {
+    // Skip the RIFF header and walk the chunks.
+    dec->pos_ = RIFF_HEADER_SIZE;
+    dec->header_size_ = size - RIFF_HEADER_SIZE;
+    memmove(dec->header_, buf + RIFF_HEADER_SIZE, dec->header_size_);
+    dec->state_ = PULL_CHUNK_HEADER;
+  }
+}
+
+// Parses the chunk header in header_. Moves to the next chunk, or to the data
+// of the frame.
+static void ParseChunkHeader(WebPPullDecoder* const dec) {
+  const uint32_t size = GetLE32(dec->header_ + TAG_SIZE);
+  const uint64_t chunk_end = dec->pos_ + CHUNK_HEADER_SIZE + size;
+  if (size > MAX_CHUNK_PAYLOAD || chunk_end > dec->end_) {
+    PullError(dec, VP8_STATUS_BITSTREAM_ERROR);
+    return;
+  }
+  if (!memcmp(dec->header_, "ANMF", TAG_SIZE) &&
+      ++dec->num_frames_ == dec->frame_num_) {
+    if (size < ANMF_CHUNK_SIZE) {
+      PullError(dec, VP8_STATUS_BITSTREAM_ERROR);
+      return;
+    }
+    // The frame's chunks follow the ANMF fields.
+    dec->pos_ += CHUNK_HEADER_SIZE + ANMF_CHUNK_SIZE;
+    dec->end_ = chunk_end;
+    dec->state_ = PULL_DATA;
+  } else {
+    dec->pos_ = chunk_end + (size & 1);
+  }
+  dec->header_size_ = 0;
+}
+
+WebPPullDecoder* WebPPullDecoderNew(WebPDecoderConfig* config, int frame_num) {
+  WebPPullDecoder* dec;
+  if (config == NULL || frame_num < 0) return NULL;
+  dec = (WebPPullDecoder*)WebPSafeCalloc(1ULL, sizeof(*dec));
+  if (dec == NULL) return NULL;
+  dec->idec_ = WebPIDecode(NULL, 0, config);
+  if (dec->idec_ == NULL) {
+    WebPSafeFree(dec);
+    return NULL;
+  }
+  dec->state_ = PULL_FILE_HEADER;
+  dec->frame_num_ = (frame_num > 0) ? frame_num : 1;
+  dec->end_ = ~(uint64_t)0;
+  dec->file_size_ = ~(uint64_t)0;
+  return dec;
+}
+
+void WebPPullDecoderDelete(WebPPullDecoder* dec) {
+  if (dec == NULL) return;
+  WebPIDelete(dec->idec_);
+  WebPSafeFree(dec);
+}
+
+VP8StatusCode WebPPullDecoderStep(WebPPullDecoder* dec, WebPByteRange* need) {
+  if (dec == NULL || need == NULL) return VP8_STATUS_INVALID_PARAM;
+  while (1) {
+    if (dec->state_ == PULL_FILE_HEADER) {
+      // Gather enough bytes to find out whether it is an animation.
+      if (dec->header_size_ < sizeof(dec->header_) &&
+          dec->header_size_ < dec->file_size_) {
+        return NeedBytes(dec->header_size_,
+                         sizeof(dec->header_) - dec->header_size_, need);
+      }
+      ParseFileHeader(dec);
+    } else if (dec->state_ == PULL_CHUNK_HEADER) {
+      const uint64_t end = dec->pos_ + dec->header_size_;
+      if (dec->pos_ + CHUNK_HEADER_SIZE > dec->end_) {
+        return PullError(dec, VP8_STATUS_INVALID_PARAM);   // no such frame
+      }
+      // Only frames need the ANMF fields, but reading them along with the
+      // chunk header saves a request.
+      if (dec->header_size_ < CHUNK_HEADER_SIZE + ANMF_CHUNK_SIZE &&
+          end < dec->end_ && end < dec->file_size_) {
+        uint64_t size = CHUNK_HEADER_SIZE + ANMF_CHUNK_SIZE - dec->header_size_;
+        if (size > dec->end_ - end) size = dec->end_ - end;
+        return NeedBytes(end, size, need);
+      }
+      if (dec->header_size_ < CHUNK_HEADER_SIZE ||
+          (!memcmp(dec->header_, "ANMF", TAG_SIZE) &&
+           dec->header_size_ < CHUNK_HEADER_SIZE + ANMF_CHUNK_SIZE)) {
+        return PullError(dec, VP8_STATUS_NOT_ENOUGH_DATA);
+      }
+      ParseChunkHeader(dec);
+    } else if (dec->state_ == PULL_DATA) {
+      const uint64_t size = dec->end_ - dec->pos_;
+      if (dec->pos_ >= dec->file_size_) {
+        return PullError(dec, VP8_STATUS_NOT_ENOUGH_DATA);
+      }
+      return NeedBytes(dec->pos_, (size < PULL_READ_SIZE) ? size
+                                                          : PULL_READ_SIZE,
+                       need);
+    } else if (dec->state_ == PULL_DONE) {
+      return VP8_STATUS_OK;
+    } else {
+      return dec->status_;
+    }
+  }
+}
+
+VP8StatusCode WebPPullDecoderProvide(WebPPullDecoder* dec, uint64_t offset,
+                                     const uint8_t* data, size_t data_size) {
+  uint64_t expected;
+  if (dec == NULL || (data == NULL && data_size > 0)) {
+    return VP8_STATUS_INVALID_PARAM;
+  }
+  if (dec->state_ == PULL_FILE_HEADER || dec->state_ == PULL_CHUNK_HEADER) {
+    expected = dec->pos_ + dec->header_size_;
+  } else if (dec->state_ == PULL_DATA) {
+    expected = dec->pos_;
+  } else {
+    return VP8_STATUS_INVALID_PARAM;   // nothing was asked for
+  }
+  if (offset != expected) return VP8_STATUS_INVALID_PARAM;
+  if (data_size == 0) {
+    dec->file_size_ = offset;
+  } else if (dec->state_ == PULL_DATA) {
+    PullAppend(dec, data, data_size);
+  } else {
+    const size_t room = sizeof(dec->header_) - dec->header_size_;
+    if (data_size > room) data_size = room;
+    memcpy(dec->header_ + dec->header_size_, data, data_size);
+    dec->header_size_ += data_size;
+  }
+  return VP8_STATUS_OK;
+}
+
+VP8StatusCode WebPDecodeFromReader(WebPReadFunc read, void* user_data,
+                                   int frame_num, WebPDecoderConfig* config) {
+  WebPPullDecoder* dec;
+  uint8_t* buffer;
+  WebPByteRange need;
+  VP8StatusCode status;
+  if (read == NULL || config == NULL || frame_num < 0) {
+    return VP8_STATUS_INVALID_PARAM;
+  }
+  dec = WebPPullDecoderNew(config, frame_num);
+  buffer = (uint8_t*)WebPSafeMalloc(1ULL, PULL_READ_SIZE);
+  if (dec == NULL || buffer == NULL) {
+    status = VP8_STATUS_OUT_OF_MEMORY;
+  } else {
+    while ((status = WebPPullDecoderStep(dec, &need)) ==
+           VP8_STATUS_SUSPENDED) {
+      size_t size;
+      assert(need.size <= PULL_READ_SIZE);
+      size = read(user_data, need.offset, buffer, need.size);
+      if (size > need.size) size = need.size;
+      WebPPullDecoderProvide(dec, need.offset, buffer, size);
+    }
+  }
+  WebPSafeFree(buffer);
+  WebPPullDecoderDelete(dec);
+  return status;
+}
@@ -16,6 +16,7 @@
 #include "src/dec/vp8i_dec.h"
 #include "src/dec/webpi_dec.h"
 #include "src/dsp/dsp.h"
+#include "src/dsp/lossless.h"
 #include "src/dsp/yuv.h"
 #include "src/utils/utils.h"
 
@@ -43,15 +44,26 @@ static int EmitYUV(const VP8Io* const io, WebPDecParams* const p) {
   return io->mb_h;
 }
 
-// Point-sampling U/V sampler.
+// Point-sampling U/V sampler. For the premultiplied modes, the alpha values
+// are stored and multiplied in at the same time.
 static int EmitSampledRGB(const VP8Io* const io, WebPDecParams* const p) {
   WebPDecBuffer* const output = p->output;
   WebPRGBABuffer* const buf = &output->u.RGBA;
   uint8_t* const dst = buf->rgba + io->mb_y * buf->stride;
-  WebPSamplerProcessPlane(io->y, io->y_stride,
-                          io->u, io->v, io->uv_stride,
-                          dst, buf->stride, io->mb_w, io->mb_h,
-                          WebPSamplers[output->colorspace]);
+  const WebPSamplerAlphaRowFunc sample_alpha =
+      WebPPremultipliedSamplers[output->colorspace];
+  if (io->a != NULL && sample_alpha != NULL) {
+    WebPSamplerAlphaProcessPlane(io->y, io->y_stride,
+                                 io->u, io->v, io->uv_stride,
+                                 io->a, io->width,
+                                 dst, buf->stride, io->mb_w, io->mb_h,
+                                 sample_alpha);
+  } else {
+    WebPSamplerProcessPlane(io->y, io->y_stride,
+                            io->u, io->v, io->uv_stride,
+                            dst, buf->stride, io->mb_w, io->mb_h,
+                            WebPSamplers[output->colorspace]);
+  }
   return io->mb_h;
 }
 
@@ -59,14 +71,44 @@ static int EmitSampledRGB(const VP8Io* const io, WebPDecParams* const p) {
 // Fancy upsampling
 
 #ifdef FANCY_UPSAMPLING
+
+// Calls 'upsample_alpha' if there are alpha rows, 'upsample' otherwise.
+static void UpsampleLinePair(WebPUpsampleLinePairFunc upsample,
+                             WebPUpsampleAlphaLinePairFunc upsample_alpha,
+                             const uint8_t* top_y, const uint8_t* bottom_y,
+                             const uint8_t* top_u, const uint8_t* top_v,
+                             const uint8_t* cur_u, const uint8_t* cur_v,
+                             const uint8_t* top_a, const uint8_t* bottom_a,
+                             uint8_t* top_dst, uint8_t* bottom_dst, int len) {
+  if (top_a != NULL) {
+    upsample_alpha(top_y, bottom_y, top_u, top_v, cur_u, cur_v,
+                   top_a, bottom_a, top_dst, bottom_dst, len);
+  } else {
+    upsample(top_y, bottom_y, top_u, top_v, cur_u, cur_v,
+             top_dst, bottom_dst, len);
+  }
+}
+
+// Returns the alpha row above 'alpha', if any.
+static const uint8_t* PrevAlphaRow(const VP8Io* const io,
+                                   const uint8_t* const alpha) {
+  return (alpha != NULL) ? alpha - io->width : NULL;
+}
+
+// For the premultiplied modes, the alpha values are stored and multiplied in
+// at the same time. Like the u/v samples, the alpha row of the left-over line
+// from the previous call is still available, as the alpha plane persists.
 static int EmitFancyRGB(const VP8Io* const io, WebPDecParams* const p) {
   int num_lines_out = io->mb_h;   // a priori guess
   const WebPRGBABuffer* const buf = &p->output->u.RGBA;
   uint8_t* dst = buf->rgba + io->mb_y * buf->stride;
   WebPUpsampleLinePairFunc upsample = WebPUpsamplers[p->output->colorspace];
+  WebPUpsampleAlphaLinePairFunc upsample_alpha =
+      WebPPremultipliedUpsamplers[p->output->colorspace];
   const uint8_t* cur_y = io->y;
   const uint8_t* cur_u = io->u;
   const uint8_t* cur_v = io->v;
+  const uint8_t* cur_a = (upsample_alpha != NULL) ? io->a : NULL;
   const uint8_t* top_u = p->tmp_u;
   const uint8_t* top_v = p->tmp_v;
   int y = io->mb_y;
@@ -76,11 +118,13 @@ static int EmitFancyRGB(const VP8Io* const io, WebPDecParams* const p) {
 
   if (y == 0) {
     // First line is special cased. We mirror the u/v samples at boundary.
-    upsample(cur_y, NULL, cur_u, cur_v, cur_u, cur_v, dst, NULL, mb_w);
+    UpsampleLinePair(upsample, upsample_alpha, cur_y, NULL,
+                     cur_u, cur_v, cur_u, cur_v, cur_a, NULL, dst, NULL, mb_w);
   } else {
     // We can finish the left-over line from previous call.
-    upsample(p->tmp_y, cur_y, top_u, top_v, cur_u, cur_v,
-             dst - buf->stride, dst, mb_w);
+    UpsampleLinePair(upsample, upsample_alpha, p->tmp_y, cur_y,
+                     top_u, top_v, cur_u, cur_v, PrevAlphaRow(io, cur_a), cur_a,
+                     dst - buf->stride, dst, mb_w);
     ++num_lines_out;
   }
   // Loop over each output pairs of row.
@@ -91,12 +135,14 @@ static int EmitFancyRGB(const VP8Io* const io, WebPDecParams* const p) {
     cur_v += io->uv_stride;
     dst += 2 * buf->stride;
     cur_y += 2 * io->y_stride;
-    upsample(cur_y - io->y_stride, cur_y,
-             top_u, top_v, cur_u, cur_v,
-             dst - buf->stride, dst, mb_w);
+    if (cur_a != NULL) cur_a += 2 * io->width;
+    UpsampleLinePair(upsample, upsample_alpha, cur_y - io->y_stride, cur_y,
+                     top_u, top_v, cur_u, cur_v, PrevAlphaRow(io, cur_a), cur_a,
+                     dst - buf->stride, dst, mb_w);
   }
   // move to last row
   cur_y += io->y_stride;
+  if (cur_a != NULL) cur_a += io->width;
   if (io->crop_top + y_end < io->crop_bottom) {
     // Save the unfinished samples for next call (as we're not done yet).
     memcpy(p->tmp_y, cur_y, mb_w * sizeof(*p->tmp_y));
@@ -108,8 +154,9 @@ static int EmitFancyRGB(const VP8Io* const io, WebPDecParams* const p) {
   } else {
     // Process the very last row of even-sized picture
     if (!(y_end & 1)) {
-      upsample(cur_y, NULL, cur_u, cur_v, cur_u, cur_v,
-               dst + buf->stride, NULL, mb_w);
+      UpsampleLinePair(upsample, upsample_alpha, cur_y, NULL,
+                       cur_u, cur_v, cur_u, cur_v, cur_a, NULL,
+                       dst + buf->stride, NULL, mb_w);
     }
   }
   return num_lines_out;
@@ -189,14 +236,14 @@ static int EmitAlphaRGB(const VP8Io* const io, WebPDecParams* const p,
     const int start_y = GetAlphaSourceRow(io, &alpha, &num_rows);
     uint8_t* const base_rgba = buf->rgba + start_y * buf->stride;
     uint8_t* const dst = base_rgba + (alpha_first ? 0 : 3);
-    const int has_alpha = WebPDispatchAlpha(alpha, io->width, mb_w,
-                                            num_rows, dst, buf->stride);
     (void)expected_num_lines_out;
     assert(expected_num_lines_out == num_rows);
-    // has_alpha is true if there's non-trivial alpha to premultiply with.
-    if (has_alpha && WebPIsPremultipliedMode(colorspace)) {
-      WebPApplyAlphaMultiply(base_rgba, alpha_first,
-                             mb_w, num_rows, buf->stride);
+    if (WebPIsPremultipliedMode(colorspace)) {
+      // store alpha and premultiply in the same pass
+      WebPDispatchAlphaPremultiply(alpha, io->width, mb_w, num_rows,
+                                   base_rgba, buf->stride, alpha_first);
+    } else {
+      WebPDispatchAlpha(alpha, io->width, mb_w, num_rows, dst, buf->stride);
     }
   }
   return 0;
@@ -254,11 +301,48 @@ static int Rescale(const uint8_t* src, int src_stride,
   return num_lines_out;
 }
 
+// Luma rescaling job, run by 'scaler_worker' while the caller takes care of
+// the chroma planes.
+typedef struct {
+  WebPRescaler* scaler;
+  const uint8_t* src;
+  int src_stride;
+  int num_lines;
+  int import_only;   // if true, only WebPRescalerImportAhead() is called
+  int result;        // number of lines output, or imported if 'import_only'
+} RescalerJob;
+
+static int RescalerJobHook(void* arg1, void* arg2) {
+  RescalerJob* const job = (RescalerJob*)arg1;
+  (void)arg2;
+  job->result =
+      job->import_only ? WebPRescalerImportAhead(job->scaler, job->num_lines,
+                                                 job->src, job->src_stride)
+                       : Rescale(job->src, job->src_stride, job->num_lines,
+                                 job->scaler);
+  return 1;
+}
+
+// Runs 'job' on 'scaler_worker', or right away if it is not in use.
+static void LaunchRescalerJob(WebPDecParams* const p, RescalerJob* const job) {
+  if (p->scaler_mt) {
+    p->scaler_worker.data1 = job;
+    WebPGetWorkerInterface()->Launch(&p->scaler_worker);
+  } else {
+    RescalerJobHook(job, NULL);
+  }
+}
+
+static void SyncRescalerJob(WebPDecParams* const p) {
+  if (p->scaler_mt) {
+    (void)WebPGetWorkerInterface()->Sync(&p->scaler_worker);
+  }
+}
+
 static int EmitRescaledYUV(const VP8Io* const io, WebPDecParams* const p) {
   const int mb_h = io->mb_h;
   const int uv_mb_h = (mb_h + 1) >> 1;
-  WebPRescaler* const scaler = p->scaler_y;
-  int num_lines_out = 0;
+  RescalerJob job;
   if (WebPIsAlphaMode(p->output->colorspace) && io->a != NULL) {
     // Before rescaling, we premultiply the luma directly into the io->y
     // internal buffer. This is OK since these samples are not used for
@@ -267,10 +351,16 @@ static int EmitRescaledYUV(const VP8Io* const io, WebPDecParams* const p) {
     WebPMultRows((uint8_t*)io->y, io->y_stride,
                  io->a, io->width, io->mb_w, mb_h, 0);
   }
-  num_lines_out = Rescale(io->y, io->y_stride, mb_h, scaler);
+  job.scaler = p->scaler_y;
+  job.src = io->y;
+  job.src_stride = io->y_stride;
+  job.num_lines = mb_h;
+  job.import_only = 0;
+  LaunchRescalerJob(p, &job);
   Rescale(io->u, io->uv_stride, uv_mb_h, p->scaler_u);
   Rescale(io->v, io->uv_stride, uv_mb_h, p->scaler_v);
-  return num_lines_out;
+  SyncRescalerJob(p);
+  return job.result;
 }
 
 static int EmitRescaledAlphaYUV(const VP8Io* const io, WebPDecParams* const p,
@@ -303,46 +393,63 @@ static int InitYUVRescaler(const VP8Io* const io, WebPDecParams* const p) {
   const int uv_out_height = (out_height + 1) >> 1;
   const int uv_in_width  = (io->mb_w + 1) >> 1;
   const int uv_in_height = (io->mb_h + 1) >> 1;
-  const size_t work_size = 2 * out_width;   // scratch memory for luma rescaler
-  const size_t uv_work_size = 2 * uv_out_width;  // and for each u/v ones
+  const WebPRescalerFilter filter = (WebPRescalerFilter)io->scaling_filter;
+  // scratch memory for luma rescaler
+  const size_t work_size =
+      WebPRescalerFilterWorkSize(io->mb_w, io->mb_h, out_width, out_height,
+                                 1, filter);
+  // and for each u/v ones
+  const size_t uv_work_size =
+      WebPRescalerFilterWorkSize(uv_in_width, uv_in_height,
+                                 uv_out_width, uv_out_height, 1, filter);
+  // and for the linear-light samples of the luma one
+  const size_t linear_size =
+      io->linear_scaling ? WebPRescalerLinearWorkSize(io->mb_w, 1) : 0;
   size_t tmp_size, rescaler_size;
-  rescaler_t* work;
+  uint8_t* work;
   WebPRescaler* scalers;
   const int num_rescalers = has_alpha ? 4 : 3;
 
-  tmp_size = (work_size + 2 * uv_work_size) * sizeof(*work);
+  tmp_size = work_size + 2 * uv_work_size + linear_size;
   if (has_alpha) {
-    tmp_size += work_size * sizeof(*work);
+    tmp_size += work_size;
   }
   rescaler_size = num_rescalers * sizeof(*p->scaler_y) + WEBP_ALIGN_CST;
 
-  p->memory = WebPSafeMalloc(1ULL, tmp_size + rescaler_size);
+  p->memory = WebPAllocatorMalloc(io->allocator, 1ULL,
+                                  tmp_size + rescaler_size);
   if (p->memory == NULL) {
     return 0;   // memory error
   }
-  work = (rescaler_t*)p->memory;
+  work = (uint8_t*)p->memory;
 
-  scalers = (WebPRescaler*)WEBP_ALIGN((const uint8_t*)work + tmp_size);
+  scalers = (WebPRescaler*)WEBP_ALIGN(work + tmp_size);
   p->scaler_y = &scalers[0];
   p->scaler_u = &scalers[1];
   p->scaler_v = &scalers[2];
   p->scaler_a = has_alpha ? &scalers[3] : NULL;
 
-  WebPRescalerInit(p->scaler_y, io->mb_w, io->mb_h,
-                   buf->y, out_width, out_height, buf->y_stride, 1,
-                   work);
-  WebPRescalerInit(p->scaler_u, uv_in_width, uv_in_height,
-                   buf->u, uv_out_width, uv_out_height, buf->u_stride, 1,
-                   work + work_size);
-  WebPRescalerInit(p->scaler_v, uv_in_width, uv_in_height,
-                   buf->v, uv_out_width, uv_out_height, buf->v_stride, 1,
-                   work + work_size + uv_work_size);
+  WebPRescalerInitFilter(p->scaler_y, io->mb_w, io->mb_h,
+                         buf->y, out_width, out_height, buf->y_stride, 1,
+                         filter, work);
+  if (io->linear_scaling) {
+    // Only the luma is averaged in linear light: chroma and alpha are not
+    // gamma-encoded.
+    WebPRescalerInitLinear(p->scaler_y, WEBP_RESCALER_LUMA, -1,
+                           work + tmp_size - linear_size);
+  }
+  WebPRescalerInitFilter(p->scaler_u, uv_in_width, uv_in_height,
+                         buf->u, uv_out_width, uv_out_height, buf->u_stride, 1,
+                         filter, work + work_size);
+  WebPRescalerInitFilter(p->scaler_v, uv_in_width, uv_in_height,
+                         buf->v, uv_out_width, uv_out_height, buf->v_stride, 1,
+                         filter, work + work_size + uv_work_size);
   p->emit = EmitRescaledYUV;
 
   if (has_alpha) {
-    WebPRescalerInit(p->scaler_a, io->mb_w, io->mb_h,
-                     buf->a, out_width, out_height, buf->a_stride, 1,
-                     work + work_size + 2 * uv_work_size);
+    WebPRescalerInitFilter(p->scaler_a, io->mb_w, io->mb_h,
+                           buf->a, out_width, out_height, buf->a_stride, 1,
+                           filter, work + work_size + 2 * uv_work_size);
     p->emit_alpha = EmitRescaledAlphaYUV;
     WebPInitAlphaProcessing();
   }
@@ -380,22 +487,29 @@ static int EmitRescaledRGB(const VP8Io* const io, WebPDecParams* const p) {
   const int uv_mb_h = (mb_h + 1) >> 1;
   int j = 0, uv_j = 0;
   int num_lines_out = 0;
+  RescalerJob job;
+  job.scaler = p->scaler_y;
+  job.src_stride = io->y_stride;
+  job.import_only = 1;
+  // With the separable filters, the luma and chroma windows don't line up
+  // exactly: the rescalers may need to import a few rows ahead of the output.
   while (j < mb_h) {
-    const int y_lines_in =
-        WebPRescalerImport(p->scaler_y, mb_h - j,
-                           io->y + j * io->y_stride, io->y_stride);
-    j += y_lines_in;
-    if (WebPRescaleNeededLines(p->scaler_u, uv_mb_h - uv_j)) {
+    job.src = io->y + j * io->y_stride;
+    job.num_lines = mb_h - j;
+    LaunchRescalerJob(p, &job);
+    if (uv_j < uv_mb_h) {
       const int u_lines_in =
-          WebPRescalerImport(p->scaler_u, uv_mb_h - uv_j,
-                             io->u + uv_j * io->uv_stride, io->uv_stride);
+          WebPRescalerImportAhead(p->scaler_u, uv_mb_h - uv_j,
+                                  io->u + uv_j * io->uv_stride, io->uv_stride);
       const int v_lines_in =
-          WebPRescalerImport(p->scaler_v, uv_mb_h - uv_j,
-                             io->v + uv_j * io->uv_stride, io->uv_stride);
+          WebPRescalerImportAhead(p->scaler_v, uv_mb_h - uv_j,
+                                  io->v + uv_j * io->uv_stride, io->uv_stride);
       (void)v_lines_in;   // remove a gcc warning
       assert(u_lines_in == v_lines_in);
       uv_j += u_lines_in;
     }
+    SyncRescalerJob(p);
+    j += job.result;
     num_lines_out += ExportRGB(p, p->last_y + num_lines_out);
   }
   return num_lines_out;
@@ -407,24 +521,25 @@ static int ExportAlpha(WebPDecParams* const p, int y_pos, int max_lines_out) {
   const WEBP_CSP_MODE colorspace = p->output->colorspace;
   const int alpha_first =
       (colorspace == MODE_ARGB || colorspace == MODE_Argb);
-  uint8_t* dst = base_rgba + (alpha_first ? 0 : 3);
+  uint8_t* rgba = base_rgba;
   int num_lines_out = 0;
   const int is_premult_alpha = WebPIsPremultipliedMode(colorspace);
-  uint32_t non_opaque = 0;
   const int width = p->scaler_a->dst_width;
 
   while (WebPRescalerHasPendingOutput(p->scaler_a) &&
          num_lines_out < max_lines_out) {
     assert(y_pos + num_lines_out < p->output->height);
     WebPRescalerExportRow(p->scaler_a);
-    non_opaque |= WebPDispatchAlpha(p->scaler_a->dst, 0, width, 1, dst, 0);
-    dst += buf->stride;
+    if (is_premult_alpha) {
+      WebPDispatchAlphaPremultiply(p->scaler_a->dst, 0, width, 1,
+                                   rgba, 0, alpha_first);
+    } else {
+      WebPDispatchAlpha(p->scaler_a->dst, 0, width, 1,
+                        rgba + (alpha_first ? 0 : 3), 0);
+    }
+    rgba += buf->stride;
     ++num_lines_out;
   }
-  if (is_premult_alpha && non_opaque) {
-    WebPApplyAlphaMultiply(base_rgba, alpha_first,
-                           width, num_lines_out, buf->stride);
-  }
   return num_lines_out;
 }
 
@@ -485,51 +600,67 @@ static int InitRGBRescaler(const VP8Io* const io, WebPDecParams* const p) {
   const int out_height = io->scaled_height;
   const int uv_in_width  = (io->mb_w + 1) >> 1;
   const int uv_in_height = (io->mb_h + 1) >> 1;
-  const size_t work_size = 2 * out_width;   // scratch memory for one rescaler
-  rescaler_t* work;  // rescalers work area
+  const WebPRescalerFilter filter = (WebPRescalerFilter)io->scaling_filter;
+  // scratch memory for the luma (and alpha) rescaler
+  const size_t work_size =
+      WebPRescalerFilterWorkSize(io->mb_w, io->mb_h, out_width, out_height,
+                                 1, filter);
+  // and for each u/v ones
+  const size_t uv_work_size =
+      WebPRescalerFilterWorkSize(uv_in_width, uv_in_height,
+                                 out_width, out_height, 1, filter);
+  // and for the linear-light samples of the luma one
+  const size_t linear_size =
+      io->linear_scaling ? WebPRescalerLinearWorkSize(io->mb_w, 1) : 0;
+  uint8_t* work;  // rescalers work area
   uint8_t* tmp;   // tmp storage for scaled YUV444 samples before RGB conversion
   size_t tmp_size1, tmp_size2, total_size, rescaler_size;
   WebPRescaler* scalers;
   const int num_rescalers = has_alpha ? 4 : 3;
 
-  tmp_size1 = 3 * work_size;
+  tmp_size1 = work_size + 2 * uv_work_size + linear_size;
   tmp_size2 = 3 * out_width;
   if (has_alpha) {
     tmp_size1 += work_size;
     tmp_size2 += out_width;
   }
-  total_size = tmp_size1 * sizeof(*work) + tmp_size2 * sizeof(*tmp);
+  total_size = tmp_size1 + tmp_size2 * sizeof(*tmp);
   rescaler_size = num_rescalers * sizeof(*p->scaler_y) + WEBP_ALIGN_CST;
 
-  p->memory = WebPSafeMalloc(1ULL, total_size + rescaler_size);
+  p->memory = WebPAllocatorMalloc(io->allocator, 1ULL,
+                                  total_size + rescaler_size);
   if (p->memory == NULL) {
     return 0;   // memory error
   }
-  work = (rescaler_t*)p->memory;
-  tmp = (uint8_t*)(work + tmp_size1);
+  work = (uint8_t*)p->memory;
+  tmp = work + tmp_size1;
 
-  scalers = (WebPRescaler*)WEBP_ALIGN((const uint8_t*)work + total_size);
+  scalers = (WebPRescaler*)WEBP_ALIGN(work + total_size);
   p->scaler_y = &scalers[0];
   p->scaler_u = &scalers[1];
   p->scaler_v = &scalers[2];
   p->scaler_a = has_alpha ? &scalers[3] : NULL;
 
-  WebPRescalerInit(p->scaler_y, io->mb_w, io->mb_h,
-                   tmp + 0 * out_width, out_width, out_height, 0, 1,
-                   work + 0 * work_size);
-  WebPRescalerInit(p->scaler_u, uv_in_width, uv_in_height,
-                   tmp + 1 * out_width, out_width, out_height, 0, 1,
-                   work + 1 * work_size);
-  WebPRescalerInit(p->scaler_v, uv_in_width, uv_in_height,
-                   tmp + 2 * out_width, out_width, out_height, 0, 1,
-                   work + 2 * work_size);
+  WebPRescalerInitFilter(p->scaler_y, io->mb_w, io->mb_h,
+                         tmp + 0 * out_width, out_width, out_height, 0, 1,
+                         filter, work);
+  if (io->linear_scaling) {
+    WebPRescalerInitLinear(p->scaler_y, WEBP_RESCALER_LUMA, -1,
+                           work + tmp_size1 - linear_size);
+  }
+  WebPRescalerInitFilter(p->scaler_u, uv_in_width, uv_in_height,
+                         tmp + 1 * out_width, out_width, out_height, 0, 1,
+                         filter, work + work_size);
+  WebPRescalerInitFilter(p->scaler_v, uv_in_width, uv_in_height,
+                         tmp + 2 * out_width, out_width, out_height, 0, 1,
+                         filter, work + work_size + uv_work_size);
   p->emit = EmitRescaledRGB;
   WebPInitYUV444Converters();
 
   if (has_alpha) {
-    WebPRescalerInit(p->scaler_a, io->mb_w, io->mb_h,
-                     tmp + 3 * out_width, out_width, out_height, 0, 1,
-                     work + 3 * work_size);
+    WebPRescalerInitFilter(p->scaler_a, io->mb_w, io->mb_h,
+                           tmp + 3 * out_width, out_width, out_height, 0, 1,
+                           filter, work + work_size + 2 * uv_work_size);
     p->emit_alpha = EmitRescaledAlphaRGB;
     if (p->output->colorspace == MODE_RGBA_4444 ||
         p->output->colorspace == MODE_rgbA_4444) {
@@ -542,11 +673,117 @@ static int InitRGBRescaler(const VP8Io* const io, WebPDecParams* const p) {
   return 1;
 }
 
+//------------------------------------------------------------------------------
+// Half-size RGBA output
+
+// When the output is exactly half the (cropped) picture size, the generic
+// rescaler is not needed: the luma plane is box-filtered 2:1 and then matches
+// the U/V planes at their native resolution, for a plain YUV444 conversion.
+static int IsHalfScale(const VP8Io* const io, WEBP_CSP_MODE colorspace) {
+  return io->scaling_filter == WEBP_RESCALER_AREA && !io->linear_scaling &&
+         (io->scaled_width == (io->mb_w + 1) >> 1) &&
+         (io->scaled_height == (io->mb_h + 1) >> 1) &&
+         colorspace != MODE_RGBA_4444 && colorspace != MODE_rgbA_4444;
+}
+
+static int EmitHalfRGB(const VP8Io* const io, WebPDecParams* const p) {
+  const WebPYUV444Converter convert =
+      WebPYUV444Converters[p->output->colorspace];
+  const WebPRGBABuffer* const buf = &p->output->u.RGBA;
+  uint8_t* dst = buf->rgba + p->last_y * buf->stride;
+  const uint8_t* cur_y = io->y;
+  const uint8_t* cur_u = io->u;
+  const uint8_t* cur_v = io->v;
+  const int mb_w = io->mb_w;
+  const int mb_h = io->mb_h;
+  const int out_width = (mb_w + 1) >> 1;
+  int j;
+  for (j = 0; j < mb_h; j += 2) {
+    // the last row of an odd-sized picture is only averaged horizontally
+    const uint8_t* const next_y = (j + 1 < mb_h) ? cur_y + io->y_stride : cur_y;
+    assert(p->last_y + (j >> 1) < p->output->height);
+    WebPRescalerHalveRow(cur_y, next_y, mb_w, p->tmp_y);
+    convert(p->tmp_y, cur_u, cur_v, dst, out_width);
+    cur_y += 2 * io->y_stride;
+    cur_u += io->uv_stride;
+    cur_v += io->uv_stride;
+    dst += buf->stride;
+  }
+  return (mb_h + 1) >> 1;
+}
+
+static int EmitHalfAlphaRGB(const VP8Io* const io, WebPDecParams* const p,
+                            int expected_num_lines_out) {
+  const uint8_t* alpha = io->a;
+  if (alpha != NULL) {
+    const WebPRGBABuffer* const buf = &p->output->u.RGBA;
+    const WEBP_CSP_MODE colorspace = p->output->colorspace;
+    const int alpha_first =
+        (colorspace == MODE_ARGB || colorspace == MODE_Argb);
+    const int is_premult_alpha = WebPIsPremultipliedMode(colorspace);
+    uint8_t* rgba = buf->rgba + p->last_y * buf->stride;
+    const int mb_w = io->mb_w;
+    const int mb_h = io->mb_h;
+    const int out_width = (mb_w + 1) >> 1;
+    int j;
+    (void)expected_num_lines_out;
+    assert(expected_num_lines_out == (mb_h + 1) >> 1);
+    for (j = 0; j < mb_h; j += 2) {
+      const uint8_t* const next = (j + 1 < mb_h) ? alpha + io->width : alpha;
+      WebPRescalerHalveRow(alpha, next, mb_w, p->tmp_u);
+      if (is_premult_alpha) {
+        WebPDispatchAlphaPremultiply(p->tmp_u, 0, out_width, 1,
+                                     rgba, 0, alpha_first);
+      } else {
+        WebPDispatchAlpha(p->tmp_u, 0, out_width, 1,
+                          rgba + (alpha_first ? 0 : 3), 0);
+      }
+      alpha += 2 * io->width;
+      rgba += buf->stride;
+    }
+  }
+  return 0;
+}
+
+static int InitHalfRGB(const VP8Io* const io, WebPDecParams* const p) {
+  const int has_alpha = WebPIsAlphaMode(p->output->colorspace);
+  const size_t out_width = (size_t)io->scaled_width;
+
+  // one row of half-size luma, plus one of half-size alpha
+  p->memory = WebPAllocatorMalloc(io->allocator, has_alpha ? 2ULL : 1ULL,
+                                  out_width);
+  if (p->memory == NULL) {
+    return 0;   // memory error
+  }
+  p->tmp_y = (uint8_t*)p->memory;
+  p->tmp_u = has_alpha ? p->tmp_y + out_width : NULL;
+  p->emit = EmitHalfRGB;
+  WebPRescalerDspInit();
+  WebPInitYUV444Converters();
+  if (has_alpha) {
+    p->emit_alpha = EmitHalfAlphaRGB;
+    WebPInitAlphaProcessing();
+  }
+  return 1;
+}
+
 #endif  // WEBP_REDUCE_SIZE
 
 //------------------------------------------------------------------------------
 // Default custom functions
 
+// Returns true if p->emit stores and premultiplies the alpha values itself.
+static int HasPremultipliedEmit(const WebPDecParams* const p,
+                                WEBP_CSP_MODE colorspace) {
+#ifdef FANCY_UPSAMPLING
+  if (p->emit == EmitFancyRGB) {
+    return (WebPPremultipliedUpsamplers[colorspace] != NULL);
+  }
+#endif
+  return (p->emit == EmitSampledRGB &&
+          WebPPremultipliedSamplers[colorspace] != NULL);
+}
+
 static int CustomSetup(VP8Io* io) {
   WebPDecParams* const p = (WebPDecParams*)io->opaque;
   const WEBP_CSP_MODE colorspace = p->output->colorspace;
@@ -554,6 +791,7 @@ static int CustomSetup(VP8Io* io) {
   const int is_alpha = WebPIsAlphaMode(colorspace);
 
   p->memory = NULL;
+  p->scaler_mt = 0;
   p->emit = NULL;
   p->emit_alpha = NULL;
   p->emit_alpha_row = NULL;
@@ -563,12 +801,27 @@ static int CustomSetup(VP8Io* io) {
   if (is_alpha && WebPIsPremultipliedMode(colorspace)) {
     WebPInitUpsamplers();
   }
+  if (WebPIs16bMode(colorspace)) {
+    WebPInitAlphaProcessing();   // for the 8b -> 16b conversions
+  }
   if (io->use_scaling) {
 #if !defined(WEBP_REDUCE_SIZE)
-    const int ok = is_rgb ? InitRGBRescaler(io, p) : InitYUVRescaler(io, p);
+    const int ok = !is_rgb ? InitYUVRescaler(io, p)
+                 : IsHalfScale(io, colorspace) ? InitHalfRGB(io, p)
+                 : InitRGBRescaler(io, p);
     if (!ok) {
       return 0;    // memory error
     }
+    // The luma plane is rescaled on its own thread, concurrently with the
+    // chroma planes.
+    if (p->emit != EmitHalfRGB && p->options != NULL &&
+        p->options->use_threads) {
+      WebPWorker* const worker = &p->scaler_worker;
+      WebPGetWorkerInterface()->Init(worker);
+      worker->hook = RescalerJobHook;
+      worker->data2 = NULL;
+      p->scaler_mt = WebPGetWorkerInterface()->Reset(worker);
+    }
 #else
     return 0;   // rescaling support not compiled
 #endif
@@ -579,7 +832,8 @@ static int CustomSetup(VP8Io* io) {
       if (io->fancy_upsampling) {
 #ifdef FANCY_UPSAMPLING
         const int uv_width = (io->mb_w + 1) >> 1;
-        p->memory = WebPSafeMalloc(1ULL, (size_t)(io->mb_w + 2 * uv_width));
+        p->memory = WebPAllocatorMalloc(io->allocator, 1ULL,
+                                        (size_t)(io->mb_w + 2 * uv_width));
         if (p->memory == NULL) {
           return 0;   // memory error.
         }
@@ -602,16 +856,72 @@ static int CustomSetup(VP8Io* io) {
       if (is_rgb) {
         WebPInitAlphaProcessing();
       }
+      if (HasPremultipliedEmit(p, colorspace)) {
+        p->emit_alpha = NULL;   // the alpha is emitted along with RGB
+      }
     }
   }
 
   return 1;
 }
 
+uint64_t WebPIoGetMemorySize(const VP8Io* const io,
+                             WEBP_CSP_MODE colorspace) {
+  const int is_rgb = WebPIsRGBMode(colorspace);
+  const int has_alpha = WebPIsAlphaMode(colorspace);
+  if (io->use_scaling) {
+#if !defined(WEBP_REDUCE_SIZE)
+    const int out_width  = io->scaled_width;
+    const int out_height = io->scaled_height;
+    const int uv_in_width  = (io->mb_w + 1) >> 1;
+    const int uv_in_height = (io->mb_h + 1) >> 1;
+    // the u/v planes are rescaled to the full output size for RGB
+    const int uv_out_width  = is_rgb ? out_width : (out_width + 1) >> 1;
+    const int uv_out_height = is_rgb ? out_height : (out_height + 1) >> 1;
+    const int num_rescalers = has_alpha ? 4 : 3;
+    const uint64_t work_size =
+        WebPRescalerFilterWorkSize(io->mb_w, io->mb_h, out_width, out_height,
+                                   1, io->scaling_filter);
+    const uint64_t uv_work_size =
+        WebPRescalerFilterWorkSize(uv_in_width, uv_in_height,
+                                   uv_out_width, uv_out_height, 1,
+                                   io->scaling_filter);
+    const uint64_t linear_size =
+        io->linear_scaling ? WebPRescalerLinearWorkSize(io->mb_w, 1) : 0;
+    if (is_rgb && IsHalfScale(io, colorspace)) {
+      return (has_alpha ? 2ULL : 1ULL) * out_width;
+    }
+    return (has_alpha ? 2 : 1) * work_size + 2 * uv_work_size + linear_size +
+           (is_rgb ? (uint64_t)num_rescalers * out_width : 0) +
+           num_rescalers * sizeof(WebPRescaler) + WEBP_ALIGN_CST;
+#else
+    return 0;
+#endif
+  }
+  if (is_rgb && io->fancy_upsampling) {
+    return (uint64_t)io->mb_w + 2 * ((io->mb_w + 1) >> 1);
+  }
+  return 0;
+}
+
 //------------------------------------------------------------------------------
 
+// The 16b modes are first output as plain RGBA, in the second half of the
+// rows, and then expanded in place while the rows are still in cache. Returns
+// the RGBA view of 'output' used by the emitters meanwhile.
+static void InitRGBAView(const WebPDecBuffer* const output,
+                         WebPDecBuffer* const view) {
+  *view = *output;
+  view->colorspace = MODE_RGBA;
+  view->u.RGBA.rgba += 4 * output->width;
+  view->u.RGBA.size -= 4 * output->width;
+}
+
 static int CustomPut(const VP8Io* io) {
   WebPDecParams* const p = (WebPDecParams*)io->opaque;
+  WebPDecBuffer* const output = p->output;
+  const int is_16b = WebPIs16bMode(output->colorspace);
+  WebPDecBuffer rgba_view;
   const int mb_w = io->mb_w;
   const int mb_h = io->mb_h;
   int num_lines_out;
@@ -620,10 +930,20 @@ static int CustomPut(const VP8Io* io) {
   if (mb_w <= 0 || mb_h <= 0) {
     return 0;
   }
+  if (is_16b) {
+    InitRGBAView(output, &rgba_view);
+    p->output = &rgba_view;
+  }
   num_lines_out = p->emit(io, p);
   if (p->emit_alpha != NULL) {
     p->emit_alpha(io, p, num_lines_out);
   }
+  if (is_16b) {
+    const WebPRGBABuffer* const buf = &output->u.RGBA;
+    p->output = output;
+    WebPConvertRGBARowsTo16b(buf->rgba + p->last_y * buf->stride, buf->stride,
+                             output->width, num_lines_out, output->colorspace);
+  }
   p->last_y += num_lines_out;
   return 1;
 }
@@ -632,7 +952,11 @@ static int CustomPut(const VP8Io* io) {
 
 static void CustomTeardown(const VP8Io* io) {
   WebPDecParams* const p = (WebPDecParams*)io->opaque;
-  WebPSafeFree(p->memory);
+  if (p->scaler_mt) {
+    WebPGetWorkerInterface()->End(&p->scaler_worker);
+    p->scaler_mt = 0;
+  }
+  WebPAllocatorFree(io->allocator, p->memory);
   p->memory = NULL;
 }
 
@@ -11,6 +11,7 @@
 //
 // Author: Skal (pascal.massimino@gmail.com)
 
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "src/dec/alphai_dec.h"
@@ -19,6 +20,7 @@
 #include "src/dec/webpi_dec.h"
 #include "src/utils/bit_reader_inl_utils.h"
 #include "src/utils/utils.h"
+#include "src/webp/format_constants.h"
 
 //------------------------------------------------------------------------------
 
@@ -59,6 +61,7 @@ VP8Decoder* VP8New(void) {
   if (dec != NULL) {
     SetOk(dec);
     WebPGetWorkerInterface()->Init(&dec->worker_);
+    WebPGetWorkerInterface()->Init(&dec->alpha_worker_);
     dec->ready_ = 0;
     dec->num_parts_minus_one_ = 0;
     InitGetCoeffs();
@@ -84,6 +87,19 @@ void VP8Delete(VP8Decoder* const dec) {
   }
 }
 
+void VP8ResetDecoder(VP8Decoder* const dec, int keep_memory) {
+  if (dec == NULL) return;
+  if (!keep_memory) {
+    WebPAllocatorFree(dec->allocator_, dec->mem_);
+    dec->mem_ = NULL;
+    dec->mem_size_ = 0;
+  }
+  WebPDeallocateAlphaMemory(dec);
+  memset(dec, 0, offsetof(VP8Decoder, worker_));
+  SetOk(dec);
+  WebPGetWorkerInterface()->Init(&dec->alpha_worker_);
+}
+
 int VP8SetError(VP8Decoder* const dec,
                 VP8StatusCode error, const char* const msg) {
   // The oldest error reported takes precedence over the new one.
@@ -198,34 +214,58 @@ static int ParseSegmentHeader(VP8BitReader* br,
 // If we don't even have the partitions' sizes, than VP8_STATUS_NOT_ENOUGH_DATA
 // is returned, and this is an unrecoverable error.
 // If the partitions were positioned ok, VP8_STATUS_OK is returned.
+// The partitions start at position 'offset' of the data of 'io', of which
+// 'size' bytes are available.
 static VP8StatusCode ParsePartitions(VP8Decoder* const dec,
-                                     const uint8_t* buf, size_t size) {
-  VP8BitReader* const br = &dec->br_;
-  const uint8_t* sz = buf;
-  const uint8_t* buf_end = buf + size;
-  const uint8_t* part_start;
+                                     const VP8Io* const io,
+                                     size_t offset, size_t size) {
+  uint8_t sizes[3 * (MAX_NUM_PARTITIONS - 1)];
+  const uint8_t* sz;
+  size_t part_start;
   size_t size_left = size;
   size_t last_part;
   size_t p;
 
-  dec->num_parts_minus_one_ = (1 << VP8GetValue(br, 2, "global-header")) - 1;
+  dec->num_parts_minus_one_ =
+      (1 << VP8GetValue(&dec->br_, 2, "global-header")) - 1;
   last_part = dec->num_parts_minus_one_;
   if (size < 3 * last_part) {
     // we can't even read the sizes with sz[]! That's a failure.
     return VP8_STATUS_NOT_ENOUGH_DATA;
   }
-  part_start = buf + last_part * 3;
+  if (io->input != NULL) {
+    VP8SegmentedInputCopy(io->input, io->input_offset + offset, sizes,
+                          3 * last_part);
+    sz = sizes;
+  } else {
+    sz = io->data + offset;
+  }
+  part_start = offset + last_part * 3;
   size_left -= last_part * 3;
   for (p = 0; p < last_part; ++p) {
+    VP8BitReader* const br = dec->parts_ + p;
     size_t psize = sz[0] | (sz[1] << 8) | (sz[2] << 16);
     if (psize > size_left) psize = size_left;
-    VP8InitBitReader(dec->parts_ + p, part_start, psize);
+    if (io->input != NULL) {
+      const uint64_t start = io->input_offset + part_start;
+      VP8InitBitReaderAt(br, io->input, start, start + psize);
+    } else {
+      VP8InitBitReader(br, io->data + part_start, psize);
+    }
     part_start += psize;
     size_left -= psize;
     sz += 3;
   }
-  VP8InitBitReader(dec->parts_ + last_part, part_start, size_left);
-  return (part_start < buf_end) ? VP8_STATUS_OK :
+  // The last partition runs up to the end of the data, which keeps growing
+  // with a segmented input.
+  if (io->input != NULL) {
+    VP8InitBitReaderAt(dec->parts_ + last_part, io->input,
+                       io->input_offset + part_start, ~(uint64_t)0);
+  } else {
+    VP8InitBitReader(dec->parts_ + last_part, io->data + part_start,
+                     size_left);
+  }
+  return (size_left > 0) ? VP8_STATUS_OK :
            VP8_STATUS_SUSPENDED;   // Init is ok, but there's not enough data
 }
 
@@ -257,6 +297,8 @@ static int ParseFilterHeader(VP8BitReader* br, VP8Decoder* const dec) {
 
 // Topmost call
 int VP8GetHeaders(VP8Decoder* const dec, VP8Io* const io) {
+  uint8_t header[VP8_FRAME_HEADER_SIZE];   // copy, for a segmented input
+  const uint8_t* start;
   const uint8_t* buf;
   size_t buf_size;
   VP8FrameHeader* frm_hdr;
@@ -272,8 +314,22 @@ int VP8GetHeaders(VP8Decoder* const dec, VP8Io* const io) {
     return VP8SetError(dec, VP8_STATUS_INVALID_PARAM,
                        "null VP8Io passed to VP8GetHeaders()");
   }
-  buf = io->data;
-  buf_size = io->data_size;
+  if (dec->allocator_ != io->allocator) {   // can't keep dec->mem_
+    WebPAllocatorFree(dec->allocator_, dec->mem_);
+    dec->mem_ = NULL;
+    dec->mem_size_ = 0;
+    dec->allocator_ = io->allocator;
+  }
+  if (io->input != NULL) {
+    // The size of the input is bounded by the container.
+    buf_size = (size_t)(io->input->size_ - io->input_offset);
+    VP8SegmentedInputCopy(io->input, io->input_offset, header, sizeof(header));
+    buf = header;
+  } else {
+    buf = io->data;
+    buf_size = io->data_size;
+  }
+  start = buf;
   if (buf_size < 4) {
     return VP8SetError(dec, VP8_STATUS_NOT_ENOUGH_DATA,
                        "Truncated header.");
@@ -350,8 +406,13 @@ int VP8GetHeaders(VP8Decoder* const dec, VP8Io* const io) {
   }
 
   br = &dec->br_;
-  VP8InitBitReader(br, buf, frm_hdr->partition_length_);
-  buf += frm_hdr->partition_length_;
+  if (io->input != NULL) {
+    const uint64_t part0 = io->input_offset + (size_t)(buf - start);
+    VP8InitBitReaderAt(br, io->input, part0,
+                       part0 + frm_hdr->partition_length_);
+  } else {
+    VP8InitBitReader(br, buf, frm_hdr->partition_length_);
+  }
   buf_size -= frm_hdr->partition_length_;
 
   if (frm_hdr->key_frame_) {
@@ -367,7 +428,9 @@ int VP8GetHeaders(VP8Decoder* const dec, VP8Io* const io) {
     return VP8SetError(dec, VP8_STATUS_BITSTREAM_ERROR,
                        "cannot parse filter header");
   }
-  status = ParsePartitions(dec, buf, buf_size);
+  status = ParsePartitions(dec, io,
+                           (size_t)(buf - start) + frm_hdr->partition_length_,
+                           buf_size);
   if (status != VP8_STATUS_OK) {
     return VP8SetError(dec, status, "cannot parse partitions");
   }
@@ -692,6 +755,9 @@ int VP8Decode(VP8Decoder* const dec, VP8Io* const io) {
     // Will allocate memory and prepare everything.
     if (ok) ok = VP8InitFrame(dec, io);
 
+    // The whole ALPH chunk is available: decode it in parallel if possible.
+    if (ok) VP8StartAlphaDecoding(dec, io);
+
     // Main decoding loop
     if (ok) ok = ParseFrame(dec, io);
 
@@ -713,8 +779,10 @@ void VP8Clear(VP8Decoder* const dec) {
     return;
   }
   WebPGetWorkerInterface()->End(&dec->worker_);
+  WebPTaskSchedulerDelete(dec->filter_scheduler_);
+  dec->filter_scheduler_ = NULL;
   WebPDeallocateAlphaMemory(dec);
-  WebPSafeFree(dec->mem_);
+  WebPAllocatorFree(dec->allocator_, dec->mem_);
   dec->mem_ = NULL;
   dec->mem_size_ = 0;
   memset(&dec->br_, 0, sizeof(dec->br_));
@@ -87,6 +87,11 @@ struct VP8Io {
   size_t data_size;
   const uint8_t* data;
 
+  // Alternative input, split in several buffers (data and data_size are then
+  // ignored). The data starts at position 'input_offset' of 'input'.
+  const struct VP8SegmentedInput* input;
+  uint64_t input_offset;
+
   // If true, in-loop filtering will not be performed even if present in the
   // bitstream. Switching off filtering may speed up decoding at the expense
   // of more visible blocking. Note that output will also be non-compliant
@@ -100,6 +105,12 @@ struct VP8Io {
   // Scaling parameters.
   int use_scaling;
   int scaled_width, scaled_height;
+  int scaling_filter;   // WebPRescalerFilter used by the rescalers
+  int linear_scaling;   // if true, downscale in linear light when possible
+
+  // Allocator for the working memory of the decoder. Must be set before
+  // decoding the headers. NULL means the default one.
+  const WebPAllocator* allocator;
 
   // If non NULL, pointer to the alpha data (if present) corresponding to the
   // start of the current row (That is: it is pre-offset by mb_y and takes
@@ -133,7 +144,8 @@ static WEBP_INLINE int VP8InitIo(VP8Io* const io) {
 }
 
 // Decode the VP8 frame header. Returns true if ok.
-// Note: 'io->data' must be pointing to the start of the VP8 frame header.
+// Note: 'io->data' (or 'io->input_offset') must be pointing to the start of
+// the VP8 frame header.
 int VP8GetHeaders(VP8Decoder* const dec, VP8Io* const io);
 
 // Decode a picture. Will call VP8GetHeaders() if it wasn't done already.
@@ -150,6 +162,11 @@ const char* VP8StatusMessage(VP8Decoder* const dec);
 // Not a mandatory call between calls to VP8Decode().
 void VP8Clear(VP8Decoder* const dec);
 
+// Prepares the decoder for another picture, as if it was just created, but
+// keeping its worker thread, and its main memory chunk if 'keep_memory' is
+// true, for reuse.
+void VP8ResetDecoder(VP8Decoder* const dec, int keep_memory);
+
 // Destroy the decoder object.
 void VP8Delete(VP8Decoder* const dec);
 
@@ -193,8 +193,7 @@ struct VP8Decoder {
   VP8FilterHeader  filter_hdr_;
   VP8SegmentHeader segment_hdr_;
 
-  // Worker
-  WebPWorker worker_;
+  // Worker (see worker_ below)
   int mt_method_;      // multi-thread method: 0=off, 1=[parse+recon][filter]
                        // 2=[parse][recon+filter]
   int cache_id_;       // current cache row
@@ -241,9 +240,6 @@ struct VP8Decoder {
   int cache_y_stride_;
   int cache_uv_stride_;
 
-  // main memory chunk for the above data. Persistent.
-  void* mem_;
-  size_t mem_size_;
 
   // Per macroblock non-persistent infos.
   int mb_x_, mb_y_;       // current position, in macroblock units
@@ -262,6 +258,18 @@ struct VP8Decoder {
   uint8_t* alpha_plane_;      // output. Persistent, contains the whole data.
   const uint8_t* alpha_prev_line_;  // last decoded alpha row (or NULL)
   int alpha_dithering_;       // derived from decoding options (0=off, 100=full)
+  WebPWorker alpha_worker_;   // decodes alpha bands ahead of the color rows
+  int alpha_mt_;              // true if alpha_worker_ is in use
+  int alpha_row_;             // start of the band queued on alpha_worker_
+  int alpha_num_rows_;        // number of rows in this band
+
+  // The fields below are kept by VP8ResetDecoder(), and must come last.
+  WebPWorker worker_;
+  WebPTaskScheduler* filter_scheduler_;  // filters chroma next to worker_
+  // main memory chunk for the above data. Persistent.
+  void* mem_;
+  size_t mem_size_;
+  const WebPAllocator* allocator_;   // allocator of mem_ (io->allocator)
 };
 
 //------------------------------------------------------------------------------
@@ -295,6 +303,10 @@ int VP8ExitCritical(VP8Decoder* const dec, VP8Io* const io);
 int VP8GetThreadMethod(const WebPDecoderOptions* const options,
                        const WebPHeaderStructure* const headers,
                        int width, int height);
+// Returns the size of the working memory allocated by VP8InitFrame() for
+// 'dec', whose headers are decoded, with the 'mt_method' threading method.
+// This is an upper bound, the in-loop filter being still unknown.
+uint64_t VP8GetMemorySize(const VP8Decoder* const dec, int mt_method);
 // Initialize dithering post-process if needed.
 void VP8InitDithering(const WebPDecoderOptions* const options,
                       VP8Decoder* const dec);
@@ -309,6 +321,11 @@ int VP8DecodeMB(VP8Decoder* const dec, VP8BitReader* const token_br);
 const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
                                       const VP8Io* const io,
                                       int row, int num_rows);
+// Starts decoding the alpha plane on a separate worker when threads are in
+// use, in parallel with the color decoding. Falls back to the regular on-demand
+// decoding in VP8DecompressAlphaRows() if this is not possible. The compressed
+// alpha data must stay valid and in place until the end of the decoding.
+void VP8StartAlphaDecoding(VP8Decoder* const dec, const VP8Io* const io);
 
 //------------------------------------------------------------------------------
 
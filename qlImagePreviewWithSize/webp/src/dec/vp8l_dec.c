@@ -12,6 +12,7 @@
 // Authors: Vikas Arora (vikaas.arora@gmail.com)
 //          Jyrki Alakuijala (jyrki@google.com)
 
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "src/dec/alphai_dec.h"
@@ -400,7 +401,8 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
     if (num_htree_groups_max > 1000 || num_htree_groups_max > xsize * ysize) {
       // Create a mapping from the used indices to the minimal set of used
       // values [0, num_htree_groups)
-      mapping = (int*)WebPSafeMalloc(num_htree_groups_max, sizeof(*mapping));
+      mapping = (int*)WebPAllocatorMalloc(dec->allocator_, num_htree_groups_max,
+                                          sizeof(*mapping));
       if (mapping == NULL) {
         dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
         goto Error;
@@ -432,11 +434,12 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
     }
   }
 
-  code_lengths = (int*)WebPSafeCalloc((uint64_t)max_alphabet_size,
-                                      sizeof(*code_lengths));
-  huffman_tables = (HuffmanCode*)WebPSafeMalloc(num_htree_groups * table_size,
-                                                sizeof(*huffman_tables));
-  htree_groups = VP8LHtreeGroupsNew(num_htree_groups);
+  code_lengths = (int*)WebPAllocatorCalloc(dec->allocator_,
+                                           (uint64_t)max_alphabet_size,
+                                           sizeof(*code_lengths));
+  huffman_tables = (HuffmanCode*)WebPAllocatorMalloc(
+      dec->allocator_, num_htree_groups * table_size, sizeof(*huffman_tables));
+  htree_groups = VP8LHtreeGroupsNew(dec->allocator_, num_htree_groups);
 
   if (htree_groups == NULL || code_lengths == NULL || huffman_tables == NULL) {
     dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
@@ -518,12 +521,12 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
   hdr->huffman_tables_ = huffman_tables;
 
  Error:
-  WebPSafeFree(code_lengths);
-  WebPSafeFree(mapping);
+  WebPAllocatorFree(dec->allocator_, code_lengths);
+  WebPAllocatorFree(dec->allocator_, mapping);
   if (!ok) {
-    WebPSafeFree(huffman_image);
-    WebPSafeFree(huffman_tables);
-    VP8LHtreeGroupsFree(htree_groups);
+    WebPAllocatorFree(dec->allocator_, huffman_image);
+    WebPAllocatorFree(dec->allocator_, huffman_tables);
+    VP8LHtreeGroupsFree(dec->allocator_, htree_groups);
   }
   return ok;
 }
@@ -532,20 +535,41 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
 // Scaling.
 
 #if !defined(WEBP_REDUCE_SIZE)
+// Returns the size of the memory needed by AllocateAndInitRescaler().
+static uint64_t GetRescalerMemorySize(const VP8Io* const io, int emit_mt) {
+  const int num_channels = 4;
+  const uint64_t work_size =
+      WebPRescalerFilterWorkSize(io->mb_w, io->mb_h,
+                                 io->scaled_width, io->scaled_height,
+                                 num_channels, io->scaling_filter);
+  // Copy of the rows handed over to emit_worker_, if any.
+  const uint64_t emit_rows_size =
+      emit_mt ? (uint64_t)NUM_ARGB_CACHE_ROWS * io->mb_w : 0;
+  const uint64_t linear_size =
+      io->linear_scaling ? WebPRescalerLinearWorkSize(io->mb_w, num_channels)
+                         : 0;
+  return sizeof(WebPRescaler) + work_size +
+         (uint64_t)io->scaled_width * sizeof(uint32_t) +
+         emit_rows_size * sizeof(uint32_t) + linear_size;
+}
+
 static int AllocateAndInitRescaler(VP8LDecoder* const dec, VP8Io* const io) {
   const int num_channels = 4;
   const int in_width = io->mb_w;
   const int out_width = io->scaled_width;
   const int in_height = io->mb_h;
   const int out_height = io->scaled_height;
-  const uint64_t work_size = 2 * num_channels * (uint64_t)out_width;
-  rescaler_t* work;        // Rescaler work area.
+  const uint64_t work_size =
+      WebPRescalerFilterWorkSize(in_width, in_height, out_width, out_height,
+                                 num_channels, io->scaling_filter);
+  uint8_t* work;           // Rescaler work area.
   const uint64_t scaled_data_size = (uint64_t)out_width;
   uint32_t* scaled_data;  // Temporary storage for scaled BGRA data.
-  const uint64_t memory_size = sizeof(*dec->rescaler) +
-                               work_size * sizeof(*work) +
-                               scaled_data_size * sizeof(*scaled_data);
-  uint8_t* memory = (uint8_t*)WebPSafeMalloc(memory_size, sizeof(*memory));
+  const uint64_t emit_rows_size =
+      dec->emit_mt_ ? (uint64_t)NUM_ARGB_CACHE_ROWS * in_width : 0;
+  const uint64_t memory_size = GetRescalerMemorySize(io, dec->emit_mt_);
+  uint8_t* memory = (uint8_t*)WebPAllocatorMalloc(dec->allocator_, memory_size,
+                                                  sizeof(*memory));
   if (memory == NULL) {
     dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
     return 0;
@@ -555,12 +579,26 @@ static int AllocateAndInitRescaler(VP8LDecoder* const dec, VP8Io* const io) {
 
   dec->rescaler = (WebPRescaler*)memory;
   memory += sizeof(*dec->rescaler);
-  work = (rescaler_t*)memory;
-  memory += work_size * sizeof(*work);
+  work = memory;
+  memory += work_size;
   scaled_data = (uint32_t*)memory;
-
-  WebPRescalerInit(dec->rescaler, in_width, in_height, (uint8_t*)scaled_data,
-                   out_width, out_height, 0, num_channels, work);
+  memory += scaled_data_size * sizeof(*scaled_data);
+  dec->emit_rows_ = dec->emit_mt_ ? memory : NULL;
+  memory += emit_rows_size * sizeof(uint32_t);
+
+  WebPRescalerInitFilter(dec->rescaler, in_width, in_height,
+                         (uint8_t*)scaled_data, out_width, out_height, 0,
+                         num_channels, io->scaling_filter, work);
+  if (io->linear_scaling) {
+    // The rows are BGRA (or ARGB on big-endian) words: locate the alpha byte.
+#if defined(WORDS_BIGENDIAN)
+    const int alpha_channel = 0;
+#else
+    const int alpha_channel = 3;
+#endif
+    WebPRescalerInitLinear(dec->rescaler, WEBP_RESCALER_SRGB, alpha_channel,
+                           memory);
+  }
   return 1;
 }
 #endif   // WEBP_REDUCE_SIZE
@@ -570,12 +608,55 @@ static int AllocateAndInitRescaler(VP8LDecoder* const dec, VP8Io* const io) {
 
 #if !defined(WEBP_REDUCE_SIZE)
 
+#if defined(WORDS_BIGENDIAN)
+#define MODE_NATIVE_ARGB   MODE_ARGB   // in-memory byte order of uint32_t argb
+#define MODE_NATIVE_ARGB_P MODE_Argb
+#else
+#define MODE_NATIVE_ARGB   MODE_BGRA
+#define MODE_NATIVE_ARGB_P MODE_bgrA
+#endif
+
+// Returns true if the rescaled BGRA words can be exported straight into the
+// output rows and converted there in-place (4 bytes per pixel, and either the
+// native byte order or a mere red/blue swap, on 32b-aligned rows).
+static int CanExportInPlace(WEBP_CSP_MODE colorspace,
+                            const uint8_t* const rgba, int rgba_stride) {
+  if (((uintptr_t)rgba & 3) != 0 || (rgba_stride & 3) != 0) return 0;
+  return (colorspace == MODE_NATIVE_ARGB || colorspace == MODE_NATIVE_ARGB_P ||
+          colorspace == MODE_RGBA || colorspace == MODE_rgbA);
+}
+
+// In-place version of VP8LConvertFromBGRA() for the modes above.
+static void ConvertFromBGRAInPlace(uint32_t* const argb, int width,
+                                   WEBP_CSP_MODE colorspace) {
+  uint8_t* const rgba = (uint8_t*)argb;
+  if (colorspace == MODE_RGBA || colorspace == MODE_rgbA) {
+    VP8LConvertBGRAToRGBA(argb, width, rgba);
+  }
+  if (WebPIsPremultipliedMode(colorspace)) {
+    WebPApplyAlphaMultiply(rgba, (colorspace == MODE_Argb), width, 1, 0);
+  }
+}
+
 // We have special "export" function since we need to convert from BGRA
 static int Export(WebPRescaler* const rescaler, WEBP_CSP_MODE colorspace,
                   int rgba_stride, uint8_t* const rgba) {
   uint32_t* const src = (uint32_t*)rescaler->dst;
   const int dst_width = rescaler->dst_width;
   int num_lines_out = 0;
+  if (CanExportInPlace(colorspace, rgba, rgba_stride)) {
+    // Skip the intermediate row: the rescaler writes the output directly.
+    while (WebPRescalerHasPendingOutput(rescaler)) {
+      uint32_t* const dst = (uint32_t*)(rgba + num_lines_out * rgba_stride);
+      rescaler->dst = (uint8_t*)dst;
+      WebPRescalerExportRow(rescaler);
+      WebPMultARGBRow(dst, dst_width, 1);
+      ConvertFromBGRAInPlace(dst, dst_width, colorspace);
+      ++num_lines_out;
+    }
+    rescaler->dst = (uint8_t*)src;
+    return num_lines_out;
+  }
   while (WebPRescalerHasPendingOutput(rescaler)) {
     uint8_t* const dst = rgba + num_lines_out * rgba_stride;
     WebPRescalerExportRow(rescaler);
@@ -657,6 +738,7 @@ static void ConvertToYUVA(const uint32_t* const src, int width, int y_pos,
   }
 }
 
+#if !defined(WEBP_REDUCE_SIZE)
 static int ExportYUVA(const VP8LDecoder* const dec, int y_pos) {
   WebPRescaler* const rescaler = dec->rescaler;
   uint32_t* const src = (uint32_t*)rescaler->dst;
@@ -690,6 +772,7 @@ static int EmitRescaledRowsYUVA(const VP8LDecoder* const dec,
   }
   return y_pos;
 }
+#endif   // WEBP_REDUCE_SIZE
 
 static int EmitRowsYUVA(const VP8LDecoder* const dec,
                         const uint8_t* in, int in_stride,
@@ -703,6 +786,176 @@ static int EmitRowsYUVA(const VP8LDecoder* const dec,
   return y_pos;
 }
 
+//------------------------------------------------------------------------------
+// Multi-threaded rescaling.
+
+// Waits until the rows queued on 'emit_worker_' are output.
+static void SyncEmitWorker(VP8LDecoder* const dec) {
+  if (dec->emit_mt_) {
+    (void)WebPGetWorkerInterface()->Sync(&dec->emit_worker_);
+  }
+}
+
+#if !defined(WEBP_REDUCE_SIZE)
+// Rescales and color-converts 'mb_h' rows of 'in', updating 'last_out_row_'.
+static void EmitRescaledRows(VP8LDecoder* const dec,
+                             uint8_t* in, int in_stride, int mb_h) {
+  const WebPDecBuffer* const output = dec->output_;
+  if (WebPIsRGBMode(output->colorspace)) {  // convert to RGBA
+    const WebPRGBABuffer* const buf = &output->u.RGBA;
+    uint8_t* const rgba = buf->rgba + dec->last_out_row_ * buf->stride;
+    dec->last_out_row_ +=
+        EmitRescaledRowsRGBA(dec, in, in_stride, mb_h, rgba, buf->stride);
+  } else {                                  // convert to YUVA
+    dec->last_out_row_ = EmitRescaledRowsYUVA(dec, in, in_stride, mb_h);
+  }
+  assert(dec->last_out_row_ <= output->height);
+}
+
+static int EmitWorkerHook(void* arg1, void* arg2) {
+  VP8LDecoder* const dec = (VP8LDecoder*)arg1;
+  const int stride = dec->rescaler->src_width * sizeof(uint32_t);
+  (void)arg2;
+  EmitRescaledRows(dec, dec->emit_rows_, stride, dec->emit_num_rows_);
+  return 1;
+}
+
+// Starts 'emit_worker_' if the rescaling is to be done on its own thread.
+// Must be called before AllocateAndInitRescaler().
+static void InitEmitWorker(VP8LDecoder* const dec,
+                           const WebPDecoderOptions* const options) {
+  WebPWorker* const worker = &dec->emit_worker_;
+  dec->emit_mt_ = 0;
+  if (options == NULL || !options->use_threads || !dec->io_->use_scaling) {
+    return;
+  }
+  if (!WebPGetWorkerInterface()->Reset(worker)) return;   // single-threaded
+  worker->hook = EmitWorkerHook;
+  worker->data1 = dec;
+  worker->data2 = NULL;
+  dec->emit_mt_ = 1;
+}
+
+// Copies the 'num_rows' rows of 'in' once the previous ones are output, and
+// queues them on 'emit_worker_'.
+static void QueueRescaledRows(VP8LDecoder* const dec,
+                              const uint8_t* in, int in_stride, int num_rows) {
+  const size_t row_size = (size_t)dec->rescaler->src_width * sizeof(uint32_t);
+  int y;
+  assert(num_rows <= NUM_ARGB_CACHE_ROWS);
+  SyncEmitWorker(dec);
+  for (y = 0; y < num_rows; ++y) {
+    memcpy(dec->emit_rows_ + y * row_size, in + y * in_stride, row_size);
+  }
+  dec->emit_num_rows_ = num_rows;
+  WebPGetWorkerInterface()->Launch(&dec->emit_worker_);
+}
+#endif   // WEBP_REDUCE_SIZE
+
+//------------------------------------------------------------------------------
+// Direct output of color-indexed images.
+
+// Returns true if the only transform is color-indexing, in which case the
+// packed palette indices can be mapped straight to output samples.
+static int IsPaletteOnly(const VP8LDecoder* const dec) {
+  return (dec->next_transform_ == 1 &&
+          dec->transforms_[0].type_ == COLOR_INDEXING_TRANSFORM);
+}
+
+static int GetPaletteBpp(WEBP_CSP_MODE colorspace) {
+  switch (colorspace) {
+    case MODE_RGB:
+    case MODE_BGR:
+      return 3;
+    case MODE_RGBA_4444:
+    case MODE_rgbA_4444:
+    case MODE_RGB_565:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+// Converts the (expanded) palette to the output colorspace once, so that each
+// pixel only costs a table lookup.
+static void InitPaletteOutput(VP8LDecoder* const dec,
+                              WEBP_CSP_MODE colorspace) {
+  const VP8LTransform* const transform = &dec->transforms_[0];
+  const int num_colors = 1 << (8 >> transform->bits_);
+  assert(IsPaletteOnly(dec));
+  assert(WebPIsRGBMode(colorspace));
+  VP8LConvertFromBGRA(transform->data_, num_colors, colorspace,
+                      dec->palette_out_);
+  dec->palette_bpp_ = GetPaletteBpp(colorspace);
+}
+
+#define MAP_PALETTE_ROW(BPP) do {                                     \
+  if (bits_per_pixel < 8) {                                           \
+    const int count_mask = (1 << bits) - 1;                           \
+    const uint32_t bit_mask = (1 << bits_per_pixel) - 1;              \
+    uint32_t packed_pixels =                                          \
+        VP8GetARGBIndex(src[x_start >> bits]) >>                      \
+        ((x_start & count_mask) * bits_per_pixel);                    \
+    for (x = x_start; x < x_end; ++x) {                               \
+      if ((x & count_mask) == 0) {                                    \
+        packed_pixels = VP8GetARGBIndex(src[x >> bits]);              \
+      }                                                               \
+      memcpy(dst, palette + (packed_pixels & bit_mask) * (BPP), (BPP)); \
+      dst += (BPP);                                                   \
+      packed_pixels >>= bits_per_pixel;                               \
+    }                                                                 \
+  } else {                                                            \
+    for (x = x_start; x < x_end; ++x) {                               \
+      memcpy(dst, palette + VP8GetARGBIndex(src[x]) * (BPP), (BPP));  \
+      dst += (BPP);                                                   \
+    }                                                                 \
+  }                                                                   \
+} while (0)
+
+// Maps the columns [x_start, x_end) of a row of packed palette indices to
+// 'dec->palette_bpp_'-byte output samples.
+static void MapPaletteRow(const VP8LDecoder* const dec,
+                          const uint32_t* const src, int x_start, int x_end,
+                          uint8_t* dst) {
+  const int bits = dec->transforms_[0].bits_;
+  const int bits_per_pixel = 8 >> bits;
+  const uint8_t* const palette = dec->palette_out_;
+  int x;
+  switch (dec->palette_bpp_) {
+    case 4: MAP_PALETTE_ROW(4); break;
+    case 3: MAP_PALETTE_ROW(3); break;
+    case 2: MAP_PALETTE_ROW(2); break;
+    default: MAP_PALETTE_ROW(1); break;
+  }
+}
+#undef MAP_PALETTE_ROW
+
+// Row-processing for color-indexed images: the cropped rows decoded since the
+// last call are mapped to the output, which saves the ARGB expansion of the
+// palette and the colorspace conversion pass.
+static void ProcessPalettedRows(VP8LDecoder* const dec, int row) {
+  const VP8Io* const io = dec->io_;
+  const int y_start =
+      (dec->last_row_ < io->crop_top) ? io->crop_top : dec->last_row_;
+  const int y_end = (row > io->crop_bottom) ? io->crop_bottom : row;
+  if (y_end > y_start) {
+    const WebPRGBABuffer* const buf = &dec->output_->u.RGBA;
+    const uint32_t* src =
+        dec->pixels_ + dec->width_ * (y_start - dec->first_pixel_row_);
+    uint8_t* dst = buf->rgba + dec->last_out_row_ * buf->stride;
+    int y;
+    for (y = y_start; y < y_end; ++y) {
+      MapPaletteRow(dec, src, io->crop_left, io->crop_right, dst);
+      src += dec->width_;
+      dst += buf->stride;
+    }
+    dec->last_out_row_ += y_end - y_start;
+    assert(dec->last_out_row_ <= dec->output_->height);
+  }
+  dec->last_row_ = row;
+  assert(dec->last_row_ <= dec->height_);
+}
+
 //------------------------------------------------------------------------------
 // Cropping.
 
@@ -778,7 +1031,8 @@ static void ApplyInverseTransforms(VP8LDecoder* const dec,
 // Processes (transforms, scales & color-converts) the rows decoded after the
 // last call.
 static void ProcessRows(VP8LDecoder* const dec, int row) {
-  const uint32_t* const rows = dec->pixels_ + dec->width_ * dec->last_row_;
+  const uint32_t* const rows =
+      dec->pixels_ + dec->width_ * (dec->last_row_ - dec->first_pixel_row_);
   const int num_rows = row - dec->last_row_;
 
   assert(row <= dec->io_->crop_bottom);
@@ -792,24 +1046,26 @@ static void ProcessRows(VP8LDecoder* const dec, int row) {
     ApplyInverseTransforms(dec, dec->last_row_, num_rows, rows);
     if (!SetCropWindow(io, dec->last_row_, row, &rows_data, in_stride)) {
       // Nothing to output (this time).
+    } else if (io->use_scaling) {
+#if !defined(WEBP_REDUCE_SIZE)
+      if (dec->emit_mt_) {
+        QueueRescaledRows(dec, rows_data, in_stride, io->mb_h);
+      } else {
+        EmitRescaledRows(dec, rows_data, in_stride, io->mb_h);
+      }
+#endif  // WEBP_REDUCE_SIZE
     } else {
       const WebPDecBuffer* const output = dec->output_;
       if (WebPIsRGBMode(output->colorspace)) {  // convert to RGBA
         const WebPRGBABuffer* const buf = &output->u.RGBA;
         uint8_t* const rgba = buf->rgba + dec->last_out_row_ * buf->stride;
         const int num_rows_out =
-#if !defined(WEBP_REDUCE_SIZE)
-         io->use_scaling ?
-            EmitRescaledRowsRGBA(dec, rows_data, in_stride, io->mb_h,
-                                 rgba, buf->stride) :
-#endif  // WEBP_REDUCE_SIZE
             EmitRows(output->colorspace, rows_data, in_stride,
                      io->mb_w, io->mb_h, rgba, buf->stride);
         // Update 'last_out_row_'.
         dec->last_out_row_ += num_rows_out;
       } else {                              // convert to YUVA
-        dec->last_out_row_ = io->use_scaling ?
-            EmitRescaledRowsYUVA(dec, rows_data, in_stride, io->mb_h) :
+        dec->last_out_row_ =
             EmitRowsYUVA(dec, rows_data, in_stride, io->mb_w, io->mb_h);
       }
       assert(dec->last_out_row_ <= output->height);
@@ -1087,18 +1343,34 @@ static int DecodeAlphaData(VP8LDecoder* const dec, uint8_t* const data,
   return ok;
 }
 
-static void SaveState(VP8LDecoder* const dec, int last_pixel) {
+// The saved color cache always matches the pixels before 'saved_last_pixel_'.
+// It is brought up to date by inserting the pixels decoded since the previous
+// check-point, unless copying the whole cache is cheaper.
+static void SaveState(VP8LDecoder* const dec, const uint32_t* const data,
+                      int last_pixel) {
   assert(dec->incremental_);
+  assert(last_pixel >= dec->saved_last_pixel_);
   dec->saved_br_ = dec->br_;
-  dec->saved_last_pixel_ = last_pixel;
   if (dec->hdr_.color_cache_size_ > 0) {
-    VP8LColorCacheCopy(&dec->hdr_.color_cache_, &dec->hdr_.saved_color_cache_);
+    VP8LColorCache* const saved = &dec->hdr_.saved_color_cache_;
+    const int num_pixels = last_pixel - dec->saved_last_pixel_;
+    if (8 * num_pixels < dec->hdr_.color_cache_size_) {
+      int i;
+      for (i = dec->saved_last_pixel_; i < last_pixel; ++i) {
+        VP8LColorCacheInsert(saved, data[i]);
+      }
+    } else {
+      VP8LColorCacheCopy(&dec->hdr_.color_cache_, saved);
+    }
   }
+  dec->saved_last_pixel_ = last_pixel;
 }
 
 static void RestoreState(VP8LDecoder* const dec) {
   assert(dec->br_.eos_);
   dec->status_ = VP8_STATUS_SUSPENDED;
+  dec->redo_size_ = (size_t)(VP8LBitReaderPosition(&dec->br_) -
+                             VP8LBitReaderPosition(&dec->saved_br_));
   dec->br_ = dec->saved_br_;
   dec->last_pixel_ = dec->saved_last_pixel_;
   if (dec->hdr_.color_cache_size_ > 0) {
@@ -1106,7 +1378,29 @@ static void RestoreState(VP8LDecoder* const dec) {
   }
 }
 
-#define SYNC_EVERY_N_ROWS 8  // minimum number of rows between check-points
+// Windowed decoding: when less than one row plus the longest copy is left at
+// the end of pixels_, the rows that are still needed (the back-reference
+// window, the rows not processed yet and the ones not inserted in the color
+// cache yet) are moved back to the beginning of pixels_.
+// Returns the number of pixels the data was moved by.
+static int SlidePixelWindow(VP8LDecoder* const dec, uint32_t* const data,
+                            int width, const uint32_t* const src,
+                            const uint32_t* const last_cached) {
+  const int first_row = dec->first_pixel_row_;
+  const int pos = first_row * width + (int)(src - data);
+  const int cached_row = first_row + (int)(last_cached - data) / width;
+  int keep_row = pos / width - dec->window_rows_;
+  int delta;
+  if (keep_row > dec->last_row_) keep_row = dec->last_row_;
+  if (keep_row > cached_row) keep_row = cached_row;
+  if (keep_row <= first_row) return 0;
+  delta = (keep_row - first_row) * width;
+  memmove(data, data + delta, (pos - keep_row * width) * sizeof(*data));
+  dec->first_pixel_row_ = keep_row;
+  return delta;
+}
+
+#define MAX_COPY_LENGTH 4096  // longest backward reference, in pixels
 static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
                            int width, int height, int last_row,
                            ProcessRowsFunc process_func) {
@@ -1114,10 +1408,21 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
   int col = dec->last_pixel_ % width;
   VP8LBitReader* const br = &dec->br_;
   VP8LMetadata* const hdr = &dec->hdr_;
-  uint32_t* src = data + dec->last_pixel_;
+  // In windowed mode, 'data' starts at row 'dec->first_pixel_row_' and holds
+  // 'dec->num_pixel_rows_' rows.
+  const int windowed = (dec->window_rows_ > 0 && data == dec->pixels_);
+  const int num_rows = windowed ? dec->num_pixel_rows_ : height;
+  const int first_pixel = windowed ? dec->first_pixel_row_ * width : 0;
+  uint32_t* src = data + dec->last_pixel_ - first_pixel;
   uint32_t* last_cached = src;
-  uint32_t* const src_end = data + width * height;     // End of data
-  uint32_t* const src_last = data + width * last_row;  // Last pixel to decode
+  uint32_t* src_end = data + width * num_rows;   // End of data
+  // Last pixel to decode.
+  uint32_t* src_last =
+      data + width * ((last_row - dec->first_pixel_row_ < num_rows) ?
+                      last_row - dec->first_pixel_row_ : num_rows);
+  // In windowed mode, data is moved when 'src' goes past 'src_slide'.
+  const uint32_t* src_slide =
+      windowed ? src_end - width - MAX_COPY_LENGTH : src_end;
   const int len_code_limit = NUM_LITERAL_CODES + NUM_LENGTH_CODES;
   const int color_cache_limit = len_code_limit + hdr->color_cache_size_;
   int next_sync_row = dec->incremental_ ? row : 1 << 24;
@@ -1132,8 +1437,10 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
   while (src < src_last) {
     int code;
     if (row >= next_sync_row) {
-      SaveState(dec, (int)(src - data));
-      next_sync_row = row + SYNC_EVERY_N_ROWS;
+      // Check-points are cheap enough to be taken at every row, which
+      // bounds the data decoded again when resuming.
+      SaveState(dec, data, (int)(src - data));
+      next_sync_row = row + 1;
     }
     // Only update when changing tile. Note we could use this test:
     // if "((((prev_col ^ col) | prev_row ^ row)) > mask)" -> tile changed
@@ -1183,6 +1490,7 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
             VP8LColorCacheInsert(color_cache, *last_cached++);
           }
         }
+        if (src > src_slide) goto Slide;
       }
     } else if (code < len_code_limit) {  // Backward reference
       int dist_code, dist;
@@ -1195,6 +1503,10 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
 
       if (VP8LIsEndOfStream(br)) break;
       if (src - data < (ptrdiff_t)dist || src_end - src < (ptrdiff_t)length) {
+        if (windowed && src - data + dec->first_pixel_row_ * width >= dist &&
+            src_end - src >= (ptrdiff_t)length) {
+          dec->window_exceeded_ = 1;  // valid, but beyond the window.
+        }
         goto Error;
       } else {
         CopyBlock32b(src, dist, length);
@@ -1219,6 +1531,7 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
           VP8LColorCacheInsert(color_cache, *last_cached++);
         }
       }
+      if (src > src_slide) goto Slide;
     } else if (code < color_cache_limit) {  // Color cache
       const int key = code - len_code_limit;
       assert(color_cache != NULL);
@@ -1230,6 +1543,23 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
     } else {  // Not reached
       goto Error;
     }
+    continue;
+
+   Slide:
+    {
+      const int delta = SlidePixelWindow(
+          dec, data, width, src, (color_cache != NULL) ? last_cached : src);
+      const int last = last_row - dec->first_pixel_row_;
+      assert(windowed && delta > 0);
+      src -= delta;
+      last_cached = (color_cache != NULL) ? last_cached - delta : src;
+      src_end = data + width * ((height - dec->first_pixel_row_ < num_rows) ?
+                                height - dec->first_pixel_row_ : num_rows);
+      src_last = data + width * ((last < num_rows) ? last : num_rows);
+      if (src_end < data + width * num_rows) {
+        src_slide = src_end;  // The end of the image fits in the window.
+      }
+    }
   }
 
   br->eos_ = VP8LIsEndOfStream(br);
@@ -1241,7 +1571,8 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
       process_func(dec, row > last_row ? last_row : row);
     }
     dec->status_ = VP8_STATUS_OK;
-    dec->last_pixel_ = (int)(src - data);  // end-of-scan marker
+    // end-of-scan marker
+    dec->last_pixel_ = (int)(src - data) + dec->first_pixel_row_ * width;
   } else {
     // if not incremental, and we are past the end of buffer (eos_=1), then this
     // is a real bitstream error.
@@ -1257,19 +1588,21 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
 // -----------------------------------------------------------------------------
 // VP8LTransform
 
-static void ClearTransform(VP8LTransform* const transform) {
-  WebPSafeFree(transform->data_);
+static void ClearTransform(const WebPAllocator* const allocator,
+                           VP8LTransform* const transform) {
+  WebPAllocatorFree(allocator, transform->data_);
   transform->data_ = NULL;
 }
 
 // For security reason, we need to remap the color map to span
 // the total possible bundled values, and not just the num_colors.
-static int ExpandColorMap(int num_colors, VP8LTransform* const transform) {
+static int ExpandColorMap(const WebPAllocator* const allocator,
+                          int num_colors, VP8LTransform* const transform) {
   int i;
   const int final_num_colors = 1 << (8 >> transform->bits_);
   uint32_t* const new_color_map =
-      (uint32_t*)WebPSafeMalloc((uint64_t)final_num_colors,
-                                sizeof(*new_color_map));
+      (uint32_t*)WebPAllocatorMalloc(allocator, (uint64_t)final_num_colors,
+                                     sizeof(*new_color_map));
   if (new_color_map == NULL) {
     return 0;
   } else {
@@ -1283,7 +1616,7 @@ static int ExpandColorMap(int num_colors, VP8LTransform* const transform) {
     for (; i < 4 * final_num_colors; ++i) {
       new_data[i] = 0;  // black tail.
     }
-    WebPSafeFree(transform->data_);
+    WebPAllocatorFree(allocator, transform->data_);
     transform->data_ = new_color_map;
   }
   return 1;
@@ -1329,7 +1662,7 @@ static int ReadTransform(int* const xsize, int const* ysize,
        *xsize = VP8LSubSampleSize(transform->xsize_, bits);
        transform->bits_ = bits;
        ok = DecodeImageStream(num_colors, 1, 0, dec, &transform->data_);
-       ok = ok && ExpandColorMap(num_colors, transform);
+       ok = ok && ExpandColorMap(dec->allocator_, num_colors, transform);
       break;
     }
     case SUBTRACT_GREEN:
@@ -1350,12 +1683,13 @@ static void InitMetadata(VP8LMetadata* const hdr) {
   memset(hdr, 0, sizeof(*hdr));
 }
 
-static void ClearMetadata(VP8LMetadata* const hdr) {
+static void ClearMetadata(const WebPAllocator* const allocator,
+                          VP8LMetadata* const hdr) {
   assert(hdr != NULL);
 
-  WebPSafeFree(hdr->huffman_image_);
-  WebPSafeFree(hdr->huffman_tables_);
-  VP8LHtreeGroupsFree(hdr->htree_groups_);
+  WebPAllocatorFree(allocator, hdr->huffman_image_);
+  WebPAllocatorFree(allocator, hdr->huffman_tables_);
+  VP8LHtreeGroupsFree(allocator, hdr->htree_groups_);
   VP8LColorCacheClear(&hdr->color_cache_);
   VP8LColorCacheClear(&hdr->saved_color_cache_);
   InitMetadata(hdr);
@@ -1369,31 +1703,52 @@ VP8LDecoder* VP8LNew(void) {
   if (dec == NULL) return NULL;
   dec->status_ = VP8_STATUS_OK;
   dec->state_ = READ_DIM;
+  WebPGetWorkerInterface()->Init(&dec->emit_worker_);
 
   VP8LDspInit();  // Init critical function pointers.
 
   return dec;
 }
 
-void VP8LClear(VP8LDecoder* const dec) {
+// Releases the memory of 'dec'. emit_worker_ must be idle.
+static void ClearDecoder(VP8LDecoder* const dec) {
   int i;
-  if (dec == NULL) return;
-  ClearMetadata(&dec->hdr_);
+  ClearMetadata(dec->allocator_, &dec->hdr_);
 
-  WebPSafeFree(dec->pixels_);
+  WebPAllocatorFree(dec->allocator_, dec->pixels_);
   dec->pixels_ = NULL;
   for (i = 0; i < dec->next_transform_; ++i) {
-    ClearTransform(&dec->transforms_[i]);
+    ClearTransform(dec->allocator_, &dec->transforms_[i]);
   }
   dec->next_transform_ = 0;
   dec->transforms_seen_ = 0;
+  dec->window_rows_ = 0;
+  dec->first_pixel_row_ = 0;
+  dec->window_exceeded_ = 0;
 
-  WebPSafeFree(dec->rescaler_memory);
+  WebPAllocatorFree(dec->allocator_, dec->rescaler_memory);
   dec->rescaler_memory = NULL;
+  dec->emit_rows_ = NULL;
+  dec->palette_bpp_ = 0;
 
   dec->output_ = NULL;   // leave no trace behind
 }
 
+void VP8LClear(VP8LDecoder* const dec) {
+  if (dec == NULL) return;
+  WebPGetWorkerInterface()->End(&dec->emit_worker_);
+  dec->emit_mt_ = 0;
+  ClearDecoder(dec);
+}
+
+void VP8LResetDecoder(VP8LDecoder* const dec) {
+  if (dec == NULL) return;
+  ClearDecoder(dec);
+  memset(dec, 0, offsetof(VP8LDecoder, emit_worker_));
+  dec->status_ = VP8_STATUS_OK;
+  dec->state_ = READ_DIM;
+}
+
 void VP8LDelete(VP8LDecoder* const dec) {
   if (dec != NULL) {
     VP8LClear(dec);
@@ -1468,7 +1823,8 @@ static int DecodeImageStream(int xsize, int ysize,
 
   {
     const uint64_t total_size = (uint64_t)transform_xsize * transform_ysize;
-    data = (uint32_t*)WebPSafeMalloc(total_size, sizeof(*data));
+    data = (uint32_t*)WebPAllocatorMalloc(dec->allocator_, total_size,
+                                          sizeof(*data));
     if (data == NULL) {
       dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
       ok = 0;
@@ -1483,8 +1839,8 @@ static int DecodeImageStream(int xsize, int ysize,
 
  End:
   if (!ok) {
-    WebPSafeFree(data);
-    ClearMetadata(hdr);
+    WebPAllocatorFree(dec->allocator_, data);
+    ClearMetadata(dec->allocator_, hdr);
   } else {
     if (decoded_data != NULL) {
       *decoded_data = data;
@@ -1495,7 +1851,8 @@ static int DecodeImageStream(int xsize, int ysize,
       assert(is_level0);
     }
     dec->last_pixel_ = 0;  // Reset for future DECODE_DATA_FUNC() calls.
-    if (!is_level0) ClearMetadata(hdr);  // Clean up temporary data behind.
+    // Clean up temporary data behind.
+    if (!is_level0) ClearMetadata(dec->allocator_, hdr);
   }
   return ok;
 }
@@ -1503,30 +1860,124 @@ static int DecodeImageStream(int xsize, int ysize,
 //------------------------------------------------------------------------------
 // Allocate internal buffers dec->pixels_ and dec->argb_cache_.
 static int AllocateInternalBuffers32b(VP8LDecoder* const dec, int final_width) {
-  const uint64_t num_pixels = (uint64_t)dec->width_ * dec->height_;
+  const uint64_t num_pixels = (uint64_t)dec->width_ *
+      ((dec->window_rows_ > 0) ? dec->num_pixel_rows_ : dec->height_);
+  // Neither cache is needed when the palette is mapped straight to the output.
+  const int use_cache = (dec->palette_bpp_ == 0);
   // Scratch buffer corresponding to top-prediction row for transforming the
   // first row in the row-blocks. Not needed for paletted alpha.
-  const uint64_t cache_top_pixels = (uint16_t)final_width;
+  const uint64_t cache_top_pixels = use_cache ? (uint16_t)final_width : 0;
   // Scratch buffer for temporary BGRA storage. Not needed for paletted alpha.
-  const uint64_t cache_pixels = (uint64_t)final_width * NUM_ARGB_CACHE_ROWS;
+  const uint64_t cache_pixels =
+      use_cache ? (uint64_t)final_width * NUM_ARGB_CACHE_ROWS : 0;
   const uint64_t total_num_pixels =
       num_pixels + cache_top_pixels + cache_pixels;
 
   assert(dec->width_ <= final_width);
-  dec->pixels_ = (uint32_t*)WebPSafeMalloc(total_num_pixels, sizeof(uint32_t));
+  dec->pixels_ = (uint32_t*)WebPAllocatorMalloc(dec->allocator_,
+                                                total_num_pixels,
+                                                sizeof(uint32_t));
   if (dec->pixels_ == NULL) {
     dec->argb_cache_ = NULL;    // for sanity check
     dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
     return 0;
   }
-  dec->argb_cache_ = dec->pixels_ + num_pixels + cache_top_pixels;
+  dec->argb_cache_ =
+      use_cache ? dec->pixels_ + num_pixels + cache_top_pixels : NULL;
+  return 1;
+}
+
+// Sets up windowed decoding, keeping 'window_rows' rows for back-references,
+// unless the whole image is as small.
+static void InitPixelWindow(VP8LDecoder* const dec, int window_rows) {
+  dec->first_pixel_row_ = 0;
+  dec->window_exceeded_ = 0;
+  dec->window_rows_ = 0;
+  dec->num_pixel_rows_ = dec->height_;
+  if (window_rows > 0 && window_rows < dec->height_) {
+    // Room for the rows not processed yet, the current row and the longest
+    // copy, on top of the window.
+    const int num_rows =
+        ((window_rows > NUM_ARGB_CACHE_ROWS) ? window_rows
+                                             : NUM_ARGB_CACHE_ROWS) +
+        3 + (MAX_COPY_LENGTH + dec->width_ - 1) / dec->width_;
+    if (num_rows < dec->height_) {
+      dec->window_rows_ = window_rows;
+      dec->num_pixel_rows_ = num_rows;
+    }
+  }
+}
+
+// Scans the entropy-coded pixels of the image without storing them, and
+// returns in '*window_rows' the smallest window covering all of its
+// back-references. The bit reader is left at the end of the image data.
+// Returns false in case of bitstream error.
+static int GetWindowRows(VP8LDecoder* const dec, int* const window_rows) {
+  VP8LBitReader* const br = &dec->br_;
+  VP8LMetadata* const hdr = &dec->hdr_;
+  const int width = dec->width_;
+  const int num_pixels = width * dec->height_;
+  const int len_code_limit = NUM_LITERAL_CODES + NUM_LENGTH_CODES;
+  const int color_cache_limit = len_code_limit + hdr->color_cache_size_;
+  const int mask = hdr->huffman_mask_;
+  const HTreeGroup* htree_group = NULL;
+  int pos = 0, col = 0, row = 0;
+  int max_dist = 0;
+  int length = 1;
+  while (pos < num_pixels) {
+    if ((col & mask) == 0 || length > 1) {
+      htree_group = GetHtreeGroupForPos(hdr, col, row);
+    }
+    length = 1;
+    if (!htree_group->is_trivial_code) {
+      int code;
+      VP8LFillBitWindow(br);
+      if (htree_group->use_packed_table) {
+        uint32_t pixel;
+        code = ReadPackedSymbols(htree_group, br, &pixel);
+      } else {
+        code = ReadSymbol(htree_group->htrees[GREEN], br);
+        if (code < NUM_LITERAL_CODES && !htree_group->is_trivial_literal) {
+          ReadSymbol(htree_group->htrees[RED], br);
+          VP8LFillBitWindow(br);
+          ReadSymbol(htree_group->htrees[BLUE], br);
+          ReadSymbol(htree_group->htrees[ALPHA], br);
+        }
+      }
+      if (code >= NUM_LITERAL_CODES && code < len_code_limit) {
+        int dist_symbol, dist;
+        length = GetCopyLength(code - NUM_LITERAL_CODES, br);
+        dist_symbol = ReadSymbol(htree_group->htrees[DIST], br);
+        VP8LFillBitWindow(br);
+        dist = PlaneCodeToDistance(width, GetCopyDistance(dist_symbol, br));
+        if (pos < dist || num_pixels - pos < length) goto Error;
+        if (dist > max_dist) max_dist = dist;
+      } else if (code >= color_cache_limit) {
+        goto Error;
+      }
+      if (VP8LIsEndOfStream(br)) goto Error;
+    }
+    pos += length;
+    col += length;
+    while (col >= width) {
+      col -= width;
+      ++row;
+    }
+  }
+  *window_rows = (max_dist + width - 1) / width;
   return 1;
+
+ Error:
+  dec->status_ = VP8_STATUS_BITSTREAM_ERROR;
+  return 0;
 }
 
 static int AllocateInternalBuffers8b(VP8LDecoder* const dec) {
   const uint64_t total_num_pixels = (uint64_t)dec->width_ * dec->height_;
   dec->argb_cache_ = NULL;    // for sanity check
-  dec->pixels_ = (uint32_t*)WebPSafeMalloc(total_num_pixels, sizeof(uint8_t));
+  dec->pixels_ = (uint32_t*)WebPAllocatorMalloc(dec->allocator_,
+                                                total_num_pixels,
+                                                sizeof(uint8_t));
   if (dec->pixels_ == NULL) {
     dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
     return 0;
@@ -1644,8 +2095,13 @@ int VP8LDecodeHeader(VP8LDecoder* const dec, VP8Io* const io) {
   }
 
   dec->io_ = io;
+  dec->allocator_ = io->allocator;
   dec->status_ = VP8_STATUS_OK;
-  VP8LInitBitReader(&dec->br_, io->data, io->data_size);
+  if (io->input != NULL) {
+    VP8LInitBitReaderAt(&dec->br_, io->input, io->input_offset);
+  } else {
+    VP8LInitBitReader(&dec->br_, io->data, io->data_size);
+  }
   if (!ReadImageInfo(&dec->br_, &width, &height, &has_alpha)) {
     dec->status_ = VP8_STATUS_BITSTREAM_ERROR;
     goto Error;
@@ -1663,6 +2119,63 @@ int VP8LDecodeHeader(VP8LDecoder* const dec, VP8Io* const io) {
   return 0;
 }
 
+// Resets the decoder to the start of the image data, with a window covering
+// all of the back-references. Returns false in case of error.
+static int RestartWithLargerWindow(VP8LDecoder* const dec,
+                                   const WebPDecParams* const params) {
+  VP8Io* const io = dec->io_;
+  VP8LColorCache* const color_cache = &dec->hdr_.color_cache_;
+  int window_rows;
+
+  assert(!dec->incremental_);
+  dec->br_ = dec->saved_br_;
+  if (!GetWindowRows(dec, &window_rows)) return 0;
+  dec->br_ = dec->saved_br_;
+  dec->status_ = VP8_STATUS_OK;
+  dec->last_pixel_ = 0;
+  dec->last_row_ = 0;
+  dec->last_out_row_ = 0;
+  if (dec->hdr_.color_cache_size_ > 0) {
+    memset(color_cache->colors_, 0,
+           sizeof(*color_cache->colors_) << color_cache->hash_bits_);
+  }
+
+  WebPAllocatorFree(dec->allocator_, dec->pixels_);
+  dec->pixels_ = NULL;
+  InitPixelWindow(dec, window_rows);
+  if (!AllocateInternalBuffers32b(dec, io->width)) return 0;
+
+  // Rows may have been emitted already: restore 'io' and the rescaler.
+  if (!WebPIoInitFromOptions(params->options, io, MODE_BGRA)) {
+    dec->status_ = VP8_STATUS_INVALID_PARAM;
+    return 0;
+  }
+#if !defined(WEBP_REDUCE_SIZE)
+  if (io->use_scaling) {
+    WebPAllocatorFree(dec->allocator_, dec->rescaler_memory);
+    dec->rescaler_memory = NULL;
+    if (!AllocateAndInitRescaler(dec, io)) return 0;
+  }
+#endif
+  return 1;
+}
+
+uint64_t VP8LGetMemorySize(const VP8Io* const io,
+                           const WebPDecoderOptions* const options) {
+  // The pixels of the whole image, plus the top row and the cache rows.
+  uint64_t size = ((uint64_t)io->width * io->height +
+                   (uint64_t)io->width * (1 + NUM_ARGB_CACHE_ROWS)) *
+                  sizeof(uint32_t);
+#if !defined(WEBP_REDUCE_SIZE)
+  if (io->use_scaling) {
+    size += GetRescalerMemorySize(io, options != NULL && options->use_threads);
+  }
+#else
+  (void)options;
+#endif
+  return size;
+}
+
 int VP8LDecodeImage(VP8LDecoder* const dec) {
   VP8Io* io = NULL;
   WebPDecParams* params = NULL;
@@ -1689,9 +2202,26 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
       goto Err;
     }
 
+    if (!io->use_scaling && WebPIsRGBMode(dec->output_->colorspace) &&
+        !WebPIs16bMode(dec->output_->colorspace) && IsPaletteOnly(dec)) {
+      InitPaletteOutput(dec, dec->output_->colorspace);
+    }
+
+    if (!dec->incremental_ && params->options != NULL &&
+        params->options->lossless_window_rows != 0) {
+      int window_rows = params->options->lossless_window_rows;
+      dec->saved_br_ = dec->br_;    // start of the image data
+      if (window_rows < 0) {
+        if (!GetWindowRows(dec, &window_rows)) goto Err;
+        dec->br_ = dec->saved_br_;
+      }
+      InitPixelWindow(dec, window_rows);
+    }
+
     if (!AllocateInternalBuffers32b(dec, io->width)) goto Err;
 
 #if !defined(WEBP_REDUCE_SIZE)
+    InitEmitWorker(dec, params->options);
     if (io->use_scaling && !AllocateAndInitRescaler(dec, io)) goto Err;
 #else
     if (io->use_scaling) {
@@ -1699,8 +2229,10 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
       goto Err;
     }
 #endif
-    if (io->use_scaling || WebPIsPremultipliedMode(dec->output_->colorspace)) {
-      // need the alpha-multiply functions for premultiplied output or rescaling
+    if (io->use_scaling || WebPIsPremultipliedMode(dec->output_->colorspace) ||
+        WebPIs16bMode(dec->output_->colorspace)) {
+      // need the alpha-multiply functions for premultiplied output or
+      // rescaling, and the 8b -> 16b conversions
       WebPInitAlphaProcessing();
     }
 
@@ -1716,6 +2248,9 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
           dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
           goto Err;
         }
+        // Both caches are empty before the first pixel.
+        assert(dec->last_pixel_ == 0);
+        dec->saved_last_pixel_ = 0;
       }
     }
     dec->state_ = READ_DATA;
@@ -1723,10 +2258,23 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
 
   // Decode.
   if (!DecodeImageData(dec, dec->pixels_, dec->width_, dec->height_,
-                       io->crop_bottom, ProcessRows)) {
-    goto Err;
+                       io->crop_bottom,
+                       (dec->palette_bpp_ > 0) ? ProcessPalettedRows
+                                               : ProcessRows)) {
+    SyncEmitWorker(dec);
+    // A back-reference went beyond the window: fall back to scanning the
+    // image first and decoding it again with a large enough window.
+    if (!dec->window_exceeded_ || !RestartWithLargerWindow(dec, params) ||
+        !DecodeImageData(dec, dec->pixels_, dec->width_, dec->height_,
+                         io->crop_bottom,
+                         (dec->palette_bpp_ > 0) ? ProcessPalettedRows
+                                                 : ProcessRows)) {
+      goto Err;
+    }
   }
 
+  SyncEmitWorker(dec);   // the last queued rows must be output
+  assert(dec->last_out_row_ <= dec->output_->height);
   params->last_y = dec->last_out_row_;
   return 1;
 
@@ -1736,4 +2284,68 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
   return 0;
 }
 
+int VP8LDecodeIndexedImage(VP8LDecoder* const dec,
+                           uint8_t* const indices, int stride,
+                           uint8_t* const palette) {
+  VP8Io* io = NULL;
+  WebPDecBuffer output;
+  int i;
+
+  // Sanity checks.
+  if (dec == NULL) return 0;
+  if (indices == NULL || palette == NULL) {
+    dec->status_ = VP8_STATUS_INVALID_PARAM;
+    goto Err;
+  }
+  if (!IsPaletteOnly(dec)) {
+    dec->status_ = VP8_STATUS_UNSUPPORTED_FEATURE;
+    goto Err;
+  }
+  io = dec->io_;
+  assert(io != NULL);
+  assert(dec->state_ != READ_DATA);
+
+  // The palette indices are mapped through an identity 'palette', and only
+  // the RGBA view of 'output' is used.
+  WebPInitDecBuffer(&output);
+  output.colorspace = MODE_RGBA;
+  output.width = io->width;
+  output.height = io->height;
+  output.u.RGBA.rgba = indices;
+  output.u.RGBA.stride = stride;
+  output.u.RGBA.size = (size_t)stride * io->height;
+  output.is_external_memory = 1;
+  dec->output_ = &output;
+
+  if (!WebPIoInitFromOptions(NULL, io, MODE_BGRA)) {
+    dec->status_ = VP8_STATUS_INVALID_PARAM;
+    goto Err;
+  }
+  InitPaletteOutput(dec, MODE_RGBA);
+  memcpy(palette, dec->palette_out_, sizeof(dec->palette_out_));
+  if (dec->transforms_[0].bits_ > 0) {
+    // Only the first 1 << (8 >> bits) entries are reachable, the rest is
+    // transparent black.
+    const int num_colors = 1 << (8 >> dec->transforms_[0].bits_);
+    memset(palette + 4 * num_colors, 0, 4 * (256 - num_colors));
+  }
+  for (i = 0; i < 256; ++i) dec->palette_out_[i] = (uint8_t)i;
+  dec->palette_bpp_ = 1;
+
+  if (!AllocateInternalBuffers32b(dec, io->width)) goto Err;
+  dec->state_ = READ_DATA;
+
+  if (!DecodeImageData(dec, dec->pixels_, dec->width_, dec->height_,
+                       io->crop_bottom, ProcessPalettedRows)) {
+    goto Err;
+  }
+  dec->output_ = NULL;
+  return 1;
+
+ Err:
+  VP8LClear(dec);
+  assert(dec->status_ != VP8_STATUS_OK);
+  return 0;
+}
+
 //------------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 #include "src/utils/bit_reader_utils.h"
 #include "src/utils/color_cache_utils.h"
 #include "src/utils/huffman_utils.h"
+#include "src/utils/thread_utils.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -70,6 +71,8 @@ struct VP8LDecoder {
   int              incremental_;   // if true, incremental decoding is expected
   VP8LBitReader    saved_br_;      // note: could be local variables too
   int              saved_last_pixel_;
+  size_t           redo_size_;     // bytes read in vain past the last
+                                   // check-point, when suspended
 
   int              width_;
   int              height_;
@@ -79,6 +82,15 @@ struct VP8LDecoder {
                                    // color-converted yet.
   int              last_out_row_;  // last row output so far.
 
+  // Windowed decoding (see WebPDecoderOptions::lossless_window_rows): pixels_
+  // only holds 'num_pixel_rows_' rows, starting at row 'first_pixel_row_'.
+  int              window_rows_;      // rows kept for back-references, or 0
+                                      // when the whole image is stored.
+  int              first_pixel_row_;
+  int              num_pixel_rows_;
+  int              window_exceeded_;  // true if a back-reference went beyond
+                                      // the window.
+
   VP8LMetadata     hdr_;
 
   int              next_transform_;
@@ -88,6 +100,25 @@ struct VP8LDecoder {
 
   uint8_t*         rescaler_memory;  // Working memory for rescaling work.
   WebPRescaler*    rescaler;         // Common rescaler for all channels.
+
+  // Allocator of the working memory above (io->allocator, NULL by default).
+  const WebPAllocator* allocator_;
+
+  // Multi-threaded rescaling (WebPDecoderOptions::use_threads): a copy of the
+  // rows of argb_cache_ is rescaled and color-converted by 'emit_worker_',
+  // while the next rows are being decoded.
+  int              emit_mt_;         // true if emit_worker_ is in use
+  uint8_t*         emit_rows_;       // rows handed over to emit_worker_
+  int              emit_num_rows_;
+
+  // Direct output for color-indexed images: the packed palette indices are
+  // mapped straight to the output samples, without using argb_cache_.
+  int              palette_bpp_;     // Bytes per output sample, or 0 if the
+                                     // direct output is not used.
+  uint8_t          palette_out_[256 * 4];  // Palette, in output colorspace.
+
+  // The fields below are kept by VP8LResetDecoder(), and must come last.
+  WebPWorker       emit_worker_;
 };
 
 //------------------------------------------------------------------------------
@@ -119,10 +150,30 @@ int VP8LDecodeHeader(VP8LDecoder* const dec, VP8Io* const io);
 // this function. Returns false in case of error, with updated dec->status_.
 int VP8LDecodeImage(VP8LDecoder* const dec);
 
+// Returns an upper bound of the memory VP8LDecodeImage() allocates for
+// decoding the pixels, once 'io' is set up by WebPIoInitFromOptions().
+uint64_t VP8LGetMemorySize(const VP8Io* const io,
+                           const WebPDecoderOptions* const options);
+
+// Decodes an image whose only transform is a color-indexing one into a plane
+// of 8-bit palette indices (with stride 'stride'), and stores the palette as
+// 256 non-premultiplied RGBA entries in 'palette'. It's required to decode the
+// lossless header before calling this function. Returns false in case of
+// error, with updated dec->status_ (VP8_STATUS_UNSUPPORTED_FEATURE if the
+// image is not palette-based).
+int VP8LDecodeIndexedImage(VP8LDecoder* const dec,
+                           uint8_t* const indices, int stride,
+                           uint8_t* const palette);
+
 // Resets the decoder in its initial state, reclaiming memory.
 // Preserves the dec->status_ value.
 void VP8LClear(VP8LDecoder* const dec);
 
+// Prepares the decoder for another picture, as if it was just created, but
+// keeping the thread of emit_worker_. The memory is released to
+// dec->allocator_, which may recycle it.
+void VP8LResetDecoder(VP8LDecoder* const dec);
+
 // Clears and deallocate a lossless decoder instance.
 void VP8LDelete(VP8LDecoder* const dec);
 
@@ -443,12 +443,97 @@ void WebPResetDecParams(WebPDecParams* const params) {
 //------------------------------------------------------------------------------
 // "Into" decoding variants
 
-// Main flow
-static VP8StatusCode DecodeInto(const uint8_t* const data, size_t data_size,
-                                WebPDecParams* const params) {
+struct WebPDecoderContext {
+  VP8Decoder* vp8_;         // created on first use, and reset after each picture
+  VP8LDecoder* vp8l_;
+  WebPBlockCache cache_;    // recycles the memory released by the decoders
+  WebPMemoryCounter counter_;   // measures the memory taken from 'cache_'
+};
+
+static VP8Decoder* GetVP8Decoder(WebPDecoderContext* const context) {
+  if (context == NULL) return VP8New();
+  if (context->vp8_ == NULL) context->vp8_ = VP8New();
+  return context->vp8_;
+}
+
+static VP8LDecoder* GetVP8LDecoder(WebPDecoderContext* const context) {
+  if (context == NULL) return VP8LNew();
+  if (context->vp8l_ == NULL) context->vp8l_ = VP8LNew();
+  return context->vp8l_;
+}
+
+// Returns an upper bound of the memory that remains to be allocated, output
+// buffer included, once the headers of the picture are decoded into 'io'.
+// 'vp8' is the decoder of a lossy picture, NULL for a lossless one.
+static uint64_t GetPendingMemorySize(const VP8Io* const io,
+                                     const VP8Decoder* const vp8,
+                                     const WebPDecoderOptions* const options,
+                                     const WebPDecBuffer* const output) {
+  VP8Io tmp_io = *io;
+  uint64_t size = 0;
+  if (!WebPIoInitFromOptions(options, &tmp_io,
+                             (vp8 != NULL) ? MODE_YUV : MODE_BGRA)) {
+    return 0;   // invalid options, reported when allocating the output
+  }
+  if (vp8 != NULL) {
+    // The main memory chunk of the decoder is only reallocated if too small.
+    const uint64_t frame_size = VP8GetMemorySize(vp8, vp8->mt_method_);
+    if (frame_size > vp8->mem_size_) size += frame_size - vp8->mem_size_;
+    size += WebPIoGetMemorySize(&tmp_io, output->colorspace);
+  } else {
+    size += VP8LGetMemorySize(&tmp_io, options);
+  }
+  if (output->is_external_memory <= 0 && output->private_memory == NULL) {
+    size += tmp_io.use_scaling ?
+        WebPGetDecBufferSize(tmp_io.scaled_width, tmp_io.scaled_height,
+                             output->colorspace) :
+        WebPGetDecBufferSize(tmp_io.mb_w, tmp_io.mb_h, output->colorspace);
+  }
+  return size;
+}
+
+// Allocates the output buffer, if the memory still needed fits in the budget
+// of 'counter'. The size of the allocation is stored in '*output_size'.
+static VP8StatusCode AllocateOutput(const VP8Io* const io,
+                                    const VP8Decoder* const vp8,
+                                    WebPDecParams* const params,
+                                    WebPMemoryCounter* const counter,
+                                    uint64_t* const output_size) {
+  WebPDecBuffer* const output = params->output;
+  const int is_allocated =
+      (output->is_external_memory <= 0 && output->private_memory == NULL);
+  VP8StatusCode status;
+  if (counter->budget_ > 0 &&
+      counter->used_ + GetPendingMemorySize(io, vp8, params->options, output) >
+          counter->budget_) {
+    counter->over_budget_ = 1;
+    return VP8_STATUS_OVER_MEMORY_BUDGET;
+  }
+  status = WebPAllocateDecBuffer(io->width, io->height, params->options,
+                                 output);
+  if (status == VP8_STATUS_OK && is_allocated) {
+    const uint64_t size = WebPGetDecBufferSize(output->width, output->height,
+                                               output->colorspace);
+    if (!WebPMemoryCounterAdd(counter, size)) {
+      return VP8_STATUS_OVER_MEMORY_BUDGET;
+    }
+    *output_size = size;
+  }
+  return status;
+}
+
+// Main flow. 'context' and 'peak_memory' can be NULL.
+static VP8StatusCode DecodeWithContext(const uint8_t* const data,
+                                       size_t data_size,
+                                       WebPDecParams* const params,
+                                       WebPDecoderContext* const context,
+                                       size_t* const peak_memory) {
   VP8StatusCode status;
   VP8Io io;
   WebPHeaderStructure headers;
+  WebPMemoryCounter local_counter;
+  WebPMemoryCounter* counter;
+  uint64_t output_size = 0;
 
   headers.data = data;
   headers.data_size = data_size;
@@ -462,10 +547,20 @@ static VP8StatusCode DecodeInto(const uint8_t* const data, size_t data_size,
   VP8InitIo(&io);
   io.data = headers.data + headers.offset;
   io.data_size = headers.data_size - headers.offset;
+  if (params->options != NULL) io.allocator = params->options->allocator;
+  if (io.allocator == NULL && context != NULL) {
+    counter = &context->counter_;
+  } else {
+    counter = &local_counter;
+    WebPMemoryCounterInit(counter, io.allocator);
+  }
+  WebPMemoryCounterReset(counter, (params->options != NULL) ?
+                                      params->options->memory_budget : 0);
+  io.allocator = &counter->allocator_;
   WebPInitCustomIo(params, &io);  // Plug the I/O functions.
 
   if (!headers.is_lossless) {
-    VP8Decoder* const dec = VP8New();
+    VP8Decoder* const dec = GetVP8Decoder(context);
     if (dec == NULL) {
       return VP8_STATUS_OUT_OF_MEMORY;
     }
@@ -476,22 +571,26 @@ static VP8StatusCode DecodeInto(const uint8_t* const data, size_t data_size,
     if (!VP8GetHeaders(dec, &io)) {
       status = dec->status_;   // An error occurred. Grab error status.
     } else {
+      // This change must be done before calling VP8Decode()
+      dec->mt_method_ = VP8GetThreadMethod(params->options, &headers,
+                                           io.width, io.height);
       // Allocate/check output buffers.
-      status = WebPAllocateDecBuffer(io.width, io.height, params->options,
-                                     params->output);
+      status = AllocateOutput(&io, dec, params, counter, &output_size);
       if (status == VP8_STATUS_OK) {  // Decode
-        // This change must be done before calling VP8Decode()
-        dec->mt_method_ = VP8GetThreadMethod(params->options, &headers,
-                                             io.width, io.height);
         VP8InitDithering(params->options, dec);
         if (!VP8Decode(dec, &io)) {
           status = dec->status_;
         }
       }
     }
-    VP8Delete(dec);
+    if (context != NULL) {
+      // Memory from the caller's allocator isn't kept for the next call.
+      VP8ResetDecoder(dec, counter == &context->counter_);
+    } else {
+      VP8Delete(dec);
+    }
   } else {
-    VP8LDecoder* const dec = VP8LNew();
+    VP8LDecoder* const dec = GetVP8LDecoder(context);
     if (dec == NULL) {
       return VP8_STATUS_OUT_OF_MEMORY;
     }
@@ -499,16 +598,26 @@ static VP8StatusCode DecodeInto(const uint8_t* const data, size_t data_size,
       status = dec->status_;   // An error occurred. Grab error status.
     } else {
       // Allocate/check output buffers.
-      status = WebPAllocateDecBuffer(io.width, io.height, params->options,
-                                     params->output);
+      status = AllocateOutput(&io, NULL, params, counter, &output_size);
       if (status == VP8_STATUS_OK) {  // Decode
         if (!VP8LDecodeImage(dec)) {
           status = dec->status_;
         }
       }
     }
-    VP8LDelete(dec);
+    if (context != NULL) {
+      VP8LResetDecoder(dec);
+    } else {
+      VP8LDelete(dec);
+    }
+  }
+
+  // A refused allocation surfaces as a memory error.
+  if (status != VP8_STATUS_OK && counter->over_budget_) {
+    status = VP8_STATUS_OVER_MEMORY_BUDGET;
   }
+  if (peak_memory != NULL) *peak_memory = (size_t)counter->peak_;
+  WebPMemoryCounterRemove(counter, output_size);   // not ours anymore
 
   if (status != VP8_STATUS_OK) {
     WebPFreeDecBuffer(params->output);
@@ -522,6 +631,11 @@ static VP8StatusCode DecodeInto(const uint8_t* const data, size_t data_size,
   return status;
 }
 
+static VP8StatusCode DecodeInto(const uint8_t* const data, size_t data_size,
+                                WebPDecParams* const params) {
+  return DecodeWithContext(data, data_size, params, NULL, NULL);
+}
+
 // Helpers
 static uint8_t* DecodeIntoRGBABuffer(WEBP_CSP_MODE colorspace,
                                      const uint8_t* const data,
@@ -673,6 +787,49 @@ uint8_t* WebPDecodeYUV(const uint8_t* data, size_t data_size,
   return out;
 }
 
+uint8_t* WebPDecodeIndexed(const uint8_t* data, size_t data_size,
+                           int* width, int* height,
+                           uint8_t* palette, int* palette_size) {
+  VP8StatusCode status;
+  VP8Io io;
+  WebPHeaderStructure headers;
+  VP8LDecoder* dec;
+  uint8_t* indices = NULL;
+
+  if (palette == NULL) return NULL;
+  headers.data = data;
+  headers.data_size = data_size;
+  headers.have_all_data = 1;
+  status = WebPParseHeaders(&headers);   // Process Pre-VP8 chunks.
+  if (status != VP8_STATUS_OK || !headers.is_lossless) {
+    return NULL;
+  }
+
+  VP8InitIo(&io);
+  io.data = headers.data + headers.offset;
+  io.data_size = headers.data_size - headers.offset;
+
+  dec = VP8LNew();
+  if (dec == NULL) return NULL;
+  if (VP8LDecodeHeader(dec, &io)) {
+    indices = (uint8_t*)WebPSafeMalloc((uint64_t)io.width * io.height,
+                                       sizeof(*indices));
+    if (indices != NULL &&
+        !VP8LDecodeIndexedImage(dec, indices, io.width, palette)) {
+      WebPSafeFree(indices);
+      indices = NULL;
+    }
+  }
+  if (indices != NULL) {
+    const int bits = dec->transforms_[0].bits_;
+    if (width != NULL) *width = io.width;
+    if (height != NULL) *height = io.height;
+    if (palette_size != NULL) *palette_size = 1 << (8 >> bits);
+  }
+  VP8LDelete(dec);
+  return indices;
+}
+
 static void DefaultFeatures(WebPBitstreamFeatures* const features) {
   assert(features != NULL);
   memset(features, 0, sizeof(*features));
@@ -742,8 +899,9 @@ VP8StatusCode WebPGetFeaturesInternal(const uint8_t* data, size_t data_size,
   return GetFeatures(data, data_size, features);
 }
 
-VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
-                         WebPDecoderConfig* config) {
+static VP8StatusCode DecodeConfig(const uint8_t* data, size_t data_size,
+                                  WebPDecoderConfig* const config,
+                                  WebPDecoderContext* const context) {
   WebPDecParams params;
   VP8StatusCode status;
 
@@ -770,21 +928,141 @@ VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
     in_mem_buffer.width = config->input.width;
     in_mem_buffer.height = config->input.height;
     params.output = &in_mem_buffer;
-    status = DecodeInto(data, data_size, &params);
+    status = DecodeWithContext(data, data_size, &params, context,
+                               &config->peak_memory);
     if (status == VP8_STATUS_OK) {  // do the slow-copy
       status = WebPCopyDecBufferPixels(&in_mem_buffer, &config->output);
     }
     WebPFreeDecBuffer(&in_mem_buffer);
   } else {
-    status = DecodeInto(data, data_size, &params);
+    status = DecodeWithContext(data, data_size, &params, context,
+                               &config->peak_memory);
+  }
+
+  return status;
+}
+
+VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
+                         WebPDecoderConfig* config) {
+  return DecodeConfig(data, data_size, config, NULL);
+}
+
+VP8StatusCode WebPEstimateDecodeMemory(const uint8_t* data, size_t data_size,
+                                       const WebPDecoderConfig* config,
+                                       size_t* memory_size) {
+  WebPBitstreamFeatures features;
+  WebPHeaderStructure headers;
+  WebPDecBuffer output;
+  WebPMemoryCounter counter;
+  VP8Io io;
+  uint64_t size = 0;
+  VP8StatusCode status;
+
+  if (config == NULL || memory_size == NULL) {
+    return VP8_STATUS_INVALID_PARAM;
+  }
+  status = GetFeatures(data, data_size, &features);
+  if (status != VP8_STATUS_OK) {
+    if (status == VP8_STATUS_NOT_ENOUGH_DATA) {
+      return VP8_STATUS_BITSTREAM_ERROR;  // Not-enough-data treated as error.
+    }
+    return status;
+  }
+  headers.data = data;
+  headers.data_size = data_size;
+  headers.have_all_data = 1;
+  status = WebPParseHeaders(&headers);
+  if (status != VP8_STATUS_OK) {
+    return status;
   }
 
+  output = config->output;
+  if (WebPAvoidSlowMemory(&output, &features)) {
+    // WebPDecode() goes through a temporary in-mem buffer.
+    output.is_external_memory = 0;
+    output.private_memory = NULL;
+  }
+  // The memory taken by the headers is measured, the rest is computed.
+  WebPMemoryCounterInit(&counter, config->options.allocator);
+  VP8InitIo(&io);
+  io.data = headers.data + headers.offset;
+  io.data_size = headers.data_size - headers.offset;
+  io.allocator = &counter.allocator_;
+  if (!headers.is_lossless) {
+    VP8Decoder* const dec = VP8New();
+    if (dec == NULL) {
+      return VP8_STATUS_OUT_OF_MEMORY;
+    }
+    dec->alpha_data_ = headers.alpha_data;
+    dec->alpha_data_size_ = headers.alpha_data_size;
+    if (!VP8GetHeaders(dec, &io)) {
+      status = dec->status_;
+    } else {
+      dec->mt_method_ = VP8GetThreadMethod(&config->options, &headers,
+                                           io.width, io.height);
+      size = counter.used_ +
+             GetPendingMemorySize(&io, dec, &config->options, &output);
+    }
+    VP8Delete(dec);
+  } else {
+    VP8LDecoder* const dec = VP8LNew();
+    if (dec == NULL) {
+      return VP8_STATUS_OUT_OF_MEMORY;
+    }
+    if (!VP8LDecodeHeader(dec, &io)) {
+      status = dec->status_;
+    } else {
+      size = counter.used_ +
+             GetPendingMemorySize(&io, NULL, &config->options, &output);
+    }
+    VP8LDelete(dec);
+  }
+  if (status == VP8_STATUS_OK) {
+    if (size < counter.peak_) size = counter.peak_;
+    *memory_size = (size == (size_t)size) ? (size_t)size : ~(size_t)0;
+  }
   return status;
 }
 
+//------------------------------------------------------------------------------
+// Decoder contexts
+
+WebPDecoderContext* WebPDecoderContextNew(void) {
+  WebPDecoderContext* const context =
+      (WebPDecoderContext*)WebPSafeCalloc(1ULL, sizeof(*context));
+  if (context != NULL) {
+    WebPBlockCacheInit(&context->cache_);
+    WebPMemoryCounterInit(&context->counter_, &context->cache_.allocator_);
+  }
+  return context;
+}
+
+void WebPDecoderContextDelete(WebPDecoderContext* context) {
+  if (context == NULL) return;
+  VP8Delete(context->vp8_);
+  VP8LDelete(context->vp8l_);
+  WebPBlockCacheClear(&context->cache_);
+  WebPSafeFree(context);
+}
+
+VP8StatusCode WebPDecodeWithContext(WebPDecoderContext* context,
+                                    const uint8_t* data, size_t data_size,
+                                    WebPDecoderConfig* config) {
+  if (context == NULL) return VP8_STATUS_INVALID_PARAM;
+  return DecodeConfig(data, data_size, config, context);
+}
+
 //------------------------------------------------------------------------------
 // Cropping and rescaling.
 
+// Rescaler kernel of each WEBP_SCALING_FILTER option.
+static const WebPRescalerFilter kRescalerFilters[WEBP_SCALING_FILTER_LAST] = {
+  WEBP_RESCALER_AREA,       // WEBP_SCALING_DEFAULT
+  WEBP_RESCALER_BOX,        // WEBP_SCALING_BOX
+  WEBP_RESCALER_BILINEAR,   // WEBP_SCALING_BILINEAR
+  WEBP_RESCALER_LANCZOS3    // WEBP_SCALING_LANCZOS3
+};
+
 int WebPIoInitFromOptions(const WebPDecoderOptions* const options,
                           VP8Io* const io, WEBP_CSP_MODE src_colorspace) {
   const int W = io->width;
@@ -823,6 +1101,12 @@ int WebPIoInitFromOptions(const WebPDecoderOptions* const options,
     }
     io->scaled_width = scaled_width;
     io->scaled_height = scaled_height;
+    if (options->scaling_filter < WEBP_SCALING_DEFAULT ||
+        options->scaling_filter >= WEBP_SCALING_FILTER_LAST) {
+      return 0;
+    }
+    io->scaling_filter = kRescalerFilters[options->scaling_filter];
+    io->linear_scaling = (options->linear_scaling != 0);
   }
 
   // Filter
@@ -19,6 +19,7 @@ extern "C" {
 #endif
 
 #include "src/utils/rescaler_utils.h"
+#include "src/utils/thread_utils.h"
 #include "src/dec/vp8_dec.h"
 
 //------------------------------------------------------------------------------
@@ -41,6 +42,8 @@ struct WebPDecParams {
 
   WebPRescaler* scaler_y, *scaler_u, *scaler_v, *scaler_a;  // rescalers
   void* memory;                  // overall scratch memory for the output work.
+  WebPWorker scaler_worker;      // rescales the luma plane, if 'scaler_mt'
+  int scaler_mt;                 // true if 'scaler_worker' is in use
 
   OutputFunc emit;               // output RGB or YUV samples
   OutputAlphaFunc emit_alpha;    // output alpha channel
@@ -86,6 +89,10 @@ void WebPInitCustomIo(WebPDecParams* const params, VP8Io* const io);
 int WebPIoInitFromOptions(const WebPDecoderOptions* const options,
                           VP8Io* const io, WEBP_CSP_MODE src_colorspace);
 
+// Returns the size of the scratch memory allocated by the custom setup() for
+// an output in 'colorspace', once 'io' is set up by WebPIoInitFromOptions().
+uint64_t WebPIoGetMemorySize(const VP8Io* const io, WEBP_CSP_MODE colorspace);
+
 //------------------------------------------------------------------------------
 // Internal functions regarding WebPDecBuffer memory (in buffer.c).
 // Don't really need to be externally visible for now.
@@ -119,6 +126,10 @@ void WebPGrabDecBuffer(WebPDecBuffer* const src, WebPDecBuffer* const dst);
 VP8StatusCode WebPCopyDecBufferPixels(const WebPDecBuffer* const src,
                                       WebPDecBuffer* const dst);
 
+// Returns the size of the memory allocated by WebPAllocateDecBuffer() for a
+// 'width' x 'height' picture in 'colorspace' (after cropping and scaling).
+uint64_t WebPGetDecBufferSize(int width, int height, WEBP_CSP_MODE colorspace);
+
 // Returns true if decoding will be slow with the current configuration
 // and bitstream features.
 int WebPAvoidSlowMemory(const WebPDecBuffer* const output,
@@ -50,7 +50,6 @@ typedef struct Frame {
   int frame_num_;
   int complete_;   // img_components_ contains a full image.
   ChunkData img_components_[2];  // 0=VP8{,L} 1=ALPH
-  struct Frame* next_;
 } Frame;
 
 typedef struct Chunk {
@@ -67,8 +66,8 @@ struct WebPDemuxer {
   int loop_count_;
   uint32_t bgcolor_;
   int num_frames_;
-  Frame* frames_;
-  Frame** frames_tail_;
+  Frame* frames_;  // frame table, indexed by frame number - 1
+  int frames_size_;  // allocated size of frames_
   Chunk* chunks_;  // non-image chunks
   Chunk** chunks_tail_;
 };
@@ -180,15 +179,27 @@ static void AddChunk(WebPDemuxer* const dmux, Chunk* const chunk) {
   dmux->chunks_tail_ = &chunk->next_;
 }
 
-// Add a frame to the end of the list, ensuring the last frame is complete.
+// Copy a frame to the end of the table, ensuring the last frame is complete.
 // Returns true on success, false otherwise.
-static int AddFrame(WebPDemuxer* const dmux, Frame* const frame) {
-  const Frame* const last_frame = *dmux->frames_tail_;
-  if (last_frame != NULL && !last_frame->complete_) return 0;
+static int AddFrame(WebPDemuxer* const dmux, const Frame* const frame) {
+  if (dmux->num_frames_ > 0 &&
+      !dmux->frames_[dmux->num_frames_ - 1].complete_) {
+    return 0;
+  }
 
-  *dmux->frames_tail_ = frame;
-  frame->next_ = NULL;
-  dmux->frames_tail_ = &frame->next_;
+  if (dmux->num_frames_ == dmux->frames_size_) {
+    const int new_size = (dmux->frames_size_ > 0) ? 2 * dmux->frames_size_
+                                                  : 8;
+    Frame* const frames = (Frame*)WebPSafeMalloc(new_size, sizeof(*frames));
+    if (frames == NULL) return 0;
+    if (dmux->num_frames_ > 0) {
+      memcpy(frames, dmux->frames_, dmux->num_frames_ * sizeof(*frames));
+    }
+    WebPSafeFree(dmux->frames_);
+    dmux->frames_ = frames;
+    dmux->frames_size_ = new_size;
+  }
+  dmux->frames_[dmux->num_frames_++] = *frame;
   return 1;
 }
 
@@ -287,19 +298,19 @@ static ParseStatus StoreFrame(int frame_num, uint32_t min_size,
   return status;
 }
 
-// Creates a new Frame if 'actual_size' is within bounds and 'mem' contains
+// Clears 'frame' if 'actual_size' is within bounds and 'mem' contains
 // enough data ('min_size') to parse the payload.
-// Returns PARSE_OK on success with *frame pointing to the new Frame.
+// Returns PARSE_OK on success.
 // Returns PARSE_NEED_MORE_DATA with insufficient data, PARSE_ERROR otherwise.
 static ParseStatus NewFrame(const MemBuffer* const mem,
                             uint32_t min_size, uint32_t actual_size,
-                            Frame** frame) {
+                            Frame* const frame) {
   if (SizeIsInvalid(mem, min_size)) return PARSE_ERROR;
   if (actual_size < min_size) return PARSE_ERROR;
   if (MemDataSize(mem) < min_size)  return PARSE_NEED_MORE_DATA;
 
-  *frame = (Frame*)WebPSafeCalloc(1ULL, sizeof(**frame));
-  return (*frame == NULL) ? PARSE_ERROR : PARSE_OK;
+  memset(frame, 0, sizeof(*frame));
+  return PARSE_OK;
 }
 
 // Parse a 'ANMF' chunk and any image bearing chunks that immediately follow.
@@ -308,41 +319,32 @@ static ParseStatus ParseAnimationFrame(
     WebPDemuxer* const dmux, uint32_t frame_chunk_size) {
   const int is_animation = !!(dmux->feature_flags_ & ANIMATION_FLAG);
   const uint32_t anmf_payload_size = frame_chunk_size - ANMF_CHUNK_SIZE;
-  int added_frame = 0;
   int bits;
   MemBuffer* const mem = &dmux->mem_;
-  Frame* frame;
+  Frame frame;
   ParseStatus status =
       NewFrame(mem, ANMF_CHUNK_SIZE, frame_chunk_size, &frame);
   if (status != PARSE_OK) return status;
 
-  frame->x_offset_       = 2 * ReadLE24s(mem);
-  frame->y_offset_       = 2 * ReadLE24s(mem);
-  frame->width_          = 1 + ReadLE24s(mem);
-  frame->height_         = 1 + ReadLE24s(mem);
-  frame->duration_       = ReadLE24s(mem);
+  frame.x_offset_       = 2 * ReadLE24s(mem);
+  frame.y_offset_       = 2 * ReadLE24s(mem);
+  frame.width_          = 1 + ReadLE24s(mem);
+  frame.height_         = 1 + ReadLE24s(mem);
+  frame.duration_       = ReadLE24s(mem);
   bits = ReadByte(mem);
-  frame->dispose_method_ =
+  frame.dispose_method_ =
       (bits & 1) ? WEBP_MUX_DISPOSE_BACKGROUND : WEBP_MUX_DISPOSE_NONE;
-  frame->blend_method_ = (bits & 2) ? WEBP_MUX_NO_BLEND : WEBP_MUX_BLEND;
-  if (frame->width_ * (uint64_t)frame->height_ >= MAX_IMAGE_AREA) {
-    WebPSafeFree(frame);
+  frame.blend_method_ = (bits & 2) ? WEBP_MUX_NO_BLEND : WEBP_MUX_BLEND;
+  if (frame.width_ * (uint64_t)frame.height_ >= MAX_IMAGE_AREA) {
     return PARSE_ERROR;
   }
 
   // Store a frame only if the animation flag is set there is some data for
   // this frame is available.
-  status = StoreFrame(dmux->num_frames_ + 1, anmf_payload_size, mem, frame);
-  if (status != PARSE_ERROR && is_animation && frame->frame_num_ > 0) {
-    added_frame = AddFrame(dmux, frame);
-    if (added_frame) {
-      ++dmux->num_frames_;
-    } else {
-      status = PARSE_ERROR;
-    }
+  status = StoreFrame(dmux->num_frames_ + 1, anmf_payload_size, mem, &frame);
+  if (status != PARSE_ERROR && is_animation && frame.frame_num_ > 0) {
+    if (!AddFrame(dmux, &frame)) status = PARSE_ERROR;
   }
-
-  if (!added_frame) WebPSafeFree(frame);
   return status;
 }
 
@@ -392,46 +394,37 @@ static ParseStatus ReadHeader(MemBuffer* const mem) {
 static ParseStatus ParseSingleImage(WebPDemuxer* const dmux) {
   const size_t min_size = CHUNK_HEADER_SIZE;
   MemBuffer* const mem = &dmux->mem_;
-  Frame* frame;
+  Frame frame;
   ParseStatus status;
-  int image_added = 0;
 
-  if (dmux->frames_ != NULL) return PARSE_ERROR;
+  if (dmux->num_frames_ > 0) return PARSE_ERROR;
   if (SizeIsInvalid(mem, min_size)) return PARSE_ERROR;
   if (MemDataSize(mem) < min_size) return PARSE_NEED_MORE_DATA;
 
-  frame = (Frame*)WebPSafeCalloc(1ULL, sizeof(*frame));
-  if (frame == NULL) return PARSE_ERROR;
+  memset(&frame, 0, sizeof(frame));
 
   // For the single image case we allow parsing of a partial frame, so no
   // minimum size is imposed here.
-  status = StoreFrame(1, 0, &dmux->mem_, frame);
+  status = StoreFrame(1, 0, &dmux->mem_, &frame);
   if (status != PARSE_ERROR) {
     const int has_alpha = !!(dmux->feature_flags_ & ALPHA_FLAG);
     // Clear any alpha when the alpha flag is missing.
-    if (!has_alpha && frame->img_components_[1].size_ > 0) {
-      frame->img_components_[1].offset_ = 0;
-      frame->img_components_[1].size_ = 0;
-      frame->has_alpha_ = 0;
+    if (!has_alpha && frame.img_components_[1].size_ > 0) {
+      frame.img_components_[1].offset_ = 0;
+      frame.img_components_[1].size_ = 0;
+      frame.has_alpha_ = 0;
     }
 
     // Use the frame width/height as the canvas values for non-vp8x files.
     // Also, set ALPHA_FLAG if this is a lossless image with alpha.
-    if (!dmux->is_ext_format_ && frame->width_ > 0 && frame->height_ > 0) {
+    if (!dmux->is_ext_format_ && frame.width_ > 0 && frame.height_ > 0) {
       dmux->state_ = WEBP_DEMUX_PARSED_HEADER;
-      dmux->canvas_width_ = frame->width_;
-      dmux->canvas_height_ = frame->height_;
-      dmux->feature_flags_ |= frame->has_alpha_ ? ALPHA_FLAG : 0;
-    }
-    if (!AddFrame(dmux, frame)) {
-      status = PARSE_ERROR;  // last frame was left incomplete
-    } else {
-      image_added = 1;
-      dmux->num_frames_ = 1;
+      dmux->canvas_width_ = frame.width_;
+      dmux->canvas_height_ = frame.height_;
+      dmux->feature_flags_ |= frame.has_alpha_ ? ALPHA_FLAG : 0;
     }
+    if (!AddFrame(dmux, &frame)) status = PARSE_ERROR;
   }
-
-  if (!image_added) WebPSafeFree(frame);
   return status;
 }
 
@@ -561,7 +554,7 @@ static ParseStatus ParseVP8X(WebPDemuxer* const dmux) {
 // Format validation
 
 static int IsValidSimpleFormat(const WebPDemuxer* const dmux) {
-  const Frame* const frame = dmux->frames_;
+  const Frame* const frame = (dmux->num_frames_ > 0) ? dmux->frames_ : NULL;
   if (dmux->state_ == WEBP_DEMUX_PARSING_HEADER) return 1;
 
   if (dmux->canvas_width_ <= 0 || dmux->canvas_height_ <= 0) return 0;
@@ -592,54 +585,48 @@ static int CheckFrameBounds(const Frame* const frame, int exact,
 
 static int IsValidExtendedFormat(const WebPDemuxer* const dmux) {
   const int is_animation = !!(dmux->feature_flags_ & ANIMATION_FLAG);
-  const Frame* f = dmux->frames_;
+  int i;
 
   if (dmux->state_ == WEBP_DEMUX_PARSING_HEADER) return 1;
 
   if (dmux->canvas_width_ <= 0 || dmux->canvas_height_ <= 0) return 0;
   if (dmux->loop_count_ < 0) return 0;
-  if (dmux->state_ == WEBP_DEMUX_DONE && dmux->frames_ == NULL) return 0;
+  if (dmux->state_ == WEBP_DEMUX_DONE && dmux->num_frames_ == 0) return 0;
   if (dmux->feature_flags_ & ~ALL_VALID_FLAGS) return 0;  // invalid bitstream
 
-  while (f != NULL) {
-    const int cur_frame_set = f->frame_num_;
-    int frame_count = 0;
-
-    // Check frame properties.
-    for (; f != NULL && f->frame_num_ == cur_frame_set; f = f->next_) {
-      const ChunkData* const image = f->img_components_;
-      const ChunkData* const alpha = f->img_components_ + 1;
-
-      if (!is_animation && f->frame_num_ > 1) return 0;
-
-      if (f->complete_) {
-        if (alpha->size_ == 0 && image->size_ == 0) return 0;
-        // Ensure alpha precedes image bitstream.
-        if (alpha->size_ > 0 && alpha->offset_ > image->offset_) {
-          return 0;
-        }
+  // Check frame properties.
+  for (i = 0; i < dmux->num_frames_; ++i) {
+    const Frame* const f = &dmux->frames_[i];
+    const ChunkData* const image = f->img_components_;
+    const ChunkData* const alpha = f->img_components_ + 1;
 
-        if (f->width_ <= 0 || f->height_ <= 0) return 0;
-      } else {
-        // There shouldn't be a partial frame in a complete file.
-        if (dmux->state_ == WEBP_DEMUX_DONE) return 0;
+    if (!is_animation && f->frame_num_ > 1) return 0;
 
-        // Ensure alpha precedes image bitstream.
-        if (alpha->size_ > 0 && image->size_ > 0 &&
-            alpha->offset_ > image->offset_) {
-          return 0;
-        }
-        // There shouldn't be any frames after an incomplete one.
-        if (f->next_ != NULL) return 0;
+    if (f->complete_) {
+      if (alpha->size_ == 0 && image->size_ == 0) return 0;
+      // Ensure alpha precedes image bitstream.
+      if (alpha->size_ > 0 && alpha->offset_ > image->offset_) {
+        return 0;
       }
 
-      if (f->width_ > 0 && f->height_ > 0 &&
-          !CheckFrameBounds(f, !is_animation,
-                            dmux->canvas_width_, dmux->canvas_height_)) {
+      if (f->width_ <= 0 || f->height_ <= 0) return 0;
+    } else {
+      // There shouldn't be a partial frame in a complete file.
+      if (dmux->state_ == WEBP_DEMUX_DONE) return 0;
+
+      // Ensure alpha precedes image bitstream.
+      if (alpha->size_ > 0 && image->size_ > 0 &&
+          alpha->offset_ > image->offset_) {
         return 0;
       }
+      // There shouldn't be any frames after an incomplete one.
+      if (i + 1 < dmux->num_frames_) return 0;
+    }
 
-      ++frame_count;
+    if (f->width_ > 0 && f->height_ > 0 &&
+        !CheckFrameBounds(f, !is_animation,
+                          dmux->canvas_width_, dmux->canvas_height_)) {
+      return 0;
     }
   }
   return 1;
@@ -654,7 +641,6 @@ static void InitDemux(WebPDemuxer* const dmux, const MemBuffer* const mem) {
   dmux->bgcolor_ = 0xFFFFFFFF;  // White background by default.
   dmux->canvas_width_ = -1;
   dmux->canvas_height_ = -1;
-  dmux->frames_tail_ = &dmux->frames_;
   dmux->chunks_tail_ = &dmux->chunks_;
   dmux->mem_ = *mem;
 }
@@ -664,6 +650,7 @@ static ParseStatus CreateRawImageDemuxer(MemBuffer* const mem,
   WebPBitstreamFeatures features;
   const VP8StatusCode status =
       WebPGetFeatures(mem->buf_, mem->buf_size_, &features);
+  Frame frame;
   *demuxer = NULL;
   if (status != VP8_STATUS_OK) {
     return (status == VP8_STATUS_NOT_ENOUGH_DATA) ? PARSE_NEED_MORE_DATA
@@ -672,25 +659,22 @@ static ParseStatus CreateRawImageDemuxer(MemBuffer* const mem,
 
   {
     WebPDemuxer* const dmux = (WebPDemuxer*)WebPSafeCalloc(1ULL, sizeof(*dmux));
-    Frame* const frame = (Frame*)WebPSafeCalloc(1ULL, sizeof(*frame));
-    if (dmux == NULL || frame == NULL) goto Error;
+    if (dmux == NULL) return PARSE_ERROR;
     InitDemux(dmux, mem);
+    memset(&frame, 0, sizeof(frame));
     SetFrameInfo(0, mem->buf_size_, 1 /*frame_num*/, 1 /*complete*/, &features,
-                 frame);
-    if (!AddFrame(dmux, frame)) goto Error;
+                 &frame);
+    if (!AddFrame(dmux, &frame)) {
+      WebPDemuxDelete(dmux);
+      return PARSE_ERROR;
+    }
     dmux->state_ = WEBP_DEMUX_DONE;
-    dmux->canvas_width_ = frame->width_;
-    dmux->canvas_height_ = frame->height_;
-    dmux->feature_flags_ |= frame->has_alpha_ ? ALPHA_FLAG : 0;
-    dmux->num_frames_ = 1;
+    dmux->canvas_width_ = frame.width_;
+    dmux->canvas_height_ = frame.height_;
+    dmux->feature_flags_ |= frame.has_alpha_ ? ALPHA_FLAG : 0;
     assert(IsValidSimpleFormat(dmux));
     *demuxer = dmux;
     return PARSE_OK;
-
- Error:
-    WebPSafeFree(dmux);
-    WebPSafeFree(frame);
-    return PARSE_ERROR;
   }
 }
 
@@ -755,14 +739,9 @@ WebPDemuxer* WebPDemuxInternal(const WebPData* data, int allow_partial,
 
 void WebPDemuxDelete(WebPDemuxer* dmux) {
   Chunk* c;
-  Frame* f;
   if (dmux == NULL) return;
 
-  for (f = dmux->frames_; f != NULL;) {
-    Frame* const cur_frame = f;
-    f = f->next_;
-    WebPSafeFree(cur_frame);
-  }
+  WebPSafeFree(dmux->frames_);
   for (c = dmux->chunks_; c != NULL;) {
     Chunk* const cur_chunk = c;
     c = c->next_;
@@ -792,10 +771,10 @@ uint32_t WebPDemuxGetI(const WebPDemuxer* dmux, WebPFormatFeature feature) {
 
 static const Frame* GetFrame(const WebPDemuxer* const dmux, int frame_num) {
   const Frame* f;
-  for (f = dmux->frames_; f != NULL; f = f->next_) {
-    if (frame_num == f->frame_num_) break;
-  }
-  return f;
+  if (frame_num < 1 || frame_num > dmux->num_frames_) return NULL;
+  f = &dmux->frames_[frame_num - 1];
+  // A partial single image may not have its frame number set yet.
+  return (f->frame_num_ == frame_num) ? f : NULL;
 }
 
 static const uint8_t* GetFramePayload(const uint8_t* const mem_buf,
@@ -965,3 +944,359 @@ void WebPDemuxReleaseChunkIterator(WebPChunkIterator* iter) {
   (void)iter;
 }
 
+
+// -----------------------------------------------------------------------------
+// Index-only demuxing
+
+// Compact description of a frame, sufficient to read and compose it.
+typedef struct {
+  uint64_t offset_;            // start of the ALPH/VP8/VP8L chunks
+  uint32_t size_;              // size of these chunks
+  int x_offset_, y_offset_;
+  int width_, height_;
+  int duration_;
+  uint8_t flags_;              // combination of INDEX_* flags
+} IndexedFrame;
+
+#define INDEX_HAS_ALPHA          1
+#define INDEX_DISPOSE_BACKGROUND 2
+#define INDEX_NO_BLEND           4
+
+// Enough to read a chunk header and the start of its payload: the ANMF or
+// ANIM fields, or the bitstream header of an image chunk.
+#define INDEX_READ_SIZE (CHUNK_HEADER_SIZE + ANMF_CHUNK_SIZE)
+
+struct WebPDemuxIndex {
+  WebPReadFunc read_;
+  void* user_data_;
+  uint64_t riff_end_;
+  uint32_t feature_flags_;
+  int canvas_width_, canvas_height_;
+  int loop_count_;
+  uint32_t bgcolor_;
+  int num_frames_;
+  int max_frames_;             // size of frames_
+  IndexedFrame* frames_;
+};
+
+// Reads up to 'size' bytes at 'offset', stopping at the end of the RIFF
+// chunk. Returns the number of bytes read.
+static size_t ReadAt(const WebPDemuxIndex* const idx, uint64_t offset,
+                     uint8_t* buf, size_t size) {
+  size_t total = 0;
+  if (offset >= idx->riff_end_) return 0;
+  if (size > idx->riff_end_ - offset) size = (size_t)(idx->riff_end_ - offset);
+  while (total < size) {
+    size_t n = idx->read_(idx->user_data_, offset + total, buf + total,
+                          size - total);
+    if (n == 0) break;
+    if (n > size - total) n = size - total;
+    total += n;
+  }
+  return total;
+}
+
+// Same as CheckFrameBounds().
+static int CheckIndexedFrameBounds(const IndexedFrame* const frame, int exact,
+                                   int canvas_width, int canvas_height) {
+  if (exact) {
+    if (frame->x_offset_ != 0 || frame->y_offset_ != 0) {
+      return 0;
+    }
+    if (frame->width_ != canvas_width || frame->height_ != canvas_height) {
+      return 0;
+    }
+  } else {
+    if (frame->x_offset_ < 0 || frame->y_offset_ < 0) return 0;
+    if (frame->width_ + frame->x_offset_ > canvas_width) return 0;
+    if (frame->height_ + frame->y_offset_ > canvas_height) return 0;
+  }
+  return 1;
+}
+
+static IndexedFrame* NewIndexedFrame(WebPDemuxIndex* const idx) {
+  if (idx->num_frames_ == idx->max_frames_) {
+    const int max_frames = (idx->max_frames_ > 0) ? 2 * idx->max_frames_ : 16;
+    IndexedFrame* const frames =
+        (IndexedFrame*)WebPSafeMalloc(max_frames, sizeof(*frames));
+    if (frames == NULL) return NULL;
+    if (idx->num_frames_ > 0) {
+      memcpy(frames, idx->frames_, idx->num_frames_ * sizeof(*frames));
+    }
+    WebPSafeFree(idx->frames_);
+    idx->frames_ = frames;
+    idx->max_frames_ = max_frames;
+  }
+  memset(&idx->frames_[idx->num_frames_], 0, sizeof(*idx->frames_));
+  return &idx->frames_[idx->num_frames_];
+}
+
+// Indexes the image bearing chunks starting at 'start', up to 'end', like
+// StoreFrame() does. An 'ALPH' chunk is left out if 'use_alpha' is false.
+// '*next' is set to the position of the next chunk. Returns false in case of
+// error or if no image chunk is found.
+static int IndexFrameChunks(const WebPDemuxIndex* const idx,
+                            uint64_t start, uint64_t end, int use_alpha,
+                            IndexedFrame* const frame, uint64_t* const next) {
+  int alpha_chunks = 0;
+  uint64_t pos = start;
+  frame->offset_ = start;
+  while (pos + CHUNK_HEADER_SIZE <= end) {
+    uint8_t buf[INDEX_READ_SIZE];
+    const size_t size = ReadAt(idx, pos, buf, sizeof(buf));
+    const uint32_t fourcc = (size >= CHUNK_HEADER_SIZE) ? GetLE32(buf) : 0;
+    const uint32_t payload_size = (size >= CHUNK_HEADER_SIZE)
+                                ? GetLE32(buf + TAG_SIZE) : 0;
+    const uint64_t chunk_end = pos + CHUNK_HEADER_SIZE + payload_size +
+                               (payload_size & 1);
+    if (size < CHUNK_HEADER_SIZE) return 0;
+    if (payload_size > MAX_CHUNK_PAYLOAD || chunk_end > end) return 0;
+    if (fourcc == MKFOURCC('A', 'L', 'P', 'H') && alpha_chunks == 0) {
+      ++alpha_chunks;
+      if (use_alpha) frame->flags_ |= INDEX_HAS_ALPHA;
+    } else if (fourcc == MKFOURCC('V', 'P', '8', ' ') ||
+               fourcc == MKFOURCC('V', 'P', '8', 'L')) {
+      const uint64_t chunk_size = chunk_end - pos;
+      WebPBitstreamFeatures features;
+      if (fourcc == MKFOURCC('V', 'P', '8', 'L') && alpha_chunks > 0) return 0;
+      if (WebPGetFeatures(buf, (size < chunk_size) ? size : (size_t)chunk_size,
+                          &features) != VP8_STATUS_OK) {
+        return 0;
+      }
+      if (!use_alpha) frame->offset_ = pos;
+      frame->size_ = (uint32_t)(chunk_end - frame->offset_);
+      frame->width_ = features.width;
+      frame->height_ = features.height;
+      if (features.has_alpha) frame->flags_ |= INDEX_HAS_ALPHA;
+      *next = chunk_end;
+      return 1;
+    } else {
+      return 0;   // an image chunk must follow the alpha
+    }
+    pos = chunk_end;
+  }
+  return 0;
+}
+
+// Indexes the frame of the 'ANMF' chunk at 'pos' of size 'chunk_size'.
+static int IndexAnimationFrame(WebPDemuxIndex* const idx, uint64_t pos,
+                               const uint8_t* const data, uint32_t chunk_size) {
+  const uint8_t* const anmf = data + CHUNK_HEADER_SIZE;
+  IndexedFrame* frame;
+  uint64_t next;
+  if (chunk_size < ANMF_CHUNK_SIZE) return 0;
+  frame = NewIndexedFrame(idx);
+  if (frame == NULL) return 0;
+  frame->x_offset_ = 2 * GetLE24(anmf + 0);
+  frame->y_offset_ = 2 * GetLE24(anmf + 3);
+  frame->duration_ = GetLE24(anmf + 12);
+  if (anmf[15] & 1) frame->flags_ |= INDEX_DISPOSE_BACKGROUND;
+  if (anmf[15] & 2) frame->flags_ |= INDEX_NO_BLEND;
+  if (!IndexFrameChunks(idx, pos + CHUNK_HEADER_SIZE + ANMF_CHUNK_SIZE,
+                        pos + CHUNK_HEADER_SIZE + chunk_size, 1, frame,
+                        &next)) {
+    return 0;
+  }
+  if (frame->width_ != 1 + GetLE24(anmf + 6) ||
+      frame->height_ != 1 + GetLE24(anmf + 9)) {
+    return 0;
+  }
+  if (!CheckIndexedFrameBounds(frame, 0,
+                               idx->canvas_width_, idx->canvas_height_)) {
+    return 0;
+  }
+  ++idx->num_frames_;
+  return 1;
+}
+
+// Walks the chunks following the 'VP8X' one, up to the end of the RIFF chunk.
+static int IndexVP8XChunks(WebPDemuxIndex* const idx, uint64_t pos) {
+  const int is_animation = !!(idx->feature_flags_ & ANIMATION_FLAG);
+  int anim_chunks = 0;
+  while (pos < idx->riff_end_) {
+    uint8_t buf[INDEX_READ_SIZE];
+    const size_t size = ReadAt(idx, pos, buf, sizeof(buf));
+    uint32_t fourcc, chunk_size, chunk_size_padded;
+    if (size < CHUNK_HEADER_SIZE) return 0;
+    fourcc = GetLE32(buf);
+    chunk_size = GetLE32(buf + TAG_SIZE);
+    chunk_size_padded = chunk_size + (chunk_size & 1);
+    if (chunk_size > MAX_CHUNK_PAYLOAD) return 0;
+    if (chunk_size_padded > idx->riff_end_ - pos - CHUNK_HEADER_SIZE) return 0;
+
+    switch (fourcc) {
+      case MKFOURCC('V', 'P', '8', 'X'):
+        return 0;
+      case MKFOURCC('A', 'L', 'P', 'H'):
+      case MKFOURCC('V', 'P', '8', ' '):
+      case MKFOURCC('V', 'P', '8', 'L'): {
+        IndexedFrame* frame;
+        if (anim_chunks > 0 || is_animation || idx->num_frames_ > 0) return 0;
+        frame = NewIndexedFrame(idx);
+        if (frame == NULL) return 0;
+        // Any alpha is ignored when the alpha flag is missing.
+        if (!IndexFrameChunks(idx, pos, idx->riff_end_,
+                              !!(idx->feature_flags_ & ALPHA_FLAG),
+                              frame, &pos)) {
+          return 0;
+        }
+        if (!CheckIndexedFrameBounds(frame, 1,
+                                     idx->canvas_width_, idx->canvas_height_)) {
+          return 0;
+        }
+        idx->num_frames_ = 1;
+        continue;
+      }
+      case MKFOURCC('A', 'N', 'I', 'M'):
+        if (chunk_size_padded < ANIM_CHUNK_SIZE) return 0;
+        if (anim_chunks++ == 0) {
+          idx->bgcolor_ = GetLE32(buf + CHUNK_HEADER_SIZE);
+          idx->loop_count_ = GetLE16(buf + CHUNK_HEADER_SIZE + 4);
+        }
+        break;
+      case MKFOURCC('A', 'N', 'M', 'F'):
+        if (anim_chunks == 0) return 0;  // 'ANIM' precedes frames.
+        if (is_animation &&
+            !IndexAnimationFrame(idx, pos, buf, chunk_size_padded)) {
+          return 0;
+        }
+        break;
+      default:
+        break;
+    }
+    pos += CHUNK_HEADER_SIZE + chunk_size_padded;
+  }
+  return 1;
+}
+
+static int IndexFile(WebPDemuxIndex* const idx) {
+  uint8_t buf[RIFF_HEADER_SIZE + CHUNK_HEADER_SIZE + VP8X_CHUNK_SIZE];
+  const uint64_t pos = RIFF_HEADER_SIZE;
+  size_t size;
+  uint32_t riff_size, chunk_size;
+
+  idx->riff_end_ = sizeof(buf);
+  size = ReadAt(idx, 0, buf, sizeof(buf));
+  if (size < RIFF_HEADER_SIZE + CHUNK_HEADER_SIZE) return 0;
+  if (memcmp(buf, "RIFF", CHUNK_SIZE_BYTES) ||
+      memcmp(buf + CHUNK_HEADER_SIZE, "WEBP", CHUNK_SIZE_BYTES)) {
+    return 0;
+  }
+  riff_size = GetLE32(buf + TAG_SIZE);
+  if (riff_size < CHUNK_HEADER_SIZE) return 0;
+  if (riff_size > MAX_CHUNK_PAYLOAD) return 0;
+  idx->riff_end_ = (uint64_t)riff_size + CHUNK_HEADER_SIZE;
+  chunk_size = GetLE32(buf + RIFF_HEADER_SIZE + TAG_SIZE);
+  if (chunk_size > MAX_CHUNK_PAYLOAD) return 0;
+
+  if (!memcmp(buf + RIFF_HEADER_SIZE, "VP8X", TAG_SIZE)) {
+    const uint8_t* const vp8x = buf + RIFF_HEADER_SIZE + CHUNK_HEADER_SIZE;
+    const uint32_t chunk_size_padded = chunk_size + (chunk_size & 1);
+    if (size < sizeof(buf) || chunk_size < VP8X_CHUNK_SIZE) return 0;
+    if (chunk_size_padded > idx->riff_end_ - pos - CHUNK_HEADER_SIZE) return 0;
+    idx->feature_flags_ = vp8x[0];
+    idx->canvas_width_  = 1 + GetLE24(vp8x + 4);
+    idx->canvas_height_ = 1 + GetLE24(vp8x + 7);
+    if (idx->canvas_width_ * (uint64_t)idx->canvas_height_ >= MAX_IMAGE_AREA) {
+      return 0;
+    }
+    if (idx->feature_flags_ & ~ALL_VALID_FLAGS) return 0;
+    if (!IndexVP8XChunks(idx, pos + CHUNK_HEADER_SIZE + chunk_size_padded)) {
+      return 0;
+    }
+  } else if (!memcmp(buf + RIFF_HEADER_SIZE, "VP8 ", TAG_SIZE) ||
+             !memcmp(buf + RIFF_HEADER_SIZE, "VP8L", TAG_SIZE)) {
+    IndexedFrame* const frame = NewIndexedFrame(idx);
+    uint64_t next;
+    if (frame == NULL) return 0;
+    if (!IndexFrameChunks(idx, pos, idx->riff_end_, 1, frame, &next)) {
+      return 0;
+    }
+    idx->num_frames_ = 1;
+    idx->canvas_width_ = frame->width_;
+    idx->canvas_height_ = frame->height_;
+    if (frame->flags_ & INDEX_HAS_ALPHA) idx->feature_flags_ |= ALPHA_FLAG;
+  } else {
+    return 0;
+  }
+  return (idx->num_frames_ > 0);
+}
+
+WebPDemuxIndex* WebPDemuxIndexNew(WebPReadFunc read, void* user_data) {
+  WebPDemuxIndex* idx;
+  if (read == NULL) return NULL;
+  idx = (WebPDemuxIndex*)WebPSafeCalloc(1ULL, sizeof(*idx));
+  if (idx == NULL) return NULL;
+  idx->read_ = read;
+  idx->user_data_ = user_data;
+  idx->loop_count_ = 1;
+  idx->bgcolor_ = 0xFFFFFFFF;  // White background by default.
+  if (!IndexFile(idx)) {
+    WebPDemuxIndexDelete(idx);
+    return NULL;
+  }
+  return idx;
+}
+
+void WebPDemuxIndexDelete(WebPDemuxIndex* idx) {
+  if (idx == NULL) return;
+  WebPSafeFree(idx->frames_);
+  WebPSafeFree(idx);
+}
+
+uint32_t WebPDemuxIndexGetI(const WebPDemuxIndex* idx,
+                            WebPFormatFeature feature) {
+  if (idx == NULL) return 0;
+
+  switch (feature) {
+    case WEBP_FF_FORMAT_FLAGS:     return idx->feature_flags_;
+    case WEBP_FF_CANVAS_WIDTH:     return (uint32_t)idx->canvas_width_;
+    case WEBP_FF_CANVAS_HEIGHT:    return (uint32_t)idx->canvas_height_;
+    case WEBP_FF_LOOP_COUNT:       return (uint32_t)idx->loop_count_;
+    case WEBP_FF_BACKGROUND_COLOR: return idx->bgcolor_;
+    case WEBP_FF_FRAME_COUNT:      return (uint32_t)idx->num_frames_;
+  }
+  return 0;
+}
+
+int WebPDemuxIndexGetFrame(const WebPDemuxIndex* idx, int frame_number,
+                           WebPFrameInfo* info) {
+  const IndexedFrame* frame;
+  if (idx == NULL || info == NULL) return 0;
+  if (frame_number < 0 || frame_number > idx->num_frames_) return 0;
+  if (frame_number == 0) frame_number = idx->num_frames_;
+  frame = &idx->frames_[frame_number - 1];
+
+  memset(info, 0, sizeof(*info));
+  info->offset    = frame->offset_;
+  info->size      = frame->size_;
+  info->x_offset  = frame->x_offset_;
+  info->y_offset  = frame->y_offset_;
+  info->width     = frame->width_;
+  info->height    = frame->height_;
+  info->duration  = frame->duration_;
+  info->has_alpha = !!(frame->flags_ & INDEX_HAS_ALPHA);
+  info->dispose_method = (frame->flags_ & INDEX_DISPOSE_BACKGROUND)
+                       ? WEBP_MUX_DISPOSE_BACKGROUND : WEBP_MUX_DISPOSE_NONE;
+  info->blend_method = (frame->flags_ & INDEX_NO_BLEND) ? WEBP_MUX_NO_BLEND
+                                                        : WEBP_MUX_BLEND;
+  return 1;
+}
+
+int WebPDemuxIndexReadFrame(const WebPDemuxIndex* idx, int frame_number,
+                            WebPData* data) {
+  WebPFrameInfo info;
+  uint8_t* buf;
+  if (data == NULL) return 0;
+  WebPDataInit(data);
+  if (!WebPDemuxIndexGetFrame(idx, frame_number, &info)) return 0;
+  buf = (uint8_t*)WebPMalloc(info.size);
+  if (buf == NULL) return 0;
+  if (ReadAt(idx, info.offset, buf, info.size) != info.size) {
+    WebPFree(buf);
+    return 0;
+  }
+  data->bytes = buf;
+  data->size = info.size;
+  return 1;
+}
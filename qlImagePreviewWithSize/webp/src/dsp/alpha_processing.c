@@ -308,7 +308,24 @@ static int DispatchAlpha_C(const uint8_t* alpha, int alpha_stride,
 
   return (alpha_mask != 0xff);
 }
+#endif  // !WEBP_NEON_OMIT_C_CODE
+
+// Generic version, relying on the best available WebPDispatchAlpha() and
+// WebPApplyAlphaMultiply() implementations.
+static int DispatchAlphaPremultiply_C(const uint8_t* alpha, int alpha_stride,
+                                      int width, int height,
+                                      uint8_t* rgba, int rgba_stride,
+                                      int alpha_first) {
+  const int has_alpha =
+      WebPDispatchAlpha(alpha, alpha_stride, width, height,
+                        rgba + (alpha_first ? 0 : 3), rgba_stride);
+  if (has_alpha) {
+    WebPApplyAlphaMultiply(rgba, alpha_first, width, height, rgba_stride);
+  }
+  return has_alpha;
+}
 
+#if !WEBP_NEON_OMIT_C_CODE
 static void DispatchAlphaToGreen_C(const uint8_t* alpha, int alpha_stride,
                                    int width, int height,
                                    uint32_t* dst, int dst_stride) {
@@ -385,9 +402,160 @@ static void PackRGB_C(const uint8_t* r, const uint8_t* g, const uint8_t* b,
   }
 }
 
+//------------------------------------------------------------------------------
+// 8b -> 16b RGBA conversions.
+// All of them read each pixel before writing it, so that they can run in place
+// from the second half of the destination row.
+
+// Half-float value of v / 255 (float division, rounded to nearest-even).
+const uint16_t WebPkToHalf[256] = {
+  0x0000, 0x1c04, 0x2004, 0x2206, 0x2404, 0x2505, 0x2606, 0x2707,
+  0x2804, 0x2885, 0x2905, 0x2986, 0x2a06, 0x2a87, 0x2b07, 0x2b88,
+  0x2c04, 0x2c44, 0x2c85, 0x2cc5, 0x2d05, 0x2d45, 0x2d86, 0x2dc6,
+  0x2e06, 0x2e46, 0x2e87, 0x2ec7, 0x2f07, 0x2f47, 0x2f88, 0x2fc8,
+  0x3004, 0x3024, 0x3044, 0x3064, 0x3085, 0x30a5, 0x30c5, 0x30e5,
+  0x3105, 0x3125, 0x3145, 0x3165, 0x3186, 0x31a6, 0x31c6, 0x31e6,
+  0x3206, 0x3226, 0x3246, 0x3266, 0x3287, 0x32a7, 0x32c7, 0x32e7,
+  0x3307, 0x3327, 0x3347, 0x3367, 0x3388, 0x33a8, 0x33c8, 0x33e8,
+  0x3404, 0x3414, 0x3424, 0x3434, 0x3444, 0x3454, 0x3464, 0x3474,
+  0x3485, 0x3495, 0x34a5, 0x34b5, 0x34c5, 0x34d5, 0x34e5, 0x34f5,
+  0x3505, 0x3515, 0x3525, 0x3535, 0x3545, 0x3555, 0x3565, 0x3575,
+  0x3586, 0x3596, 0x35a6, 0x35b6, 0x35c6, 0x35d6, 0x35e6, 0x35f6,
+  0x3606, 0x3616, 0x3626, 0x3636, 0x3646, 0x3656, 0x3666, 0x3676,
+  0x3687, 0x3697, 0x36a7, 0x36b7, 0x36c7, 0x36d7, 0x36e7, 0x36f7,
+  0x3707, 0x3717, 0x3727, 0x3737, 0x3747, 0x3757, 0x3767, 0x3777,
+  0x3788, 0x3798, 0x37a8, 0x37b8, 0x37c8, 0x37d8, 0x37e8, 0x37f8,
+  0x3804, 0x380c, 0x3814, 0x381c, 0x3824, 0x382c, 0x3834, 0x383c,
+  0x3844, 0x384c, 0x3854, 0x385c, 0x3864, 0x386c, 0x3874, 0x387c,
+  0x3885, 0x388d, 0x3895, 0x389d, 0x38a5, 0x38ad, 0x38b5, 0x38bd,
+  0x38c5, 0x38cd, 0x38d5, 0x38dd, 0x38e5, 0x38ed, 0x38f5, 0x38fd,
+  0x3905, 0x390d, 0x3915, 0x391d, 0x3925, 0x392d, 0x3935, 0x393d,
+  0x3945, 0x394d, 0x3955, 0x395d, 0x3965, 0x396d, 0x3975, 0x397d,
+  0x3986, 0x398e, 0x3996, 0x399e, 0x39a6, 0x39ae, 0x39b6, 0x39be,
+  0x39c6, 0x39ce, 0x39d6, 0x39de, 0x39e6, 0x39ee, 0x39f6, 0x39fe,
+  0x3a06, 0x3a0e, 0x3a16, 0x3a1e, 0x3a26, 0x3a2e, 0x3a36, 0x3a3e,
+  0x3a46, 0x3a4e, 0x3a56, 0x3a5e, 0x3a66, 0x3a6e, 0x3a76, 0x3a7e,
+  0x3a87, 0x3a8f, 0x3a97, 0x3a9f, 0x3aa7, 0x3aaf, 0x3ab7, 0x3abf,
+  0x3ac7, 0x3acf, 0x3ad7, 0x3adf, 0x3ae7, 0x3aef, 0x3af7, 0x3aff,
+  0x3b07, 0x3b0f, 0x3b17, 0x3b1f, 0x3b27, 0x3b2f, 0x3b37, 0x3b3f,
+  0x3b47, 0x3b4f, 0x3b57, 0x3b5f, 0x3b67, 0x3b6f, 0x3b77, 0x3b7f,
+  0x3b88, 0x3b90, 0x3b98, 0x3ba0, 0x3ba8, 0x3bb0, 0x3bb8, 0x3bc0,
+  0x3bc8, 0x3bd0, 0x3bd8, 0x3be0, 0x3be8, 0x3bf0, 0x3bf8, 0x3c00,
+};
+
+// 16b linear light value of the sRGB-encoded v / 255.
+const uint16_t WebPkToLinear16[256] = {
+  0x0000, 0x0014, 0x0028, 0x003c, 0x0050, 0x0063, 0x0077, 0x008b,
+  0x009f, 0x00b3, 0x00c7, 0x00db, 0x00f1, 0x0108, 0x0120, 0x0139,
+  0x0154, 0x016f, 0x018c, 0x01ab, 0x01ca, 0x01eb, 0x020e, 0x0232,
+  0x0257, 0x027d, 0x02a5, 0x02ce, 0x02f9, 0x0325, 0x0353, 0x0382,
+  0x03b3, 0x03e5, 0x0418, 0x044d, 0x0484, 0x04bc, 0x04f6, 0x0532,
+  0x056f, 0x05ad, 0x05ed, 0x062f, 0x0673, 0x06b8, 0x06fe, 0x0747,
+  0x0791, 0x07dd, 0x082a, 0x087a, 0x08ca, 0x091d, 0x0972, 0x09c8,
+  0x0a20, 0x0a79, 0x0ad5, 0x0b32, 0x0b91, 0x0bf2, 0x0c55, 0x0cba,
+  0x0d20, 0x0d88, 0x0df2, 0x0e5e, 0x0ecc, 0x0f3c, 0x0fae, 0x1021,
+  0x1097, 0x110e, 0x1188, 0x1203, 0x1280, 0x1300, 0x1381, 0x1404,
+  0x1489, 0x1510, 0x159a, 0x1625, 0x16b2, 0x1741, 0x17d3, 0x1866,
+  0x18fb, 0x1993, 0x1a2c, 0x1ac8, 0x1b66, 0x1c06, 0x1ca7, 0x1d4c,
+  0x1df2, 0x1e9a, 0x1f44, 0x1ff1, 0x20a0, 0x2150, 0x2204, 0x22b9,
+  0x2370, 0x242a, 0x24e5, 0x25a3, 0x2664, 0x2726, 0x27eb, 0x28b1,
+  0x297b, 0x2a46, 0x2b14, 0x2be3, 0x2cb6, 0x2d8a, 0x2e61, 0x2f3a,
+  0x3015, 0x30f2, 0x31d2, 0x32b4, 0x3399, 0x3480, 0x3569, 0x3655,
+  0x3742, 0x3833, 0x3925, 0x3a1a, 0x3b12, 0x3c0b, 0x3d07, 0x3e06,
+  0x3f07, 0x400a, 0x4110, 0x4218, 0x4323, 0x4430, 0x453f, 0x4651,
+  0x4765, 0x487c, 0x4995, 0x4ab1, 0x4bcf, 0x4cf0, 0x4e13, 0x4f39,
+  0x5061, 0x518c, 0x52b9, 0x53e9, 0x551b, 0x5650, 0x5787, 0x58c1,
+  0x59fe, 0x5b3d, 0x5c7e, 0x5dc2, 0x5f09, 0x6052, 0x619e, 0x62ed,
+  0x643e, 0x6591, 0x66e8, 0x6840, 0x699c, 0x6afa, 0x6c5b, 0x6dbe,
+  0x6f24, 0x708d, 0x71f8, 0x7366, 0x74d7, 0x764a, 0x77c0, 0x7939,
+  0x7ab4, 0x7c32, 0x7db3, 0x7f37, 0x80bd, 0x8246, 0x83d1, 0x855f,
+  0x86f0, 0x8884, 0x8a1b, 0x8bb4, 0x8d50, 0x8eef, 0x9090, 0x9235,
+  0x93dc, 0x9586, 0x9732, 0x98e2, 0x9a94, 0x9c49, 0x9e01, 0x9fbb,
+  0xa179, 0xa339, 0xa4fc, 0xa6c2, 0xa88b, 0xaa56, 0xac25, 0xadf6,
+  0xafca, 0xb1a1, 0xb37b, 0xb557, 0xb737, 0xb919, 0xbaff, 0xbce7,
+  0xbed2, 0xc0c0, 0xc2b1, 0xc4a5, 0xc69c, 0xc895, 0xca92, 0xcc91,
+  0xce94, 0xd099, 0xd2a1, 0xd4ad, 0xd6bb, 0xd8cc, 0xdae0, 0xdcf7,
+  0xdf11, 0xe12e, 0xe34e, 0xe571, 0xe797, 0xe9c0, 0xebec, 0xee1b,
+  0xf04d, 0xf282, 0xf4ba, 0xf6f5, 0xf933, 0xfb74, 0xfdb8, 0xffff,
+};
+
+// Half-float linear light value of the sRGB-encoded v / 255.
+const uint16_t WebPkToLinearHalf[256] = {
+  0x0000, 0x0cf9, 0x10f9, 0x1376, 0x14f9, 0x1637, 0x1776, 0x185a,
+  0x18f9, 0x1998, 0x1a37, 0x1adb, 0x1b88, 0x1c1f, 0x1c7f, 0x1ce4,
+  0x1d4e, 0x1dbd, 0x1e32, 0x1eab, 0x1f2a, 0x1fae, 0x201c, 0x2063,
+  0x20ad, 0x20fa, 0x214a, 0x219d, 0x21f2, 0x224a, 0x22a6, 0x2304,
+  0x2365, 0x23c9, 0x2418, 0x244d, 0x2484, 0x24bc, 0x24f6, 0x2532,
+  0x256f, 0x25ad, 0x25ed, 0x262f, 0x2673, 0x26b8, 0x26ff, 0x2747,
+  0x2791, 0x27dd, 0x2815, 0x283d, 0x2865, 0x288f, 0x28b9, 0x28e4,
+  0x2910, 0x293d, 0x296a, 0x2999, 0x29c9, 0x29f9, 0x2a2a, 0x2a5d,
+  0x2a90, 0x2ac4, 0x2af9, 0x2b2f, 0x2b66, 0x2b9e, 0x2bd7, 0x2c08,
+  0x2c26, 0x2c44, 0x2c62, 0x2c81, 0x2ca0, 0x2cc0, 0x2ce0, 0x2d01,
+  0x2d22, 0x2d44, 0x2d66, 0x2d89, 0x2dad, 0x2dd0, 0x2df5, 0x2e1a,
+  0x2e3f, 0x2e65, 0x2e8b, 0x2eb2, 0x2ed9, 0x2f01, 0x2f2a, 0x2f53,
+  0x2f7c, 0x2fa7, 0x2fd1, 0x2ffc, 0x3014, 0x302a, 0x3040, 0x3057,
+  0x306e, 0x3085, 0x309d, 0x30b4, 0x30cc, 0x30e5, 0x30fd, 0x3116,
+  0x312f, 0x3149, 0x3162, 0x317c, 0x3197, 0x31b1, 0x31cc, 0x31e7,
+  0x3203, 0x321e, 0x323a, 0x3257, 0x3273, 0x3290, 0x32ad, 0x32cb,
+  0x32e8, 0x3306, 0x3325, 0x3343, 0x3362, 0x3381, 0x33a1, 0x33c1,
+  0x33e1, 0x3401, 0x3411, 0x3422, 0x3432, 0x3443, 0x3454, 0x3465,
+  0x3476, 0x3488, 0x3499, 0x34ab, 0x34bd, 0x34cf, 0x34e1, 0x34f4,
+  0x3506, 0x3519, 0x352c, 0x353f, 0x3552, 0x3565, 0x3578, 0x358c,
+  0x35a0, 0x35b4, 0x35c8, 0x35dc, 0x35f1, 0x3605, 0x361a, 0x362f,
+  0x3644, 0x3659, 0x366f, 0x3684, 0x369a, 0x36b0, 0x36c6, 0x36dc,
+  0x36f2, 0x3709, 0x3720, 0x3736, 0x374d, 0x3765, 0x377c, 0x3794,
+  0x37ab, 0x37c3, 0x37db, 0x37f3, 0x3806, 0x3812, 0x381f, 0x382b,
+  0x3838, 0x3844, 0x3851, 0x385e, 0x386b, 0x3877, 0x3885, 0x3892,
+  0x389f, 0x38ac, 0x38ba, 0x38c7, 0x38d5, 0x38e2, 0x38f0, 0x38fe,
+  0x390c, 0x391a, 0x3928, 0x3936, 0x3944, 0x3953, 0x3961, 0x3970,
+  0x397e, 0x398d, 0x399c, 0x39ab, 0x39ba, 0x39c9, 0x39d8, 0x39e7,
+  0x39f7, 0x3a06, 0x3a16, 0x3a25, 0x3a35, 0x3a45, 0x3a55, 0x3a65,
+  0x3a75, 0x3a85, 0x3a95, 0x3aa5, 0x3ab6, 0x3ac6, 0x3ad7, 0x3ae8,
+  0x3af9, 0x3b09, 0x3b1a, 0x3b2c, 0x3b3d, 0x3b4e, 0x3b5f, 0x3b71,
+  0x3b82, 0x3b94, 0x3ba6, 0x3bb8, 0x3bca, 0x3bdc, 0x3bee, 0x3c00,
+};
+
+void WebPConvertRGBAToRGBA16_C(const uint8_t* rgba, int len, uint16_t* dst) {
+  int i;
+  for (i = 0; i < 4 * len; ++i) dst[i] = rgba[i] * 0x0101;
+}
+
+void WebPConvertRGBAToRGBAF16_C(const uint8_t* rgba, int len, uint16_t* dst) {
+  int i;
+  for (i = 0; i < 4 * len; ++i) dst[i] = WebPkToHalf[rgba[i]];
+}
+
+void WebPConvertRGBAToRGBA16Linear_C(const uint8_t* rgba, int len,
+                                     uint16_t* dst) {
+  int i;
+  for (i = 0; i < len; ++i) {
+    const int r = rgba[4 * i + 0], g = rgba[4 * i + 1], b = rgba[4 * i + 2];
+    const int a = rgba[4 * i + 3];
+    dst[4 * i + 0] = WebPkToLinear16[r];
+    dst[4 * i + 1] = WebPkToLinear16[g];
+    dst[4 * i + 2] = WebPkToLinear16[b];
+    dst[4 * i + 3] = a * 0x0101;
+  }
+}
+
+void WebPConvertRGBAToRGBAF16Linear_C(const uint8_t* rgba, int len,
+                                      uint16_t* dst) {
+  int i;
+  for (i = 0; i < len; ++i) {
+    const int r = rgba[4 * i + 0], g = rgba[4 * i + 1], b = rgba[4 * i + 2];
+    const int a = rgba[4 * i + 3];
+    dst[4 * i + 0] = WebPkToLinearHalf[r];
+    dst[4 * i + 1] = WebPkToLinearHalf[g];
+    dst[4 * i + 2] = WebPkToLinearHalf[b];
+    dst[4 * i + 3] = WebPkToHalf[a];
+  }
+}
+
 void (*WebPApplyAlphaMultiply)(uint8_t*, int, int, int, int);
 void (*WebPApplyAlphaMultiply4444)(uint8_t*, int, int, int);
 int (*WebPDispatchAlpha)(const uint8_t*, int, int, int, uint8_t*, int);
+int (*WebPDispatchAlphaPremultiply)(const uint8_t*, int, int, int,
+                                    uint8_t*, int, int);
 void (*WebPDispatchAlphaToGreen)(const uint8_t*, int, int, int, uint32_t*, int);
 int (*WebPExtractAlpha)(const uint8_t*, int, int, int, uint8_t*, int);
 void (*WebPExtractGreen)(const uint32_t* argb, uint8_t* alpha, int size);
@@ -401,6 +569,13 @@ void (*WebPPackRGB)(const uint8_t* r, const uint8_t* g, const uint8_t* b,
 int (*WebPHasAlpha8b)(const uint8_t* src, int length);
 int (*WebPHasAlpha32b)(const uint8_t* src, int length);
 
+void (*WebPConvertRGBAToRGBA16)(const uint8_t* rgba, int len, uint16_t* dst);
+void (*WebPConvertRGBAToRGBAF16)(const uint8_t* rgba, int len, uint16_t* dst);
+void (*WebPConvertRGBAToRGBA16Linear)(const uint8_t* rgba, int len,
+                                      uint16_t* dst);
+void (*WebPConvertRGBAToRGBAF16Linear)(const uint8_t* rgba, int len,
+                                       uint16_t* dst);
+
 //------------------------------------------------------------------------------
 // Init function
 
@@ -418,6 +593,7 @@ WEBP_DSP_INIT_FUNC(WebPInitAlphaProcessing) {
   WebPPackARGB = PackARGB_C;
 #endif
   WebPPackRGB = PackRGB_C;
+  WebPDispatchAlphaPremultiply = DispatchAlphaPremultiply_C;
 #if !WEBP_NEON_OMIT_C_CODE
   WebPApplyAlphaMultiply = ApplyAlphaMultiply_C;
   WebPDispatchAlpha = DispatchAlpha_C;
@@ -429,6 +605,11 @@ WEBP_DSP_INIT_FUNC(WebPInitAlphaProcessing) {
   WebPHasAlpha8b = HasAlpha8b_C;
   WebPHasAlpha32b = HasAlpha32b_C;
 
+  WebPConvertRGBAToRGBA16 = WebPConvertRGBAToRGBA16_C;
+  WebPConvertRGBAToRGBAF16 = WebPConvertRGBAToRGBAF16_C;
+  WebPConvertRGBAToRGBA16Linear = WebPConvertRGBAToRGBA16Linear_C;
+  WebPConvertRGBAToRGBAF16Linear = WebPConvertRGBAToRGBAF16Linear_C;
+
   // If defined, use CPUInfo() to overwrite some pointers with faster versions.
   if (VP8GetCPUInfo != NULL) {
 #if defined(WEBP_USE_SSE2)
@@ -460,6 +641,7 @@ WEBP_DSP_INIT_FUNC(WebPInitAlphaProcessing) {
   assert(WebPApplyAlphaMultiply != NULL);
   assert(WebPApplyAlphaMultiply4444 != NULL);
   assert(WebPDispatchAlpha != NULL);
+  assert(WebPDispatchAlphaPremultiply != NULL);
   assert(WebPDispatchAlphaToGreen != NULL);
   assert(WebPExtractAlpha != NULL);
   assert(WebPExtractGreen != NULL);
@@ -469,4 +651,8 @@ WEBP_DSP_INIT_FUNC(WebPInitAlphaProcessing) {
   assert(WebPPackRGB != NULL);
   assert(WebPHasAlpha8b != NULL);
   assert(WebPHasAlpha32b != NULL);
+  assert(WebPConvertRGBAToRGBA16 != NULL);
+  assert(WebPConvertRGBAToRGBAF16 != NULL);
+  assert(WebPConvertRGBAToRGBA16Linear != NULL);
+  assert(WebPConvertRGBAToRGBAF16Linear != NULL);
 }
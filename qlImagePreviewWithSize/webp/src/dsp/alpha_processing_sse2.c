@@ -207,6 +207,89 @@ static void ApplyAlphaMultiply_SSE2(uint8_t* rgba, int alpha_first,
     rgba += stride;
   }
 }
+// Fused WebPDispatchAlpha() + WebPApplyAlphaMultiply().
+static int DispatchAlphaPremultiply_SSE2(const uint8_t* alpha, int alpha_stride,
+                                         int width, int height,
+                                         uint8_t* rgba, int rgba_stride,
+                                         int alpha_first) {
+  uint32_t alpha_and = 0xff;
+  int i, j;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i kMult = _mm_set1_epi16(0x8081u);
+  const __m128i all_0xff = _mm_set_epi32(0, 0, ~0u, ~0u);
+  const __m128i rgb_mask =
+      _mm_set1_epi32(alpha_first ? 0xffffff00u : 0x00ffffffu);
+  const __m128i alpha_shift = _mm_cvtsi32_si128(alpha_first ? 0 : 24);
+  __m128i all_alphas = all_0xff;
+
+  for (j = 0; j < height; ++j) {
+    __m128i* out = (__m128i*)rgba;
+    for (i = 0; i + 8 <= width; i += 8) {
+      // load 8 alpha bytes and put them in place
+      const __m128i a0 = _mm_loadl_epi64((const __m128i*)&alpha[i]);
+      const __m128i a1 = _mm_unpacklo_epi8(a0, zero);
+      const __m128i a2_lo = _mm_sll_epi32(_mm_unpacklo_epi16(a1, zero),
+                                          alpha_shift);
+      const __m128i a2_hi = _mm_sll_epi32(_mm_unpackhi_epi16(a1, zero),
+                                          alpha_shift);
+      // load 8 dst pixels (32 bytes)
+      __m128i b0_lo = _mm_loadu_si128(out + 0);
+      __m128i b0_hi = _mm_loadu_si128(out + 1);
+      const int is_opaque =
+          (_mm_movemask_epi8(_mm_cmpeq_epi8(a0, all_0xff)) == 0xffff);
+      if (!is_opaque) {
+        // alpha multipliers: [a0 a0 a0 a0 a1 a1 a1 a1], ...
+        const __m128i m0 = _mm_unpacklo_epi16(a1, a1);
+        const __m128i m1 = _mm_unpackhi_epi16(a1, a1);
+        const __m128i m00 = _mm_unpacklo_epi32(m0, m0);
+        const __m128i m01 = _mm_unpackhi_epi32(m0, m0);
+        const __m128i m10 = _mm_unpacklo_epi32(m1, m1);
+        const __m128i m11 = _mm_unpackhi_epi32(m1, m1);
+        const __m128i b1_00 = _mm_unpacklo_epi8(b0_lo, zero);
+        const __m128i b1_01 = _mm_unpackhi_epi8(b0_lo, zero);
+        const __m128i b1_10 = _mm_unpacklo_epi8(b0_hi, zero);
+        const __m128i b1_11 = _mm_unpackhi_epi8(b0_hi, zero);
+        // v / 255 = (v * 0x8081) >> 23, as in APPLY_ALPHA
+        const __m128i c00 = _mm_mullo_epi16(b1_00, m00);
+        const __m128i c01 = _mm_mullo_epi16(b1_01, m01);
+        const __m128i c10 = _mm_mullo_epi16(b1_10, m10);
+        const __m128i c11 = _mm_mullo_epi16(b1_11, m11);
+        const __m128i d00 = _mm_srli_epi16(_mm_mulhi_epu16(c00, kMult), 7);
+        const __m128i d01 = _mm_srli_epi16(_mm_mulhi_epu16(c01, kMult), 7);
+        const __m128i d10 = _mm_srli_epi16(_mm_mulhi_epu16(c10, kMult), 7);
+        const __m128i d11 = _mm_srli_epi16(_mm_mulhi_epu16(c11, kMult), 7);
+        b0_lo = _mm_packus_epi16(d00, d01);
+        b0_hi = _mm_packus_epi16(d10, d11);
+      }
+      // mask dst alpha values and combine
+      b0_lo = _mm_or_si128(_mm_and_si128(b0_lo, rgb_mask), a2_lo);
+      b0_hi = _mm_or_si128(_mm_and_si128(b0_hi, rgb_mask), a2_hi);
+      _mm_storeu_si128(out + 0, b0_lo);
+      _mm_storeu_si128(out + 1, b0_hi);
+      // accumulate eight alpha 'and' in parallel
+      all_alphas = _mm_and_si128(all_alphas, a0);
+      out += 2;
+    }
+    for (; i < width; ++i) {
+      uint8_t* const rgb = rgba + 4 * i + (alpha_first ? 1 : 0);
+      const uint32_t a = alpha[i];
+      rgba[4 * i + (alpha_first ? 0 : 3)] = a;
+      alpha_and &= a;
+      if (a != 0xff) {
+        const uint32_t mult = MULTIPLIER(a);
+        rgb[0] = PREMULTIPLY(rgb[0], mult);
+        rgb[1] = PREMULTIPLY(rgb[1], mult);
+        rgb[2] = PREMULTIPLY(rgb[2], mult);
+      }
+    }
+    alpha += alpha_stride;
+    rgba += rgba_stride;
+  }
+  // Combine the eight alpha 'and' into a 8-bit mask.
+  alpha_and &= _mm_movemask_epi8(_mm_cmpeq_epi8(all_alphas, all_0xff));
+  return (alpha_and != 0xff);
+}
+
 #undef MULTIPLIER
 #undef PREMULTIPLY
 
@@ -268,6 +351,69 @@ static int HasAlpha32b_SSE2(const uint8_t* src, int length) {
 // -----------------------------------------------------------------------------
 // Apply alpha value to rows
 
+// (255 << 24) / alpha, same as the C version's scale (with kInvAlpha[0] = 0).
+static const uint32_t kInvAlpha[256] = {
+  0x00000000, 0xff000000, 0x7f800000, 0x55000000, 0x3fc00000, 0x33000000,
+  0x2a800000, 0x246db6db, 0x1fe00000, 0x1c555555, 0x19800000, 0x172e8ba2,
+  0x15400000, 0x139d89d8, 0x1236db6d, 0x11000000, 0x0ff00000, 0x0f000000,
+  0x0e2aaaaa, 0x0d6bca1a, 0x0cc00000, 0x0c249249, 0x0b9745d1, 0x0b1642c8,
+  0x0aa00000, 0x0a333333, 0x09cec4ec, 0x0971c71c, 0x091b6db6, 0x08cb08d3,
+  0x08800000, 0x0839ce73, 0x07f80000, 0x07ba2e8b, 0x07800000, 0x07492492,
+  0x07155555, 0x06e45306, 0x06b5e50d, 0x0689d89d, 0x06600000, 0x063831f3,
+  0x06124924, 0x05ee23b8, 0x05cba2e8, 0x05aaaaaa, 0x058b2164, 0x056cefa8,
+  0x05500000, 0x05343eb1, 0x05199999, 0x05000000, 0x04e76276, 0x04cfb2b7,
+  0x04b8e38e, 0x04a2e8ba, 0x048db6db, 0x0479435e, 0x04658469, 0x045270d0,
+  0x04400000, 0x042e29f7, 0x041ce739, 0x040c30c3, 0x03fc0000, 0x03ec4ec4,
+  0x03dd1745, 0x03ce540f, 0x03c00000, 0x03b21642, 0x03a49249, 0x03976fc6,
+  0x038aaaaa, 0x037e3f1f, 0x03722983, 0x03666666, 0x035af286, 0x034fcace,
+  0x0344ec4e, 0x033a5440, 0x03300000, 0x0325ed09, 0x031c18f9, 0x0312818a,
+  0x03092492, 0x03000000, 0x02f711dc, 0x02ee5846, 0x02e5d174, 0x02dd7baf,
+  0x02d55555, 0x02cd5cd5, 0x02c590b2, 0x02bdef7b, 0x02b677d4, 0x02af286b,
+  0x02a80000, 0x02a0fd5c, 0x029a1f58, 0x029364d9, 0x028ccccc, 0x0286562d,
+  0x02800000, 0x0279c952, 0x0273b13b, 0x026db6db, 0x0267d95b, 0x026217ec,
+  0x025c71c7, 0x0256e62a, 0x0251745d, 0x024c1bac, 0x0246db6d, 0x0241b2f9,
+  0x023ca1af, 0x0237a6f4, 0x0232c234, 0x022df2df, 0x02293868, 0x02249249,
+  0x02200000, 0x021b810e, 0x021714fb, 0x0212bb51, 0x020e739c, 0x020a3d70,
+  0x02061861, 0x02020408, 0x01fe0000, 0x01fa0be8, 0x01f62762, 0x01f25213,
+  0x01ee8ba2, 0x01ead3ba, 0x01e72a07, 0x01e38e38, 0x01e00000, 0x01dc7f10,
+  0x01d90b21, 0x01d5a3e9, 0x01d24924, 0x01cefa8d, 0x01cbb7e3, 0x01c880e5,
+  0x01c55555, 0x01c234f7, 0x01bf1f8f, 0x01bc14e5, 0x01b914c1, 0x01b61eed,
+  0x01b33333, 0x01b05160, 0x01ad7943, 0x01aaaaaa, 0x01a7e567, 0x01a5294a,
+  0x01a27627, 0x019fcbd2, 0x019d2a20, 0x019a90e7, 0x01980000, 0x01957741,
+  0x0192f684, 0x01907da4, 0x018e0c7c, 0x018ba2e8, 0x018940c5, 0x0186e5f0,
+  0x01849249, 0x018245ae, 0x01800000, 0x017dc11f, 0x017b88ee, 0x0179574e,
+  0x01772c23, 0x01750750, 0x0172e8ba, 0x0170d045, 0x016ebdd7, 0x016cb157,
+  0x016aaaaa, 0x0168a9b9, 0x0166ae6a, 0x0164b8a7, 0x0162c859, 0x0160dd67,
+  0x015ef7bd, 0x015d1745, 0x015b3bea, 0x01596596, 0x01579435, 0x0155c7b4,
+  0x01540000, 0x01523d03, 0x01507eae, 0x014ec4ec, 0x014d0fac, 0x014b5edc,
+  0x0149b26c, 0x01480a4a, 0x01466666, 0x0144c6af, 0x01432b16, 0x0141938b,
+  0x01400000, 0x013e7063, 0x013ce4a9, 0x013b5cc0, 0x0139d89d, 0x01385830,
+  0x0136db6d, 0x01356246, 0x0133ecad, 0x01327a97, 0x01310bf6, 0x012fa0be,
+  0x012e38e3, 0x012cd459, 0x012b7315, 0x012a150a, 0x0128ba2e, 0x01276276,
+  0x01260dd6, 0x0124bc44, 0x01236db6, 0x01222222, 0x0120d97c, 0x011f93bc,
+  0x011e50d7, 0x011d10c4, 0x011bd37a, 0x011a98ef, 0x0119611a, 0x01182bf2,
+  0x0116f96f, 0x0115c988, 0x01149c34, 0x0113716a, 0x01124924, 0x01112358,
+  0x01100000, 0x010edf12, 0x010dc087, 0x010ca458, 0x010b8a7d, 0x010a72f0,
+  0x01095da8, 0x01084a9f, 0x010739ce, 0x01062b2e, 0x01051eb8, 0x01041465,
+  0x01030c30, 0x01020612, 0x01010204, 0x01000000
+};
+
+// Low 32 bits of the 32x32 products, per lane.
+static WEBP_INLINE __m128i MulLo32_SSE2(const __m128i a, const __m128i b) {
+  const __m128i even = _mm_mul_epu32(a, b);
+  const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32),
+                                    _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Returns '((channel * scale + half) >> 24) << shift' for the 8b channel
+// at bit 'shift' of each argb lane, wrapping like the uint32_t C version.
+#define UNMULT_CHANNEL(ARGB, SCALE, SHIFT)                                   \
+    _mm_slli_epi32(_mm_srli_epi32(_mm_add_epi32(MulLo32_SSE2(                \
+        _mm_and_si128(_mm_srli_epi32((ARGB), (SHIFT)), kByte), (SCALE)),      \
+        kHalf), 24), (SHIFT))
+
 static void MultARGBRow_SSE2(uint32_t* const ptr, int width, int inverse) {
   int x = 0;
   if (!inverse) {
@@ -291,11 +437,36 @@ static void MultARGBRow_SSE2(uint32_t* const ptr, int width, int inverse) {
       const __m128i A10 = _mm_packus_epi16(A7, zero);
       _mm_storel_epi64((__m128i*)&ptr[x], A10);
     }
+  } else {
+    const __m128i kAlpha = _mm_set1_epi32((int)0xff000000u);
+    const __m128i kByte = _mm_set1_epi32(0xff);
+    const __m128i kHalf = _mm_set1_epi32(1 << 23);
+    for (x = 0; x + 4 <= width; x += 4) {
+      const __m128i A0 = _mm_loadu_si128((const __m128i*)&ptr[x]);
+      const __m128i A1 = _mm_and_si128(A0, kAlpha);
+      const __m128i opaque = _mm_cmpeq_epi32(A1, kAlpha);
+      if (_mm_movemask_epi8(opaque) != 0xffff) {
+        // With a 0xff alpha the scale is 1 << 24 (no-op), and a null alpha
+        // gives a null scale (so the pixel is cleared), as in the C version.
+        const __m128i scale = _mm_set_epi32((int)kInvAlpha[ptr[x + 3] >> 24],
+                                            (int)kInvAlpha[ptr[x + 2] >> 24],
+                                            (int)kInvAlpha[ptr[x + 1] >> 24],
+                                            (int)kInvAlpha[ptr[x + 0] >> 24]);
+        const __m128i B0 = UNMULT_CHANNEL(A0, scale, 0);
+        const __m128i B1 = UNMULT_CHANNEL(A0, scale, 8);
+        const __m128i B2 = UNMULT_CHANNEL(A0, scale, 16);
+        const __m128i C0 = _mm_or_si128(_mm_or_si128(B0, B1),
+                                        _mm_or_si128(B2, A1));
+        _mm_storeu_si128((__m128i*)&ptr[x], C0);
+      }
+    }
   }
   width -= x;
   if (width > 0) WebPMultARGBRow_C(ptr + x, width, inverse);
 }
 
+#undef UNMULT_CHANNEL
+
 static void MultRow_SSE2(uint8_t* const ptr, const uint8_t* const alpha,
                          int width, int inverse) {
   int x = 0;
@@ -319,6 +490,98 @@ static void MultRow_SSE2(uint8_t* const ptr, const uint8_t* const alpha,
   if (width > 0) WebPMultRow_C(ptr + x, alpha + x, width, inverse);
 }
 
+//------------------------------------------------------------------------------
+// 8b -> 16b RGBA conversions
+
+static void ConvertRGBAToRGBA16_SSE2(const uint8_t* rgba, int len,
+                                     uint16_t* dst) {
+  int i;
+  for (i = 0; i + 4 <= len; i += 4) {
+    // v * 257 is just the byte v, repeated.
+    const __m128i A = _mm_loadu_si128((const __m128i*)(rgba + 4 * i));
+    _mm_storeu_si128((__m128i*)(dst + 4 * i + 0), _mm_unpacklo_epi8(A, A));
+    _mm_storeu_si128((__m128i*)(dst + 4 * i + 8), _mm_unpackhi_epi8(A, A));
+  }
+  if (i < len) WebPConvertRGBAToRGBA16_C(rgba + 4 * i, len - i, dst + 4 * i);
+}
+
+// Returns the half-float values of A / 255 (rounded to nearest-even) for the
+// four 32b samples of 'A'. All the non-zero ones are normal half-floats, so
+// re-biasing the exponent of the float bits is enough.
+static WEBP_INLINE __m128i ToHalf_SSE2(const __m128i A) {
+  const __m128 scale = _mm_set1_ps(255.f);
+  const __m128i bias = _mm_set1_epi32(0x0fff - ((127 - 15) << 23));
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i F = _mm_castps_si128(_mm_div_ps(_mm_cvtepi32_ps(A), scale));
+  const __m128i odd = _mm_and_si128(_mm_srli_epi32(F, 13), one);
+  const __m128i H = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(F, bias), odd),
+                                   13);
+  return _mm_and_si128(H, _mm_cmpgt_epi32(A, _mm_setzero_si128()));
+}
+
+static void ConvertRGBAToRGBAF16_SSE2(const uint8_t* rgba, int len,
+                                      uint16_t* dst) {
+  const __m128i zero = _mm_setzero_si128();
+  int i;
+  for (i = 0; i + 4 <= len; i += 4) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)(rgba + 4 * i));
+    const __m128i B0 = _mm_unpacklo_epi8(A, zero);
+    const __m128i B1 = _mm_unpackhi_epi8(A, zero);
+    const __m128i C0 = ToHalf_SSE2(_mm_unpacklo_epi16(B0, zero));
+    const __m128i C1 = ToHalf_SSE2(_mm_unpackhi_epi16(B0, zero));
+    const __m128i C2 = ToHalf_SSE2(_mm_unpacklo_epi16(B1, zero));
+    const __m128i C3 = ToHalf_SSE2(_mm_unpackhi_epi16(B1, zero));
+    // The values are at most 0x3c00 (1.0): signed saturation is harmless.
+    _mm_storeu_si128((__m128i*)(dst + 4 * i + 0), _mm_packs_epi32(C0, C1));
+    _mm_storeu_si128((__m128i*)(dst + 4 * i + 8), _mm_packs_epi32(C2, C3));
+  }
+  if (i < len) WebPConvertRGBAToRGBAF16_C(rgba + 4 * i, len - i, dst + 4 * i);
+}
+
+// SSE2 has no table lookup: the linear light values of R, G and B are loaded
+// one by one into the 16b lanes, and the two pixels are stored at once.
+static void ConvertRGBAToRGBA16Linear_SSE2(const uint8_t* rgba, int len,
+                                           uint16_t* dst) {
+  const uint16_t* const table = WebPkToLinear16;
+  int i;
+  for (i = 0; i + 2 <= len; i += 2) {
+    const uint8_t* const src = rgba + 4 * i;
+    const __m128i A = _mm_loadl_epi64((const __m128i*)src);
+    __m128i B = _mm_unpacklo_epi8(A, A);   // alpha * 257
+    B = _mm_insert_epi16(B, table[src[0]], 0);
+    B = _mm_insert_epi16(B, table[src[1]], 1);
+    B = _mm_insert_epi16(B, table[src[2]], 2);
+    B = _mm_insert_epi16(B, table[src[4]], 4);
+    B = _mm_insert_epi16(B, table[src[5]], 5);
+    B = _mm_insert_epi16(B, table[src[6]], 6);
+    _mm_storeu_si128((__m128i*)(dst + 4 * i), B);
+  }
+  if (i < len) {
+    WebPConvertRGBAToRGBA16Linear_C(rgba + 4 * i, len - i, dst + 4 * i);
+  }
+}
+
+static void ConvertRGBAToRGBAF16Linear_SSE2(const uint8_t* rgba, int len,
+                                            uint16_t* dst) {
+  const uint16_t* const table = WebPkToLinearHalf;
+  int i;
+  for (i = 0; i + 2 <= len; i += 2) {
+    const uint8_t* const src = rgba + 4 * i;
+    __m128i B = _mm_cvtsi32_si128(table[src[0]]);
+    B = _mm_insert_epi16(B, table[src[1]], 1);
+    B = _mm_insert_epi16(B, table[src[2]], 2);
+    B = _mm_insert_epi16(B, WebPkToHalf[src[3]], 3);
+    B = _mm_insert_epi16(B, table[src[4]], 4);
+    B = _mm_insert_epi16(B, table[src[5]], 5);
+    B = _mm_insert_epi16(B, table[src[6]], 6);
+    B = _mm_insert_epi16(B, WebPkToHalf[src[7]], 7);
+    _mm_storeu_si128((__m128i*)(dst + 4 * i), B);
+  }
+  if (i < len) {
+    WebPConvertRGBAToRGBAF16Linear_C(rgba + 4 * i, len - i, dst + 4 * i);
+  }
+}
+
 //------------------------------------------------------------------------------
 // Entry point
 
@@ -329,11 +592,17 @@ WEBP_TSAN_IGNORE_FUNCTION void WebPInitAlphaProcessingSSE2(void) {
   WebPMultRow = MultRow_SSE2;
   WebPApplyAlphaMultiply = ApplyAlphaMultiply_SSE2;
   WebPDispatchAlpha = DispatchAlpha_SSE2;
+  WebPDispatchAlphaPremultiply = DispatchAlphaPremultiply_SSE2;
   WebPDispatchAlphaToGreen = DispatchAlphaToGreen_SSE2;
   WebPExtractAlpha = ExtractAlpha_SSE2;
 
   WebPHasAlpha8b = HasAlpha8b_SSE2;
   WebPHasAlpha32b = HasAlpha32b_SSE2;
+
+  WebPConvertRGBAToRGBA16 = ConvertRGBAToRGBA16_SSE2;
+  WebPConvertRGBAToRGBAF16 = ConvertRGBAToRGBAF16_SSE2;
+  WebPConvertRGBAToRGBA16Linear = ConvertRGBAToRGBA16Linear_SSE2;
+  WebPConvertRGBAToRGBAF16Linear = ConvertRGBAToRGBAF16Linear_SSE2;
 }
 
 #else  // !WEBP_USE_SSE2
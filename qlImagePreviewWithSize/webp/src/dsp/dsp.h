@@ -76,6 +76,17 @@ extern "C" {
 #define WEBP_USE_SSE41
 #endif
 
+// AVX2 code doesn't need the whole file to be built with -mavx2: gcc and clang
+// can enable the instruction set per function (see WEBP_AVX2_BEGIN), which
+// also suits builds of several architectures at once. The runtime check
+// decides whether the code is used.
+#if defined(__AVX2__) || defined(WEBP_HAVE_AVX2) ||                        \
+    (defined(WEBP_USE_SSE2) && (LOCAL_GCC_PREREQ(4, 9) ||                  \
+     (defined(__apple_build_version__) && LOCAL_CLANG_PREREQ(10, 0)) ||    \
+     (!defined(__apple_build_version__) && LOCAL_CLANG_PREREQ(6, 0))))
+#define WEBP_USE_AVX2
+#endif
+
 // The intrinsics currently cause compiler errors with arm-nacl-gcc and the
 // inline assembly would need to be modified for use with Native Client.
 #if (defined(__ARM_NEON__) || \
@@ -112,6 +123,23 @@ extern "C" {
 
 #endif  /* EMSCRIPTEN */
 
+// Code between WEBP_AVX2_BEGIN and WEBP_AVX2_END is compiled for AVX2. Only
+// function definitions should be placed there, after all the #includes.
+#if defined(WEBP_USE_AVX2) && !defined(__AVX2__)
+#if defined(__clang__)
+#define WEBP_AVX2_BEGIN \
+  _Pragma("clang attribute push(__attribute__((target(\"avx2\"))), apply_to = function)")
+#define WEBP_AVX2_END _Pragma("clang attribute pop")
+#else
+#define WEBP_AVX2_BEGIN \
+  _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+#define WEBP_AVX2_END _Pragma("GCC pop_options")
+#endif
+#else
+#define WEBP_AVX2_BEGIN
+#define WEBP_AVX2_END
+#endif
+
 #ifndef WEBP_DSP_OMIT_C_CODE
 #define WEBP_DSP_OMIT_C_CODE 1
 #endif
@@ -448,6 +476,21 @@ typedef void (*WebPUpsampleLinePairFunc)(
 // Fancy upsampling functions to convert YUV to RGB(A) modes
 extern WebPUpsampleLinePairFunc WebPUpsamplers[/* MODE_LAST */];
 
+// Same as WebPUpsampleLinePairFunc, but also reading the alpha values from
+// top_a/bottom_a, for the premultiplied modes (see WebPSamplerAlphaRowFunc).
+typedef void (*WebPUpsampleAlphaLinePairFunc)(
+    const uint8_t* top_y, const uint8_t* bottom_y,
+    const uint8_t* top_u, const uint8_t* top_v,
+    const uint8_t* cur_u, const uint8_t* cur_v,
+    const uint8_t* top_a, const uint8_t* bottom_a,
+    uint8_t* top_dst, uint8_t* bottom_dst, int len);
+
+// Fancy upsampling functions to convert YUV and alpha to the rgbA, bgrA and
+// Argb modes. The entries are NULL for the other modes, or if the platform
+// has no such function: the alpha must then be premultiplied separately.
+extern WebPUpsampleAlphaLinePairFunc
+    WebPPremultipliedUpsamplers[/* MODE_LAST */];
+
 #endif    // FANCY_UPSAMPLING
 
 // Per-row point-sampling methods.
@@ -463,6 +506,26 @@ void WebPSamplerProcessPlane(const uint8_t* y, int y_stride,
 // Sampling functions to convert rows of YUV to RGB(A)
 extern WebPSamplerRowFunc WebPSamplers[/* MODE_LAST */];
 
+// Per-row point-sampling methods for the premultiplied modes: the alpha
+// values 'a' are stored along with the color components, which are multiplied
+// by them in the same pass, with the same result as WebPApplyAlphaMultiply().
+typedef void (*WebPSamplerAlphaRowFunc)(const uint8_t* y,
+                                        const uint8_t* u, const uint8_t* v,
+                                        const uint8_t* a,
+                                        uint8_t* dst, int len);
+// Same as WebPSamplerProcessPlane(), with the alpha plane 'a':
+void WebPSamplerAlphaProcessPlane(const uint8_t* y, int y_stride,
+                                  const uint8_t* u, const uint8_t* v,
+                                  int uv_stride,
+                                  const uint8_t* a, int a_stride,
+                                  uint8_t* dst, int dst_stride,
+                                  int width, int height,
+                                  WebPSamplerAlphaRowFunc func);
+
+// Sampling functions to convert rows of YUV and alpha to the rgbA, bgrA and
+// Argb modes. The other entries are NULL.
+extern WebPSamplerAlphaRowFunc WebPPremultipliedSamplers[/* MODE_LAST */];
+
 // General function for converting two lines of ARGB or RGBA.
 // 'alpha_is_last' should be true if 0xff000000 is stored in memory as
 // as 0x00, 0x00, 0x00, 0xff (little endian).
@@ -475,10 +538,11 @@ typedef void (*WebPYUV444Converter)(const uint8_t* y,
 
 extern WebPYUV444Converter WebPYUV444Converters[/* MODE_LAST */];
 
-// Must be called before using the WebPUpsamplers[] (and for premultiplied
-// colorspaces like rgbA, rgbA4444, etc)
+// Must be called before using the WebPUpsamplers[] and
+// WebPPremultipliedUpsamplers[] (and for premultiplied colorspaces like rgbA,
+// rgbA4444, etc)
 void WebPInitUpsamplers(void);
-// Must be called before using WebPSamplers[]
+// Must be called before using WebPSamplers[] and WebPPremultipliedSamplers[]
 void WebPInitSamplers(void);
 // Must be called before using WebPYUV444Converters[]
 void WebPInitYUV444Converters(void);
@@ -549,12 +613,48 @@ extern void WebPRescalerImportRowShrink_C(struct WebPRescaler* const wrk,
 extern void WebPRescalerExportRowExpand_C(struct WebPRescaler* const wrk);
 extern void WebPRescalerExportRowShrink_C(struct WebPRescaler* const wrk);
 
+// Integer-ratio shrink (wrk->x_box != 0): adds the sums of each wrk->x_box
+// input pixels of 'src' to wrk->irow. The rows are then exported with
+// WebPRescalerExportRowShrink.
+extern WebPRescalerImportRowFunc WebPRescalerImportRowBox;
+extern void WebPRescalerImportRowBox_C(struct WebPRescaler* const wrk,
+                                       const uint8_t* src);
+
+// Linear-light mode (wrk->linear_row != NULL): same as ImportRowShrink and
+// ExportRowShrink, on WEBP_RESCALER_LINEAR_BITS linear samples.
+// 'ExportRowLinear' stores the output samples in wrk->linear_row.
+typedef void (*WebPRescalerImportRowLinearFunc)(struct WebPRescaler* const wrk,
+                                                const uint16_t* src);
+extern WebPRescalerImportRowLinearFunc WebPRescalerImportRowLinear;
+extern WebPRescalerExportRowFunc WebPRescalerExportRowLinear;
+extern void WebPRescalerImportRowLinear_C(struct WebPRescaler* const wrk,
+                                          const uint16_t* src);
+extern void WebPRescalerExportRowLinear_C(struct WebPRescaler* const wrk);
+
+// Separable-filter mode (wrk->filter != WEBP_RESCALER_AREA).
+// 'ImportRowFilter' filters the zero-padded row 'src' horizontally into the
+// ring buffer row of wrk->src_y. 'ExportRowFilter' filters the rows pointed to
+// by wrk->y_rows vertically into wrk->dst.
+extern WebPRescalerImportRowFunc WebPRescalerImportRowFilter;
+extern WebPRescalerExportRowFunc WebPRescalerExportRowFilter;
+extern void WebPRescalerImportRowFilter_C(struct WebPRescaler* const wrk,
+                                          const uint8_t* src);
+extern void WebPRescalerExportRowFilter_C(struct WebPRescaler* const wrk);
+
 // Main entry calls:
 extern void WebPRescalerImportRow(struct WebPRescaler* const wrk,
                                   const uint8_t* src);
 // Export one row (starting at x_out position) from rescaler.
 extern void WebPRescalerExportRow(struct WebPRescaler* const wrk);
 
+// Average the 2x2 blocks of the rows 'src0' and 'src1' ('src_width' samples
+// each) into the (src_width + 1) / 2 samples of 'dst', with rounding.
+// An odd last column only averages the two rows.
+typedef void (*WebPRescalerHalveRowFunc)(const uint8_t* src0,
+                                         const uint8_t* src1,
+                                         int src_width, uint8_t* dst);
+extern WebPRescalerHalveRowFunc WebPRescalerHalveRow;
+
 // Must be called first before using the above.
 void WebPRescalerDspInit(void);
 
@@ -576,6 +676,16 @@ extern int (*WebPDispatchAlpha)(const uint8_t* alpha, int alpha_stride,
                                 int width, int height,
                                 uint8_t* dst, int dst_stride);
 
+// Same as WebPDispatchAlpha(), but also pre-multiplies the RGB values of the
+// 32b 'rgba' destination with the dispatched alpha, in a single pass.
+// 'alpha_first' is 1 for argb order, 0 for rgba or bgra (where alpha is last).
+// Returns true if alpha[] plane has non-trivial values different from 0xff.
+extern int (*WebPDispatchAlphaPremultiply)(const uint8_t* alpha,
+                                           int alpha_stride,
+                                           int width, int height,
+                                           uint8_t* rgba, int rgba_stride,
+                                           int alpha_first);
+
 // Transfer packed 8b alpha[] values to green channel in dst[], zero'ing the
 // A/R/B values. 'dst_stride' is the stride for dst[] in uint32_t units.
 extern void (*WebPDispatchAlphaToGreen)(const uint8_t* alpha, int alpha_stride,
@@ -633,6 +743,32 @@ extern int (*WebPHasAlpha8b)(const uint8_t* src, int length);
 // This function returns true if src[4*i] contains a value different from 0xff.
 extern int (*WebPHasAlpha32b)(const uint8_t* src, int length);
 
+// Convert 'len' RGBA pixels to 16b samples: integers (v * 257) or half-floats
+// (v / 255). The conversion can be done in place, when 'rgba' is the second
+// half of the destination row (that is: dst + 2 * len).
+extern void (*WebPConvertRGBAToRGBA16)(const uint8_t* rgba, int len,
+                                       uint16_t* dst);
+extern void (*WebPConvertRGBAToRGBAF16)(const uint8_t* rgba, int len,
+                                        uint16_t* dst);
+void WebPConvertRGBAToRGBA16_C(const uint8_t* rgba, int len, uint16_t* dst);
+void WebPConvertRGBAToRGBAF16_C(const uint8_t* rgba, int len, uint16_t* dst);
+
+// Same, with R, G and B taken from sRGB to linear light (alpha is unchanged).
+extern void (*WebPConvertRGBAToRGBA16Linear)(const uint8_t* rgba, int len,
+                                             uint16_t* dst);
+extern void (*WebPConvertRGBAToRGBAF16Linear)(const uint8_t* rgba, int len,
+                                              uint16_t* dst);
+void WebPConvertRGBAToRGBA16Linear_C(const uint8_t* rgba, int len,
+                                     uint16_t* dst);
+void WebPConvertRGBAToRGBAF16Linear_C(const uint8_t* rgba, int len,
+                                      uint16_t* dst);
+
+// Tables of the conversions above, for 8b samples v: half-float value of
+// v / 255, and 16b integer and half-float linear light values of v / 255.
+extern const uint16_t WebPkToHalf[256];
+extern const uint16_t WebPkToLinear16[256];
+extern const uint16_t WebPkToLinearHalf[256];
+
 // To be called first before using the above.
 void WebPInitAlphaProcessing(void);
 
@@ -668,6 +804,22 @@ extern WebPFilterFunc WebPFilters[WEBP_FILTER_LAST];
 // (assuming rows upto 'row - 1' are already reconstructed).
 extern WebPUnfilterFunc WebPUnfilters[WEBP_FILTER_LAST];
 
+// Box-filter passes used by the alpha smoothing in WebPDequantizeLevels().
+// Vertical pass: 'cur[x]' is replaced by 'top[x] + src[0] + ... + src[x]' and
+// 'out[x]' receives the difference with the previous 'cur[x]' value (all
+// modulo 16 bits).
+typedef void (*WebPQuantLevelsVFilterFunc)(const uint8_t* src,
+                                           const uint16_t* top, uint16_t* cur,
+                                           uint16_t* out, int width);
+// Horizontal pass:
+//   out[x] = ((uint16_t)(in[x + radius] - in[x - radius - 1]) * scale) >> 16
+// for x in [0, width). 'scale' must be less than 1 << 16.
+typedef void (*WebPQuantLevelsHFilterFunc)(const uint16_t* in, int radius,
+                                           uint32_t scale, uint16_t* out,
+                                           int width);
+extern WebPQuantLevelsVFilterFunc WebPQuantLevelsVFilter;
+extern WebPQuantLevelsHFilterFunc WebPQuantLevelsHFilter;
+
 // To be called first before using the above.
 void VP8FiltersInit(void);
 
@@ -227,16 +227,44 @@ static void GradientUnfilter_C(const uint8_t* prev, const uint8_t* in,
   }
 }
 
+//------------------------------------------------------------------------------
+// Box-filter for levels dequantization
+
+static void QuantLevelsVFilter_C(const uint8_t* src, const uint16_t* top,
+                                 uint16_t* cur, uint16_t* out, int width) {
+  uint16_t sum = 0;               // all arithmetic is modulo 16bit
+  int x;
+  for (x = 0; x < width; ++x) {
+    uint16_t new_value;
+    sum += src[x];
+    new_value = top[x] + sum;
+    out[x] = new_value - cur[x];  // vertical sum of 'r' pixels.
+    cur[x] = new_value;
+  }
+}
+
+static void QuantLevelsHFilter_C(const uint16_t* in, int radius,
+                                 uint32_t scale, uint16_t* out, int width) {
+  int x;
+  for (x = 0; x < width; ++x) {
+    const uint16_t delta = in[x + radius] - in[x - radius - 1];
+    out[x] = (delta * scale) >> 16;
+  }
+}
+
 //------------------------------------------------------------------------------
 // Init function
 
 WebPFilterFunc WebPFilters[WEBP_FILTER_LAST];
 WebPUnfilterFunc WebPUnfilters[WEBP_FILTER_LAST];
+WebPQuantLevelsVFilterFunc WebPQuantLevelsVFilter;
+WebPQuantLevelsHFilterFunc WebPQuantLevelsHFilter;
 
 extern void VP8FiltersInitMIPSdspR2(void);
 extern void VP8FiltersInitMSA(void);
 extern void VP8FiltersInitNEON(void);
 extern void VP8FiltersInitSSE2(void);
+extern void VP8FiltersInitAVX2(void);
 
 WEBP_DSP_INIT_FUNC(VP8FiltersInit) {
   WebPUnfilters[WEBP_FILTER_NONE] = NULL;
@@ -247,6 +275,8 @@ WEBP_DSP_INIT_FUNC(VP8FiltersInit) {
   WebPUnfilters[WEBP_FILTER_GRADIENT] = GradientUnfilter_C;
 
   WebPFilters[WEBP_FILTER_NONE] = NULL;
+  WebPQuantLevelsVFilter = QuantLevelsVFilter_C;
+  WebPQuantLevelsHFilter = QuantLevelsHFilter_C;
 #if !WEBP_NEON_OMIT_C_CODE
   WebPFilters[WEBP_FILTER_HORIZONTAL] = HorizontalFilter_C;
   WebPFilters[WEBP_FILTER_VERTICAL] = VerticalFilter_C;
@@ -259,6 +289,11 @@ WEBP_DSP_INIT_FUNC(VP8FiltersInit) {
       VP8FiltersInitSSE2();
     }
 #endif
+#if defined(WEBP_USE_AVX2)
+    if (VP8GetCPUInfo(kAVX2)) {
+      VP8FiltersInitAVX2();
+    }
+#endif
 #if defined(WEBP_USE_MIPS_DSP_R2)
     if (VP8GetCPUInfo(kMIPSdspR2)) {
       VP8FiltersInitMIPSdspR2();
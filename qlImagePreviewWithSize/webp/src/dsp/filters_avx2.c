@@ -0,0 +1,156 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 variant of alpha unfilters
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <assert.h>
+#include <immintrin.h>
+
+WEBP_AVX2_BEGIN
+
+//------------------------------------------------------------------------------
+// Inverse transforms
+
+// Returns the prefix-sums of the 32 bytes of 'A', plus 'last' in each byte.
+static WEBP_INLINE __m256i PrefixSum32_AVX2(const __m256i A,
+                                            const __m256i last) {
+  // within each 128-bit lane, in log2(16) steps
+  const __m256i A1 = _mm256_add_epi8(A, _mm256_slli_si256(A, 1));
+  const __m256i A2 = _mm256_add_epi8(A1, _mm256_slli_si256(A1, 2));
+  const __m256i A3 = _mm256_add_epi8(A2, _mm256_slli_si256(A2, 4));
+  const __m256i A4 = _mm256_add_epi8(A3, _mm256_slli_si256(A3, 8));
+  // then the total of the low lane is carried to the high lane
+  const __m256i kLast = _mm256_set1_epi8(15);
+  const __m256i A5 = _mm256_permute2x128_si256(A4, A4, 0x08);
+  const __m256i A6 = _mm256_add_epi8(A4, _mm256_shuffle_epi8(A5, kLast));
+  return _mm256_add_epi8(A6, last);
+}
+
+static void HorizontalUnfilter_AVX2(const uint8_t* prev, const uint8_t* in,
+                                    uint8_t* out, int width) {
+  int i;
+  out[0] = (uint8_t)(in[0] + (prev == NULL ? 0 : prev[0]));
+  if (width <= 1) return;
+  if (width >= 33) {
+    const __m256i kLast = _mm256_set1_epi8(15);
+    __m256i last = _mm256_set1_epi8((char)out[0]);
+    for (i = 1; i + 32 <= width; i += 32) {
+      const __m256i A = _mm256_loadu_si256((const __m256i*)(in + i));
+      const __m256i B = PrefixSum32_AVX2(A, last);
+      _mm256_storeu_si256((__m256i*)(out + i), B);
+      // broadcast the last byte
+      last = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(B, kLast), 0xff);
+    }
+  } else {
+    i = 1;
+  }
+  for (; i < width; ++i) out[i] = (uint8_t)(in[i] + out[i - 1]);
+}
+
+static void VerticalUnfilter_AVX2(const uint8_t* prev, const uint8_t* in,
+                                  uint8_t* out, int width) {
+  if (prev == NULL) {
+    HorizontalUnfilter_AVX2(NULL, in, out, width);
+  } else {
+    int i;
+    const int max_pos = width & ~63;
+    assert(width >= 0);
+    for (i = 0; i < max_pos; i += 64) {
+      const __m256i A0 = _mm256_loadu_si256((const __m256i*)&in[i +  0]);
+      const __m256i A1 = _mm256_loadu_si256((const __m256i*)&in[i + 32]);
+      const __m256i B0 = _mm256_loadu_si256((const __m256i*)&prev[i +  0]);
+      const __m256i B1 = _mm256_loadu_si256((const __m256i*)&prev[i + 32]);
+      _mm256_storeu_si256((__m256i*)&out[i +  0], _mm256_add_epi8(A0, B0));
+      _mm256_storeu_si256((__m256i*)&out[i + 32], _mm256_add_epi8(A1, B1));
+    }
+    for (; i < width; ++i) out[i] = (uint8_t)(in[i] + prev[i]);
+  }
+}
+
+static WEBP_INLINE int GradientPredictor_AVX2(uint8_t a, uint8_t b, uint8_t c) {
+  const int g = a + b - c;
+  return ((g & ~0xff) == 0) ? g : (g < 0) ? 0 : 255;  // clip to 8bit
+}
+
+// Same fast path as GradientPredictInverse_SSE2(), on 16 samples at a time:
+// while no 'left + top - top_left' prediction needs clipping, 'row - top' is
+// the prefix-sum of 'in'. Blocks for which this doesn't hold are done
+// serially.
+static void GradientPredictInverse_AVX2(const uint8_t* const in,
+                                        const uint8_t* const top,
+                                        uint8_t* const row, int length) {
+  int i;
+  const __m256i kClipMask = _mm256_set1_epi16((short)0xff00);
+  for (i = 0; i + 16 <= length; i += 16) {
+    const __m128i T0 = _mm_loadu_si128((const __m128i*)&top[i]);
+    const __m128i T1 = _mm_loadu_si128((const __m128i*)&top[i - 1]);
+    const __m128i D = _mm_loadu_si128((const __m128i*)&in[i]);
+    const __m128i G0 = _mm_set1_epi8((char)(row[i - 1] - top[i - 1]));
+    const __m128i S0 = _mm_add_epi8(D, _mm_slli_si128(D, 1));
+    const __m128i S1 = _mm_add_epi8(S0, _mm_slli_si128(S0, 2));
+    const __m128i S2 = _mm_add_epi8(S1, _mm_slli_si128(S1, 4));
+    const __m128i S3 = _mm_add_epi8(S2, _mm_slli_si128(S2, 8));
+    const __m128i O = _mm_add_epi8(_mm_add_epi8(S3, G0), T0);
+    // left samples: row[i - 1], then the first 15 outputs
+    const __m128i L = _mm_or_si128(_mm_slli_si128(O, 1),
+                                   _mm_cvtsi32_si128(row[i - 1]));
+    const __m256i P =
+        _mm256_sub_epi16(_mm256_add_epi16(_mm256_cvtepu8_epi16(L),
+                                          _mm256_cvtepu8_epi16(T0)),
+                         _mm256_cvtepu8_epi16(T1));
+    const __m256i clipped = _mm256_and_si256(P, kClipMask);
+    if (_mm256_testz_si256(clipped, clipped)) {
+      _mm_storeu_si128((__m128i*)&row[i], O);
+    } else {
+      int k;
+      for (k = i; k < i + 16; ++k) {
+        const int delta =
+            GradientPredictor_AVX2(row[k - 1], top[k], top[k - 1]);
+        row[k] = (uint8_t)(in[k] + delta);
+      }
+    }
+  }
+  for (; i < length; ++i) {
+    const int delta = GradientPredictor_AVX2(row[i - 1], top[i], top[i - 1]);
+    row[i] = (uint8_t)(in[i] + delta);
+  }
+}
+
+static void GradientUnfilter_AVX2(const uint8_t* prev, const uint8_t* in,
+                                  uint8_t* out, int width) {
+  if (prev == NULL) {
+    HorizontalUnfilter_AVX2(NULL, in, out, width);
+  } else {
+    out[0] = (uint8_t)(in[0] + prev[0]);  // predict from above
+    GradientPredictInverse_AVX2(in + 1, prev + 1, out + 1, width - 1);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void VP8FiltersInitAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void VP8FiltersInitAVX2(void) {
+  WebPUnfilters[WEBP_FILTER_HORIZONTAL] = HorizontalUnfilter_AVX2;
+  WebPUnfilters[WEBP_FILTER_VERTICAL] = VerticalUnfilter_AVX2;
+  WebPUnfilters[WEBP_FILTER_GRADIENT] = GradientUnfilter_AVX2;
+}
+
+WEBP_AVX2_END
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(VP8FiltersInitAVX2)
+
+#endif  // WEBP_USE_AVX2
@@ -227,7 +227,22 @@ static void HorizontalUnfilter_SSE2(const uint8_t* prev, const uint8_t* in,
   out[0] = (uint8_t)(in[0] + (prev == NULL ? 0 : prev[0]));
   if (width <= 1) return;
   last = _mm_set_epi32(0, 0, 0, out[0]);
-  for (i = 1; i + 8 <= width; i += 8) {
+  // prefix-sums over 16 bytes, in log2(16) steps
+  for (i = 1; i + 16 <= width; i += 16) {
+    const __m128i A0 = _mm_loadu_si128((const __m128i*)(in + i));
+    const __m128i A1 = _mm_add_epi8(A0, last);
+    const __m128i A2 = _mm_slli_si128(A1, 1);
+    const __m128i A3 = _mm_add_epi8(A1, A2);
+    const __m128i A4 = _mm_slli_si128(A3, 2);
+    const __m128i A5 = _mm_add_epi8(A3, A4);
+    const __m128i A6 = _mm_slli_si128(A5, 4);
+    const __m128i A7 = _mm_add_epi8(A5, A6);
+    const __m128i A8 = _mm_slli_si128(A7, 8);
+    const __m128i A9 = _mm_add_epi8(A7, A8);
+    _mm_storeu_si128((__m128i*)(out + i), A9);
+    last = _mm_srli_si128(A9, 15);
+  }
+  if (i + 8 <= width) {
     const __m128i A0 = _mm_loadl_epi64((const __m128i*)(in + i));
     const __m128i A1 = _mm_add_epi8(A0, last);
     const __m128i A2 = _mm_slli_si128(A1, 1);
@@ -237,7 +252,7 @@ static void HorizontalUnfilter_SSE2(const uint8_t* prev, const uint8_t* in,
     const __m128i A6 = _mm_slli_si128(A5, 4);
     const __m128i A7 = _mm_add_epi8(A5, A6);
     _mm_storel_epi64((__m128i*)(out + i), A7);
-    last = _mm_srli_epi64(A7, 56);
+    i += 8;
   }
   for (; i < width; ++i) out[i] = (uint8_t)(in[i] + out[i - 1]);
 }
@@ -271,6 +286,7 @@ static void GradientPredictInverse_SSE2(const uint8_t* const in,
     int i;
     const int max_pos = length & ~7;
     const __m128i zero = _mm_setzero_si128();
+    const __m128i kClipMask = _mm_set1_epi16((short)0xff00);
     __m128i A = _mm_set_epi32(0, 0, 0, row[-1]);   // left sample
     for (i = 0; i < max_pos; i += 8) {
       const __m128i tmp0 = _mm_loadl_epi64((const __m128i*)&top[i]);
@@ -282,6 +298,25 @@ static void GradientPredictInverse_SSE2(const uint8_t* const in,
       __m128i out = zero;                     // accumulator for output
       __m128i mask_hi = _mm_set_epi32(0, 0, 0, 0xff);
       int k = 8;
+      {
+        // Fast path: as long as no 'A + B - C' prediction needs clipping,
+        // 'row[] - top[]' is just the prefix-sum of in[]. We compute it and
+        // only keep it if the predictions it implies are indeed in range.
+        const __m128i G0 = _mm_set1_epi8((char)(row[i - 1] - top[i - 1]));
+        const __m128i S0 = _mm_add_epi8(D, _mm_slli_si128(D, 1));
+        const __m128i S1 = _mm_add_epi8(S0, _mm_slli_si128(S0, 2));
+        const __m128i S2 = _mm_add_epi8(S1, _mm_slli_si128(S1, 4));
+        const __m128i O0 = _mm_add_epi8(_mm_add_epi8(S2, G0), tmp0);
+        const __m128i O1 = _mm_unpacklo_epi8(O0, zero);
+        const __m128i L = _mm_or_si128(_mm_slli_si128(O1, 2), A);
+        const __m128i P = _mm_add_epi16(L, E);   // predictions to check
+        const __m128i clipped = _mm_and_si128(P, kClipMask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(clipped, zero)) == 0xffff) {
+          _mm_storel_epi64((__m128i*)&row[i], O0);
+          A = _mm_srli_si128(O1, 14);
+          continue;
+        }
+      }
       while (1) {
         const __m128i tmp3 = _mm_add_epi16(A, E);           // delta = A + B - C
         const __m128i tmp4 = _mm_packus_epi16(tmp3, zero);  // saturate delta
@@ -313,6 +348,59 @@ static void GradientUnfilter_SSE2(const uint8_t* prev, const uint8_t* in,
   }
 }
 
+//------------------------------------------------------------------------------
+// Box-filter for levels dequantization
+
+static void QuantLevelsVFilter_SSE2(const uint8_t* src, const uint16_t* top,
+                                    uint16_t* cur, uint16_t* out, int width) {
+  int x;
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;    // running horizontal sum, in all 16b lanes
+  for (x = 0; x + 8 <= width; x += 8) {
+    const __m128i A0 = _mm_loadl_epi64((const __m128i*)&src[x]);
+    const __m128i A1 = _mm_unpacklo_epi8(A0, zero);
+    // prefix-sums over the 8 lanes
+    const __m128i A2 = _mm_add_epi16(A1, _mm_slli_si128(A1, 2));
+    const __m128i A3 = _mm_add_epi16(A2, _mm_slli_si128(A2, 4));
+    const __m128i A4 = _mm_add_epi16(A3, _mm_slli_si128(A3, 8));
+    const __m128i A5 = _mm_add_epi16(A4, sum);
+    const __m128i T = _mm_loadu_si128((const __m128i*)&top[x]);
+    const __m128i C = _mm_loadu_si128((const __m128i*)&cur[x]);
+    const __m128i new_value = _mm_add_epi16(T, A5);
+    const __m128i B0 = _mm_shufflehi_epi16(A5, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm_storeu_si128((__m128i*)&out[x], _mm_sub_epi16(new_value, C));
+    _mm_storeu_si128((__m128i*)&cur[x], new_value);
+    sum = _mm_unpackhi_epi64(B0, B0);   // broadcast the last lane
+  }
+  if (x < width) {
+    uint16_t last_sum = (uint16_t)_mm_extract_epi16(sum, 0);
+    for (; x < width; ++x) {
+      uint16_t new_value;
+      last_sum += src[x];
+      new_value = top[x] + last_sum;
+      out[x] = new_value - cur[x];
+      cur[x] = new_value;
+    }
+  }
+}
+
+static void QuantLevelsHFilter_SSE2(const uint16_t* in, int radius,
+                                    uint32_t scale, uint16_t* out, int width) {
+  int x;
+  const __m128i mult = _mm_set1_epi16((short)scale);
+  assert(scale < (1u << 16));
+  for (x = 0; x + 8 <= width; x += 8) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)&in[x + radius]);
+    const __m128i B = _mm_loadu_si128((const __m128i*)&in[x - radius - 1]);
+    const __m128i delta = _mm_sub_epi16(A, B);
+    _mm_storeu_si128((__m128i*)&out[x], _mm_mulhi_epu16(delta, mult));
+  }
+  for (; x < width; ++x) {
+    const uint16_t delta = in[x + radius] - in[x - radius - 1];
+    out[x] = (delta * scale) >> 16;
+  }
+}
+
 //------------------------------------------------------------------------------
 // Entry point
 
@@ -326,6 +414,9 @@ WEBP_TSAN_IGNORE_FUNCTION void VP8FiltersInitSSE2(void) {
   WebPFilters[WEBP_FILTER_HORIZONTAL] = HorizontalFilter_SSE2;
   WebPFilters[WEBP_FILTER_VERTICAL] = VerticalFilter_SSE2;
   WebPFilters[WEBP_FILTER_GRADIENT] = GradientFilter_SSE2;
+
+  WebPQuantLevelsVFilter = QuantLevelsVFilter_SSE2;
+  WebPQuantLevelsHFilter = QuantLevelsHFilter_SSE2;
 }
 
 #else  // !WEBP_USE_SSE2
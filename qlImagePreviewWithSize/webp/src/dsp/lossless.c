@@ -509,6 +509,35 @@ static void CopyOrSwap(const uint32_t* src, int num_pixels, uint8_t* dst,
   }
 }
 
+void WebPConvertRGBATo16b(const uint8_t* rgba, int len, WEBP_CSP_MODE mode,
+                          uint16_t* dst) {
+  switch (mode) {
+    case MODE_RGBA_16:
+      WebPConvertRGBAToRGBA16(rgba, len, dst);
+      break;
+    case MODE_RGBA_F16:
+      WebPConvertRGBAToRGBAF16(rgba, len, dst);
+      break;
+    case MODE_RGBA_16_LINEAR:
+      WebPConvertRGBAToRGBA16Linear(rgba, len, dst);
+      break;
+    case MODE_RGBA_F16_LINEAR:
+      WebPConvertRGBAToRGBAF16Linear(rgba, len, dst);
+      break;
+    default:
+      assert(0);          // Code flow should not reach here.
+  }
+}
+
+void WebPConvertRGBARowsTo16b(uint8_t* rgba, int stride, int width,
+                              int num_rows, WEBP_CSP_MODE mode) {
+  int j;
+  for (j = 0; j < num_rows; ++j) {
+    WebPConvertRGBATo16b(rgba + 4 * width, width, mode, (uint16_t*)rgba);
+    rgba += stride;
+  }
+}
+
 void VP8LConvertFromBGRA(const uint32_t* const in_data, int num_pixels,
                          WEBP_CSP_MODE out_colorspace, uint8_t* const rgba) {
   switch (out_colorspace) {
@@ -549,6 +578,16 @@ void VP8LConvertFromBGRA(const uint32_t* const in_data, int num_pixels,
     case MODE_RGB_565:
       VP8LConvertBGRAToRGB565(in_data, num_pixels, rgba);
       break;
+    case MODE_RGBA_16:
+    case MODE_RGBA_F16:
+    case MODE_RGBA_16_LINEAR:
+    case MODE_RGBA_F16_LINEAR: {
+      // Expand in place from the second half of the 8 bytes-per-pixel row.
+      uint8_t* const tmp = rgba + 4 * num_pixels;
+      VP8LConvertBGRAToRGBA(in_data, num_pixels, tmp);
+      WebPConvertRGBATo16b(tmp, num_pixels, out_colorspace, (uint16_t*)rgba);
+      break;
+    }
     default:
       assert(0);          // Code flow should not reach here.
   }
@@ -77,6 +77,15 @@ extern VP8LConvertFunc VP8LConvertBGRAToBGR;
 void VP8LConvertFromBGRA(const uint32_t* const in_data, int num_pixels,
                          WEBP_CSP_MODE out_colorspace, uint8_t* const rgba);
 
+// Converts 'len' RGBA pixels to any of the 16b output modes (including the
+// _LINEAR ones), using the WebPConvertRGBAToRGBA16() family of dsp.h.
+void WebPConvertRGBATo16b(const uint8_t* rgba, int len, WEBP_CSP_MODE mode,
+                          uint16_t* dst);
+// In-place conversion of 'num_rows' rows holding RGBA samples in their second
+// half ('rgba + 4 * width') to the 16b 'mode'.
+void WebPConvertRGBARowsTo16b(uint8_t* rgba, int stride, int width,
+                              int num_rows, WEBP_CSP_MODE mode);
+
 typedef void (*VP8LMapARGBFunc)(const uint32_t* src,
                                 const uint32_t* const color_map,
                                 uint32_t* dst, int y_start,
@@ -248,10 +248,78 @@ GENERATE_PREDICTOR_1(4, upper[i - 1])
 #undef GENERATE_PREDICTOR_1
 
 // Due to averages with integers, values cannot be accumulated in parallel for
-// predictors 5 to 7.
-GENERATE_PREDICTOR_ADD(Predictor5_SSE2, PredictorAdd5_SSE2)
-GENERATE_PREDICTOR_ADD(Predictor6_SSE2, PredictorAdd6_SSE2)
-GENERATE_PREDICTOR_ADD(Predictor7_SSE2, PredictorAdd7_SSE2)
+// predictors 5 to 7 (the floor and the mod-256 wrap break associativity).
+// Instead, everything that does not depend on the left pixel is computed for
+// four pixels at once, and only the left dependency is resolved lane by lane
+// without leaving the registers.
+
+// Predictor5: average of (average of (L, TR), T).
+#define DO_PRED5(OUT) do {                \
+  __m128i avgLTR, avg;                    \
+  Average2_m128i(&L, &TR, &avgLTR);       \
+  Average2_m128i(&avgLTR, &T, &avg);      \
+  L = _mm_add_epi8(avg, src);             \
+  out[i + (OUT)] = _mm_cvtsi128_si32(L);  \
+} while (0)
+
+#define DO_PRED5_SHIFT do {                                   \
+  /* Rotate the pre-computed values for the next iteration.*/ \
+  T = _mm_srli_si128(T, 4);                                   \
+  TR = _mm_srli_si128(TR, 4);                                 \
+  src = _mm_srli_si128(src, 4);                               \
+} while (0)
+
+static void PredictorAdd5_SSE2(const uint32_t* in, const uint32_t* upper,
+                               int num_pixels, uint32_t* out) {
+  int i;
+  __m128i L = _mm_cvtsi32_si128(out[-1]);
+  for (i = 0; i + 4 <= num_pixels; i += 4) {
+    __m128i src = _mm_loadu_si128((const __m128i*)&in[i]);
+    __m128i T = _mm_loadu_si128((const __m128i*)&upper[i]);
+    __m128i TR = _mm_loadu_si128((const __m128i*)&upper[i + 1]);
+    DO_PRED5(0);
+    DO_PRED5_SHIFT;
+    DO_PRED5(1);
+    DO_PRED5_SHIFT;
+    DO_PRED5(2);
+    DO_PRED5_SHIFT;
+    DO_PRED5(3);
+  }
+  if (i != num_pixels) {
+    VP8LPredictorsAdd_C[5](in + i, upper + i, num_pixels - i, out + i);
+  }
+}
+#undef DO_PRED5
+#undef DO_PRED5_SHIFT
+
+// Predictor6: average L TL.
+// Predictor7: average L T.
+#define GENERATE_PREDICTOR_3(X, IN)                                           \
+static void PredictorAdd##X##_SSE2(const uint32_t* in, const uint32_t* upper, \
+                                   int num_pixels, uint32_t* out) {           \
+  int i;                                                                      \
+  __m128i L = _mm_cvtsi32_si128(out[-1]);                                     \
+  for (i = 0; i + 4 <= num_pixels; i += 4) {                                  \
+    __m128i src = _mm_loadu_si128((const __m128i*)&in[i]);                    \
+    __m128i other = _mm_loadu_si128((const __m128i*)&(IN));                   \
+    int k;                                                                    \
+    for (k = 0; k < 4; ++k) {                                                 \
+      __m128i avg;                                                            \
+      Average2_m128i(&L, &other, &avg);                                       \
+      L = _mm_add_epi8(avg, src);                                             \
+      out[i + k] = _mm_cvtsi128_si32(L);                                      \
+      /* Rotate the pre-computed values for the next iteration.*/             \
+      other = _mm_srli_si128(other, 4);                                       \
+      src = _mm_srli_si128(src, 4);                                           \
+    }                                                                         \
+  }                                                                           \
+  if (i != num_pixels) {                                                      \
+    VP8LPredictorsAdd_C[(X)](in + i, upper + i, num_pixels - i, out + i);     \
+  }                                                                           \
+}
+GENERATE_PREDICTOR_3(6, upper[i - 1])
+GENERATE_PREDICTOR_3(7, upper[i])
+#undef GENERATE_PREDICTOR_3
 
 #define GENERATE_PREDICTOR_2(X, IN)                                           \
 static void PredictorAdd##X##_SSE2(const uint32_t* in, const uint32_t* upper, \
@@ -422,9 +490,56 @@ static void PredictorAdd12_SSE2(const uint32_t* in, const uint32_t* upper,
 #undef DO_PRED12
 #undef DO_PRED12_SHIFT
 
-// Due to averages with integers, values cannot be accumulated in parallel for
-// predictors 13.
-GENERATE_PREDICTOR_ADD(Predictor13_SSE2, PredictorAdd13_SSE2)
+// Predictor13: ClampedAddSubtractHalf
+#define DO_PRED13(TL16, OUT) do {                          \
+  __m128i avg;                                             \
+  Average2_m128i(&L, &T, &avg);                            \
+  {                                                        \
+    const __m128i A0 = _mm_unpacklo_epi8(avg, zero);       \
+    const __m128i A1 = _mm_sub_epi16(A0, (TL16));          \
+    const __m128i BgtA = _mm_cmpgt_epi16((TL16), A0);      \
+    const __m128i A2 = _mm_sub_epi16(A1, BgtA);            \
+    const __m128i A3 = _mm_srai_epi16(A2, 1);              \
+    const __m128i A4 = _mm_add_epi16(A0, A3);              \
+    const __m128i A5 = _mm_packus_epi16(A4, A4);           \
+    L = _mm_add_epi8(src, A5);                             \
+    out[i + (OUT)] = _mm_cvtsi128_si32(L);                 \
+  }                                                        \
+} while (0)
+
+#define DO_PRED13_SHIFT(TL16, LANE) do {                    \
+  /* Shift the pre-computed value for the next iteration.*/ \
+  if ((LANE) == 0) (TL16) = _mm_srli_si128((TL16), 8);      \
+  T = _mm_srli_si128(T, 4);                                 \
+  src = _mm_srli_si128(src, 4);                             \
+} while (0)
+
+static void PredictorAdd13_SSE2(const uint32_t* in, const uint32_t* upper,
+                                int num_pixels, uint32_t* out) {
+  int i;
+  const __m128i zero = _mm_setzero_si128();
+  __m128i L = _mm_cvtsi32_si128(out[-1]);
+  for (i = 0; i + 4 <= num_pixels; i += 4) {
+    // Load 4 pixels at a time.
+    __m128i src = _mm_loadu_si128((const __m128i*)&in[i]);
+    __m128i T = _mm_loadu_si128((const __m128i*)&upper[i]);
+    const __m128i TL = _mm_loadu_si128((const __m128i*)&upper[i - 1]);
+    __m128i TL_lo = _mm_unpacklo_epi8(TL, zero);
+    __m128i TL_hi = _mm_unpackhi_epi8(TL, zero);
+    DO_PRED13(TL_lo, 0);
+    DO_PRED13_SHIFT(TL_lo, 0);
+    DO_PRED13(TL_lo, 1);
+    DO_PRED13_SHIFT(TL_lo, 1);
+    DO_PRED13(TL_hi, 2);
+    DO_PRED13_SHIFT(TL_hi, 0);
+    DO_PRED13(TL_hi, 3);
+  }
+  if (i != num_pixels) {
+    VP8LPredictorsAdd_C[13](in + i, upper + i, num_pixels - i, out + i);
+  }
+}
+#undef DO_PRED13
+#undef DO_PRED13_SHIFT
 
 //------------------------------------------------------------------------------
 // Subtract-Green Transform
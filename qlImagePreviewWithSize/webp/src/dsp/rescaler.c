@@ -92,6 +92,58 @@ void WebPRescalerImportRowShrink_C(WebPRescaler* const wrk,
   }
 }
 
+void WebPRescalerImportRowBox_C(WebPRescaler* const wrk,
+                                const uint8_t* src) {
+  const int x_stride = wrk->num_channels;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const int box_size = wrk->x_box * x_stride;
+  rescaler_t* const irow = wrk->irow;
+  int x_out, channel, k;
+  assert(!WebPRescalerInputDone(wrk));
+  assert(wrk->x_box > 0);
+  for (x_out = 0; x_out < x_out_max; x_out += x_stride, src += box_size) {
+    for (channel = 0; channel < x_stride; ++channel) {
+      uint32_t sum = 0;
+      for (k = channel; k < box_size; k += x_stride) sum += src[k];
+      irow[x_out + channel] += sum;
+    }
+  }
+}
+
+void WebPRescalerImportRowLinear_C(WebPRescaler* const wrk,
+                                   const uint16_t* src) {
+  const int x_stride = wrk->num_channels;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  int channel;
+  assert(!WebPRescalerInputDone(wrk));
+  assert(!wrk->x_expand);
+  for (channel = 0; channel < x_stride; ++channel) {
+    int x_in = channel;
+    int x_out = channel;
+    uint32_t sum = 0;
+    int accum = 0;
+    while (x_out < x_out_max) {
+      uint32_t base = 0;
+      accum += wrk->x_add;
+      while (accum > 0) {
+        accum -= wrk->x_sub;
+        assert(x_in < wrk->src_width * x_stride);
+        base = src[x_in];
+        sum += base;
+        x_in += x_stride;
+      }
+      {        // Emit next horizontal pixel.
+        const rescaler_t frac = base * (-accum);
+        wrk->frow[x_out] = sum * wrk->x_sub - frac;
+        // fresh fractional start for next pixel
+        sum = (int)MULT_FIX(frac, wrk->fx_scale);
+      }
+      x_out += x_stride;
+    }
+    assert(accum == 0);
+  }
+}
+
 //------------------------------------------------------------------------------
 // Row export
 
@@ -150,16 +202,124 @@ void WebPRescalerExportRowShrink_C(WebPRescaler* const wrk) {
   }
 }
 
+void WebPRescalerExportRowLinear_C(WebPRescaler* const wrk) {
+  int x_out;
+  uint16_t* const dst = wrk->linear_row;
+  rescaler_t* const irow = wrk->irow;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const rescaler_t* const frow = wrk->frow;
+  const uint32_t yscale = wrk->fy_scale * (-wrk->y_accum);
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(wrk->y_accum <= 0);
+  assert(!wrk->y_expand);
+  for (x_out = 0; x_out < x_out_max; ++x_out) {
+    const uint32_t frac = (uint32_t)MULT_FIX_FLOOR(frow[x_out], yscale);
+    const int v = (int)MULT_FIX(irow[x_out] - frac, wrk->fxy_scale);
+    dst[x_out] = (v > WEBP_RESCALER_LINEAR_MAX) ? WEBP_RESCALER_LINEAR_MAX : v;
+    irow[x_out] = frac;   // new fractional start
+  }
+}
+
 #undef MULT_FIX_FLOOR
 #undef MULT_FIX
 #undef ROUNDER
 
+//------------------------------------------------------------------------------
+// Separable filters
+
+#define HSHIFT (WEBP_RESCALER_WFIX - WEBP_RESCALER_HFIX)
+#define VSHIFT (WEBP_RESCALER_WFIX + WEBP_RESCALER_HFIX)
+
+void WebPRescalerImportRowFilter_C(WebPRescaler* const wrk,
+                                   const uint8_t* src) {
+  const int x_stride = wrk->num_channels;
+  const int num_taps = wrk->x_taps;
+  int16_t* const dst = WebPRescalerFilterRow(wrk, wrk->src_y);
+  const int16_t* w = wrk->x_weights;
+  int x_out, channel, k;
+  assert(!WebPRescalerInputDone(wrk));
+  assert(wrk->filter != WEBP_RESCALER_AREA);
+  for (x_out = 0; x_out < wrk->dst_width; ++x_out, w += num_taps) {
+    const uint8_t* const s = src + wrk->x_start[x_out] * x_stride;
+    for (channel = 0; channel < x_stride; ++channel) {
+      int32_t sum = 0;
+      for (k = 0; k < num_taps; ++k) sum += s[k * x_stride + channel] * w[k];
+      dst[x_out * x_stride + channel] =
+          (int16_t)((sum + (1 << (HSHIFT - 1))) >> HSHIFT);
+    }
+  }
+}
+
+void WebPRescalerExportRowFilter_C(WebPRescaler* const wrk) {
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const int16_t* const w = wrk->y_weights + wrk->dst_y * wrk->y_taps;
+  uint8_t* const dst = wrk->dst;
+  int x_out, k;
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(wrk->filter != WEBP_RESCALER_AREA);
+  for (x_out = 0; x_out < x_out_max; ++x_out) {
+    int32_t sum = 0;
+    int v;
+    for (k = 0; k < wrk->y_taps; ++k) sum += wrk->y_rows[k][x_out] * w[k];
+    v = (sum + (1 << (VSHIFT - 1))) >> VSHIFT;
+    dst[x_out] = (v < 0) ? 0 : (v > 255) ? 255 : v;
+  }
+}
+
+#undef VSHIFT
+#undef HSHIFT
+
+//------------------------------------------------------------------------------
+// 2:1 box filter
+
+static void RescalerHalveRow_C(const uint8_t* src0, const uint8_t* src1,
+                               int src_width, uint8_t* dst) {
+  const int w = src_width >> 1;
+  int x;
+  for (x = 0; x < w; ++x) {
+    dst[x] = (src0[2 * x + 0] + src0[2 * x + 1] +
+              src1[2 * x + 0] + src1[2 * x + 1] + 2) >> 2;
+  }
+  if (src_width & 1) {
+    dst[x] = (src0[2 * x] + src1[2 * x] + 1) >> 1;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Linear light conversions (table look-ups)
+
+static void RowToLinear(WebPRescaler* const wrk, const uint8_t* const src) {
+  const int x_stride = wrk->num_channels;
+  const int x_max = wrk->src_width * wrk->num_channels;
+  uint16_t* const dst = wrk->linear_row;
+  int channel, x;
+  for (channel = 0; channel < x_stride; ++channel) {
+    const uint16_t* const tab = wrk->to_linear[channel];
+    for (x = channel; x < x_max; x += x_stride) dst[x] = tab[src[x]];
+  }
+}
+
+static void RowFromLinear(WebPRescaler* const wrk) {
+  const int x_stride = wrk->num_channels;
+  const int x_max = wrk->dst_width * wrk->num_channels;
+  const uint16_t* const src = wrk->linear_row;
+  uint8_t* const dst = wrk->dst;
+  int channel, x;
+  for (channel = 0; channel < x_stride; ++channel) {
+    const uint8_t* const tab = wrk->from_linear[channel];
+    for (x = channel; x < x_max; x += x_stride) dst[x] = tab[src[x]];
+  }
+}
+
 //------------------------------------------------------------------------------
 // Main entry calls
 
 void WebPRescalerImportRow(WebPRescaler* const wrk, const uint8_t* src) {
   assert(!WebPRescalerInputDone(wrk));
-  if (!wrk->x_expand) {
+  if (wrk->linear_row != NULL) {
+    RowToLinear(wrk, src);
+    WebPRescalerImportRowLinear(wrk, wrk->linear_row);
+  } else if (!wrk->x_expand) {
     WebPRescalerImportRowShrink(wrk, src);
   } else {
     WebPRescalerImportRowExpand(wrk, src);
@@ -169,7 +329,17 @@ void WebPRescalerImportRow(WebPRescaler* const wrk, const uint8_t* src) {
 void WebPRescalerExportRow(WebPRescaler* const wrk) {
   if (wrk->y_accum <= 0) {
     assert(!WebPRescalerOutputDone(wrk));
-    if (wrk->y_expand) {
+    if (wrk->filter != WEBP_RESCALER_AREA) {
+      int k;
+      for (k = 0; k < wrk->y_taps; ++k) {
+        wrk->y_rows[k] =
+            WebPRescalerFilterRow(wrk, wrk->y_start[wrk->dst_y] + k);
+      }
+      WebPRescalerExportRowFilter(wrk);
+    } else if (wrk->linear_row != NULL) {
+      WebPRescalerExportRowLinear(wrk);
+      RowFromLinear(wrk);
+    } else if (wrk->y_expand) {
       WebPRescalerExportRowExpand(wrk);
     } else if (wrk->fxy_scale) {
       WebPRescalerExportRowShrink(wrk);
@@ -182,9 +352,16 @@ void WebPRescalerExportRow(WebPRescaler* const wrk) {
         wrk->irow[i] = 0;
       }
     }
-    wrk->y_accum += wrk->y_add;
     wrk->dst += wrk->dst_stride;
     ++wrk->dst_y;
+    if (wrk->filter == WEBP_RESCALER_AREA) {
+      wrk->y_accum += wrk->y_add;
+    } else {
+      // Once all rows are emitted, the remaining input rows are just skipped.
+      wrk->y_accum = (wrk->dst_y < wrk->dst_height)
+                   ? wrk->y_end[wrk->dst_y] - wrk->src_y
+                   : wrk->src_height - wrk->src_y;
+    }
   }
 }
 
@@ -196,7 +373,18 @@ WebPRescalerImportRowFunc WebPRescalerImportRowShrink;
 WebPRescalerExportRowFunc WebPRescalerExportRowExpand;
 WebPRescalerExportRowFunc WebPRescalerExportRowShrink;
 
+WebPRescalerImportRowFunc WebPRescalerImportRowBox;
+
+WebPRescalerImportRowLinearFunc WebPRescalerImportRowLinear;
+WebPRescalerExportRowFunc WebPRescalerExportRowLinear;
+
+WebPRescalerImportRowFunc WebPRescalerImportRowFilter;
+WebPRescalerExportRowFunc WebPRescalerExportRowFilter;
+
+WebPRescalerHalveRowFunc WebPRescalerHalveRow;
+
 extern void WebPRescalerDspInitSSE2(void);
+extern void WebPRescalerDspInitAVX2(void);
 extern void WebPRescalerDspInitMIPS32(void);
 extern void WebPRescalerDspInitMIPSdspR2(void);
 extern void WebPRescalerDspInitMSA(void);
@@ -211,6 +399,12 @@ WEBP_DSP_INIT_FUNC(WebPRescalerDspInit) {
 
   WebPRescalerImportRowExpand = WebPRescalerImportRowExpand_C;
   WebPRescalerImportRowShrink = WebPRescalerImportRowShrink_C;
+  WebPRescalerImportRowBox = WebPRescalerImportRowBox_C;
+  WebPRescalerImportRowLinear = WebPRescalerImportRowLinear_C;
+  WebPRescalerExportRowLinear = WebPRescalerExportRowLinear_C;
+  WebPRescalerImportRowFilter = WebPRescalerImportRowFilter_C;
+  WebPRescalerExportRowFilter = WebPRescalerExportRowFilter_C;
+  WebPRescalerHalveRow = RescalerHalveRow_C;
 
   if (VP8GetCPUInfo != NULL) {
 #if defined(WEBP_USE_SSE2)
@@ -218,6 +412,11 @@ WEBP_DSP_INIT_FUNC(WebPRescalerDspInit) {
       WebPRescalerDspInitSSE2();
     }
 #endif
+#if defined(WEBP_USE_AVX2)
+    if (VP8GetCPUInfo(kAVX2)) {
+      WebPRescalerDspInitAVX2();
+    }
+#endif
 #if defined(WEBP_USE_MIPS32)
     if (VP8GetCPUInfo(kMIPS32)) {
       WebPRescalerDspInitMIPS32();
@@ -246,5 +445,11 @@ WEBP_DSP_INIT_FUNC(WebPRescalerDspInit) {
   assert(WebPRescalerExportRowShrink != NULL);
   assert(WebPRescalerImportRowExpand != NULL);
   assert(WebPRescalerImportRowShrink != NULL);
+  assert(WebPRescalerImportRowBox != NULL);
+  assert(WebPRescalerImportRowLinear != NULL);
+  assert(WebPRescalerExportRowLinear != NULL);
+  assert(WebPRescalerImportRowFilter != NULL);
+  assert(WebPRescalerExportRowFilter != NULL);
+  assert(WebPRescalerHalveRow != NULL);
 #endif   // WEBP_REDUCE_SIZE
 }
@@ -0,0 +1,196 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 Rescaling functions (separable-filter mode)
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_AVX2) && !defined(WEBP_REDUCE_SIZE)
+#include <immintrin.h>
+
+#include <assert.h>
+#include "src/utils/rescaler_utils.h"
+#include "src/utils/utils.h"
+
+WEBP_AVX2_BEGIN
+
+// Same arithmetic as WebPRescalerImportRowFilter_C() and
+// WebPRescalerExportRowFilter_C(), hence bit-exact with them.
+#define HSHIFT (WEBP_RESCALER_WFIX - WEBP_RESCALER_HFIX)
+#define VSHIFT (WEBP_RESCALER_WFIX + WEBP_RESCALER_HFIX)
+
+//------------------------------------------------------------------------------
+// Row import
+
+// Returns the four 32b sums of 'x_taps' weighted 8b samples, 4 outputs apart.
+static WEBP_INLINE __m128i FilterGray4_AVX2(const uint8_t* const src,
+                                            const int* const x_start,
+                                            const int16_t* const w,
+                                            int x_taps) {
+  __m128i sum[4];
+  int i, k;
+  for (i = 0; i < 4; ++i) {
+    const uint8_t* const s = src + x_start[i];
+    const int16_t* const wi = w + i * x_taps;
+    __m256i acc = _mm256_setzero_si256();
+    __m128i acc128;
+    for (k = 0; k + 16 <= x_taps; k += 16) {
+      const __m128i A = _mm_loadu_si128((const __m128i*)(s + k));
+      const __m256i B = _mm256_cvtepu8_epi16(A);
+      const __m256i W = _mm256_loadu_si256((const __m256i*)(wi + k));
+      acc = _mm256_add_epi32(acc, _mm256_madd_epi16(B, W));
+    }
+    acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                           _mm256_extracti128_si256(acc, 1));
+    if (k < x_taps) {   // 'x_taps' is a multiple of 8
+      const __m128i A = _mm_loadl_epi64((const __m128i*)(s + k));
+      const __m128i B = _mm_cvtepu8_epi16(A);
+      const __m128i W = _mm_loadu_si128((const __m128i*)(wi + k));
+      acc128 = _mm_add_epi32(acc128, _mm_madd_epi16(B, W));
+    }
+    sum[i] = acc128;
+  }
+  {
+    // transpose-and-add the four partial sums
+    const __m128i A0 = _mm_unpacklo_epi32(sum[0], sum[1]);
+    const __m128i A1 = _mm_unpackhi_epi32(sum[0], sum[1]);
+    const __m128i A2 = _mm_unpacklo_epi32(sum[2], sum[3]);
+    const __m128i A3 = _mm_unpackhi_epi32(sum[2], sum[3]);
+    const __m128i B0 = _mm_add_epi32(A0, A1);
+    const __m128i B1 = _mm_add_epi32(A2, A3);
+    return _mm_add_epi32(_mm_unpacklo_epi64(B0, B1),
+                         _mm_unpackhi_epi64(B0, B1));
+  }
+}
+
+// Returns the 32b sums of the four channels of 'x_taps' weighted pixels.
+// Each iteration handles 4 taps: pixels 0,1 in the low lane, 2,3 in the high.
+static WEBP_INLINE __m128i FilterRGBA_AVX2(const uint8_t* const src,
+                                           const int16_t* const w,
+                                           int x_taps) {
+  // interleave the channels of the two pixels: r0 r1 g0 g1 b0 b1 a0 a1
+  const __m256i shuffle =
+      _mm256_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+                       0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+  const __m256i pairs = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+  __m256i sum = _mm256_setzero_si256();
+  int k;
+  for (k = 0; k < x_taps; k += 4) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)(src + 4 * k));
+    const __m128i W = _mm_loadl_epi64((const __m128i*)(w + k));
+    const __m256i B = _mm256_shuffle_epi8(_mm256_cvtepu8_epi16(A), shuffle);
+    const __m256i W2 =
+        _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(W), pairs);
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(B, W2));
+  }
+  return _mm_add_epi32(_mm256_castsi256_si128(sum),
+                       _mm256_extracti128_si256(sum, 1));
+}
+
+static void RescalerImportRowFilter_AVX2(WebPRescaler* const wrk,
+                                         const uint8_t* src) {
+  const int x_taps = wrk->x_taps;
+  const __m128i round = _mm_set1_epi32(1 << (HSHIFT - 1));
+  int16_t* const dst = WebPRescalerFilterRow(wrk, wrk->src_y);
+  int x_out = 0;
+  assert(!WebPRescalerInputDone(wrk));
+  if (wrk->num_channels == 4) {
+    for (; x_out < wrk->dst_width; ++x_out) {
+      const __m128i A = FilterRGBA_AVX2(src + 4 * wrk->x_start[x_out],
+                                        wrk->x_weights + x_out * x_taps,
+                                        x_taps);
+      const __m128i B = _mm_srai_epi32(_mm_add_epi32(A, round), HSHIFT);
+      _mm_storel_epi64((__m128i*)(dst + 4 * x_out), _mm_packs_epi32(B, B));
+    }
+  } else if (wrk->num_channels == 1) {
+    for (; x_out + 4 <= wrk->dst_width; x_out += 4) {
+      const __m128i A = FilterGray4_AVX2(src, wrk->x_start + x_out,
+                                         wrk->x_weights + x_out * x_taps,
+                                         x_taps);
+      const __m128i B = _mm_srai_epi32(_mm_add_epi32(A, round), HSHIFT);
+      _mm_storel_epi64((__m128i*)(dst + x_out), _mm_packs_epi32(B, B));
+    }
+    for (; x_out < wrk->dst_width; ++x_out) {   // left-overs
+      const uint8_t* const s = src + wrk->x_start[x_out];
+      const int16_t* const w = wrk->x_weights + x_out * x_taps;
+      int32_t sum = 0;
+      int k;
+      for (k = 0; k < x_taps; ++k) sum += s[k] * w[k];
+      dst[x_out] = (int16_t)((sum + (1 << (HSHIFT - 1))) >> HSHIFT);
+    }
+  } else {
+    WebPRescalerImportRowFilter_C(wrk, src);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Row export
+
+static void RescalerExportRowFilter_AVX2(WebPRescaler* const wrk) {
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const int y_taps = wrk->y_taps;
+  const int16_t* const w = wrk->y_weights + wrk->dst_y * y_taps;
+  const int16_t* const* const rows = wrk->y_rows;
+  const __m256i round = _mm256_set1_epi32(1 << (VSHIFT - 1));
+  uint8_t* const dst = wrk->dst;
+  int x_out, k;
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(!(y_taps & 1));
+  for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+    // 'lo' holds the samples 0-3 and 8-11, 'hi' the samples 4-7 and 12-15.
+    __m256i lo = round, hi = round;
+    for (k = 0; k < y_taps; k += 2) {
+      const __m256i W =
+          _mm256_set1_epi32((int)WebPMemToUint32((const uint8_t*)(w + k)));
+      const __m256i A0 =
+          _mm256_loadu_si256((const __m256i*)(rows[k + 0] + x_out));
+      const __m256i A1 =
+          _mm256_loadu_si256((const __m256i*)(rows[k + 1] + x_out));
+      lo = _mm256_add_epi32(lo,
+                            _mm256_madd_epi16(_mm256_unpacklo_epi16(A0, A1), W));
+      hi = _mm256_add_epi32(hi,
+                            _mm256_madd_epi16(_mm256_unpackhi_epi16(A0, A1), W));
+    }
+    {
+      // the in-lane packing restores the order: samples 0-7, then 8-15
+      const __m256i B = _mm256_packs_epi32(_mm256_srai_epi32(lo, VSHIFT),
+                                           _mm256_srai_epi32(hi, VSHIFT));
+      const __m128i C = _mm_packus_epi16(_mm256_castsi256_si128(B),
+                                         _mm256_extracti128_si256(B, 1));
+      _mm_storeu_si128((__m128i*)(dst + x_out), C);
+    }
+  }
+  for (; x_out < x_out_max; ++x_out) {   // left-overs
+    int32_t sum = 0;
+    int v;
+    for (k = 0; k < y_taps; ++k) sum += rows[k][x_out] * w[k];
+    v = (sum + (1 << (VSHIFT - 1))) >> VSHIFT;
+    dst[x_out] = (v < 0) ? 0 : (v > 255) ? 255 : v;
+  }
+}
+
+#undef VSHIFT
+#undef HSHIFT
+
+//------------------------------------------------------------------------------
+
+extern void WebPRescalerDspInitAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPRescalerDspInitAVX2(void) {
+  WebPRescalerImportRowFilter = RescalerImportRowFilter_AVX2;
+  WebPRescalerExportRowFilter = RescalerExportRowFilter_AVX2;
+}
+
+WEBP_AVX2_END
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(WebPRescalerDspInitAVX2)
+
+#endif  // WEBP_USE_AVX2
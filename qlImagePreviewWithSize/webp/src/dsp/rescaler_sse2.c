@@ -164,6 +164,228 @@ static void RescalerImportRowShrink_SSE2(WebPRescaler* const wrk,
   assert(accum == 0);
 }
 
+//------------------------------------------------------------------------------
+// Linear light
+
+// Returns the low and high 32b of the products of the four 32b lanes of 'A'
+// by the 32b value in the even lanes of 'mult'.
+static WEBP_INLINE void Mult32_SSE2(const __m128i A, const __m128i mult,
+                                    __m128i* const lo, __m128i* const hi) {
+  const __m128i B0 = _mm_mul_epu32(A, mult);                     // lanes 0, 2
+  const __m128i B1 = _mm_mul_epu32(_mm_srli_epi64(A, 32), mult); // lanes 1, 3
+  if (lo != NULL) {
+    *lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(B0, _MM_SHUFFLE(0, 0, 2, 0)),
+                             _mm_shuffle_epi32(B1, _MM_SHUFFLE(0, 0, 2, 0)));
+  }
+  if (hi != NULL) {
+    *hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(B0, _MM_SHUFFLE(0, 0, 3, 1)),
+                             _mm_shuffle_epi32(B1, _MM_SHUFFLE(0, 0, 3, 1)));
+  }
+}
+
+// MULT_FIX() on the four 32b lanes of 'A'.
+static WEBP_INLINE __m128i MultFix_SSE2(const __m128i A, const __m128i mult) {
+  const __m128i rounder = _mm_set_epi32(0, ROUNDER, 0, ROUNDER);
+  const __m128i B0 = _mm_add_epi64(_mm_mul_epu32(A, mult), rounder);
+  const __m128i B1 =
+      _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(A, 32), mult), rounder);
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(B0, _MM_SHUFFLE(0, 0, 3, 1)),
+                            _mm_shuffle_epi32(B1, _MM_SHUFFLE(0, 0, 3, 1)));
+}
+
+static void RescalerImportRowLinear_SSE2(WebPRescaler* const wrk,
+                                         const uint16_t* src) {
+  const int x_sub = wrk->x_sub;
+  int accum = 0;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mult_x = _mm_set_epi32(0, x_sub, 0, x_sub);
+  const __m128i mult_fx = _mm_set_epi32(0, wrk->fx_scale, 0, wrk->fx_scale);
+  __m128i sum = zero;
+  rescaler_t* frow = wrk->frow;
+  const rescaler_t* const frow_end = wrk->frow + 4 * wrk->dst_width;
+
+  if (wrk->num_channels != 4) {
+    WebPRescalerImportRowLinear_C(wrk, src);
+    return;
+  }
+  assert(!WebPRescalerInputDone(wrk));
+  assert(!wrk->x_expand);
+
+  for (; frow < frow_end; frow += 4) {
+    __m128i base = zero;
+    accum += wrk->x_add;
+    while (accum > 0) {
+      base = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)src), zero);
+      src += 4;
+      sum = _mm_add_epi32(sum, base);
+      accum -= x_sub;
+    }
+    {    // Emit next horizontal pixel.
+      const __m128i mult = _mm_set_epi32(0, -accum, 0, -accum);
+      __m128i frac, A;
+      Mult32_SSE2(base, mult, &frac, NULL);                // base * -accum
+      Mult32_SSE2(sum, mult_x, &A, NULL);                  // sum * x_sub
+      _mm_storeu_si128((__m128i*)frow, _mm_sub_epi32(A, frac));
+      sum = MultFix_SSE2(frac, mult_fx);
+    }
+  }
+  assert(accum == 0);
+}
+
+static void RescalerExportRowLinear_SSE2(WebPRescaler* const wrk) {
+  int x_out;
+  uint16_t* const dst = wrk->linear_row;
+  rescaler_t* const irow = wrk->irow;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const rescaler_t* const frow = wrk->frow;
+  const uint32_t yscale = wrk->fy_scale * (-wrk->y_accum);
+  const __m128i mult_y = _mm_set_epi32(0, yscale, 0, yscale);
+  const __m128i mult_xy = _mm_set_epi32(0, wrk->fxy_scale, 0, wrk->fxy_scale);
+  const __m128i max = _mm_set1_epi16(WEBP_RESCALER_LINEAR_MAX);
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(wrk->y_accum <= 0);
+  assert(!wrk->y_expand);
+  for (x_out = 0; x_out + 8 <= x_out_max; x_out += 8) {
+    const __m128i A0 = _mm_loadu_si128((const __m128i*)(frow + x_out + 0));
+    const __m128i A1 = _mm_loadu_si128((const __m128i*)(frow + x_out + 4));
+    const __m128i B0 = _mm_loadu_si128((const __m128i*)(irow + x_out + 0));
+    const __m128i B1 = _mm_loadu_si128((const __m128i*)(irow + x_out + 4));
+    __m128i frac0, frac1;
+    Mult32_SSE2(A0, mult_y, NULL, &frac0);   // MULT_FIX_FLOOR(frow, yscale)
+    Mult32_SSE2(A1, mult_y, NULL, &frac1);
+    {
+      const __m128i C0 = MultFix_SSE2(_mm_sub_epi32(B0, frac0), mult_xy);
+      const __m128i C1 = MultFix_SSE2(_mm_sub_epi32(B1, frac1), mult_xy);
+      const __m128i D = _mm_min_epi16(_mm_packs_epi32(C0, C1), max);
+      _mm_storeu_si128((__m128i*)(dst + x_out), D);
+      _mm_storeu_si128((__m128i*)(irow + x_out + 0), frac0);
+      _mm_storeu_si128((__m128i*)(irow + x_out + 4), frac1);
+    }
+  }
+  for (; x_out < x_out_max; ++x_out) {
+    const uint32_t frac = (uint32_t)MULT_FIX_FLOOR(frow[x_out], yscale);
+    const int v = (int)MULT_FIX(irow[x_out] - frac, wrk->fxy_scale);
+    dst[x_out] = (v > WEBP_RESCALER_LINEAR_MAX) ? WEBP_RESCALER_LINEAR_MAX : v;
+    irow[x_out] = frac;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Integer-ratio shrink
+
+// Returns the sums of the pairs of consecutive bytes of 'A', as 16b.
+static WEBP_INLINE __m128i SumBytePairs_SSE2(const __m128i A) {
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+  return _mm_add_epi16(_mm_and_si128(A, mask), _mm_srli_epi16(A, 8));
+}
+
+// Adds the four 32b values of 'A' to irow[0..3].
+static WEBP_INLINE void AddToIRow_SSE2(rescaler_t* const irow,
+                                       const __m128i A) {
+  const __m128i B = _mm_loadu_si128((const __m128i*)irow);
+  _mm_storeu_si128((__m128i*)irow, _mm_add_epi32(A, B));
+}
+
+// Returns the sums of the four channels of 'x_box' consecutive RGBA pixels.
+// Lanes accumulate at most 'x_box' samples: no 16b overflow if x_box < 257.
+static WEBP_INLINE __m128i SumRGBA_SSE2(const uint8_t* const src, int x_box) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;   // channels of the even pixels, then of the odd ones
+  int k = 0;
+  for (; k + 4 <= x_box; k += 4) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)(src + 4 * k));
+    sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(A, zero));
+    sum = _mm_add_epi16(sum, _mm_unpackhi_epi8(A, zero));
+  }
+  if (k + 2 <= x_box) {
+    const __m128i A = _mm_loadl_epi64((const __m128i*)(src + 4 * k));
+    sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(A, zero));
+    k += 2;
+  }
+  if (k < x_box) {
+    const __m128i A = _mm_cvtsi32_si128((int)WebPMemToUint32(src + 4 * k));
+    sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(A, zero));
+  }
+  sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+  return _mm_unpacklo_epi16(sum, zero);
+}
+
+// Returns the sum of 'x_box' consecutive bytes.
+static WEBP_INLINE uint32_t SumGray_SSE2(const uint8_t* const src, int x_box) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;
+  uint32_t v;
+  int k = 0;
+  for (; k + 16 <= x_box; k += 16) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)(src + k));
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(A, zero));
+  }
+  if (k + 8 <= x_box) {
+    const __m128i A = _mm_loadl_epi64((const __m128i*)(src + k));
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(A, zero));
+    k += 8;
+  }
+  v = (uint32_t)(_mm_cvtsi128_si32(sum) +
+                 _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+  for (; k < x_box; ++k) v += src[k];
+  return v;
+}
+
+static void RescalerImportRowBox_SSE2(WebPRescaler* const wrk,
+                                      const uint8_t* src) {
+  const int x_box = wrk->x_box;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  rescaler_t* const irow = wrk->irow;
+  const __m128i zero = _mm_setzero_si128();
+  int x_out = 0;
+  assert(!WebPRescalerInputDone(wrk));
+  assert(x_box > 0);
+  if (wrk->num_channels == 1) {
+    if (x_box == 2) {
+      for (; x_out + 8 <= x_out_max; x_out += 8) {
+        const __m128i A = _mm_loadu_si128((const __m128i*)(src + 2 * x_out));
+        const __m128i B = SumBytePairs_SSE2(A);
+        AddToIRow_SSE2(irow + x_out + 0, _mm_unpacklo_epi16(B, zero));
+        AddToIRow_SSE2(irow + x_out + 4, _mm_unpackhi_epi16(B, zero));
+      }
+    } else if (x_box == 4) {
+      const __m128i one = _mm_set1_epi16(1);
+      for (; x_out + 4 <= x_out_max; x_out += 4) {
+        const __m128i A = _mm_loadu_si128((const __m128i*)(src + 4 * x_out));
+        AddToIRow_SSE2(irow + x_out,
+                       _mm_madd_epi16(SumBytePairs_SSE2(A), one));
+      }
+    } else if (x_box == 8) {
+      for (; x_out + 2 <= x_out_max; x_out += 2) {
+        const __m128i A = _mm_loadu_si128((const __m128i*)(src + 8 * x_out));
+        const __m128i B = _mm_sad_epu8(A, zero);
+        irow[x_out + 0] += (uint32_t)_mm_cvtsi128_si32(B);
+        irow[x_out + 1] += (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(B, 8));
+      }
+    }
+    for (; x_out < x_out_max; ++x_out) {   // left-overs and other ratios
+      irow[x_out] += SumGray_SSE2(src + x_out * x_box, x_box);
+    }
+  } else if (wrk->num_channels == 4 && x_box < 257) {
+    if (x_box == 2) {
+      for (; x_out + 8 <= x_out_max; x_out += 8) {
+        const __m128i A = _mm_loadu_si128((const __m128i*)(src + 2 * x_out));
+        const __m128i lo = _mm_unpacklo_epi8(A, zero);   // pixels 0, 1
+        const __m128i hi = _mm_unpackhi_epi8(A, zero);   // pixels 2, 3
+        const __m128i B = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi),
+                                        _mm_unpackhi_epi64(lo, hi));
+        AddToIRow_SSE2(irow + x_out + 0, _mm_unpacklo_epi16(B, zero));
+        AddToIRow_SSE2(irow + x_out + 4, _mm_unpackhi_epi16(B, zero));
+      }
+    }
+    for (; x_out < x_out_max; x_out += 4) {
+      AddToIRow_SSE2(irow + x_out, SumRGBA_SSE2(src + x_out * x_box, x_box));
+    }
+  } else {
+    WebPRescalerImportRowBox_C(wrk, src);
+  }
+}
+
 //------------------------------------------------------------------------------
 // Row export
 
@@ -348,6 +570,183 @@ static void RescalerExportRowShrink_SSE2(WebPRescaler* const wrk) {
 #undef MULT_FIX
 #undef ROUNDER
 
+//------------------------------------------------------------------------------
+// Separable filters
+
+#define HSHIFT (WEBP_RESCALER_WFIX - WEBP_RESCALER_HFIX)
+#define VSHIFT (WEBP_RESCALER_WFIX + WEBP_RESCALER_HFIX)
+
+// Loads the weights w[0] and w[1] in each 32b word, for _mm_madd_epi16().
+static WEBP_INLINE __m128i LoadWeightPair_SSE2(const int16_t* const w) {
+  return _mm_set1_epi32((int)WebPMemToUint32((const uint8_t*)w));
+}
+
+// Returns the four 32b sums of 'x_taps' weighted 8b samples, 4 outputs apart.
+static WEBP_INLINE __m128i FilterGray4_SSE2(const uint8_t* const src,
+                                            const int* const x_start,
+                                            const int16_t* const w,
+                                            int x_taps) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum[4];
+  int i, k;
+  for (i = 0; i < 4; ++i) {
+    const uint8_t* const s = src + x_start[i];
+    const int16_t* const wi = w + i * x_taps;
+    sum[i] = zero;
+    for (k = 0; k < x_taps; k += 8) {
+      const __m128i A = _mm_loadl_epi64((const __m128i*)(s + k));
+      const __m128i B = _mm_unpacklo_epi8(A, zero);
+      const __m128i W = _mm_loadu_si128((const __m128i*)(wi + k));
+      sum[i] = _mm_add_epi32(sum[i], _mm_madd_epi16(B, W));
+    }
+  }
+  {
+    // transpose-and-add the four partial sums
+    const __m128i A0 = _mm_unpacklo_epi32(sum[0], sum[1]);
+    const __m128i A1 = _mm_unpackhi_epi32(sum[0], sum[1]);
+    const __m128i A2 = _mm_unpacklo_epi32(sum[2], sum[3]);
+    const __m128i A3 = _mm_unpackhi_epi32(sum[2], sum[3]);
+    const __m128i B0 = _mm_add_epi32(A0, A1);
+    const __m128i B1 = _mm_add_epi32(A2, A3);
+    return _mm_add_epi32(_mm_unpacklo_epi64(B0, B1),
+                         _mm_unpackhi_epi64(B0, B1));
+  }
+}
+
+// Returns the 32b sums of the four channels of 'x_taps' weighted pixels.
+static WEBP_INLINE __m128i FilterRGBA_SSE2(const uint8_t* const src,
+                                           const int16_t* const w,
+                                           int x_taps) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;
+  int k;
+  for (k = 0; k < x_taps; k += 4) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)(src + 4 * k));
+    const __m128i W = _mm_loadl_epi64((const __m128i*)(w + k));
+    const __m128i W01 = _mm_shuffle_epi32(W, _MM_SHUFFLE(0, 0, 0, 0));
+    const __m128i W23 = _mm_shuffle_epi32(W, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m128i P01 = _mm_unpacklo_epi8(A, zero);   // pixels 0 and 1
+    const __m128i P23 = _mm_unpackhi_epi8(A, zero);   // pixels 2 and 3
+    // interleave the channels of the two pixels: r0 r1 g0 g1 b0 b1 a0 a1
+    const __m128i B01 = _mm_unpacklo_epi16(P01, _mm_srli_si128(P01, 8));
+    const __m128i B23 = _mm_unpacklo_epi16(P23, _mm_srli_si128(P23, 8));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(B01, W01));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(B23, W23));
+  }
+  return sum;
+}
+
+static void RescalerImportRowFilter_SSE2(WebPRescaler* const wrk,
+                                         const uint8_t* src) {
+  const int x_taps = wrk->x_taps;
+  const __m128i round = _mm_set1_epi32(1 << (HSHIFT - 1));
+  int16_t* const dst = WebPRescalerFilterRow(wrk, wrk->src_y);
+  int x_out = 0;
+  assert(!WebPRescalerInputDone(wrk));
+  if (wrk->num_channels == 4) {
+    for (; x_out < wrk->dst_width; ++x_out) {
+      const __m128i A = FilterRGBA_SSE2(src + 4 * wrk->x_start[x_out],
+                                        wrk->x_weights + x_out * x_taps,
+                                        x_taps);
+      const __m128i B = _mm_srai_epi32(_mm_add_epi32(A, round), HSHIFT);
+      _mm_storel_epi64((__m128i*)(dst + 4 * x_out), _mm_packs_epi32(B, B));
+    }
+  } else if (wrk->num_channels == 1) {
+    for (; x_out + 4 <= wrk->dst_width; x_out += 4) {
+      const __m128i A = FilterGray4_SSE2(src, wrk->x_start + x_out,
+                                         wrk->x_weights + x_out * x_taps,
+                                         x_taps);
+      const __m128i B = _mm_srai_epi32(_mm_add_epi32(A, round), HSHIFT);
+      _mm_storel_epi64((__m128i*)(dst + x_out), _mm_packs_epi32(B, B));
+    }
+    for (; x_out < wrk->dst_width; ++x_out) {   // left-overs
+      const uint8_t* const s = src + wrk->x_start[x_out];
+      const int16_t* const w = wrk->x_weights + x_out * x_taps;
+      int32_t sum = 0;
+      int k;
+      for (k = 0; k < x_taps; ++k) sum += s[k] * w[k];
+      dst[x_out] = (int16_t)((sum + (1 << (HSHIFT - 1))) >> HSHIFT);
+    }
+  } else {
+    WebPRescalerImportRowFilter_C(wrk, src);
+  }
+}
+
+static void RescalerExportRowFilter_SSE2(WebPRescaler* const wrk) {
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const int y_taps = wrk->y_taps;
+  const int16_t* const w = wrk->y_weights + wrk->dst_y * y_taps;
+  const int16_t* const* const rows = wrk->y_rows;
+  const __m128i round = _mm_set1_epi32(1 << (VSHIFT - 1));
+  uint8_t* const dst = wrk->dst;
+  int x_out, k;
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(!(y_taps & 1));
+  for (x_out = 0; x_out + 8 <= x_out_max; x_out += 8) {
+    __m128i lo = round, hi = round;
+    for (k = 0; k < y_taps; k += 2) {
+      const __m128i W = LoadWeightPair_SSE2(w + k);
+      const __m128i A0 = _mm_loadu_si128((const __m128i*)(rows[k + 0] + x_out));
+      const __m128i A1 = _mm_loadu_si128((const __m128i*)(rows[k + 1] + x_out));
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(A0, A1), W));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(A0, A1), W));
+    }
+    {
+      const __m128i B = _mm_packs_epi32(_mm_srai_epi32(lo, VSHIFT),
+                                        _mm_srai_epi32(hi, VSHIFT));
+      _mm_storel_epi64((__m128i*)(dst + x_out), _mm_packus_epi16(B, B));
+    }
+  }
+  for (; x_out < x_out_max; ++x_out) {   // left-overs
+    int32_t sum = 0;
+    int v;
+    for (k = 0; k < y_taps; ++k) sum += rows[k][x_out] * w[k];
+    v = (sum + (1 << (VSHIFT - 1))) >> VSHIFT;
+    dst[x_out] = (v < 0) ? 0 : (v > 255) ? 255 : v;
+  }
+}
+
+#undef VSHIFT
+#undef HSHIFT
+
+//------------------------------------------------------------------------------
+// 2:1 box filter
+
+static void RescalerHalveRow_SSE2(const uint8_t* src0, const uint8_t* src1,
+                                  int src_width, uint8_t* dst) {
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+  const __m128i two = _mm_set1_epi16(2);
+  const int w = src_width >> 1;
+  int x;
+  for (x = 0; x + 16 <= w; x += 16) {
+    const __m128i A0 = _mm_loadu_si128((const __m128i*)(src0 + 2 * x +  0));
+    const __m128i A1 = _mm_loadu_si128((const __m128i*)(src0 + 2 * x + 16));
+    const __m128i B0 = _mm_loadu_si128((const __m128i*)(src1 + 2 * x +  0));
+    const __m128i B1 = _mm_loadu_si128((const __m128i*)(src1 + 2 * x + 16));
+    // sum the two rows as 16b words, even and odd columns apart
+    const __m128i E0 = _mm_add_epi16(_mm_and_si128(A0, mask),
+                                     _mm_and_si128(B0, mask));
+    const __m128i E1 = _mm_add_epi16(_mm_and_si128(A1, mask),
+                                     _mm_and_si128(B1, mask));
+    const __m128i O0 = _mm_add_epi16(_mm_srli_epi16(A0, 8),
+                                     _mm_srli_epi16(B0, 8));
+    const __m128i O1 = _mm_add_epi16(_mm_srli_epi16(A1, 8),
+                                     _mm_srli_epi16(B1, 8));
+    const __m128i S0 = _mm_add_epi16(_mm_add_epi16(E0, O0), two);
+    const __m128i S1 = _mm_add_epi16(_mm_add_epi16(E1, O1), two);
+    const __m128i D0 = _mm_srli_epi16(S0, 2);
+    const __m128i D1 = _mm_srli_epi16(S1, 2);
+    _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(D0, D1));
+  }
+  for (; x < w; ++x) {   // left-overs
+    dst[x] = (src0[2 * x + 0] + src0[2 * x + 1] +
+              src1[2 * x + 0] + src1[2 * x + 1] + 2) >> 2;
+  }
+  if (src_width & 1) {
+    dst[x] = (src0[2 * x] + src1[2 * x] + 1) >> 1;
+  }
+}
+
 //------------------------------------------------------------------------------
 
 extern void WebPRescalerDspInitSSE2(void);
@@ -355,8 +754,14 @@ extern void WebPRescalerDspInitSSE2(void);
 WEBP_TSAN_IGNORE_FUNCTION void WebPRescalerDspInitSSE2(void) {
   WebPRescalerImportRowExpand = RescalerImportRowExpand_SSE2;
   WebPRescalerImportRowShrink = RescalerImportRowShrink_SSE2;
+  WebPRescalerImportRowBox = RescalerImportRowBox_SSE2;
+  WebPRescalerImportRowLinear = RescalerImportRowLinear_SSE2;
+  WebPRescalerExportRowLinear = RescalerExportRowLinear_SSE2;
   WebPRescalerExportRowExpand = RescalerExportRowExpand_SSE2;
   WebPRescalerExportRowShrink = RescalerExportRowShrink_SSE2;
+  WebPRescalerImportRowFilter = RescalerImportRowFilter_SSE2;
+  WebPRescalerExportRowFilter = RescalerExportRowFilter_SSE2;
+  WebPRescalerHalveRow = RescalerHalveRow_SSE2;
 }
 
 #else  // !WEBP_USE_SSE2
@@ -127,8 +127,78 @@ static void EmptyUpsampleFunc(const uint8_t* top_y, const uint8_t* bottom_y,
 
 #endif
 
+// Same as UPSAMPLE_FUNC, for the premultiplied modes.
+#define UPSAMPLE_ALPHA_FUNC(FUNC_NAME, FUNC)                                   \
+static void FUNC_NAME(const uint8_t* top_y, const uint8_t* bottom_y,           \
+                      const uint8_t* top_u, const uint8_t* top_v,              \
+                      const uint8_t* cur_u, const uint8_t* cur_v,              \
+                      const uint8_t* top_a, const uint8_t* bottom_a,           \
+                      uint8_t* top_dst, uint8_t* bottom_dst, int len) {        \
+  int x;                                                                       \
+  const int last_pixel_pair = (len - 1) >> 1;                                  \
+  uint32_t tl_uv = LOAD_UV(top_u[0], top_v[0]);   /* top-left sample */        \
+  uint32_t l_uv  = LOAD_UV(cur_u[0], cur_v[0]);   /* left-sample */            \
+  assert(top_y != NULL && top_a != NULL);                                      \
+  assert(bottom_y == NULL || bottom_a != NULL);                                \
+  {                                                                            \
+    const uint32_t uv0 = (3 * tl_uv + l_uv + 0x00020002u) >> 2;                \
+    FUNC(top_y[0], uv0 & 0xff, (uv0 >> 16), top_a[0], top_dst);               \
+  }                                                                            \
+  if (bottom_y != NULL) {                                                      \
+    const uint32_t uv0 = (3 * l_uv + tl_uv + 0x00020002u) >> 2;                \
+    FUNC(bottom_y[0], uv0 & 0xff, (uv0 >> 16), bottom_a[0], bottom_dst);      \
+  }                                                                            \
+  for (x = 1; x <= last_pixel_pair; ++x) {                                     \
+    const uint32_t t_uv = LOAD_UV(top_u[x], top_v[x]);  /* top sample */       \
+    const uint32_t uv   = LOAD_UV(cur_u[x], cur_v[x]);  /* sample */           \
+    /* precompute invariant values associated with first and second diagonals*/\
+    const uint32_t avg = tl_uv + t_uv + l_uv + uv + 0x00080008u;               \
+    const uint32_t diag_12 = (avg + 2 * (t_uv + l_uv)) >> 3;                   \
+    const uint32_t diag_03 = (avg + 2 * (tl_uv + uv)) >> 3;                    \
+    {                                                                          \
+      const uint32_t uv0 = (diag_12 + tl_uv) >> 1;                             \
+      const uint32_t uv1 = (diag_03 + t_uv) >> 1;                              \
+      FUNC(top_y[2 * x - 1], uv0 & 0xff, (uv0 >> 16), top_a[2 * x - 1],       \
+           top_dst + (2 * x - 1) * 4);                                         \
+      FUNC(top_y[2 * x - 0], uv1 & 0xff, (uv1 >> 16), top_a[2 * x - 0],       \
+           top_dst + (2 * x - 0) * 4);                                         \
+    }                                                                          \
+    if (bottom_y != NULL) {                                                    \
+      const uint32_t uv0 = (diag_03 + l_uv) >> 1;                              \
+      const uint32_t uv1 = (diag_12 + uv) >> 1;                                \
+      FUNC(bottom_y[2 * x - 1], uv0 & 0xff, (uv0 >> 16), bottom_a[2 * x - 1],  \
+           bottom_dst + (2 * x - 1) * 4);                                      \
+      FUNC(bottom_y[2 * x + 0], uv1 & 0xff, (uv1 >> 16), bottom_a[2 * x + 0],  \
+           bottom_dst + (2 * x + 0) * 4);                                      \
+    }                                                                          \
+    tl_uv = t_uv;                                                              \
+    l_uv = uv;                                                                 \
+  }                                                                            \
+  if (!(len & 1)) {                                                            \
+    {                                                                          \
+      const uint32_t uv0 = (3 * tl_uv + l_uv + 0x00020002u) >> 2;              \
+      FUNC(top_y[len - 1], uv0 & 0xff, (uv0 >> 16), top_a[len - 1],           \
+           top_dst + (len - 1) * 4);                                           \
+    }                                                                          \
+    if (bottom_y != NULL) {                                                    \
+      const uint32_t uv0 = (3 * l_uv + tl_uv + 0x00020002u) >> 2;              \
+      FUNC(bottom_y[len - 1], uv0 & 0xff, (uv0 >> 16), bottom_a[len - 1],     \
+           bottom_dst + (len - 1) * 4);                                        \
+    }                                                                          \
+  }                                                                            \
+}
+
+WebPUpsampleAlphaLinePairFunc WebPPremultipliedUpsamplers[MODE_LAST];
+
+#if !WEBP_NEON_OMIT_C_CODE
+UPSAMPLE_ALPHA_FUNC(UpsampleRgbaPremulLinePair_C, VP8YuvToRgbaPremul)
+UPSAMPLE_ALPHA_FUNC(UpsampleBgraPremulLinePair_C, VP8YuvToBgraPremul)
+UPSAMPLE_ALPHA_FUNC(UpsampleArgbPremulLinePair_C, VP8YuvToArgbPremul)
+#endif
+
 #undef LOAD_UV
 #undef UPSAMPLE_FUNC
+#undef UPSAMPLE_ALPHA_FUNC
 
 #endif  // FANCY_UPSAMPLING
 
@@ -218,6 +288,7 @@ WebPYUV444Converter WebPYUV444Converters[MODE_LAST];
 extern void WebPInitYUV444ConvertersMIPSdspR2(void);
 extern void WebPInitYUV444ConvertersSSE2(void);
 extern void WebPInitYUV444ConvertersSSE41(void);
+extern void WebPInitYUV444ConvertersAVX2(void);
 
 WEBP_DSP_INIT_FUNC(WebPInitYUV444Converters) {
   WebPYUV444Converters[MODE_RGBA]      = WebPYuv444ToRgba_C;
@@ -243,6 +314,11 @@ WEBP_DSP_INIT_FUNC(WebPInitYUV444Converters) {
       WebPInitYUV444ConvertersSSE41();
     }
 #endif
+#if defined(WEBP_USE_AVX2)
+    if (VP8GetCPUInfo(kAVX2)) {
+      WebPInitYUV444ConvertersAVX2();
+    }
+#endif
 #if defined(WEBP_USE_MIPS_DSP_R2)
     if (VP8GetCPUInfo(kMIPSdspR2)) {
       WebPInitYUV444ConvertersMIPSdspR2();
@@ -256,6 +332,7 @@ WEBP_DSP_INIT_FUNC(WebPInitYUV444Converters) {
 
 extern void WebPInitUpsamplersSSE2(void);
 extern void WebPInitUpsamplersSSE41(void);
+extern void WebPInitUpsamplersAVX2(void);
 extern void WebPInitUpsamplersNEON(void);
 extern void WebPInitUpsamplersMIPSdspR2(void);
 extern void WebPInitUpsamplersMSA(void);
@@ -274,6 +351,9 @@ WEBP_DSP_INIT_FUNC(WebPInitUpsamplers) {
   WebPUpsamplers[MODE_RGB_565]   = UpsampleRgb565LinePair_C;
   WebPUpsamplers[MODE_Argb]      = UpsampleArgbLinePair_C;
   WebPUpsamplers[MODE_rgbA_4444] = UpsampleRgba4444LinePair_C;
+  WebPPremultipliedUpsamplers[MODE_rgbA] = UpsampleRgbaPremulLinePair_C;
+  WebPPremultipliedUpsamplers[MODE_bgrA] = UpsampleBgraPremulLinePair_C;
+  WebPPremultipliedUpsamplers[MODE_Argb] = UpsampleArgbPremulLinePair_C;
 #endif
 
   // If defined, use CPUInfo() to overwrite some pointers with faster versions.
@@ -288,6 +368,11 @@ WEBP_DSP_INIT_FUNC(WebPInitUpsamplers) {
       WebPInitUpsamplersSSE41();
     }
 #endif
+#if defined(WEBP_USE_AVX2)
+    if (VP8GetCPUInfo(kAVX2)) {
+      WebPInitUpsamplersAVX2();
+    }
+#endif
 #if defined(WEBP_USE_MIPS_DSP_R2)
     if (VP8GetCPUInfo(kMIPSdspR2)) {
       WebPInitUpsamplersMIPSdspR2();
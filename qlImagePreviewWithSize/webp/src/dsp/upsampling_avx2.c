@@ -0,0 +1,354 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 version of YUV to RGB upsampling functions.
+//
+// Same U/V interpolation as upsampling_sse2.c, but on 32 chroma samples at a
+// time: 33 chroma samples per row make up one 64-pixel block, converted 32
+// pixels at a time by VP8YuvTo*32_AVX2().
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <assert.h>
+#include <immintrin.h>
+#include <string.h>
+#include "src/dsp/yuv.h"
+
+WEBP_AVX2_BEGIN
+
+#ifdef FANCY_UPSAMPLING
+
+// We compute (9*a + 3*b + 3*c + d + 8) / 16 as follows
+// u = (9*a + 3*b + 3*c + d + 8) / 16
+//   = (a + (a + 3*b + 3*c + d) / 8 + 1) / 2
+//   = (a + m + 1) / 2
+// where m = (a + 3*b + 3*c + d) / 8
+//         = ((a + b + c + d) / 2 + b + c) / 4
+//
+// Let's say  k = (a + b + c + d) / 4.
+// We can compute k as
+// k = (s + t + 1) / 2 - ((a^d) | (b^c) | (s^t)) & 1
+// where s = (a + d + 1) / 2 and t = (b + c + 1) / 2
+//
+// Then m can be written as
+// m = (k + t + 1) / 2 - (((b^c) & (s^t)) | (k^t)) & 1
+
+// Computes out = (k + in + 1) / 2 - ((ij & (s^t)) | (k^in)) & 1
+#define GET_M(ij, in, out) do {                                                \
+  const __m256i tmp0 = _mm256_avg_epu8(k, (in));   /* (k + in + 1) / 2 */      \
+  const __m256i tmp1 = _mm256_and_si256((ij), st); /* (ij) & (s^t) */          \
+  const __m256i tmp2 = _mm256_xor_si256(k, (in));  /* (k^in) */                \
+  const __m256i tmp3 = _mm256_or_si256(tmp1, tmp2);  /* ... | (k^in) */        \
+  const __m256i tmp4 = _mm256_and_si256(tmp3, one); /* & 1 -> lsb_correction*/\
+  (out) = _mm256_sub_epi8(tmp0, tmp4); /* (k + in + 1) / 2 - lsb_correction */ \
+} while (0)
+
+// pack and store two alternating pixel rows. The unpacks work within 128-bit
+// lanes, hence the final lane permutations.
+#define PACK_AND_STORE(a, b, da, db, out) do {                                 \
+  const __m256i t_a = _mm256_avg_epu8(a, da); /* (9a + 3b + 3c +  d + 8) / 16*/\
+  const __m256i t_b = _mm256_avg_epu8(b, db); /* (3a + 9b +  c + 3d + 8) / 16*/\
+  const __m256i t_1 = _mm256_unpacklo_epi8(t_a, t_b);                          \
+  const __m256i t_2 = _mm256_unpackhi_epi8(t_a, t_b);                          \
+  _mm256_store_si256(((__m256i*)(out)) + 0,                                    \
+                     _mm256_permute2x128_si256(t_1, t_2, 0x20));               \
+  _mm256_store_si256(((__m256i*)(out)) + 1,                                    \
+                     _mm256_permute2x128_si256(t_1, t_2, 0x31));               \
+} while (0)
+
+// Loads 33 pixels each from rows r1 and r2 and generates 64 pixels.
+#define UPSAMPLE_64PIXELS(r1, r2, out) {                                       \
+  const __m256i one = _mm256_set1_epi8(1);                                     \
+  const __m256i a = _mm256_loadu_si256((const __m256i*)&(r1)[0]);              \
+  const __m256i b = _mm256_loadu_si256((const __m256i*)&(r1)[1]);              \
+  const __m256i c = _mm256_loadu_si256((const __m256i*)&(r2)[0]);              \
+  const __m256i d = _mm256_loadu_si256((const __m256i*)&(r2)[1]);              \
+                                                                               \
+  const __m256i s = _mm256_avg_epu8(a, d);       /* s = (a + d + 1) / 2 */     \
+  const __m256i t = _mm256_avg_epu8(b, c);       /* t = (b + c + 1) / 2 */     \
+  const __m256i st = _mm256_xor_si256(s, t);     /* st = s^t */                \
+                                                                               \
+  const __m256i ad = _mm256_xor_si256(a, d);     /* ad = a^d */                \
+  const __m256i bc = _mm256_xor_si256(b, c);     /* bc = b^c */                \
+                                                                               \
+  const __m256i t1 = _mm256_or_si256(ad, bc);    /* (a^d) | (b^c) */           \
+  const __m256i t2 = _mm256_or_si256(t1, st);    /* (a^d) | (b^c) | (s^t) */   \
+  const __m256i t3 = _mm256_and_si256(t2, one);  /* ... & 1 */                 \
+  const __m256i t4 = _mm256_avg_epu8(s, t);                                    \
+  const __m256i k = _mm256_sub_epi8(t4, t3);     /* k = (a + b + c + d) / 4 */ \
+  __m256i diag1, diag2;                                                        \
+                                                                               \
+  GET_M(bc, t, diag1);                  /* diag1 = (a + 3b + 3c + d) / 8 */    \
+  GET_M(ad, s, diag2);                  /* diag2 = (3a + b + c + 3d) / 8 */    \
+                                                                               \
+  /* pack the alternate pixels */                                              \
+  PACK_AND_STORE(a, b, diag1, diag2, (out) +      0);  /* store top */         \
+  PACK_AND_STORE(c, d, diag2, diag1, (out) + 2 * 64);  /* store bottom */      \
+}
+
+// Turn the macro into a function for reducing code-size when non-critical
+static void Upsample64Pixels_AVX2(const uint8_t r1[], const uint8_t r2[],
+                                  uint8_t* const out) {
+  UPSAMPLE_64PIXELS(r1, r2, out);
+}
+
+#define UPSAMPLE_LAST_BLOCK(tb, bb, num_pixels, out) {                         \
+  uint8_t r1[33], r2[33];                                                      \
+  memcpy(r1, (tb), (num_pixels));                                              \
+  memcpy(r2, (bb), (num_pixels));                                              \
+  /* replicate last byte */                                                    \
+  memset(r1 + (num_pixels), r1[(num_pixels) - 1], 33 - (num_pixels));          \
+  memset(r2 + (num_pixels), r2[(num_pixels) - 1], 33 - (num_pixels));          \
+  /* using the shared function instead of the macro saves code size */         \
+  Upsample64Pixels_AVX2(r1, r2, out);                                          \
+}
+
+#define CONVERT2RGB_64(FUNC, XSTEP, top_y, bottom_y,                           \
+                       top_dst, bottom_dst, cur_x) do {                        \
+  FUNC##32_AVX2((top_y) + (cur_x), r_u, r_v, (top_dst) + (cur_x) * (XSTEP));   \
+  FUNC##32_AVX2((top_y) + (cur_x) + 32, r_u + 32, r_v + 32,                    \
+                (top_dst) + ((cur_x) + 32) * (XSTEP));                         \
+  if ((bottom_y) != NULL) {                                                    \
+    FUNC##32_AVX2((bottom_y) + (cur_x), r_u + 128, r_v + 128,                  \
+                  (bottom_dst) + (cur_x) * (XSTEP));                           \
+    FUNC##32_AVX2((bottom_y) + (cur_x) + 32, r_u + 128 + 32, r_v + 128 + 32,   \
+                  (bottom_dst) + ((cur_x) + 32) * (XSTEP));                    \
+  }                                                                            \
+} while (0)
+
+#define AVX2_UPSAMPLE_FUNC(FUNC_NAME, FUNC, XSTEP)                             \
+static void FUNC_NAME(const uint8_t* top_y, const uint8_t* bottom_y,           \
+                      const uint8_t* top_u, const uint8_t* top_v,              \
+                      const uint8_t* cur_u, const uint8_t* cur_v,              \
+                      uint8_t* top_dst, uint8_t* bottom_dst, int len) {        \
+  int uv_pos, pos;                                                             \
+  /* 32byte-aligned array to cache reconstructed u and v */                    \
+  uint8_t uv_buf[14 * 64 + 31] = { 0 };                                        \
+  uint8_t* const r_u = (uint8_t*)((uintptr_t)(uv_buf + 31) & ~31);             \
+  uint8_t* const r_v = r_u + 64;                                               \
+                                                                               \
+  assert(top_y != NULL);                                                       \
+  {   /* Treat the first pixel in regular way */                               \
+    const int u_diag = ((top_u[0] + cur_u[0]) >> 1) + 1;                       \
+    const int v_diag = ((top_v[0] + cur_v[0]) >> 1) + 1;                       \
+    const int u0_t = (top_u[0] + u_diag) >> 1;                                 \
+    const int v0_t = (top_v[0] + v_diag) >> 1;                                 \
+    FUNC(top_y[0], u0_t, v0_t, top_dst);                                       \
+    if (bottom_y != NULL) {                                                    \
+      const int u0_b = (cur_u[0] + u_diag) >> 1;                               \
+      const int v0_b = (cur_v[0] + v_diag) >> 1;                               \
+      FUNC(bottom_y[0], u0_b, v0_b, bottom_dst);                               \
+    }                                                                          \
+  }                                                                            \
+  /* For UPSAMPLE_64PIXELS, 33 u/v values must be read-able for each block */  \
+  for (pos = 1, uv_pos = 0; pos + 64 + 1 <= len; pos += 64, uv_pos += 32) {    \
+    UPSAMPLE_64PIXELS(top_u + uv_pos, cur_u + uv_pos, r_u);                    \
+    UPSAMPLE_64PIXELS(top_v + uv_pos, cur_v + uv_pos, r_v);                    \
+    CONVERT2RGB_64(FUNC, XSTEP, top_y, bottom_y, top_dst, bottom_dst, pos);    \
+  }                                                                            \
+  if (len > 1) {                                                               \
+    const int left_over = ((len + 1) >> 1) - (pos >> 1);                       \
+    uint8_t* const tmp_top_dst = r_u + 4 * 64;                                 \
+    uint8_t* const tmp_bottom_dst = tmp_top_dst + 4 * 64;                      \
+    uint8_t* const tmp_top = tmp_bottom_dst + 4 * 64;                          \
+    uint8_t* const tmp_bottom = (bottom_y == NULL) ? NULL : tmp_top + 64;      \
+    assert(left_over > 0);                                                     \
+    UPSAMPLE_LAST_BLOCK(top_u + uv_pos, cur_u + uv_pos, left_over, r_u);       \
+    UPSAMPLE_LAST_BLOCK(top_v + uv_pos, cur_v + uv_pos, left_over, r_v);       \
+    memcpy(tmp_top, top_y + pos, len - pos);                                   \
+    if (bottom_y != NULL) memcpy(tmp_bottom, bottom_y + pos, len - pos);       \
+    CONVERT2RGB_64(FUNC, XSTEP, tmp_top, tmp_bottom, tmp_top_dst,              \
+                   tmp_bottom_dst, 0);                                         \
+    memcpy(top_dst + pos * (XSTEP), tmp_top_dst, (len - pos) * (XSTEP));       \
+    if (bottom_y != NULL) {                                                    \
+      memcpy(bottom_dst + pos * (XSTEP), tmp_bottom_dst,                       \
+             (len - pos) * (XSTEP));                                           \
+    }                                                                          \
+  }                                                                            \
+}
+
+// AVX2 variants of the fancy upsampler.
+AVX2_UPSAMPLE_FUNC(UpsampleRgbaLinePair_AVX2, VP8YuvToRgba, 4)
+AVX2_UPSAMPLE_FUNC(UpsampleBgraLinePair_AVX2, VP8YuvToBgra, 4)
+
+#if !defined(WEBP_REDUCE_CSP)
+AVX2_UPSAMPLE_FUNC(UpsampleRgbLinePair_AVX2,  VP8YuvToRgb,  3)
+AVX2_UPSAMPLE_FUNC(UpsampleBgrLinePair_AVX2,  VP8YuvToBgr,  3)
+AVX2_UPSAMPLE_FUNC(UpsampleArgbLinePair_AVX2, VP8YuvToArgb, 4)
+#endif   // WEBP_REDUCE_CSP
+
+#define CONVERT2RGBA_64(FUNC, top_y, bottom_y, top_a, bottom_a,               \
+                        top_dst, bottom_dst, cur_x) do {                       \
+  FUNC##32_AVX2((top_y) + (cur_x), r_u, r_v, (top_a) + (cur_x),                \
+                (top_dst) + (cur_x) * 4);                                      \
+  FUNC##32_AVX2((top_y) + (cur_x) + 32, r_u + 32, r_v + 32,                    \
+                (top_a) + (cur_x) + 32, (top_dst) + ((cur_x) + 32) * 4);       \
+  if ((bottom_y) != NULL) {                                                    \
+    FUNC##32_AVX2((bottom_y) + (cur_x), r_u + 128, r_v + 128,                  \
+                  (bottom_a) + (cur_x), (bottom_dst) + (cur_x) * 4);           \
+    FUNC##32_AVX2((bottom_y) + (cur_x) + 32, r_u + 128 + 32, r_v + 128 + 32,   \
+                  (bottom_a) + (cur_x) + 32,                                   \
+                  (bottom_dst) + ((cur_x) + 32) * 4);                          \
+  }                                                                            \
+} while (0)
+
+// Same as AVX2_UPSAMPLE_FUNC, for the premultiplied modes.
+#define AVX2_UPSAMPLE_ALPHA_FUNC(FUNC_NAME, FUNC)                              \
+static void FUNC_NAME(const uint8_t* top_y, const uint8_t* bottom_y,           \
+                      const uint8_t* top_u, const uint8_t* top_v,              \
+                      const uint8_t* cur_u, const uint8_t* cur_v,              \
+                      const uint8_t* top_a, const uint8_t* bottom_a,           \
+                      uint8_t* top_dst, uint8_t* bottom_dst, int len) {        \
+  int uv_pos, pos;                                                             \
+  /* 32byte-aligned array to cache reconstructed u and v */                    \
+  uint8_t uv_buf[16 * 64 + 31] = { 0 };                                        \
+  uint8_t* const r_u = (uint8_t*)((uintptr_t)(uv_buf + 31) & ~31);             \
+  uint8_t* const r_v = r_u + 64;                                               \
+                                                                               \
+  assert(top_y != NULL && top_a != NULL);                                      \
+  assert(bottom_y == NULL || bottom_a != NULL);                                \
+  {   /* Treat the first pixel in regular way */                               \
+    const int u_diag = ((top_u[0] + cur_u[0]) >> 1) + 1;                       \
+    const int v_diag = ((top_v[0] + cur_v[0]) >> 1) + 1;                       \
+    const int u0_t = (top_u[0] + u_diag) >> 1;                                 \
+    const int v0_t = (top_v[0] + v_diag) >> 1;                                 \
+    FUNC(top_y[0], u0_t, v0_t, top_a[0], top_dst);                             \
+    if (bottom_y != NULL) {                                                    \
+      const int u0_b = (cur_u[0] + u_diag) >> 1;                               \
+      const int v0_b = (cur_v[0] + v_diag) >> 1;                               \
+      FUNC(bottom_y[0], u0_b, v0_b, bottom_a[0], bottom_dst);                  \
+    }                                                                          \
+  }                                                                            \
+  /* For UPSAMPLE_64PIXELS, 33 u/v values must be read-able for each block */  \
+  for (pos = 1, uv_pos = 0; pos + 64 + 1 <= len; pos += 64, uv_pos += 32) {    \
+    UPSAMPLE_64PIXELS(top_u + uv_pos, cur_u + uv_pos, r_u);                    \
+    UPSAMPLE_64PIXELS(top_v + uv_pos, cur_v + uv_pos, r_v);                    \
+    CONVERT2RGBA_64(FUNC, top_y, bottom_y, top_a, bottom_a,                    \
+                    top_dst, bottom_dst, pos);                                 \
+  }                                                                            \
+  if (len > 1) {                                                               \
+    const int left_over = ((len + 1) >> 1) - (pos >> 1);                       \
+    uint8_t* const tmp_top_dst = r_u + 4 * 64;                                 \
+    uint8_t* const tmp_bottom_dst = tmp_top_dst + 4 * 64;                      \
+    uint8_t* const tmp_top = tmp_bottom_dst + 4 * 64;                          \
+    uint8_t* const tmp_bottom = (bottom_y == NULL) ? NULL : tmp_top + 64;      \
+    uint8_t* const tmp_top_a = tmp_top + 2 * 64;                               \
+    uint8_t* const tmp_bottom_a = tmp_top_a + 64;                              \
+    assert(left_over > 0);                                                     \
+    UPSAMPLE_LAST_BLOCK(top_u + uv_pos, cur_u + uv_pos, left_over, r_u);       \
+    UPSAMPLE_LAST_BLOCK(top_v + uv_pos, cur_v + uv_pos, left_over, r_v);       \
+    memcpy(tmp_top, top_y + pos, len - pos);                                   \
+    memcpy(tmp_top_a, top_a + pos, len - pos);                                 \
+    if (bottom_y != NULL) {                                                    \
+      memcpy(tmp_bottom, bottom_y + pos, len - pos);                           \
+      memcpy(tmp_bottom_a, bottom_a + pos, len - pos);                         \
+    }                                                                          \
+    CONVERT2RGBA_64(FUNC, tmp_top, tmp_bottom, tmp_top_a, tmp_bottom_a,        \
+                    tmp_top_dst, tmp_bottom_dst, 0);                           \
+    memcpy(top_dst + pos * 4, tmp_top_dst, (len - pos) * 4);                   \
+    if (bottom_y != NULL) {                                                    \
+      memcpy(bottom_dst + pos * 4, tmp_bottom_dst, (len - pos) * 4);           \
+    }                                                                          \
+  }                                                                            \
+}
+
+AVX2_UPSAMPLE_ALPHA_FUNC(UpsampleRgbaPremulLinePair_AVX2, VP8YuvToRgbaPremul)
+AVX2_UPSAMPLE_ALPHA_FUNC(UpsampleBgraPremulLinePair_AVX2, VP8YuvToBgraPremul)
+AVX2_UPSAMPLE_ALPHA_FUNC(UpsampleArgbPremulLinePair_AVX2, VP8YuvToArgbPremul)
+
+#undef GET_M
+#undef PACK_AND_STORE
+#undef UPSAMPLE_64PIXELS
+#undef UPSAMPLE_LAST_BLOCK
+#undef CONVERT2RGB_64
+#undef CONVERT2RGBA_64
+#undef AVX2_UPSAMPLE_FUNC
+#undef AVX2_UPSAMPLE_ALPHA_FUNC
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern WebPUpsampleLinePairFunc WebPUpsamplers[/* MODE_LAST */];
+extern WebPUpsampleAlphaLinePairFunc
+    WebPPremultipliedUpsamplers[/* MODE_LAST */];
+
+extern void WebPInitUpsamplersAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPInitUpsamplersAVX2(void) {
+  WebPUpsamplers[MODE_RGBA] = UpsampleRgbaLinePair_AVX2;
+  WebPUpsamplers[MODE_BGRA] = UpsampleBgraLinePair_AVX2;
+  WebPUpsamplers[MODE_rgbA] = UpsampleRgbaLinePair_AVX2;
+  WebPUpsamplers[MODE_bgrA] = UpsampleBgraLinePair_AVX2;
+  WebPPremultipliedUpsamplers[MODE_rgbA] = UpsampleRgbaPremulLinePair_AVX2;
+  WebPPremultipliedUpsamplers[MODE_bgrA] = UpsampleBgraPremulLinePair_AVX2;
+  WebPPremultipliedUpsamplers[MODE_Argb] = UpsampleArgbPremulLinePair_AVX2;
+#if !defined(WEBP_REDUCE_CSP)
+  WebPUpsamplers[MODE_RGB]  = UpsampleRgbLinePair_AVX2;
+  WebPUpsamplers[MODE_BGR]  = UpsampleBgrLinePair_AVX2;
+  WebPUpsamplers[MODE_ARGB] = UpsampleArgbLinePair_AVX2;
+  WebPUpsamplers[MODE_Argb] = UpsampleArgbLinePair_AVX2;
+#endif   // WEBP_REDUCE_CSP
+}
+
+#endif  // FANCY_UPSAMPLING
+
+//------------------------------------------------------------------------------
+
+extern WebPYUV444Converter WebPYUV444Converters[/* MODE_LAST */];
+extern void WebPInitYUV444ConvertersAVX2(void);
+
+#define YUV444_FUNC(FUNC_NAME, CALL, CALL_C, XSTEP)                            \
+extern void CALL_C(const uint8_t* y, const uint8_t* u, const uint8_t* v,       \
+                   uint8_t* dst, int len);                                     \
+static void FUNC_NAME(const uint8_t* y, const uint8_t* u, const uint8_t* v,    \
+                      uint8_t* dst, int len) {                                 \
+  int i;                                                                       \
+  const int max_len = len & ~31;                                               \
+  for (i = 0; i < max_len; i += 32) {                                          \
+    CALL(y + i, u + i, v + i, dst + i * (XSTEP));                              \
+  }                                                                            \
+  if (i < len) {  /* C-fallback */                                             \
+    CALL_C(y + i, u + i, v + i, dst + i * (XSTEP), len - i);                   \
+  }                                                                            \
+}
+
+YUV444_FUNC(Yuv444ToRgba_AVX2, VP8YuvToRgba32_AVX2, WebPYuv444ToRgba_C, 4);
+YUV444_FUNC(Yuv444ToBgra_AVX2, VP8YuvToBgra32_AVX2, WebPYuv444ToBgra_C, 4);
+#if !defined(WEBP_REDUCE_CSP)
+YUV444_FUNC(Yuv444ToRgb_AVX2, VP8YuvToRgb32_AVX2, WebPYuv444ToRgb_C, 3);
+YUV444_FUNC(Yuv444ToBgr_AVX2, VP8YuvToBgr32_AVX2, WebPYuv444ToBgr_C, 3);
+YUV444_FUNC(Yuv444ToArgb_AVX2, VP8YuvToArgb32_AVX2, WebPYuv444ToArgb_C, 4)
+#endif   // WEBP_REDUCE_CSP
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPInitYUV444ConvertersAVX2(void) {
+  WebPYUV444Converters[MODE_RGBA]      = Yuv444ToRgba_AVX2;
+  WebPYUV444Converters[MODE_BGRA]      = Yuv444ToBgra_AVX2;
+  WebPYUV444Converters[MODE_rgbA]      = Yuv444ToRgba_AVX2;
+  WebPYUV444Converters[MODE_bgrA]      = Yuv444ToBgra_AVX2;
+#if !defined(WEBP_REDUCE_CSP)
+  WebPYUV444Converters[MODE_RGB]       = Yuv444ToRgb_AVX2;
+  WebPYUV444Converters[MODE_BGR]       = Yuv444ToBgr_AVX2;
+  WebPYUV444Converters[MODE_ARGB]      = Yuv444ToArgb_AVX2;
+  WebPYUV444Converters[MODE_Argb]      = Yuv444ToArgb_AVX2;
+#endif   // WEBP_REDUCE_CSP
+}
+
+WEBP_AVX2_END
+
+#else
+
+WEBP_DSP_INIT_STUB(WebPInitYUV444ConvertersAVX2)
+
+#endif  // WEBP_USE_AVX2
+
+#if !(defined(FANCY_UPSAMPLING) && defined(WEBP_USE_AVX2))
+WEBP_DSP_INIT_STUB(WebPInitUpsamplersAVX2)
+#endif
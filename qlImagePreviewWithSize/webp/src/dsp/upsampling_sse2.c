@@ -176,18 +176,96 @@ SSE2_UPSAMPLE_FUNC(UpsampleRgba4444LinePair_SSE2, VP8YuvToRgba4444, 2)
 SSE2_UPSAMPLE_FUNC(UpsampleRgb565LinePair_SSE2, VP8YuvToRgb565, 2)
 #endif   // WEBP_REDUCE_CSP
 
+#define CONVERT2RGBA_32(FUNC, top_y, bottom_y, top_a, bottom_a,               \
+                        top_dst, bottom_dst, cur_x) do {                       \
+  FUNC##32_SSE2((top_y) + (cur_x), r_u, r_v, (top_a) + (cur_x),                \
+                (top_dst) + (cur_x) * 4);                                      \
+  if ((bottom_y) != NULL) {                                                    \
+    FUNC##32_SSE2((bottom_y) + (cur_x), r_u + 64, r_v + 64,                    \
+                  (bottom_a) + (cur_x), (bottom_dst) + (cur_x) * 4);           \
+  }                                                                            \
+} while (0)
+
+// Same as SSE2_UPSAMPLE_FUNC, for the premultiplied modes.
+#define SSE2_UPSAMPLE_ALPHA_FUNC(FUNC_NAME, FUNC)                              \
+static void FUNC_NAME(const uint8_t* top_y, const uint8_t* bottom_y,           \
+                      const uint8_t* top_u, const uint8_t* top_v,              \
+                      const uint8_t* cur_u, const uint8_t* cur_v,              \
+                      const uint8_t* top_a, const uint8_t* bottom_a,           \
+                      uint8_t* top_dst, uint8_t* bottom_dst, int len) {        \
+  int uv_pos, pos;                                                             \
+  /* 16byte-aligned array to cache reconstructed u and v */                    \
+  uint8_t uv_buf[16 * 32 + 15] = { 0 };                                        \
+  uint8_t* const r_u = (uint8_t*)((uintptr_t)(uv_buf + 15) & ~15);             \
+  uint8_t* const r_v = r_u + 32;                                               \
+                                                                               \
+  assert(top_y != NULL && top_a != NULL);                                      \
+  assert(bottom_y == NULL || bottom_a != NULL);                                \
+  {   /* Treat the first pixel in regular way */                               \
+    const int u_diag = ((top_u[0] + cur_u[0]) >> 1) + 1;                       \
+    const int v_diag = ((top_v[0] + cur_v[0]) >> 1) + 1;                       \
+    const int u0_t = (top_u[0] + u_diag) >> 1;                                 \
+    const int v0_t = (top_v[0] + v_diag) >> 1;                                 \
+    FUNC(top_y[0], u0_t, v0_t, top_a[0], top_dst);                             \
+    if (bottom_y != NULL) {                                                    \
+      const int u0_b = (cur_u[0] + u_diag) >> 1;                               \
+      const int v0_b = (cur_v[0] + v_diag) >> 1;                               \
+      FUNC(bottom_y[0], u0_b, v0_b, bottom_a[0], bottom_dst);                  \
+    }                                                                          \
+  }                                                                            \
+  /* For UPSAMPLE_32PIXELS, 17 u/v values must be read-able for each block */  \
+  for (pos = 1, uv_pos = 0; pos + 32 + 1 <= len; pos += 32, uv_pos += 16) {    \
+    UPSAMPLE_32PIXELS(top_u + uv_pos, cur_u + uv_pos, r_u);                    \
+    UPSAMPLE_32PIXELS(top_v + uv_pos, cur_v + uv_pos, r_v);                    \
+    CONVERT2RGBA_32(FUNC, top_y, bottom_y, top_a, bottom_a,                    \
+                    top_dst, bottom_dst, pos);                                 \
+  }                                                                            \
+  if (len > 1) {                                                               \
+    const int left_over = ((len + 1) >> 1) - (pos >> 1);                       \
+    uint8_t* const tmp_top_dst = r_u + 4 * 32;                                 \
+    uint8_t* const tmp_bottom_dst = tmp_top_dst + 4 * 32;                      \
+    uint8_t* const tmp_top = tmp_bottom_dst + 4 * 32;                          \
+    uint8_t* const tmp_bottom = (bottom_y == NULL) ? NULL : tmp_top + 32;      \
+    uint8_t* const tmp_top_a = tmp_top + 2 * 32;                               \
+    uint8_t* const tmp_bottom_a = tmp_top_a + 32;                              \
+    assert(left_over > 0);                                                     \
+    UPSAMPLE_LAST_BLOCK(top_u + uv_pos, cur_u + uv_pos, left_over, r_u);       \
+    UPSAMPLE_LAST_BLOCK(top_v + uv_pos, cur_v + uv_pos, left_over, r_v);       \
+    memcpy(tmp_top, top_y + pos, len - pos);                                   \
+    memcpy(tmp_top_a, top_a + pos, len - pos);                                 \
+    if (bottom_y != NULL) {                                                    \
+      memcpy(tmp_bottom, bottom_y + pos, len - pos);                           \
+      memcpy(tmp_bottom_a, bottom_a + pos, len - pos);                         \
+    }                                                                          \
+    CONVERT2RGBA_32(FUNC, tmp_top, tmp_bottom, tmp_top_a, tmp_bottom_a,        \
+                    tmp_top_dst, tmp_bottom_dst, 0);                           \
+    memcpy(top_dst + pos * 4, tmp_top_dst, (len - pos) * 4);                   \
+    if (bottom_y != NULL) {                                                    \
+      memcpy(bottom_dst + pos * 4, tmp_bottom_dst, (len - pos) * 4);           \
+    }                                                                          \
+  }                                                                            \
+}
+
+SSE2_UPSAMPLE_ALPHA_FUNC(UpsampleRgbaPremulLinePair_SSE2, VP8YuvToRgbaPremul)
+SSE2_UPSAMPLE_ALPHA_FUNC(UpsampleBgraPremulLinePair_SSE2, VP8YuvToBgraPremul)
+SSE2_UPSAMPLE_ALPHA_FUNC(UpsampleArgbPremulLinePair_SSE2, VP8YuvToArgbPremul)
+
 #undef GET_M
 #undef PACK_AND_STORE
 #undef UPSAMPLE_32PIXELS
 #undef UPSAMPLE_LAST_BLOCK
 #undef CONVERT2RGB
 #undef CONVERT2RGB_32
+#undef CONVERT2RGBA_32
 #undef SSE2_UPSAMPLE_FUNC
+#undef SSE2_UPSAMPLE_ALPHA_FUNC
 
 //------------------------------------------------------------------------------
 // Entry point
 
 extern WebPUpsampleLinePairFunc WebPUpsamplers[/* MODE_LAST */];
+extern WebPUpsampleAlphaLinePairFunc
+    WebPPremultipliedUpsamplers[/* MODE_LAST */];
 
 extern void WebPInitUpsamplersSSE2(void);
 
@@ -196,6 +274,9 @@ WEBP_TSAN_IGNORE_FUNCTION void WebPInitUpsamplersSSE2(void) {
   WebPUpsamplers[MODE_BGRA] = UpsampleBgraLinePair_SSE2;
   WebPUpsamplers[MODE_rgbA] = UpsampleRgbaLinePair_SSE2;
   WebPUpsamplers[MODE_bgrA] = UpsampleBgraLinePair_SSE2;
+  WebPPremultipliedUpsamplers[MODE_rgbA] = UpsampleRgbaPremulLinePair_SSE2;
+  WebPPremultipliedUpsamplers[MODE_bgrA] = UpsampleBgraPremulLinePair_SSE2;
+  WebPPremultipliedUpsamplers[MODE_Argb] = UpsampleArgbPremulLinePair_SSE2;
 #if !defined(WEBP_REDUCE_CSP)
   WebPUpsamplers[MODE_RGB]  = UpsampleRgbLinePair_SSE2;
   WebPUpsamplers[MODE_BGR]  = UpsampleBgrLinePair_SSE2;
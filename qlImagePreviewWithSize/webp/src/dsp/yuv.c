@@ -48,6 +48,31 @@ ROW_FUNC(YuvToRgb565Row,   VP8YuvToRgb565, 2)
 
 #undef ROW_FUNC
 
+#define ROW_FUNC_ALPHA(FUNC_NAME, FUNC)                                        \
+static void FUNC_NAME(const uint8_t* y,                                        \
+                      const uint8_t* u, const uint8_t* v,                      \
+                      const uint8_t* a, uint8_t* dst, int len) {               \
+  const uint8_t* const end = dst + (len & ~1) * 4;                             \
+  while (dst != end) {                                                         \
+    FUNC(y[0], u[0], v[0], a[0], dst);                                         \
+    FUNC(y[1], u[0], v[0], a[1], dst + 4);                                     \
+    y += 2;                                                                    \
+    a += 2;                                                                    \
+    ++u;                                                                       \
+    ++v;                                                                       \
+    dst += 2 * 4;                                                              \
+  }                                                                            \
+  if (len & 1) {                                                               \
+    FUNC(y[0], u[0], v[0], a[0], dst);                                         \
+  }                                                                            \
+}                                                                              \
+
+ROW_FUNC_ALPHA(YuvToRgbaPremulRow, VP8YuvToRgbaPremul)
+ROW_FUNC_ALPHA(YuvToBgraPremulRow, VP8YuvToBgraPremul)
+ROW_FUNC_ALPHA(YuvToArgbPremulRow, VP8YuvToArgbPremul)
+
+#undef ROW_FUNC_ALPHA
+
 // Main call for processing a plane with a WebPSamplerRowFunc function:
 void WebPSamplerProcessPlane(const uint8_t* y, int y_stride,
                              const uint8_t* u, const uint8_t* v, int uv_stride,
@@ -65,13 +90,35 @@ void WebPSamplerProcessPlane(const uint8_t* y, int y_stride,
   }
 }
 
+void WebPSamplerAlphaProcessPlane(const uint8_t* y, int y_stride,
+                                  const uint8_t* u, const uint8_t* v,
+                                  int uv_stride,
+                                  const uint8_t* a, int a_stride,
+                                  uint8_t* dst, int dst_stride,
+                                  int width, int height,
+                                  WebPSamplerAlphaRowFunc func) {
+  int j;
+  for (j = 0; j < height; ++j) {
+    func(y, u, v, a, dst, width);
+    y += y_stride;
+    a += a_stride;
+    if (j & 1) {
+      u += uv_stride;
+      v += uv_stride;
+    }
+    dst += dst_stride;
+  }
+}
+
 //-----------------------------------------------------------------------------
 // Main call
 
 WebPSamplerRowFunc WebPSamplers[MODE_LAST];
+WebPSamplerAlphaRowFunc WebPPremultipliedSamplers[MODE_LAST];
 
 extern void WebPInitSamplersSSE2(void);
 extern void WebPInitSamplersSSE41(void);
+extern void WebPInitSamplersAVX2(void);
 extern void WebPInitSamplersMIPS32(void);
 extern void WebPInitSamplersMIPSdspR2(void);
 
@@ -87,6 +134,9 @@ WEBP_DSP_INIT_FUNC(WebPInitSamplers) {
   WebPSamplers[MODE_bgrA]      = YuvToBgraRow;
   WebPSamplers[MODE_Argb]      = YuvToArgbRow;
   WebPSamplers[MODE_rgbA_4444] = YuvToRgba4444Row;
+  WebPPremultipliedSamplers[MODE_rgbA] = YuvToRgbaPremulRow;
+  WebPPremultipliedSamplers[MODE_bgrA] = YuvToBgraPremulRow;
+  WebPPremultipliedSamplers[MODE_Argb] = YuvToArgbPremulRow;
 
   // If defined, use CPUInfo() to overwrite some pointers with faster versions.
   if (VP8GetCPUInfo != NULL) {
@@ -100,6 +150,11 @@ WEBP_DSP_INIT_FUNC(WebPInitSamplers) {
       WebPInitSamplersSSE41();
     }
 #endif  // WEBP_USE_SSE41
+#if defined(WEBP_USE_AVX2)
+    if (VP8GetCPUInfo(kAVX2)) {
+      WebPInitSamplersAVX2();
+    }
+#endif  // WEBP_USE_AVX2
 #if defined(WEBP_USE_MIPS32)
     if (VP8GetCPUInfo(kMIPS32)) {
       WebPInitSamplersMIPS32();
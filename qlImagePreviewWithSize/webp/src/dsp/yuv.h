@@ -143,6 +143,38 @@ static WEBP_INLINE void VP8YuvToRgba(uint8_t y, uint8_t u, uint8_t v,
   rgba[3] = 0xff;
 }
 
+//-----------------------------------------------------------------------------
+// Premultiplied variants
+
+// Returns (int)(v * a / 255.), computed as in WebPApplyAlphaMultiply().
+static WEBP_INLINE int VP8MultAlpha(int v, int a) {
+  return (int)(((uint32_t)v * a * 32897U) >> 23);
+}
+
+static WEBP_INLINE void VP8YuvToRgbaPremul(uint8_t y, uint8_t u, uint8_t v,
+                                           uint8_t a, uint8_t* const rgba) {
+  rgba[0] = VP8MultAlpha(VP8YUVToR(y, v), a);
+  rgba[1] = VP8MultAlpha(VP8YUVToG(y, u, v), a);
+  rgba[2] = VP8MultAlpha(VP8YUVToB(y, u), a);
+  rgba[3] = a;
+}
+
+static WEBP_INLINE void VP8YuvToBgraPremul(uint8_t y, uint8_t u, uint8_t v,
+                                           uint8_t a, uint8_t* const bgra) {
+  bgra[0] = VP8MultAlpha(VP8YUVToB(y, u), a);
+  bgra[1] = VP8MultAlpha(VP8YUVToG(y, u, v), a);
+  bgra[2] = VP8MultAlpha(VP8YUVToR(y, v), a);
+  bgra[3] = a;
+}
+
+static WEBP_INLINE void VP8YuvToArgbPremul(uint8_t y, uint8_t u, uint8_t v,
+                                           uint8_t a, uint8_t* const argb) {
+  argb[0] = a;
+  argb[1] = VP8MultAlpha(VP8YUVToR(y, v), a);
+  argb[2] = VP8MultAlpha(VP8YUVToG(y, u, v), a);
+  argb[3] = VP8MultAlpha(VP8YUVToB(y, u), a);
+}
+
 //-----------------------------------------------------------------------------
 // SSE2 extra functions (mostly for upsampling_sse2.c)
 
@@ -163,6 +195,16 @@ void VP8YuvToRgba444432_SSE2(const uint8_t* y, const uint8_t* u,
                              const uint8_t* v, uint8_t* dst);
 void VP8YuvToRgb56532_SSE2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
                            uint8_t* dst);
+// Same as above for the premultiplied modes, with 32 alpha values in *a.
+void VP8YuvToRgbaPremul32_SSE2(const uint8_t* y, const uint8_t* u,
+                               const uint8_t* v, const uint8_t* a,
+                               uint8_t* dst);
+void VP8YuvToBgraPremul32_SSE2(const uint8_t* y, const uint8_t* u,
+                               const uint8_t* v, const uint8_t* a,
+                               uint8_t* dst);
+void VP8YuvToArgbPremul32_SSE2(const uint8_t* y, const uint8_t* u,
+                               const uint8_t* v, const uint8_t* a,
+                               uint8_t* dst);
 
 #endif    // WEBP_USE_SSE2
 
@@ -179,6 +221,35 @@ void VP8YuvToBgr32_SSE41(const uint8_t* y, const uint8_t* u, const uint8_t* v,
 
 #endif    // WEBP_USE_SSE41
 
+//-----------------------------------------------------------------------------
+// AVX2 extra functions (mostly for upsampling_avx2.c)
+
+#if defined(WEBP_USE_AVX2)
+
+// Process 32 pixels and store the result (24b or 32b per pixel) in *dst.
+void VP8YuvToRgba32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst);
+void VP8YuvToRgb32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                        uint8_t* dst);
+void VP8YuvToBgra32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst);
+void VP8YuvToBgr32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                        uint8_t* dst);
+void VP8YuvToArgb32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst);
+// Same as above for the premultiplied modes, with 32 alpha values in *a.
+void VP8YuvToRgbaPremul32_AVX2(const uint8_t* y, const uint8_t* u,
+                               const uint8_t* v, const uint8_t* a,
+                               uint8_t* dst);
+void VP8YuvToBgraPremul32_AVX2(const uint8_t* y, const uint8_t* u,
+                               const uint8_t* v, const uint8_t* a,
+                               uint8_t* dst);
+void VP8YuvToArgbPremul32_AVX2(const uint8_t* y, const uint8_t* u,
+                               const uint8_t* v, const uint8_t* a,
+                               uint8_t* dst);
+
+#endif    // WEBP_USE_AVX2
+
 //------------------------------------------------------------------------------
 // RGB -> YUV conversion
 
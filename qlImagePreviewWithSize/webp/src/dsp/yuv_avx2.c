@@ -0,0 +1,393 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 version of YUV->RGB conversion functions
+
+#include "src/dsp/yuv.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <immintrin.h>
+
+WEBP_AVX2_BEGIN
+
+//-----------------------------------------------------------------------------
+// Convert spans of 32 pixels to various RGB formats for the fancy upsampler.
+
+// Same 14b fixed-point arithmetic as ConvertYUV444ToRGB_SSE2(), hence
+// bit-exact with it, but working on 16 samples at a time.
+// R = (19077 * y             + 26149 * v - 14234) >> 6
+// G = (19077 * y -  6419 * u - 13320 * v +  8708) >> 6
+// B = (19077 * y + 33050 * u             - 17685) >> 6
+static void ConvertYUV444ToRGB_AVX2(const __m256i* const Y0,
+                                    const __m256i* const U0,
+                                    const __m256i* const V0,
+                                    __m256i* const R,
+                                    __m256i* const G,
+                                    __m256i* const B) {
+  const __m256i k19077 = _mm256_set1_epi16(19077);
+  const __m256i k26149 = _mm256_set1_epi16(26149);
+  const __m256i k14234 = _mm256_set1_epi16(14234);
+  // 33050 doesn't fit in a signed short: only use this with unsigned arithmetic
+  const __m256i k33050 = _mm256_set1_epi16((short)33050);
+  const __m256i k17685 = _mm256_set1_epi16(17685);
+  const __m256i k6419  = _mm256_set1_epi16(6419);
+  const __m256i k13320 = _mm256_set1_epi16(13320);
+  const __m256i k8708  = _mm256_set1_epi16(8708);
+
+  const __m256i Y1 = _mm256_mulhi_epu16(*Y0, k19077);
+
+  const __m256i R0 = _mm256_mulhi_epu16(*V0, k26149);
+  const __m256i R1 = _mm256_sub_epi16(Y1, k14234);
+  const __m256i R2 = _mm256_add_epi16(R1, R0);
+
+  const __m256i G0 = _mm256_mulhi_epu16(*U0, k6419);
+  const __m256i G1 = _mm256_mulhi_epu16(*V0, k13320);
+  const __m256i G2 = _mm256_add_epi16(Y1, k8708);
+  const __m256i G3 = _mm256_add_epi16(G0, G1);
+  const __m256i G4 = _mm256_sub_epi16(G2, G3);
+
+  // be careful with the saturated *unsigned* arithmetic here!
+  const __m256i B0 = _mm256_mulhi_epu16(*U0, k33050);
+  const __m256i B1 = _mm256_adds_epu16(B0, Y1);
+  const __m256i B2 = _mm256_subs_epu16(B1, k17685);
+
+  // use logical shift for B2, which can be larger than 32767
+  *R = _mm256_srai_epi16(R2, 6);   // range: [-14234, 30815]
+  *G = _mm256_srai_epi16(G4, 6);   // range: [-10953, 27710]
+  *B = _mm256_srli_epi16(B2, 6);   // range: [0, 34238]
+}
+
+// Load 16 bytes into the *upper* part of 16b words. That's "<< 8", basically.
+static WEBP_INLINE __m256i Load_HI_16_AVX2(const uint8_t* src) {
+  const __m128i tmp = _mm_loadu_si128((const __m128i*)src);
+  return _mm256_slli_epi16(_mm256_cvtepu8_epi16(tmp), 8);
+}
+
+// Load and replicate 8 U/V samples
+static WEBP_INLINE __m256i Load_UV_HI_8_AVX2(const uint8_t* src) {
+  const __m128i tmp0 = _mm_loadl_epi64((const __m128i*)src);
+  const __m128i tmp1 = _mm_unpacklo_epi8(tmp0, tmp0);   // replicate samples
+  return _mm256_slli_epi16(_mm256_cvtepu8_epi16(tmp1), 8);
+}
+
+// Convert 16 samples of YUV444 to R/G/B
+static void YUV444ToRGB_AVX2(const uint8_t* const y,
+                             const uint8_t* const u,
+                             const uint8_t* const v,
+                             __m256i* const R, __m256i* const G,
+                             __m256i* const B) {
+  const __m256i Y0 = Load_HI_16_AVX2(y), U0 = Load_HI_16_AVX2(u),
+                V0 = Load_HI_16_AVX2(v);
+  ConvertYUV444ToRGB_AVX2(&Y0, &U0, &V0, R, G, B);
+}
+
+// Convert 16 samples of YUV420 to R/G/B
+static void YUV420ToRGB_AVX2(const uint8_t* const y,
+                             const uint8_t* const u,
+                             const uint8_t* const v,
+                             __m256i* const R, __m256i* const G,
+                             __m256i* const B) {
+  const __m256i Y0 = Load_HI_16_AVX2(y), U0 = Load_UV_HI_8_AVX2(u),
+                V0 = Load_UV_HI_8_AVX2(v);
+  ConvertYUV444ToRGB_AVX2(&Y0, &U0, &V0, R, G, B);
+}
+
+// Load 16 alpha samples into 16b words.
+static WEBP_INLINE __m256i Load_A_16_AVX2(const uint8_t* src) {
+  return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)src));
+}
+
+// Same as MultAlpha_SSE2(): clip the R/G/B values to [0, 255] and multiply
+// them by the alpha values, as (v * a * 0x8081) >> 23.
+static WEBP_INLINE void MultAlpha_AVX2(const __m256i* const A,
+                                       __m256i* const R, __m256i* const G,
+                                       __m256i* const B) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi16(255);
+  const __m256i kMult = _mm256_set1_epi16((short)0x8081u);
+  const __m256i R0 = _mm256_min_epi16(_mm256_max_epi16(*R, zero), max);
+  const __m256i G0 = _mm256_min_epi16(_mm256_max_epi16(*G, zero), max);
+  const __m256i B0 = _mm256_min_epi16(_mm256_max_epi16(*B, zero), max);
+  // the products v * a fit in 16 bits
+  const __m256i R1 = _mm256_mulhi_epu16(_mm256_mullo_epi16(R0, *A), kMult);
+  const __m256i G1 = _mm256_mulhi_epu16(_mm256_mullo_epi16(G0, *A), kMult);
+  const __m256i B1 = _mm256_mulhi_epu16(_mm256_mullo_epi16(B0, *A), kMult);
+  *R = _mm256_srli_epi16(R1, 7);
+  *G = _mm256_srli_epi16(G1, 7);
+  *B = _mm256_srli_epi16(B1, 7);
+}
+
+// Pack 16 R/G/B/A results into 32b pixels, 8 pixels per output register.
+static WEBP_INLINE void Pack4_AVX2(const __m256i* const R,
+                                   const __m256i* const G,
+                                   const __m256i* const B,
+                                   const __m256i* const A,
+                                   __m256i* const out0, __m256i* const out1) {
+  const __m256i rb = _mm256_packus_epi16(*R, *B);
+  const __m256i ga = _mm256_packus_epi16(*G, *A);
+  const __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+  const __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+  // The unpacks work within 128b lanes: lo holds pixels 0-3 and 8-11,
+  // hi holds pixels 4-7 and 12-15.
+  const __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+  const __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+  *out0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+  *out1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+
+// Pack R/G/B/A results into 32b output.
+static WEBP_INLINE void PackAndStore4_AVX2(const __m256i* const R,
+                                           const __m256i* const G,
+                                           const __m256i* const B,
+                                           const __m256i* const A,
+                                           uint8_t* const dst) {
+  __m256i RGBA_lo, RGBA_hi;
+  Pack4_AVX2(R, G, B, A, &RGBA_lo, &RGBA_hi);
+  _mm256_storeu_si256((__m256i*)(dst +  0), RGBA_lo);
+  _mm256_storeu_si256((__m256i*)(dst + 32), RGBA_hi);
+}
+
+// Drop the 4th byte of the 8 pixels in 'in', leaving 24 packed bytes in the
+// lower part of the result.
+static WEBP_INLINE __m256i Pack24b_AVX2(const __m256i in) {
+  const __m256i kShuffle =
+      _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                       0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  const __m256i kPermute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  const __m256i tmp = _mm256_shuffle_epi8(in, kShuffle);
+  return _mm256_permutevar8x32_epi32(tmp, kPermute);
+}
+
+// Pack 2x16 R/G/B results into 96 bytes of 24b output.
+static WEBP_INLINE void PackAndStore3_AVX2(const __m256i* const R0,
+                                           const __m256i* const G0,
+                                           const __m256i* const B0,
+                                           const __m256i* const R1,
+                                           const __m256i* const G1,
+                                           const __m256i* const B1,
+                                           uint8_t* const dst) {
+  __m256i rgb0, rgb1, rgb2, rgb3;
+  Pack4_AVX2(R0, G0, B0, B0, &rgb0, &rgb1);
+  Pack4_AVX2(R1, G1, B1, B1, &rgb2, &rgb3);
+  rgb0 = Pack24b_AVX2(rgb0);
+  rgb1 = Pack24b_AVX2(rgb1);
+  rgb2 = Pack24b_AVX2(rgb2);
+  rgb3 = Pack24b_AVX2(rgb3);
+  // Each store writes 8 bytes of padding, overwritten by the next one. The
+  // last one is split so as to not write past the 96 bytes of 'dst'.
+  _mm256_storeu_si256((__m256i*)(dst +  0), rgb0);
+  _mm256_storeu_si256((__m256i*)(dst + 24), rgb1);
+  _mm256_storeu_si256((__m256i*)(dst + 48), rgb2);
+  _mm_storeu_si128((__m128i*)(dst + 72), _mm256_castsi256_si128(rgb3));
+  _mm_storel_epi64((__m128i*)(dst + 88), _mm256_extracti128_si256(rgb3, 1));
+}
+
+void VP8YuvToRgba32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst) {
+  const __m256i kAlpha = _mm256_set1_epi16(255);
+  int n;
+  for (n = 0; n < 32; n += 16, dst += 64) {
+    __m256i R, G, B;
+    YUV444ToRGB_AVX2(y + n, u + n, v + n, &R, &G, &B);
+    PackAndStore4_AVX2(&R, &G, &B, &kAlpha, dst);
+  }
+}
+
+void VP8YuvToBgra32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst) {
+  const __m256i kAlpha = _mm256_set1_epi16(255);
+  int n;
+  for (n = 0; n < 32; n += 16, dst += 64) {
+    __m256i R, G, B;
+    YUV444ToRGB_AVX2(y + n, u + n, v + n, &R, &G, &B);
+    PackAndStore4_AVX2(&B, &G, &R, &kAlpha, dst);
+  }
+}
+
+void VP8YuvToArgb32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst) {
+  const __m256i kAlpha = _mm256_set1_epi16(255);
+  int n;
+  for (n = 0; n < 32; n += 16, dst += 64) {
+    __m256i R, G, B;
+    YUV444ToRGB_AVX2(y + n, u + n, v + n, &R, &G, &B);
+    PackAndStore4_AVX2(&kAlpha, &R, &G, &B, dst);
+  }
+}
+
+#define PREMUL_32_FUNC(FUNC_NAME, C0, C1, C2, C3)                              \
+void FUNC_NAME(const uint8_t* y, const uint8_t* u, const uint8_t* v,           \
+               const uint8_t* a, uint8_t* dst) {                               \
+  int n;                                                                       \
+  for (n = 0; n < 32; n += 16, dst += 64) {                                    \
+    const __m256i A = Load_A_16_AVX2(a + n);                                   \
+    __m256i R, G, B;                                                           \
+    YUV444ToRGB_AVX2(y + n, u + n, v + n, &R, &G, &B);                         \
+    MultAlpha_AVX2(&A, &R, &G, &B);                                            \
+    PackAndStore4_AVX2(&(C0), &(C1), &(C2), &(C3), dst);                       \
+  }                                                                            \
+}
+
+PREMUL_32_FUNC(VP8YuvToRgbaPremul32_AVX2, R, G, B, A)
+PREMUL_32_FUNC(VP8YuvToBgraPremul32_AVX2, B, G, R, A)
+PREMUL_32_FUNC(VP8YuvToArgbPremul32_AVX2, A, R, G, B)
+
+#undef PREMUL_32_FUNC
+
+void VP8YuvToRgb32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                        uint8_t* dst) {
+  __m256i R0, R1, G0, G1, B0, B1;
+  YUV444ToRGB_AVX2(y +  0, u +  0, v +  0, &R0, &G0, &B0);
+  YUV444ToRGB_AVX2(y + 16, u + 16, v + 16, &R1, &G1, &B1);
+  PackAndStore3_AVX2(&R0, &G0, &B0, &R1, &G1, &B1, dst);
+}
+
+void VP8YuvToBgr32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                        uint8_t* dst) {
+  __m256i R0, R1, G0, G1, B0, B1;
+  YUV444ToRGB_AVX2(y +  0, u +  0, v +  0, &R0, &G0, &B0);
+  YUV444ToRGB_AVX2(y + 16, u + 16, v + 16, &R1, &G1, &B1);
+  PackAndStore3_AVX2(&B0, &G0, &R0, &B1, &G1, &R1, dst);
+}
+
+//-----------------------------------------------------------------------------
+// Arbitrary-length row conversion functions
+
+#define ROW_FUNC_32B(FUNC_NAME, FUNC, C0, C1, C2, C3)                          \
+static void FUNC_NAME(const uint8_t* y,                                        \
+                      const uint8_t* u, const uint8_t* v,                      \
+                      uint8_t* dst, int len) {                                 \
+  const __m256i kAlpha = _mm256_set1_epi16(255);                               \
+  int n;                                                                       \
+  for (n = 0; n + 16 <= len; n += 16, dst += 64) {                             \
+    __m256i R, G, B;                                                           \
+    YUV420ToRGB_AVX2(y, u, v, &R, &G, &B);                                     \
+    PackAndStore4_AVX2(&(C0), &(C1), &(C2), &(C3), dst);                       \
+    y += 16;                                                                   \
+    u += 8;                                                                    \
+    v += 8;                                                                    \
+  }                                                                            \
+  for (; n < len; ++n) {   /* Finish off */                                    \
+    FUNC(y[0], u[0], v[0], dst);                                               \
+    dst += 4;                                                                  \
+    y += 1;                                                                    \
+    u += (n & 1);                                                              \
+    v += (n & 1);                                                              \
+  }                                                                            \
+}
+
+ROW_FUNC_32B(YuvToRgbaRow_AVX2, VP8YuvToRgba, R, G, B, kAlpha)
+ROW_FUNC_32B(YuvToBgraRow_AVX2, VP8YuvToBgra, B, G, R, kAlpha)
+ROW_FUNC_32B(YuvToArgbRow_AVX2, VP8YuvToArgb, kAlpha, R, G, B)
+
+#undef ROW_FUNC_32B
+
+#define PREMUL_ROW_FUNC(FUNC_NAME, FUNC, C0, C1, C2, C3)                       \
+static void FUNC_NAME(const uint8_t* y,                                        \
+                      const uint8_t* u, const uint8_t* v,                      \
+                      const uint8_t* a, uint8_t* dst, int len) {               \
+  int n;                                                                       \
+  for (n = 0; n + 16 <= len; n += 16, dst += 64) {                             \
+    const __m256i A = Load_A_16_AVX2(a);                                       \
+    __m256i R, G, B;                                                           \
+    YUV420ToRGB_AVX2(y, u, v, &R, &G, &B);                                     \
+    MultAlpha_AVX2(&A, &R, &G, &B);                                            \
+    PackAndStore4_AVX2(&(C0), &(C1), &(C2), &(C3), dst);                       \
+    y += 16;                                                                   \
+    a += 16;                                                                   \
+    u += 8;                                                                    \
+    v += 8;                                                                    \
+  }                                                                            \
+  for (; n < len; ++n) {   /* Finish off */                                    \
+    FUNC(y[0], u[0], v[0], a[0], dst);                                         \
+    dst += 4;                                                                  \
+    y += 1;                                                                    \
+    a += 1;                                                                    \
+    u += (n & 1);                                                              \
+    v += (n & 1);                                                              \
+  }                                                                            \
+}
+
+PREMUL_ROW_FUNC(YuvToRgbaPremulRow_AVX2, VP8YuvToRgbaPremul, R, G, B, A)
+PREMUL_ROW_FUNC(YuvToBgraPremulRow_AVX2, VP8YuvToBgraPremul, B, G, R, A)
+PREMUL_ROW_FUNC(YuvToArgbPremulRow_AVX2, VP8YuvToArgbPremul, A, R, G, B)
+
+#undef PREMUL_ROW_FUNC
+
+static void YuvToRgbRow_AVX2(const uint8_t* y,
+                             const uint8_t* u, const uint8_t* v,
+                             uint8_t* dst, int len) {
+  int n;
+  for (n = 0; n + 32 <= len; n += 32, dst += 32 * 3) {
+    __m256i R0, R1, G0, G1, B0, B1;
+    YUV420ToRGB_AVX2(y +  0, u + 0, v + 0, &R0, &G0, &B0);
+    YUV420ToRGB_AVX2(y + 16, u + 8, v + 8, &R1, &G1, &B1);
+    PackAndStore3_AVX2(&R0, &G0, &B0, &R1, &G1, &B1, dst);
+    y += 32;
+    u += 16;
+    v += 16;
+  }
+  for (; n < len; ++n) {   // Finish off
+    VP8YuvToRgb(y[0], u[0], v[0], dst);
+    dst += 3;
+    y += 1;
+    u += (n & 1);
+    v += (n & 1);
+  }
+}
+
+static void YuvToBgrRow_AVX2(const uint8_t* y,
+                             const uint8_t* u, const uint8_t* v,
+                             uint8_t* dst, int len) {
+  int n;
+  for (n = 0; n + 32 <= len; n += 32, dst += 32 * 3) {
+    __m256i R0, R1, G0, G1, B0, B1;
+    YUV420ToRGB_AVX2(y +  0, u + 0, v + 0, &R0, &G0, &B0);
+    YUV420ToRGB_AVX2(y + 16, u + 8, v + 8, &R1, &G1, &B1);
+    PackAndStore3_AVX2(&B0, &G0, &R0, &B1, &G1, &R1, dst);
+    y += 32;
+    u += 16;
+    v += 16;
+  }
+  for (; n < len; ++n) {   // Finish off
+    VP8YuvToBgr(y[0], u[0], v[0], dst);
+    dst += 3;
+    y += 1;
+    u += (n & 1);
+    v += (n & 1);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void WebPInitSamplersAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPInitSamplersAVX2(void) {
+  WebPSamplers[MODE_RGB]  = YuvToRgbRow_AVX2;
+  WebPSamplers[MODE_RGBA] = YuvToRgbaRow_AVX2;
+  WebPSamplers[MODE_BGR]  = YuvToBgrRow_AVX2;
+  WebPSamplers[MODE_BGRA] = YuvToBgraRow_AVX2;
+  WebPSamplers[MODE_ARGB] = YuvToArgbRow_AVX2;
+  WebPSamplers[MODE_rgbA] = YuvToRgbaRow_AVX2;
+  WebPSamplers[MODE_bgrA] = YuvToBgraRow_AVX2;
+  WebPSamplers[MODE_Argb] = YuvToArgbRow_AVX2;
+  WebPPremultipliedSamplers[MODE_rgbA] = YuvToRgbaPremulRow_AVX2;
+  WebPPremultipliedSamplers[MODE_bgrA] = YuvToBgraPremulRow_AVX2;
+  WebPPremultipliedSamplers[MODE_Argb] = YuvToArgbPremulRow_AVX2;
+}
+
+WEBP_AVX2_END
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(WebPInitSamplersAVX2)
+
+#endif  // WEBP_USE_AVX2
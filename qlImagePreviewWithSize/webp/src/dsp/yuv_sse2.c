@@ -101,6 +101,32 @@ static void YUV420ToRGB_SSE2(const uint8_t* const y,
   ConvertYUV444ToRGB_SSE2(&Y0, &U0, &V0, R, G, B);
 }
 
+// Load 8 alpha samples into 16b words.
+static WEBP_INLINE __m128i Load_A_8_SSE2(const uint8_t* src) {
+  const __m128i zero = _mm_setzero_si128();
+  return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)src), zero);
+}
+
+// Clip the R/G/B values to [0, 255] and multiply them by the alpha values,
+// using the same (v * a * 0x8081) >> 23 arithmetic as ApplyAlphaMultiply_SSE2.
+static WEBP_INLINE void MultAlpha_SSE2(const __m128i* const A,
+                                       __m128i* const R, __m128i* const G,
+                                       __m128i* const B) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i max = _mm_set1_epi16(255);
+  const __m128i kMult = _mm_set1_epi16((short)0x8081u);
+  const __m128i R0 = _mm_min_epi16(_mm_max_epi16(*R, zero), max);
+  const __m128i G0 = _mm_min_epi16(_mm_max_epi16(*G, zero), max);
+  const __m128i B0 = _mm_min_epi16(_mm_max_epi16(*B, zero), max);
+  // the products v * a fit in 16 bits
+  const __m128i R1 = _mm_mulhi_epu16(_mm_mullo_epi16(R0, *A), kMult);
+  const __m128i G1 = _mm_mulhi_epu16(_mm_mullo_epi16(G0, *A), kMult);
+  const __m128i B1 = _mm_mulhi_epu16(_mm_mullo_epi16(B0, *A), kMult);
+  *R = _mm_srli_epi16(R1, 7);
+  *G = _mm_srli_epi16(G1, 7);
+  *B = _mm_srli_epi16(B1, 7);
+}
+
 // Pack R/G/B/A results into 32b output.
 static WEBP_INLINE void PackAndStore4_SSE2(const __m128i* const R,
                                            const __m128i* const G,
@@ -223,6 +249,25 @@ void VP8YuvToArgb32_SSE2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
   }
 }
 
+#define PREMUL_32_FUNC(FUNC_NAME, C0, C1, C2, C3)                              \
+void FUNC_NAME(const uint8_t* y, const uint8_t* u, const uint8_t* v,           \
+               const uint8_t* a, uint8_t* dst) {                               \
+  int n;                                                                       \
+  for (n = 0; n < 32; n += 8, dst += 32) {                                     \
+    const __m128i A = Load_A_8_SSE2(a + n);                                    \
+    __m128i R, G, B;                                                           \
+    YUV444ToRGB_SSE2(y + n, u + n, v + n, &R, &G, &B);                         \
+    MultAlpha_SSE2(&A, &R, &G, &B);                                            \
+    PackAndStore4_SSE2(&(C0), &(C1), &(C2), &(C3), dst);                       \
+  }                                                                            \
+}
+
+PREMUL_32_FUNC(VP8YuvToRgbaPremul32_SSE2, R, G, B, A)
+PREMUL_32_FUNC(VP8YuvToBgraPremul32_SSE2, B, G, R, A)
+PREMUL_32_FUNC(VP8YuvToArgbPremul32_SSE2, A, R, G, B)
+
+#undef PREMUL_32_FUNC
+
 void VP8YuvToRgba444432_SSE2(const uint8_t* y, const uint8_t* u,
                              const uint8_t* v, uint8_t* dst) {
   const __m128i kAlpha = _mm_set1_epi16(255);
@@ -357,6 +402,38 @@ static void YuvToArgbRow_SSE2(const uint8_t* y,
   }
 }
 
+#define PREMUL_ROW_FUNC(FUNC_NAME, FUNC, C0, C1, C2, C3)                       \
+static void FUNC_NAME(const uint8_t* y,                                        \
+                      const uint8_t* u, const uint8_t* v,                      \
+                      const uint8_t* a, uint8_t* dst, int len) {               \
+  int n;                                                                       \
+  for (n = 0; n + 8 <= len; n += 8, dst += 32) {                               \
+    const __m128i A = Load_A_8_SSE2(a);                                        \
+    __m128i R, G, B;                                                           \
+    YUV420ToRGB_SSE2(y, u, v, &R, &G, &B);                                     \
+    MultAlpha_SSE2(&A, &R, &G, &B);                                            \
+    PackAndStore4_SSE2(&(C0), &(C1), &(C2), &(C3), dst);                       \
+    y += 8;                                                                    \
+    a += 8;                                                                    \
+    u += 4;                                                                    \
+    v += 4;                                                                    \
+  }                                                                            \
+  for (; n < len; ++n) {   /* Finish off */                                    \
+    FUNC(y[0], u[0], v[0], a[0], dst);                                         \
+    dst += 4;                                                                  \
+    y += 1;                                                                    \
+    a += 1;                                                                    \
+    u += (n & 1);                                                              \
+    v += (n & 1);                                                              \
+  }                                                                            \
+}
+
+PREMUL_ROW_FUNC(YuvToRgbaPremulRow_SSE2, VP8YuvToRgbaPremul, R, G, B, A)
+PREMUL_ROW_FUNC(YuvToBgraPremulRow_SSE2, VP8YuvToBgraPremul, B, G, R, A)
+PREMUL_ROW_FUNC(YuvToArgbPremulRow_SSE2, VP8YuvToArgbPremul, A, R, G, B)
+
+#undef PREMUL_ROW_FUNC
+
 static void YuvToRgbRow_SSE2(const uint8_t* y,
                              const uint8_t* u, const uint8_t* v,
                              uint8_t* dst, int len) {
@@ -442,6 +519,9 @@ WEBP_TSAN_IGNORE_FUNCTION void WebPInitSamplersSSE2(void) {
   WebPSamplers[MODE_BGR]  = YuvToBgrRow_SSE2;
   WebPSamplers[MODE_BGRA] = YuvToBgraRow_SSE2;
   WebPSamplers[MODE_ARGB] = YuvToArgbRow_SSE2;
+  WebPPremultipliedSamplers[MODE_rgbA] = YuvToRgbaPremulRow_SSE2;
+  WebPPremultipliedSamplers[MODE_bgrA] = YuvToBgraPremulRow_SSE2;
+  WebPPremultipliedSamplers[MODE_Argb] = YuvToArgbPremulRow_SSE2;
 }
 
 //------------------------------------------------------------------------------
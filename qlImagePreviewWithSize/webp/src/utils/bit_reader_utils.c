@@ -18,6 +18,78 @@
 #include "src/utils/bit_reader_inl_utils.h"
 #include "src/utils/utils.h"
 
+//------------------------------------------------------------------------------
+// VP8SegmentedInput
+
+void VP8InitSegmentedInput(VP8SegmentedInput* const input) {
+  memset(input, 0, sizeof(*input));
+}
+
+void VP8ClearSegmentedInput(VP8SegmentedInput* const input) {
+  WebPSafeFree(input->segments_);
+  VP8InitSegmentedInput(input);
+}
+
+int VP8SegmentedInputAppend(VP8SegmentedInput* const input,
+                            const uint8_t* const buf, size_t size) {
+  VP8InputSegment* segment;
+  if (size == 0) return 1;
+  if (input->num_segments_ == input->max_segments_) {
+    const int new_max = (input->max_segments_ > 0) ? 2 * input->max_segments_
+                                                   : 16;
+    VP8InputSegment* const new_segments = (VP8InputSegment*)
+        WebPSafeMalloc((uint64_t)new_max, sizeof(*new_segments));
+    if (new_segments == NULL) return 0;
+    if (input->num_segments_ > 0) {
+      memcpy(new_segments, input->segments_,
+             input->num_segments_ * sizeof(*new_segments));
+    }
+    WebPSafeFree(input->segments_);
+    input->segments_ = new_segments;
+    input->max_segments_ = new_max;
+  }
+  segment = &input->segments_[input->num_segments_++];
+  segment->buf_ = buf;
+  segment->size_ = size;
+  segment->offset_ = input->size_;
+  input->size_ += size;
+  return 1;
+}
+
+// Returns the index of the segment holding the byte at 'offset', or the last
+// segment if 'offset' is the end of the input.
+static int FindSegment(const VP8SegmentedInput* const input, uint64_t offset) {
+  int lo = 0, hi = input->num_segments_ - 1;
+  assert(input->num_segments_ > 0 && offset <= input->size_);
+  while (lo < hi) {
+    const int mid = (lo + hi + 1) >> 1;
+    if (input->segments_[mid].offset_ <= offset) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+size_t VP8SegmentedInputCopy(const VP8SegmentedInput* const input,
+                             uint64_t offset, uint8_t* dst, size_t size) {
+  size_t copied = 0;
+  int i;
+  if (offset >= input->size_) return 0;
+  for (i = FindSegment(input, offset);
+       i < input->num_segments_ && copied < size; ++i) {
+    const VP8InputSegment* const segment = &input->segments_[i];
+    const size_t skip = (size_t)(offset - segment->offset_);
+    size_t len = segment->size_ - skip;
+    if (len > size - copied) len = size - copied;
+    memcpy(dst + copied, segment->buf_ + skip, len);
+    copied += len;
+    offset += len;
+  }
+  return copied;
+}
+
 //------------------------------------------------------------------------------
 // VP8BitReader
 
@@ -31,11 +103,8 @@ void VP8BitReaderSetBuffer(VP8BitReader* const br,
                                : start;
 }
 
-void VP8InitBitReader(VP8BitReader* const br,
-                      const uint8_t* const start, size_t size) {
-  assert(br != NULL);
-  assert(start != NULL);
-  assert(size < (1u << 31));   // limit ensured by format and upstream checks
+static void InitBoolDecoder(VP8BitReader* const br,
+                            const uint8_t* const start, size_t size) {
   br->range_   = 255 - 1;
   br->value_   = 0;
   br->bits_    = -8;   // to load the very first 8bits
@@ -44,6 +113,53 @@ void VP8InitBitReader(VP8BitReader* const br,
   VP8LoadNewBytes(br);
 }
 
+void VP8InitBitReader(VP8BitReader* const br,
+                      const uint8_t* const start, size_t size) {
+  assert(br != NULL);
+  assert(start != NULL);
+  assert(size < (1u << 31));   // limit ensured by format and upstream checks
+  br->input_ = NULL;
+  InitBoolDecoder(br, start, size);
+}
+
+// Sets the buffer to the part of the segment 'segment_' before 'end_'.
+static void SetSegmentBuffer(VP8BitReader* const br, uint64_t start) {
+  const VP8InputSegment* const segment = &br->input_->segments_[br->segment_];
+  const uint64_t end = segment->offset_ + segment->size_;
+  const size_t skip = (size_t)(start - segment->offset_);
+  VP8BitReaderSetBuffer(br, segment->buf_ + skip,
+                        (size_t)((end < br->end_ ? end : br->end_) - start));
+}
+
+void VP8InitBitReaderAt(VP8BitReader* const br,
+                        const VP8SegmentedInput* const input,
+                        uint64_t start, uint64_t end) {
+  assert(br != NULL);
+  assert(input != NULL && input->num_segments_ > 0);
+  assert(start <= end && start <= input->size_);
+  br->input_ = input;
+  br->segment_ = FindSegment(input, start);
+  br->end_ = end;
+  br->range_ = 255 - 1;
+  br->value_ = 0;
+  br->bits_ = -8;
+  br->eof_ = 0;
+  SetSegmentBuffer(br, start);
+  VP8LoadNewBytes(br);
+}
+
+// Moves to the next segment of the input, if any. Returns false otherwise.
+static int NextSegment(VP8BitReader* const br) {
+  const VP8SegmentedInput* const input = br->input_;
+  if (input == NULL || br->segment_ + 1 >= input->num_segments_ ||
+      input->segments_[br->segment_ + 1].offset_ >= br->end_) {
+    return 0;
+  }
+  ++br->segment_;
+  SetSegmentBuffer(br, input->segments_[br->segment_].offset_);
+  return 1;
+}
+
 void VP8RemapBitReader(VP8BitReader* const br, ptrdiff_t offset) {
   if (br->buf_ != NULL) {
     br->buf_ += offset;
@@ -87,7 +203,7 @@ const uint8_t kVP8NewRange[128] = {
 void VP8LoadFinalBytes(VP8BitReader* const br) {
   assert(br != NULL && br->buf_ != NULL);
   // Only read 8bits at a time
-  if (br->buf_ < br->buf_end_) {
+  if (br->buf_ < br->buf_end_ || NextSegment(br)) {
     br->bits_ += 8;
     br->value_ = (bit_t)(*br->buf_++) | (br->value_ << 8);
   } else if (!br->eof_) {
@@ -159,6 +275,7 @@ void VP8LInitBitReader(VP8LBitReader* const br, const uint8_t* const start,
   br->val_ = value;
   br->pos_ = length;
   br->buf_ = start;
+  br->input_ = NULL;
 }
 
 void VP8LBitReaderSetBuffer(VP8LBitReader* const br,
@@ -177,9 +294,21 @@ static void VP8LSetEndOfStream(VP8LBitReader* const br) {
   br->bit_pos_ = 0;  // To avoid undefined behaviour with shifts.
 }
 
+// Moves to the next segment of the input, if any. Returns false otherwise.
+static int NextLSegment(VP8LBitReader* const br) {
+  const VP8SegmentedInput* const input = br->input_;
+  const VP8InputSegment* segment;
+  if (input == NULL || br->segment_ + 1 >= input->num_segments_) return 0;
+  segment = &input->segments_[++br->segment_];
+  br->buf_ = segment->buf_;
+  br->len_ = segment->size_;
+  br->pos_ = 0;
+  return 1;
+}
+
 // If not at EOS, reload up to VP8L_LBITS byte-by-byte
 static void ShiftBytes(VP8LBitReader* const br) {
-  while (br->bit_pos_ >= 8 && br->pos_ < br->len_) {
+  while (br->bit_pos_ >= 8 && (br->pos_ < br->len_ || NextLSegment(br))) {
     br->val_ >>= 8;
     br->val_ |= ((vp8l_val_t)br->buf_[br->pos_]) << (VP8L_LBITS - 8);
     ++br->pos_;
@@ -190,6 +319,36 @@ static void ShiftBytes(VP8LBitReader* const br) {
   }
 }
 
+void VP8LInitBitReaderAt(VP8LBitReader* const br,
+                         const VP8SegmentedInput* const input,
+                         uint64_t start) {
+  const VP8InputSegment* segment;
+  size_t skip;
+  assert(br != NULL);
+  assert(input != NULL && input->num_segments_ > 0);
+  assert(start <= input->size_);
+  br->input_ = input;
+  br->segment_ = FindSegment(input, start);
+  segment = &input->segments_[br->segment_];
+  skip = (size_t)(start - segment->offset_);
+  br->buf_ = segment->buf_ + skip;
+  br->len_ = segment->size_ - skip;
+  br->pos_ = 0;
+  br->val_ = 0;
+  br->eos_ = 0;
+  // Prefetch the first bytes, across segments if needed.
+  br->bit_pos_ = VP8L_LBITS;
+  ShiftBytes(br);
+}
+
+uint64_t VP8LBitReaderPosition(const VP8LBitReader* const br) {
+  if (br->input_ != NULL) {
+    const VP8InputSegment* const segment = &br->input_->segments_[br->segment_];
+    return segment->offset_ + (size_t)(br->buf_ - segment->buf_) + br->pos_;
+  }
+  return br->pos_;
+}
+
 void VP8LDoFillBitWindow(VP8LBitReader* const br) {
   assert(br->bit_pos_ >= VP8L_WBITS);
 #if defined(VP8L_USE_FAST_LOAD)
@@ -85,6 +85,36 @@ typedef uint32_t bit_t;
 
 typedef uint32_t range_t;
 
+//------------------------------------------------------------------------------
+// Input split in several buffers
+
+typedef struct {
+  const uint8_t* buf_;
+  size_t size_;           // always non-zero
+  uint64_t offset_;       // position of 'buf_' in the whole input
+} VP8InputSegment;
+
+// The bit readers only keep the address of this struct, so that segments can
+// be appended while reading. The segments themselves are not copied and must
+// stay valid.
+typedef struct VP8SegmentedInput {
+  VP8InputSegment* segments_;
+  int num_segments_;
+  int max_segments_;      // size of the 'segments_' array
+  uint64_t size_;         // total size of the input
+} VP8SegmentedInput;
+
+void VP8InitSegmentedInput(VP8SegmentedInput* const input);
+void VP8ClearSegmentedInput(VP8SegmentedInput* const input);
+// Appends 'size' bytes at 'buf' to the input. Returns false in case of memory
+// error.
+int VP8SegmentedInputAppend(VP8SegmentedInput* const input,
+                            const uint8_t* const buf, size_t size);
+// Copies up to 'size' bytes starting at position 'offset' of the input into
+// 'dst'. Returns the number of bytes copied.
+size_t VP8SegmentedInputCopy(const VP8SegmentedInput* const input,
+                             uint64_t offset, uint8_t* dst, size_t size);
+
 //------------------------------------------------------------------------------
 // Bitreader
 
@@ -99,11 +129,19 @@ struct VP8BitReader {
   const uint8_t* buf_end_;    // end of read buffer
   const uint8_t* buf_max_;    // max packed-read position on buffer
   int eof_;                   // true if input is exhausted
+  // segmented input, read further once buf_end_ is reached (or NULL)
+  const VP8SegmentedInput* input_;
+  int segment_;               // index of the segment in use
+  uint64_t end_;              // position where the data ends in 'input_'
 };
 
 // Initialize the bit reader and the boolean decoder.
 void VP8InitBitReader(VP8BitReader* const br,
                       const uint8_t* const start, size_t size);
+// Same, for reading the data of 'input' in the range [start, end).
+void VP8InitBitReaderAt(VP8BitReader* const br,
+                        const VP8SegmentedInput* const input,
+                        uint64_t start, uint64_t end);
 // Sets the working read buffer.
 void VP8BitReaderSetBuffer(VP8BitReader* const br,
                            const uint8_t* const start, size_t size);
@@ -144,11 +182,22 @@ typedef struct {
   size_t         pos_;        // byte position in buf_
   int            bit_pos_;    // current bit-reading position in val_
   int            eos_;        // true if a bit was read past the end of buffer
+  // segmented input, read further once len_ is reached (or NULL)
+  const VP8SegmentedInput* input_;
+  int            segment_;    // index of the segment in use
 } VP8LBitReader;
 
 void VP8LInitBitReader(VP8LBitReader* const br,
                        const uint8_t* const start,
                        size_t length);
+// Same, for reading the data of 'input' from position 'start' to its end,
+// including the segments appended later.
+void VP8LInitBitReaderAt(VP8LBitReader* const br,
+                         const VP8SegmentedInput* const input, uint64_t start);
+
+// Returns the position of the next byte to be loaded, counted from the start
+// of the buffer or of the segmented input.
+uint64_t VP8LBitReaderPosition(const VP8LBitReader* const br);
 
 //  Sets a new data buffer.
 void VP8LBitReaderSetBuffer(VP8LBitReader* const br,
@@ -22,9 +22,10 @@
 // bytes.
 #define MAX_HTREE_GROUPS    0x10000
 
-HTreeGroup* VP8LHtreeGroupsNew(int num_htree_groups) {
-  HTreeGroup* const htree_groups =
-      (HTreeGroup*)WebPSafeMalloc(num_htree_groups, sizeof(*htree_groups));
+HTreeGroup* VP8LHtreeGroupsNew(const WebPAllocator* const allocator,
+                               int num_htree_groups) {
+  HTreeGroup* const htree_groups = (HTreeGroup*)WebPAllocatorMalloc(
+      allocator, num_htree_groups, sizeof(*htree_groups));
   if (htree_groups == NULL) {
     return NULL;
   }
@@ -32,9 +33,10 @@ HTreeGroup* VP8LHtreeGroupsNew(int num_htree_groups) {
   return htree_groups;
 }
 
-void VP8LHtreeGroupsFree(HTreeGroup* const htree_groups) {
+void VP8LHtreeGroupsFree(const WebPAllocator* const allocator,
+                         HTreeGroup* const htree_groups) {
   if (htree_groups != NULL) {
-    WebPSafeFree(htree_groups);
+    WebPAllocatorFree(allocator, htree_groups);
   }
 }
 
@@ -67,11 +67,14 @@ struct HTreeGroup {
   HuffmanCode32 packed_table[HUFFMAN_PACKED_TABLE_SIZE];
 };
 
-// Creates the instance of HTreeGroup with specified number of tree-groups.
-HTreeGroup* VP8LHtreeGroupsNew(int num_htree_groups);
+// Creates the instance of HTreeGroup with specified number of tree-groups,
+// using 'allocator' (NULL for the default one).
+HTreeGroup* VP8LHtreeGroupsNew(const WebPAllocator* const allocator,
+                               int num_htree_groups);
 
 // Releases the memory allocated for HTreeGroup.
-void VP8LHtreeGroupsFree(HTreeGroup* const htree_groups);
+void VP8LHtreeGroupsFree(const WebPAllocator* const allocator,
+                         HTreeGroup* const htree_groups);
 
 // Builds Huffman lookup table assuming code lengths are in symbol order.
 // The 'code_lengths' is pre-allocated temporary memory buffer used for creating
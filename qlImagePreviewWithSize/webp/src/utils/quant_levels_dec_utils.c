@@ -18,6 +18,7 @@
 
 #include <string.h>   // for memset
 
+#include "src/dsp/dsp.h"
 #include "src/utils/utils.h"
 
 // #define USE_DITHERING   // uncomment to enable ordered dithering (not vital)
@@ -79,21 +80,9 @@ static WEBP_INLINE uint8_t clip_8b(int v) {
 
 // vertical accumulation
 static void VFilter(SmoothParams* const p) {
-  const uint8_t* src = p->src_;
   const int w = p->width_;
-  uint16_t* const cur = p->cur_;
-  const uint16_t* const top = p->top_;
-  uint16_t* const out = p->end_;
-  uint16_t sum = 0;               // all arithmetic is modulo 16bit
-  int x;
-
-  for (x = 0; x < w; ++x) {
-    uint16_t new_value;
-    sum += src[x];
-    new_value = top[x] + sum;
-    out[x] = new_value - cur[x];  // vertical sum of 'r' pixels.
-    cur[x] = new_value;
-  }
+  // vertical sum of 'r' pixels, in end_[].
+  WebPQuantLevelsVFilter(p->src_, p->top_, p->cur_, p->end_, w);
   // move input pointers one row down
   p->top_ = p->cur_;
   p->cur_ += w;
@@ -119,9 +108,9 @@ static void HFilter(SmoothParams* const p) {
     const uint16_t delta = in[x + r - 1] + in[r - x];
     out[x] = (delta * scale) >> FIX;
   }
-  for (; x < w - r; ++x) {     // bulk middle run
-    const uint16_t delta = in[x + r] - in[x - r - 1];
-    out[x] = (delta * scale) >> FIX;
+  if (x < w - r) {             // bulk middle run
+    WebPQuantLevelsHFilter(in + x, r, scale, out + x, w - r - x);
+    x = w - r;
   }
   for (; x < w; ++x) {         // right mirroring
     const uint16_t delta =
@@ -139,10 +128,11 @@ static void ApplyFilter(SmoothParams* const p) {
   const uint8_t* const dither = kOrderedDither[p->row_ % DSIZE];
 #endif
   uint8_t* const dst = p->dst_;
+  const int min = p->min_, max = p->max_;   // not aliased by dst[]
   int x;
   for (x = 0; x < w; ++x) {
     const int v = dst[x];
-    if (v < p->max_ && v > p->min_) {
+    if (v < max && v > min) {
       const int c = (v << DFIX) + correction[average[x] - (v << LFIX)];
 #if defined(USE_DITHERING)
       dst[x] = clip_8b(c + dither[x % DSIZE]);
@@ -184,17 +174,14 @@ static void CountLevels(SmoothParams* const p) {
   int i, j, last_level;
   uint8_t used_levels[256] = { 0 };
   const uint8_t* data = p->src_;
-  p->min_ = 255;
-  p->max_ = 0;
+  const int width = p->width_;
   for (j = 0; j < p->height_; ++j) {
-    for (i = 0; i < p->width_; ++i) {
-      const int v = data[i];
-      if (v < p->min_) p->min_ = v;
-      if (v > p->max_) p->max_ = v;
-      used_levels[v] = 1;
-    }
+    for (i = 0; i < width; ++i) used_levels[data[i]] = 1;
     data += p->stride_;
   }
+  // min and max levels
+  for (p->min_ = 0; !used_levels[p->min_]; ++p->min_) {}
+  for (p->max_ = 255; !used_levels[p->max_]; --p->max_) {}
   // Compute the mininum distance between two non-zero levels.
   p->min_level_dist_ = p->max_ - p->min_;
   last_level = -1;
@@ -273,6 +260,7 @@ int WebPDequantizeLevels(uint8_t* const data, int width, int height, int stride,
   if (radius > 0) {
     SmoothParams p;
     memset(&p, 0, sizeof(p));
+    VP8FiltersInit();
     if (!InitParams(data, width, height, stride, radius, &p)) return 0;
     if (p.num_levels_ > 2) {
       for (; p.row_ < p.height_; ++p.row_) {
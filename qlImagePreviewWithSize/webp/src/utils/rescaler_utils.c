@@ -36,6 +36,8 @@ void WebPRescalerInit(WebPRescaler* const wrk, int src_width, int src_height,
   wrk->dst = dst;
   wrk->dst_stride = dst_stride;
   wrk->num_channels = num_channels;
+  wrk->filter = WEBP_RESCALER_AREA;
+  wrk->linear_row = NULL;
 
   // for 'x_expand', we use bilinear interpolation
   wrk->x_add = wrk->x_expand ? (x_sub - 1) : x_add;
@@ -67,6 +69,18 @@ void WebPRescalerInit(WebPRescaler* const wrk, int src_width, int src_height,
     wrk->fy_scale = WEBP_RESCALER_FRAC(1, wrk->x_add);
     // wrk->fxy_scale is unused here.
   }
+  // When both ratios are integers, each output sample is the plain sum of a
+  // x_box * (src_height / dst_height) block: the rows are summed directly
+  // into 'irow', without fractional contributions. Since 'irow' then lacks
+  // the 'x_sub' factor, it is folded into 'fxy_scale', which keeps the
+  // output identical to the general case.
+  wrk->x_box = 0;
+  if (!wrk->x_expand && !wrk->y_expand && wrk->fxy_scale != 0 &&
+      src_width % dst_width == 0 && src_height % dst_height == 0 &&
+      (src_width / dst_width) * (src_height / dst_height) >= 2) {
+    wrk->x_box = src_width / dst_width;
+    wrk->fxy_scale *= wrk->x_sub;   // <= WEBP_RESCALER_ONE / 2, no overflow
+  }
   wrk->irow = work;
   wrk->frow = work + num_channels * dst_width;
   memset(work, 0, 2 * dst_width * num_channels * sizeof(*work));
@@ -74,6 +88,314 @@ void WebPRescalerInit(WebPRescaler* const wrk, int src_width, int src_height,
   WebPRescalerDspInit();
 }
 
+//------------------------------------------------------------------------------
+// Linear light
+
+// Conversions between the 8b samples and the WEBP_RESCALER_LINEAR_BITS linear
+// ones, for each WebPRescalerTransfer and for alpha (no transfer function).
+static uint16_t kSRGBToLinear[256];
+static uint16_t kLumaToLinear[256];
+static uint16_t kAlphaToLinear[256];
+static uint8_t kLinearToSRGB[WEBP_RESCALER_LINEAR_MAX + 1];
+static uint8_t kLinearToLuma[WEBP_RESCALER_LINEAR_MAX + 1];
+static uint8_t kLinearToAlpha[WEBP_RESCALER_LINEAR_MAX + 1];
+static volatile int kLinearTablesOk = 0;
+
+// Returns the n-th root of 'v' in [0..1], by Newton's method from above. The
+// iterations stop once rounding prevents the estimate from decreasing.
+static double Root(double v, int n) {
+  double y = 1., prev;
+  if (v <= 0.) return 0.;
+  do {
+    double p = 1.;   // y^(n - 1)
+    int i;
+    for (i = 1; i < n; ++i) p *= y;
+    prev = y;
+    y -= (p * y - v) / (n * p);
+  } while (y < prev);
+  return prev;
+}
+
+// sRGB transfer function, over [0..1]. The 2.4 and 1 / 2.4 exponents are
+// computed as 2 + 2 / 5 and 5 / 12, which avoids linking with libm.
+static double SRGBToLinear(double v) {
+  double t, r;
+  if (v <= 0.04045) return v / 12.92;
+  t = (v + 0.055) / 1.055;
+  r = Root(t, 5);
+  return t * t * r * r;
+}
+
+static double LinearToSRGB(double v) {
+  double r;
+  if (v <= 0.0031308) return 12.92 * v;
+  r = Root(v, 12);
+  return 1.055 * (r * r) * (r * r) * r - 0.055;
+}
+
+static WEBP_TSAN_IGNORE_FUNCTION void InitLinearTables(void) {
+  if (!kLinearTablesOk) {
+    const int max = WEBP_RESCALER_LINEAR_MAX;
+    int v;
+    for (v = 0; v <= 255; ++v) {
+      const double luma = (v <= 16) ? 0. : (v >= 235) ? 1. : (v - 16) / 219.;
+      kSRGBToLinear[v] = (uint16_t)(SRGBToLinear(v / 255.) * max + .5);
+      kLumaToLinear[v] = (uint16_t)(SRGBToLinear(luma) * max + .5);
+      kAlphaToLinear[v] = (uint16_t)((v * max + 127) / 255);
+    }
+    for (v = 0; v <= max; ++v) {
+      const double g = LinearToSRGB((double)v / max);
+      kLinearToSRGB[v] = (uint8_t)(255. * g + .5);
+      kLinearToLuma[v] = (uint8_t)(16. + 219. * g + .5);
+      kLinearToAlpha[v] = (uint8_t)((v * 255 + (max >> 1)) / max);
+    }
+    kLinearTablesOk = 1;
+  }
+}
+
+size_t WebPRescalerLinearWorkSize(int src_width, int num_channels) {
+  return (size_t)src_width * num_channels * sizeof(uint16_t);
+}
+
+int WebPRescalerInitLinear(WebPRescaler* const wrk,
+                           WebPRescalerTransfer transfer, int alpha_channel,
+                           void* const work) {
+  const int is_luma = (transfer == WEBP_RESCALER_LUMA);
+  int c;
+  // 'irow' accumulates up to x_add * (y_add / y_sub + 2) weighted samples.
+  if (wrk->filter != WEBP_RESCALER_AREA || wrk->x_expand || wrk->y_expand ||
+      wrk->fxy_scale == 0 || wrk->num_channels > 4 ||
+      (uint64_t)WEBP_RESCALER_LINEAR_MAX * wrk->x_add *
+          (wrk->y_add / wrk->y_sub + 2) >= (1ull << 32)) {
+    return 0;
+  }
+  InitLinearTables();
+  if (wrk->x_box > 0) {   // Undo the integer-ratio setup of WebPRescalerInit().
+    wrk->fxy_scale /= wrk->x_sub;
+    wrk->x_box = 0;
+  }
+  wrk->linear_row = (uint16_t*)work;
+  for (c = 0; c < wrk->num_channels; ++c) {
+    const int is_alpha = (c == alpha_channel);
+    wrk->to_linear[c] = is_alpha ? kAlphaToLinear
+                      : is_luma ? kLumaToLinear : kSRGBToLinear;
+    wrk->from_linear[c] = is_alpha ? kLinearToAlpha
+                        : is_luma ? kLinearToLuma : kLinearToSRGB;
+  }
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+// Separable filters
+
+// Support (half-width) of the kernels, in units of input samples.
+static double FilterSupport(WebPRescalerFilter filter) {
+  switch (filter) {
+    case WEBP_RESCALER_BOX: return 0.5;
+    case WEBP_RESCALER_BILINEAR: return 1.;
+    default: return 3.;   // WEBP_RESCALER_LANCZOS3
+  }
+}
+
+// Same as floor(v) and ceil(v), for 'v' in the int range.
+static int FloorToInt(double v) {
+  const int i = (int)v;
+  return (v < i) ? i - 1 : i;
+}
+
+static int CeilToInt(double v) {
+  const int i = (int)v;
+  return (v > i) ? i + 1 : i;
+}
+
+// Returns sin(pi * x) / (pi * x). The sine is computed from the Taylor series
+// of sin(pi * r), with 'r' the distance from 'x' to the nearest integer: for
+// |r| <= 1/2, the terms past the 17th power are below 1e-13.
+static double Sinc(double x) {
+  const double pi = 3.14159265358979323846;
+  const int k = (int)((x < 0.) ? x - 0.5 : x + 0.5);
+  const double r = pi * (x - k);
+  const double r2 = r * r;
+  double s = 1.;
+  int n;
+  if (x == 0.) return 1.;
+  for (n = 16; n >= 2; n -= 2) s = 1. - s * r2 / (n * (n + 1));
+  s *= r;
+  return ((k & 1) ? -s : s) / (pi * x);
+}
+
+static double FilterValue(WebPRescalerFilter filter, double x) {
+  switch (filter) {
+    case WEBP_RESCALER_BOX:
+      return (x > -0.5 && x <= 0.5) ? 1. : 0.;
+    case WEBP_RESCALER_BILINEAR:
+      if (x < 0.) x = -x;
+      return (x < 1.) ? 1. - x : 0.;
+    default:   // WEBP_RESCALER_LANCZOS3
+      return (x > -3. && x < 3.) ? Sinc(x) * Sinc(x / 3.) : 0.;
+  }
+}
+
+// When downscaling, the kernel is stretched over 'src_size / dst_size'.
+static double FilterScale(int src_size, int dst_size) {
+  const double scale = (double)src_size / dst_size;
+  return (scale > 1.) ? scale : 1.;
+}
+
+// Largest number of input samples contributing to one output sample.
+static int FilterNumTaps(WebPRescalerFilter filter,
+                         int src_size, int dst_size) {
+  const double support =
+      FilterSupport(filter) * FilterScale(src_size, dst_size);
+  const int num_taps = 2 * CeilToInt(support) + 1;
+  return (num_taps > src_size) ? src_size : num_taps;
+}
+
+// The number of taps is padded for the SIMD implementations: to a multiple of
+// 8 (single channel) or 4 (interleaved channels) horizontally, and to an even
+// number vertically. The extra taps have zero weights.
+static int PaddedXTaps(int num_taps, int num_channels) {
+  const int align = (num_channels == 1) ? 8 : 4;
+  return (num_taps + align - 1) & ~(align - 1);
+}
+
+static int PaddedYTaps(int num_taps) {
+  return (num_taps + 1) & ~1;
+}
+
+// Fills 'start', 'end' (if not NULL) and the 'num_taps' weights of each
+// output sample, with WEBP_RESCALER_WFIX precision. Each set of weights sums
+// to exactly 1 << WEBP_RESCALER_WFIX. Returns the largest 'end - start'.
+static int ComputeFilterWeights(WebPRescalerFilter filter,
+                                int src_size, int dst_size,
+                                int num_taps, int* const start,
+                                int* const end, int16_t* weights) {
+  const double scale = (double)src_size / dst_size;
+  const double filter_scale = FilterScale(src_size, dst_size);
+  const double support = FilterSupport(filter) * filter_scale;
+  int max_count = 0;
+  int i, j;
+  for (i = 0; i < dst_size; ++i, weights += num_taps) {
+    const double center = (i + 0.5) * scale;
+    int first = FloorToInt(center - support + 0.5);
+    int last = FloorToInt(center + support + 0.5);   // excluded
+    double sum = 0.;
+    int isum = 0, best = 0;
+    if (first < 0) first = 0;
+    if (last > src_size) last = src_size;
+    if (last - first > num_taps) last = first + num_taps;
+    assert(first < last);
+    for (j = first; j < last; ++j) {
+      sum += FilterValue(filter, (j + 0.5 - center) / filter_scale);
+    }
+    memset(weights, 0, num_taps * sizeof(*weights));
+    for (j = first; j < last; ++j) {
+      const double v = FilterValue(filter, (j + 0.5 - center) / filter_scale);
+      const int k = j - first;
+      weights[k] = (sum != 0.) ?
+          (int16_t)FloorToInt(v / sum * (1 << WEBP_RESCALER_WFIX) + 0.5) : 0;
+      isum += weights[k];
+      if (weights[k] > weights[best]) best = k;
+    }
+    // Leave the rounding error to the largest weight.
+    weights[best] += (1 << WEBP_RESCALER_WFIX) - isum;
+    start[i] = first;
+    if (end != NULL) end[i] = last;
+    if (last - first > max_count) max_count = last - first;
+  }
+  return max_count;
+}
+
+// Extra rows of the ring buffer, for WebPRescalerImportAhead().
+#define FILTER_LOOKAHEAD 4
+
+// Sizes of the work area sections, rounded to keep them 8b-aligned.
+#define FILTER_SIZE(N, T) ((((size_t)(N) * sizeof(T)) + 7) & ~(size_t)7)
+
+size_t WebPRescalerFilterWorkSize(int src_width, int src_height,
+                                  int dst_width, int dst_height,
+                                  int num_channels, WebPRescalerFilter filter) {
+  if (filter == WEBP_RESCALER_AREA) {
+    return FILTER_SIZE(2 * dst_width * num_channels, rescaler_t);
+  } else {
+    const int num_x_taps = FilterNumTaps(filter, src_width, dst_width);
+    const int num_y_taps = FilterNumTaps(filter, src_height, dst_height);
+    const int x_taps = PaddedXTaps(num_x_taps, num_channels);
+    const int y_taps = PaddedYTaps(num_y_taps);
+    return FILTER_SIZE(y_taps, int16_t*) +
+           FILTER_SIZE(dst_width + 2 * dst_height, int) +
+           FILTER_SIZE((size_t)dst_width * x_taps, int16_t) +
+           FILTER_SIZE((size_t)dst_height * y_taps, int16_t) +
+           FILTER_SIZE((size_t)(num_y_taps + FILTER_LOOKAHEAD) *
+                           dst_width * num_channels, int16_t) +
+           FILTER_SIZE((size_t)(src_width + x_taps) * num_channels, uint8_t);
+  }
+}
+
+void WebPRescalerInitFilter(WebPRescaler* const wrk,
+                            int src_width, int src_height,
+                            uint8_t* const dst,
+                            int dst_width, int dst_height, int dst_stride,
+                            int num_channels, WebPRescalerFilter filter,
+                            void* const work) {
+  const int num_x_taps = FilterNumTaps(filter, src_width, dst_width);
+  const int num_y_taps = FilterNumTaps(filter, src_height, dst_height);
+  uint8_t* mem = (uint8_t*)work;
+  int* x_start;
+  int* y_start;
+  int* y_end;
+  int16_t* x_weights;
+  int16_t* y_weights;
+
+  WebPRescalerInit(wrk, src_width, src_height, dst, dst_width, dst_height,
+                   dst_stride, num_channels, (rescaler_t*)work);
+  if (filter == WEBP_RESCALER_AREA) return;
+
+  wrk->filter = filter;
+  wrk->irow = wrk->frow = NULL;
+  wrk->x_taps = PaddedXTaps(num_x_taps, num_channels);
+  wrk->y_taps = PaddedYTaps(num_y_taps);
+
+  wrk->y_rows = (const int16_t**)mem;
+  mem += FILTER_SIZE(wrk->y_taps, int16_t*);
+  x_start = (int*)mem;
+  y_start = x_start + dst_width;
+  y_end = y_start + dst_height;
+  mem += FILTER_SIZE(dst_width + 2 * dst_height, int);
+  x_weights = (int16_t*)mem;
+  mem += FILTER_SIZE((size_t)dst_width * wrk->x_taps, int16_t);
+  y_weights = (int16_t*)mem;
+  mem += FILTER_SIZE((size_t)dst_height * wrk->y_taps, int16_t);
+  wrk->rows = (int16_t*)mem;
+  mem += FILTER_SIZE((size_t)(num_y_taps + FILTER_LOOKAHEAD) *
+                         dst_width * num_channels, int16_t);
+  wrk->src_row = mem;
+
+  ComputeFilterWeights(filter, src_width, dst_width, wrk->x_taps,
+                       x_start, NULL, x_weights);
+  wrk->y_ring = ComputeFilterWeights(filter, src_height, dst_height,
+                                     wrk->y_taps, y_start, y_end, y_weights) +
+                FILTER_LOOKAHEAD;
+  wrk->x_start = x_start;
+  wrk->y_start = y_start;
+  wrk->y_end = y_end;
+  wrk->x_weights = x_weights;
+  wrk->y_weights = y_weights;
+  // The padding taps read zeroes, or rows of the ring left over: clear it all.
+  memset(wrk->rows, 0,
+         (size_t)wrk->y_ring * dst_width * num_channels * sizeof(*wrk->rows));
+  memset(wrk->src_row, 0,
+         (size_t)(src_width + wrk->x_taps) * num_channels);
+  // 'y_accum' is the number of input rows still needed.
+  wrk->y_sub = 1;
+  wrk->y_accum = y_end[0];
+}
+
+#undef FILTER_SIZE
+#undef FILTER_LOOKAHEAD
+
+//------------------------------------------------------------------------------
+
 int WebPRescalerGetScaledDimensions(int src_width, int src_height,
                                     int* const scaled_width,
                                     int* const scaled_height) {
@@ -112,20 +434,50 @@ int WebPRescaleNeededLines(const WebPRescaler* const wrk, int max_num_lines) {
   return (num_lines > max_num_lines) ? max_num_lines : num_lines;
 }
 
+// Separable-filter mode import. With 'ahead', rows keep being imported as long
+// as they don't overwrite the ring buffer rows of the next output row.
+static int ImportFilterRows(WebPRescaler* const wrk, int num_lines,
+                            const uint8_t* src, int src_stride, int ahead) {
+  const size_t row_size = (size_t)wrk->src_width * wrk->num_channels;
+  int total_imported = 0;
+  while (total_imported < num_lines) {
+    if (!WebPRescalerOutputDone(wrk)) {   // otherwise, the row is just skipped
+      const int room =
+          ahead ? (wrk->src_y - wrk->y_start[wrk->dst_y] < wrk->y_ring)
+                : !WebPRescalerHasPendingOutput(wrk);
+      if (!room) break;
+      memcpy(wrk->src_row, src, row_size);
+      WebPRescalerImportRowFilter(wrk, wrk->src_row);
+    }
+    ++wrk->src_y;
+    src += src_stride;
+    ++total_imported;
+    --wrk->y_accum;
+  }
+  return total_imported;
+}
+
 int WebPRescalerImport(WebPRescaler* const wrk, int num_lines,
                        const uint8_t* src, int src_stride) {
   int total_imported = 0;
+  if (wrk->filter != WEBP_RESCALER_AREA) {
+    return ImportFilterRows(wrk, num_lines, src, src_stride, 0);
+  }
   while (total_imported < num_lines && !WebPRescalerHasPendingOutput(wrk)) {
     if (wrk->y_expand) {
       rescaler_t* const tmp = wrk->irow;
       wrk->irow = wrk->frow;
       wrk->frow = tmp;
     }
-    WebPRescalerImportRow(wrk, src);
-    if (!wrk->y_expand) {     // Accumulate the contribution of the new row.
-      int x;
-      for (x = 0; x < wrk->num_channels * wrk->dst_width; ++x) {
-        wrk->irow[x] += wrk->frow[x];
+    if (wrk->x_box > 0) {     // The row is summed into 'irow' directly.
+      WebPRescalerImportRowBox(wrk, src);
+    } else {
+      WebPRescalerImportRow(wrk, src);
+      if (!wrk->y_expand) {   // Accumulate the contribution of the new row.
+        int x;
+        for (x = 0; x < wrk->num_channels * wrk->dst_width; ++x) {
+          wrk->irow[x] += wrk->frow[x];
+        }
       }
     }
     ++wrk->src_y;
@@ -136,6 +488,14 @@ int WebPRescalerImport(WebPRescaler* const wrk, int num_lines,
   return total_imported;
 }
 
+int WebPRescalerImportAhead(WebPRescaler* const wrk, int num_lines,
+                            const uint8_t* src, int src_stride) {
+  if (wrk->filter == WEBP_RESCALER_AREA) {
+    return WebPRescalerImport(wrk, num_lines, src, src_stride);
+  }
+  return ImportFilterRows(wrk, num_lines, src, src_stride, 1);
+}
+
 int WebPRescalerExport(WebPRescaler* const rescaler) {
   int total_exported = 0;
   while (WebPRescalerHasPendingOutput(rescaler)) {
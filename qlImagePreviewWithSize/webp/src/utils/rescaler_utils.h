@@ -25,6 +25,24 @@ extern "C" {
 #define WEBP_RESCALER_FRAC(x, y) \
     ((uint32_t)(((uint64_t)(x) << WEBP_RESCALER_RFIX) / (y)))
 
+// Linear-light mode: precision of the linear samples.
+#define WEBP_RESCALER_LINEAR_BITS 12
+#define WEBP_RESCALER_LINEAR_MAX ((1 << WEBP_RESCALER_LINEAR_BITS) - 1)
+
+// Fixed-point precisions of the separable-filter mode: weights, and extra
+// bits kept in the horizontally filtered rows.
+#define WEBP_RESCALER_WFIX 14
+#define WEBP_RESCALER_HFIX 6
+
+// Kernels of the rescaler. The decoder maps the WEBP_SCALING_FILTER values
+// of the decoding options to these.
+typedef enum {
+  WEBP_RESCALER_AREA = 0,     // fixed-point area averaging
+  WEBP_RESCALER_BOX,          // separable box filter
+  WEBP_RESCALER_BILINEAR,     // separable triangle filter
+  WEBP_RESCALER_LANCZOS3      // separable 3-lobe Lanczos filter
+} WebPRescalerFilter;
+
 // Structure used for on-the-fly rescaling
 typedef uint32_t rescaler_t;   // type for side-buffer
 typedef struct WebPRescaler WebPRescaler;
@@ -38,14 +56,42 @@ struct WebPRescaler {
   int y_accum;                // vertical accumulator
   int y_add, y_sub;           // vertical increments
   int x_add, x_sub;           // horizontal increments
+  int x_box;                  // if not 0, integer-ratio shrink: number of
+                              // input columns summed per output column
   int src_width, src_height;  // source dimensions
   int dst_width, dst_height;  // destination dimensions
   int src_y, dst_y;           // row counters for input and output
   uint8_t* dst;
   int dst_stride;
   rescaler_t* irow, *frow;    // work buffer
+  // Separable-filter mode, when 'filter' is not WEBP_RESCALER_AREA. Then,
+  // only 'y_accum' (number of input rows still needed for the next output
+  // row) and 'y_sub' (1) are used among the area-averaging fields above.
+  WebPRescalerFilter filter;
+  int x_taps, y_taps;         // padded number of taps per output column / row
+  const int* x_start;         // first input column of each output column
+  const int* y_start, *y_end;  // range of input rows of each output row
+  const int16_t* x_weights;   // 'x_taps' weights per output column
+  const int16_t* y_weights;   // 'y_taps' weights per output row
+  const int16_t** y_rows;     // the 'y_taps' input rows of the current output
+  int16_t* rows;              // ring buffer of 'y_ring' filtered input rows
+  int y_ring;
+  uint8_t* src_row;           // zero-padded copy of the input row
+  // Linear-light mode, if 'linear_row' is not NULL. The input samples of each
+  // channel are converted with 'to_linear' before being accumulated, and the
+  // output ones back with 'from_linear'.
+  uint16_t* linear_row;       // src_width * num_channels linear samples
+  const uint16_t* to_linear[4];
+  const uint8_t* from_linear[4];
 };
 
+// Transfer functions of the samples, for WebPRescalerInitLinear().
+typedef enum {
+  WEBP_RESCALER_SRGB,         // sRGB-encoded R, G, B (full range)
+  WEBP_RESCALER_LUMA          // Y'CbCr luma, approximated as sRGB-encoded
+                              // luminance over the [16..235] range
+} WebPRescalerTransfer;
+
 // Initialize a rescaler given scratch area 'work' and dimensions of src & dst.
 void WebPRescalerInit(WebPRescaler* const rescaler,
                       int src_width, int src_height,
@@ -54,6 +100,39 @@ void WebPRescalerInit(WebPRescaler* const rescaler,
                       int num_channels,
                       rescaler_t* const work);
 
+// Returns the size in bytes of the 'work' area needed by
+// WebPRescalerInitFilter(), for the given dimensions and kernel.
+size_t WebPRescalerFilterWorkSize(int src_width, int src_height,
+                                  int dst_width, int dst_height,
+                                  int num_channels, WebPRescalerFilter filter);
+
+// Same as WebPRescalerInit(), using the kernel 'filter'. WEBP_RESCALER_AREA
+// selects the area-averaging scheme of WebPRescalerInit().
+// 'work' must be at least WebPRescalerFilterWorkSize() bytes, 8b-aligned.
+// Since these sizes are multiples of 8, several work areas can be carved
+// consecutively from a single allocation.
+void WebPRescalerInitFilter(WebPRescaler* const rescaler,
+                            int src_width, int src_height,
+                            uint8_t* const dst,
+                            int dst_width, int dst_height, int dst_stride,
+                            int num_channels, WebPRescalerFilter filter,
+                            void* const work);
+
+// Returns the size in bytes of the 'work' area needed by
+// WebPRescalerInitLinear().
+size_t WebPRescalerLinearWorkSize(int src_width, int num_channels);
+
+// Switches a rescaler initialized with WEBP_RESCALER_AREA to linear light:
+// the samples are averaged after removing their 'transfer' gamma, which
+// preserves the brightness of fine high-contrast details. 'alpha_channel' is
+// the index of a channel holding linear alpha values, or -1. The mode only
+// applies when shrinking in both directions, with ratios small enough for the
+// 32b accumulators. Returns false (and leaves the rescaler unchanged)
+// otherwise. 'work' must be at least WebPRescalerLinearWorkSize() bytes.
+int WebPRescalerInitLinear(WebPRescaler* const rescaler,
+                           WebPRescalerTransfer transfer, int alpha_channel,
+                           void* const work);
+
 // If either 'scaled_width' or 'scaled_height' (but not both) is 0 the value
 // will be calculated preserving the aspect ratio, otherwise the values are
 // left unmodified. Returns true on success, false if either value is 0 after
@@ -72,6 +151,13 @@ int WebPRescaleNeededLines(const WebPRescaler* const rescaler,
 int WebPRescalerImport(WebPRescaler* const rescaler, int num_rows,
                        const uint8_t* src, int src_stride);
 
+// Same as WebPRescalerImport(), except that in separable-filter mode the rows
+// keep being imported while the ring buffer has room, even if some output is
+// pending. This keeps rescalers of different input heights (luma and chroma,
+// e.g.) in step when their outputs are consumed together.
+int WebPRescalerImportAhead(WebPRescaler* const rescaler, int num_rows,
+                            const uint8_t* src, int src_stride);
+
 // Export as many rows as possible. Return the numbers of rows written.
 int WebPRescalerExport(WebPRescaler* const rescaler);
 
@@ -92,6 +178,14 @@ int WebPRescalerHasPendingOutput(const WebPRescaler* const rescaler) {
   return !WebPRescalerOutputDone(rescaler) && (rescaler->y_accum <= 0);
 }
 
+// Separable-filter mode: returns the ring buffer row holding input row 'y'.
+static WEBP_INLINE
+int16_t* WebPRescalerFilterRow(const WebPRescaler* const rescaler, int y) {
+  return rescaler->rows +
+         (size_t)(y % rescaler->y_ring) *
+             rescaler->dst_width * rescaler->num_channels;
+}
+
 //------------------------------------------------------------------------------
 
 #ifdef __cplusplus
@@ -194,9 +194,16 @@ static int pthread_cond_wait(pthread_cond_t* const condition,
   return !ok;
 }
 
+#define THREAD_ID DWORD
+#define GetCurrentThreadIdentifier() GetCurrentThreadId()
+#define SameThreadIdentifier(a, b) ((a) == (b))
+
 #else  // !_WIN32
 # define THREADFN void*
 # define THREAD_RETURN(val) val
+# define THREAD_ID pthread_t
+# define GetCurrentThreadIdentifier() pthread_self()
+# define SameThreadIdentifier(a, b) pthread_equal((a), (b))
 #endif  // _WIN32
 
 //------------------------------------------------------------------------------
@@ -345,6 +352,174 @@ static void End(WebPWorker* const worker) {
   assert(worker->status_ == NOT_OK);
 }
 
+//------------------------------------------------------------------------------
+// Worker pool: the work of all the workers is queued and run by a process-wide
+// set of threads, created on demand and never terminated.
+
+#ifdef WEBP_USE_THREAD
+
+#define MAX_POOL_THREADS 64
+
+typedef struct PooledWorkerImpl PooledWorkerImpl;
+struct PooledWorkerImpl {
+  pthread_cond_t condition_;   // signaled when the work is done
+  WebPWorker* worker_;
+  PooledWorkerImpl* next_;     // next pending work, if 'queued_'
+  int queued_;
+};
+
+static struct {
+  int initialized_;
+  pthread_mutex_t mutex_;      // guards all the fields below, and the
+                               // status_ of the pooled workers
+  pthread_cond_t condition_;   // signaled when work is queued
+  PooledWorkerImpl* head_;     // queue of pending work
+  PooledWorkerImpl* tail_;
+  int num_pending_;            // length of the queue
+  int num_idle_;               // number of threads waiting for work
+  int num_threads_;
+  int max_threads_;
+  pthread_t threads_[MAX_POOL_THREADS];
+} g_pool;
+
+static void PoolPush(PooledWorkerImpl* const impl) {
+  impl->next_ = NULL;
+  impl->queued_ = 1;
+  if (g_pool.tail_ != NULL) {
+    g_pool.tail_->next_ = impl;
+  } else {
+    g_pool.head_ = impl;
+  }
+  g_pool.tail_ = impl;
+  ++g_pool.num_pending_;
+}
+
+// Removes 'impl' from the queue of pending work.
+static void PoolRemove(PooledWorkerImpl* const impl) {
+  PooledWorkerImpl** prev = &g_pool.head_;
+  PooledWorkerImpl* last = NULL;
+  assert(impl->queued_);
+  while (*prev != impl) {
+    last = *prev;
+    prev = &last->next_;
+  }
+  *prev = impl->next_;
+  if (g_pool.tail_ == impl) g_pool.tail_ = last;
+  impl->queued_ = 0;
+  --g_pool.num_pending_;
+}
+
+static THREADFN PoolThreadLoop(void* ptr) {
+  (void)ptr;
+  pthread_mutex_lock(&g_pool.mutex_);
+  for (;;) {
+    PooledWorkerImpl* impl;
+    WebPWorker* worker;
+    while (g_pool.head_ == NULL) {
+      ++g_pool.num_idle_;
+      pthread_cond_wait(&g_pool.condition_, &g_pool.mutex_);
+      --g_pool.num_idle_;
+    }
+    impl = g_pool.head_;
+    worker = impl->worker_;
+    PoolRemove(impl);
+    pthread_mutex_unlock(&g_pool.mutex_);
+    WebPGetWorkerInterface()->Execute(worker);
+    pthread_mutex_lock(&g_pool.mutex_);
+    worker->status_ = OK;
+    // Signaled with the mutex held: the worker may be ended as soon as it is
+    // released.
+    pthread_cond_signal(&impl->condition_);
+  }
+  return THREAD_RETURN(NULL);    // never reached
+}
+
+// Waits for the work launched on 'worker', if any. Work no thread picked up
+// yet is run by the caller instead: a worker waiting for another one never
+// depends on a free pool thread, so the pool size can't cause a deadlock.
+static void PoolWait(WebPWorker* const worker) {
+  PooledWorkerImpl* const impl = (PooledWorkerImpl*)worker->impl_;
+  int run_here = 0;
+  if (impl == NULL) return;
+  pthread_mutex_lock(&g_pool.mutex_);
+  if (impl->queued_) {
+    PoolRemove(impl);
+    run_here = 1;
+  } else {
+    while (worker->status_ == WORK) {
+      pthread_cond_wait(&impl->condition_, &g_pool.mutex_);
+    }
+  }
+  pthread_mutex_unlock(&g_pool.mutex_);
+  if (run_here) {
+    WebPGetWorkerInterface()->Execute(worker);
+    worker->status_ = OK;
+  }
+}
+
+static int PoolSync(WebPWorker* const worker) {
+  PoolWait(worker);
+  assert(worker->status_ <= OK);
+  return !worker->had_error;
+}
+
+static int PoolReset(WebPWorker* const worker) {
+  int ok = 1;
+  worker->had_error = 0;
+  if (worker->status_ < OK) {
+    PooledWorkerImpl* const impl =
+        (PooledWorkerImpl*)WebPSafeCalloc(1, sizeof(*impl));
+    if (impl == NULL) return 0;
+    if (pthread_cond_init(&impl->condition_, NULL)) {
+      WebPSafeFree(impl);
+      return 0;
+    }
+    impl->worker_ = worker;
+    worker->impl_ = (void*)impl;
+    worker->status_ = OK;
+  } else if (worker->status_ > OK) {
+    ok = PoolSync(worker);
+  }
+  assert(!ok || (worker->status_ == OK));
+  return ok;
+}
+
+static void PoolLaunch(WebPWorker* const worker) {
+  PooledWorkerImpl* const impl = (PooledWorkerImpl*)worker->impl_;
+  if (impl == NULL) return;
+  PoolWait(worker);   // finish the previous work first
+  pthread_mutex_lock(&g_pool.mutex_);
+  worker->status_ = WORK;
+  PoolPush(impl);
+  if (g_pool.num_pending_ > g_pool.num_idle_ &&
+      g_pool.num_threads_ < g_pool.max_threads_) {
+    // On failure, the work will still be run by PoolWait().
+    if (!pthread_create(&g_pool.threads_[g_pool.num_threads_], NULL,
+                        PoolThreadLoop, NULL)) {
+      ++g_pool.num_threads_;
+    }
+  }
+  pthread_mutex_unlock(&g_pool.mutex_);
+  pthread_cond_signal(&g_pool.condition_);
+}
+
+static void PoolEnd(WebPWorker* const worker) {
+  PooledWorkerImpl* const impl = (PooledWorkerImpl*)worker->impl_;
+  if (impl != NULL) {
+    PoolWait(worker);
+    pthread_cond_destroy(&impl->condition_);
+    WebPSafeFree(impl);
+    worker->impl_ = NULL;
+  }
+  worker->status_ = NOT_OK;
+}
+
+static const WebPWorkerInterface kPoolInterface = {
+  Init, PoolReset, PoolSync, PoolLaunch, Execute, PoolEnd
+};
+
+#endif  // WEBP_USE_THREAD
+
 //------------------------------------------------------------------------------
 
 static WebPWorkerInterface g_worker_interface = {
@@ -366,4 +541,417 @@ const WebPWorkerInterface* WebPGetWorkerInterface(void) {
   return &g_worker_interface;
 }
 
+const WebPWorkerInterface* WebPGetWorkerPoolInterface(int max_threads) {
+#ifdef WEBP_USE_THREAD
+  if (!g_pool.initialized_) {
+    if (pthread_mutex_init(&g_pool.mutex_, NULL)) return NULL;
+    if (pthread_cond_init(&g_pool.condition_, NULL)) {
+      pthread_mutex_destroy(&g_pool.mutex_);
+      return NULL;
+    }
+    g_pool.initialized_ = 1;
+  }
+  if (max_threads < 1) max_threads = 1;
+  if (max_threads > MAX_POOL_THREADS) max_threads = MAX_POOL_THREADS;
+  pthread_mutex_lock(&g_pool.mutex_);
+  g_pool.max_threads_ = max_threads;
+  pthread_mutex_unlock(&g_pool.mutex_);
+  return &kPoolInterface;
+#else
+  static const WebPWorkerInterface kInterface = {
+    Init, Reset, Sync, Launch, Execute, End
+  };
+  (void)max_threads;
+  return &kInterface;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Task scheduler: each thread of the scheduler owns a deque of tasks. Tasks
+// are pushed and popped at the bottom of the deque of the thread creating them
+// (latest first, which is cache-friendly), while idle threads steal the oldest
+// tasks from the top of the other deques. The threads outside the scheduler
+// share an extra deque. Each deque has its own mutex, so that a thread working
+// on its own tasks doesn't contend with the others. A separate mutex is only
+// taken to put idle threads to sleep and to wake them up, and each group has
+// its own mutex for its count of pending tasks.
+
+#ifdef WEBP_USE_THREAD
+
+#define MAX_SCHEDULER_THREADS 64
+#define TASK_DEQUE_SIZE 256   // when the deque is full, tasks are run inline
+
+typedef struct TaskGroupImpl TaskGroupImpl;
+struct TaskGroupImpl {
+  pthread_mutex_t mutex_;      // guards the fields below
+  pthread_cond_t condition_;   // signaled when the last task is done
+  int pending_;                // number of tasks queued or running
+  int waiting_;                // true if a thread waits for 'condition_'
+  int had_error_;
+};
+
+typedef struct {
+  WebPWorkerHook hook_;
+  void* data1_;
+  void* data2_;
+  TaskGroupImpl* group_;
+} Task;
+
+typedef struct {
+  pthread_mutex_t mutex_;         // guards 'tasks_', 'top_' and 'size_'
+  Task tasks_[TASK_DEQUE_SIZE];   // circular buffer
+  int top_;                       // position of the oldest task
+  int size_;
+  pthread_t thread_;
+  THREAD_ID id_;                  // set once, before the scheduler is used
+} TaskDeque;
+
+struct WebPTaskScheduler {
+  pthread_mutex_t mutex_;     // guards the fields below, but not the deques
+  pthread_cond_t work_;       // signaled when a task is pushed, or to quit
+  pthread_cond_t started_;    // signaled when a thread has set its 'id_'
+  unsigned int num_pushed_;   // incremented (and wrapped) at each push
+  int num_idle_;              // number of threads waiting for 'work_'
+  int num_started_;
+  int quit_;
+  int num_threads_;           // constant once the threads are started
+  TaskDeque* deques_;         // [0] is shared by the threads outside of the
+                              // scheduler, [1..num_threads_] are owned
+};
+
+typedef struct {
+  WebPTaskScheduler* scheduler_;
+  int slot_;
+} TaskThreadArgs;
+
+// Returns the index of the deque owned by the calling thread.
+static int CurrentSlot(const WebPTaskScheduler* const s) {
+  const THREAD_ID self = GetCurrentThreadIdentifier();
+  int i;
+  for (i = 1; i <= s->num_threads_; ++i) {
+    if (SameThreadIdentifier(s->deques_[i].id_, self)) return i;
+  }
+  return 0;
+}
+
+// Returns false if the deque is full.
+static int PushTask(WebPTaskScheduler* const s, int slot,
+                    const Task* const task) {
+  TaskDeque* const dq = &s->deques_[slot];
+  pthread_mutex_lock(&dq->mutex_);
+  if (dq->size_ == TASK_DEQUE_SIZE) {
+    pthread_mutex_unlock(&dq->mutex_);
+    return 0;
+  }
+  dq->tasks_[(dq->top_ + dq->size_) % TASK_DEQUE_SIZE] = *task;
+  ++dq->size_;
+  pthread_mutex_unlock(&dq->mutex_);
+
+  pthread_mutex_lock(&s->mutex_);   // wake up an idle thread
+  ++s->num_pushed_;
+  if (s->num_idle_ > 0) pthread_cond_signal(&s->work_);
+  pthread_mutex_unlock(&s->mutex_);
+  return 1;
+}
+
+// Pops the latest task of the own deque, or steals the oldest task of another.
+static int TakeTask(WebPTaskScheduler* const s, int slot, Task* const task) {
+  const int num_deques = s->num_threads_ + 1;
+  int i;
+  for (i = 0; i < num_deques; ++i) {
+    TaskDeque* const dq = &s->deques_[(slot + i) % num_deques];
+    int found = 0;
+    pthread_mutex_lock(&dq->mutex_);
+    if (dq->size_ > 0) {
+      --dq->size_;
+      if (i == 0) {
+        *task = dq->tasks_[(dq->top_ + dq->size_) % TASK_DEQUE_SIZE];
+      } else {
+        *task = dq->tasks_[dq->top_];
+        dq->top_ = (dq->top_ + 1) % TASK_DEQUE_SIZE;
+      }
+      found = 1;
+    }
+    pthread_mutex_unlock(&dq->mutex_);
+    if (found) return 1;
+  }
+  return 0;
+}
+
+static void RunTask(const Task* const task) {
+  TaskGroupImpl* const group = task->group_;
+  const int ok = task->hook_(task->data1_, task->data2_);
+  pthread_mutex_lock(&group->mutex_);
+  group->had_error_ |= !ok;
+  if (--group->pending_ == 0 && group->waiting_) {
+    pthread_cond_signal(&group->condition_);
+  }
+  // 'group' may be released by its waiting thread from now on.
+  pthread_mutex_unlock(&group->mutex_);
+}
+
+static THREADFN TaskThreadLoop(void* ptr) {
+  TaskThreadArgs* const args = (TaskThreadArgs*)ptr;
+  WebPTaskScheduler* const s = args->scheduler_;
+  const int slot = args->slot_;
+  WebPSafeFree(args);
+  pthread_mutex_lock(&s->mutex_);
+  s->deques_[slot].id_ = GetCurrentThreadIdentifier();
+  ++s->num_started_;
+  pthread_cond_signal(&s->started_);
+  while (!s->quit_) {
+    // Any task pushed after this point changes 'num_pushed_', so that it
+    // can't be missed before going to sleep.
+    const unsigned int num_pushed = s->num_pushed_;
+    Task task;
+    pthread_mutex_unlock(&s->mutex_);
+    while (TakeTask(s, slot, &task)) RunTask(&task);
+    pthread_mutex_lock(&s->mutex_);
+    if (!s->quit_ && s->num_pushed_ == num_pushed) {
+      ++s->num_idle_;
+      pthread_cond_wait(&s->work_, &s->mutex_);
+      --s->num_idle_;
+    }
+  }
+  pthread_mutex_unlock(&s->mutex_);
+  return THREAD_RETURN(NULL);
+}
+
+// Stops the 'num_threads_' started threads and releases everything, of which
+// the first 'num_deques' deque mutexes were initialized.
+static void DeleteScheduler(WebPTaskScheduler* const s, int num_deques) {
+  int i;
+  pthread_mutex_lock(&s->mutex_);
+  s->quit_ = 1;
+  for (i = 0; i < s->num_threads_; ++i) {   // one signal per waiting thread
+    pthread_cond_signal(&s->work_);
+  }
+  pthread_mutex_unlock(&s->mutex_);
+  for (i = 1; i <= s->num_threads_; ++i) {
+    pthread_join(s->deques_[i].thread_, NULL);
+  }
+  for (i = 0; i < num_deques; ++i) {
+    assert(s->deques_[i].size_ == 0);
+    pthread_mutex_destroy(&s->deques_[i].mutex_);
+  }
+  pthread_cond_destroy(&s->started_);
+  pthread_cond_destroy(&s->work_);
+  pthread_mutex_destroy(&s->mutex_);
+  WebPSafeFree(s->deques_);
+  WebPSafeFree(s);
+}
+
+#endif  // WEBP_USE_THREAD
+
+WebPTaskScheduler* WebPTaskSchedulerNew(int num_threads) {
+#ifdef WEBP_USE_THREAD
+  WebPTaskScheduler* s;
+  int i;
+  if (num_threads < 1) return NULL;
+  if (num_threads > MAX_SCHEDULER_THREADS) num_threads = MAX_SCHEDULER_THREADS;
+  s = (WebPTaskScheduler*)WebPSafeCalloc(1, sizeof(*s));
+  if (s == NULL) return NULL;
+  s->deques_ = (TaskDeque*)WebPSafeCalloc(num_threads + 1, sizeof(*s->deques_));
+  if (s->deques_ == NULL) {
+    WebPSafeFree(s);
+    return NULL;
+  }
+  if (pthread_mutex_init(&s->mutex_, NULL)) goto Error0;
+  if (pthread_cond_init(&s->work_, NULL)) goto Error1;
+  if (pthread_cond_init(&s->started_, NULL)) goto Error2;
+  for (i = 0; i <= num_threads; ++i) {
+    if (pthread_mutex_init(&s->deques_[i].mutex_, NULL)) {
+      DeleteScheduler(s, i);
+      return NULL;
+    }
+  }
+  // The threads only start looking for tasks once 'num_threads_' is final.
+  pthread_mutex_lock(&s->mutex_);
+  for (i = 1; i <= num_threads; ++i) {
+    TaskThreadArgs* const args =
+        (TaskThreadArgs*)WebPSafeMalloc(1ULL, sizeof(*args));
+    if (args == NULL) break;
+    args->scheduler_ = s;
+    args->slot_ = i;
+    if (pthread_create(&s->deques_[i].thread_, NULL, TaskThreadLoop, args)) {
+      WebPSafeFree(args);
+      break;
+    }
+    ++s->num_threads_;
+  }
+  // Waits for all the thread identifiers, which CurrentSlot() reads without
+  // locking.
+  while (s->num_started_ < s->num_threads_) {
+    pthread_cond_wait(&s->started_, &s->mutex_);
+  }
+  pthread_mutex_unlock(&s->mutex_);
+  if (s->num_threads_ != num_threads) {
+    DeleteScheduler(s, num_threads + 1);
+    return NULL;
+  }
+  return s;
+
+ Error2:
+  pthread_cond_destroy(&s->work_);
+ Error1:
+  pthread_mutex_destroy(&s->mutex_);
+ Error0:
+  WebPSafeFree(s->deques_);
+  WebPSafeFree(s);
+  return NULL;
+#else
+  (void)num_threads;
+  return NULL;
+#endif
+}
+
+void WebPTaskSchedulerDelete(WebPTaskScheduler* const scheduler) {
+#ifdef WEBP_USE_THREAD
+  if (scheduler != NULL) {
+    DeleteScheduler(scheduler, scheduler->num_threads_ + 1);
+  }
+#else
+  (void)scheduler;
+#endif
+}
+
+int WebPTaskSchedulerNumThreads(const WebPTaskScheduler* const scheduler) {
+#ifdef WEBP_USE_THREAD
+  if (scheduler != NULL) return scheduler->num_threads_;
+#else
+  (void)scheduler;
+#endif
+  return 0;
+}
+
+int WebPTaskGroupInit(WebPTaskGroup* const group,
+                      WebPTaskScheduler* const scheduler) {
+  if (group == NULL) return 0;
+  memset(group, 0, sizeof(*group));
+#ifdef WEBP_USE_THREAD
+  if (scheduler != NULL) {
+    TaskGroupImpl* const impl =
+        (TaskGroupImpl*)WebPSafeCalloc(1, sizeof(*impl));
+    if (impl == NULL) return 0;
+    if (pthread_mutex_init(&impl->mutex_, NULL)) {
+      WebPSafeFree(impl);
+      return 0;
+    }
+    if (pthread_cond_init(&impl->condition_, NULL)) {
+      pthread_mutex_destroy(&impl->mutex_);
+      WebPSafeFree(impl);
+      return 0;
+    }
+    group->scheduler_ = scheduler;
+    group->impl_ = impl;
+  }
+#else
+  (void)scheduler;
+#endif
+  return 1;
+}
+
+void WebPTaskGroupRun(WebPTaskGroup* const group,
+                      WebPWorkerHook hook, void* data1, void* data2) {
+#ifdef WEBP_USE_THREAD
+  if (group->impl_ != NULL) {
+    WebPTaskScheduler* const s = group->scheduler_;
+    TaskGroupImpl* const impl = (TaskGroupImpl*)group->impl_;
+    Task task;
+    task.hook_ = hook;
+    task.data1_ = data1;
+    task.data2_ = data2;
+    task.group_ = impl;
+    // Counted before being pushed: another thread could run it right away.
+    pthread_mutex_lock(&impl->mutex_);
+    ++impl->pending_;
+    pthread_mutex_unlock(&impl->mutex_);
+    if (PushTask(s, CurrentSlot(s), &task)) return;
+    pthread_mutex_lock(&impl->mutex_);
+    --impl->pending_;
+    pthread_mutex_unlock(&impl->mutex_);
+  }
+#endif
+  group->had_error |= !hook(data1, data2);
+}
+
+int WebPTaskGroupWait(WebPTaskGroup* const group) {
+#ifdef WEBP_USE_THREAD
+  if (group->impl_ != NULL) {
+    WebPTaskScheduler* const s = group->scheduler_;
+    TaskGroupImpl* const impl = (TaskGroupImpl*)group->impl_;
+    const int slot = CurrentSlot(s);
+    pthread_mutex_lock(&impl->mutex_);
+    while (impl->pending_ > 0) {
+      // Help with any task rather than idling: the tasks of the group
+      // might be waiting in the calling thread's deque.
+      Task task;
+      int found;
+      pthread_mutex_unlock(&impl->mutex_);
+      found = TakeTask(s, slot, &task);
+      if (found) RunTask(&task);
+      pthread_mutex_lock(&impl->mutex_);
+      if (!found && impl->pending_ > 0) {
+        // The remaining tasks are being run by other threads.
+        impl->waiting_ = 1;
+        pthread_cond_wait(&impl->condition_, &impl->mutex_);
+      }
+    }
+    group->had_error |= impl->had_error_;
+    pthread_mutex_unlock(&impl->mutex_);
+    pthread_cond_destroy(&impl->condition_);
+    pthread_mutex_destroy(&impl->mutex_);
+    WebPSafeFree(impl);
+    group->impl_ = NULL;
+    group->scheduler_ = NULL;
+  }
+#endif
+  return !group->had_error;
+}
+
 //------------------------------------------------------------------------------
+// Parallel for
+
+typedef struct {
+  WebPBandHook hook_;
+  void* data_;
+  int start_, end_;
+} Band;
+
+static int BandHook(void* arg1, void* arg2) {
+  const Band* const band = (const Band*)arg1;
+  (void)arg2;
+  return band->hook_(band->data_, band->start_, band->end_);
+}
+
+int WebPParallelFor(WebPTaskScheduler* const scheduler, int start, int end,
+                    int grain, WebPBandHook hook, void* data) {
+  const int num_threads = WebPTaskSchedulerNumThreads(scheduler);
+  WebPTaskGroup group;
+  Band* bands;
+  int num_bands, i, ok;
+  if (start >= end) return 1;
+  if (grain <= 0) grain = (end - start + num_threads) / (num_threads + 1);
+  num_bands = (end - start + grain - 1) / grain;
+  if (num_threads == 0 || num_bands == 1) return hook(data, start, end);
+  bands = (Band*)WebPSafeMalloc(num_bands, sizeof(*bands));
+  if (bands == NULL) return hook(data, start, end);
+  if (!WebPTaskGroupInit(&group, scheduler)) {
+    WebPSafeFree(bands);
+    return hook(data, start, end);
+  }
+  for (i = 0; i < num_bands; ++i) {
+    bands[i].hook_ = hook;
+    bands[i].data_ = data;
+    bands[i].start_ = start + i * grain;
+    bands[i].end_ = (i + 1 < num_bands) ? bands[i].start_ + grain : end;
+  }
+  // The calling thread takes the first band, and then helps with the others.
+  for (i = num_bands - 1; i > 0; --i) {
+    WebPTaskGroupRun(&group, BandHook, &bands[i], NULL);
+  }
+  group.had_error |= !BandHook(&bands[0], NULL);
+  ok = WebPTaskGroupWait(&group);
+  WebPSafeFree(bands);
+  return ok;
+}
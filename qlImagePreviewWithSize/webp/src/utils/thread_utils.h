@@ -81,6 +81,69 @@ WEBP_EXTERN int WebPSetWorkerInterface(
 // Retrieve the currently set thread worker interface.
 WEBP_EXTERN const WebPWorkerInterface* WebPGetWorkerInterface(void);
 
+// Returns an interface running the work of all the workers on a process-wide
+// pool of at most 'max_threads' threads (clipped to [1, 64]), created on demand
+// and kept alive, so that Reset() and End() no longer create nor join a thread.
+// Work that no pool thread picked up yet is run by the thread calling Sync().
+// Meant to be installed with WebPSetWorkerInterface(). Calling it again only
+// changes the size limit. Like WebPSetWorkerInterface(), this function is not
+// thread-safe. Returns NULL in case of error.
+WEBP_EXTERN const WebPWorkerInterface* WebPGetWorkerPoolInterface(
+    int max_threads);
+
+//------------------------------------------------------------------------------
+// Fork/join task scheduler, for splitting a job over more than two threads.
+// Each thread of the scheduler runs its own tasks first and steals the tasks
+// of the others when idle. A thread waiting for a group of tasks runs pending
+// tasks meanwhile, so tasks may themselves create and wait for groups.
+// A NULL scheduler is valid and runs all the tasks in the calling thread.
+
+typedef struct WebPTaskScheduler WebPTaskScheduler;
+
+// Creates a scheduler with 'num_threads' threads (clipped to 64), in addition
+// to the calling thread. Returns NULL in case of error, if 'num_threads' is
+// less than 1 or if threads are not supported.
+WEBP_EXTERN WebPTaskScheduler* WebPTaskSchedulerNew(int num_threads);
+
+// Stops the threads and releases the scheduler. All its task groups must have
+// been waited for.
+WEBP_EXTERN void WebPTaskSchedulerDelete(WebPTaskScheduler* const scheduler);
+
+// Returns the number of threads of the scheduler (0 for a NULL scheduler).
+WEBP_EXTERN int WebPTaskSchedulerNumThreads(
+    const WebPTaskScheduler* const scheduler);
+
+// Set of tasks that can be waited for together.
+typedef struct {
+  WebPTaskScheduler* scheduler_;
+  void* impl_;            // implementation details
+  int had_error;          // true if a hook returned false
+} WebPTaskGroup;
+
+// Must be called before running tasks in 'group'. Returns false in case of
+// error.
+WEBP_EXTERN int WebPTaskGroupInit(WebPTaskGroup* const group,
+                                  WebPTaskScheduler* const scheduler);
+
+// Queues a call to hook(data1, data2), to be run by any thread of the
+// scheduler. The task is run immediately if it can't be queued.
+WEBP_EXTERN void WebPTaskGroupRun(WebPTaskGroup* const group,
+                                  WebPWorkerHook hook, void* data1, void* data2);
+
+// Waits for all the tasks of 'group' and releases it. WebPTaskGroupInit() must
+// be called again before reusing it. Returns false if any hook failed.
+WEBP_EXTERN int WebPTaskGroupWait(WebPTaskGroup* const group);
+
+// Function processing rows [start, end). Returns false in case of error.
+typedef int (*WebPBandHook)(void* data, int start, int end);
+
+// Splits [start, end) into bands of 'grain' rows and calls hook() on each of
+// them, in parallel. A 'grain' of 0 or less makes one band per thread,
+// including the calling one. Returns false if any hook failed.
+WEBP_EXTERN int WebPParallelFor(WebPTaskScheduler* const scheduler,
+                                int start, int end, int grain,
+                                WebPBandHook hook, void* data);
+
 //------------------------------------------------------------------------------
 
 #ifdef __cplusplus
@@ -226,6 +226,227 @@ void WebPFree(void* ptr) {
   WebPSafeFree(ptr);
 }
 
+//------------------------------------------------------------------------------
+// Custom allocators
+
+void* WebPAllocatorMalloc(const WebPAllocator* const allocator,
+                          uint64_t nmemb, size_t size) {
+  if (allocator == NULL) return WebPSafeMalloc(nmemb, size);
+  if (!CheckSizeArgumentsOverflow(nmemb, size)) return NULL;
+  assert(nmemb * size > 0);
+  return allocator->malloc_func(allocator->opaque, (size_t)(nmemb * size));
+}
+
+void* WebPAllocatorCalloc(const WebPAllocator* const allocator,
+                          uint64_t nmemb, size_t size) {
+  void* ptr;
+  if (allocator == NULL) return WebPSafeCalloc(nmemb, size);
+  ptr = WebPAllocatorMalloc(allocator, nmemb, size);
+  if (ptr != NULL) memset(ptr, 0, (size_t)(nmemb * size));
+  return ptr;
+}
+
+void WebPAllocatorFree(const WebPAllocator* const allocator, void* const ptr) {
+  if (allocator == NULL) {
+    WebPSafeFree(ptr);
+  } else if (ptr != NULL) {
+    allocator->free_func(allocator->opaque, ptr);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Block cache
+
+// The usable size of a block is stored in front of it. This keeps the
+// alignment of malloc().
+#define BLOCK_HEADER_SIZE 16
+
+static void* BlockCacheMalloc(void* opaque, size_t size) {
+  WebPBlockCache* const cache = (WebPBlockCache*)opaque;
+  int best = -1;
+  int i;
+  uint8_t* block;
+  for (i = 0; i < cache->num_blocks_; ++i) {
+    if (cache->sizes_[i] >= size &&
+        (best < 0 || cache->sizes_[i] < cache->sizes_[best])) {
+      best = i;
+    }
+  }
+  if (best >= 0) {
+    block = (uint8_t*)cache->blocks_[best];
+    cache->blocks_[best] = cache->blocks_[--cache->num_blocks_];
+    cache->sizes_[best] = cache->sizes_[cache->num_blocks_];
+  } else {
+    block = (uint8_t*)WebPSafeMalloc(1ULL, size + BLOCK_HEADER_SIZE);
+    if (block == NULL) return NULL;
+    memcpy(block, &size, sizeof(size));
+  }
+  return block + BLOCK_HEADER_SIZE;
+}
+
+static void BlockCacheFree(void* opaque, void* ptr) {
+  WebPBlockCache* const cache = (WebPBlockCache*)opaque;
+  uint8_t* const block = (uint8_t*)ptr - BLOCK_HEADER_SIZE;
+  size_t size;
+  memcpy(&size, block, sizeof(size));
+  if (cache->num_blocks_ == WEBP_BLOCK_CACHE_SIZE) {
+    // Full: evict the smallest block, unless it is the released one.
+    int smallest = 0;
+    int i;
+    for (i = 1; i < cache->num_blocks_; ++i) {
+      if (cache->sizes_[i] < cache->sizes_[smallest]) smallest = i;
+    }
+    if (cache->sizes_[smallest] >= size) {
+      WebPSafeFree(block);
+      return;
+    }
+    WebPSafeFree(cache->blocks_[smallest]);
+    cache->blocks_[smallest] = cache->blocks_[--cache->num_blocks_];
+    cache->sizes_[smallest] = cache->sizes_[cache->num_blocks_];
+  }
+  cache->blocks_[cache->num_blocks_] = block;
+  cache->sizes_[cache->num_blocks_] = size;
+  ++cache->num_blocks_;
+}
+
+void WebPBlockCacheInit(WebPBlockCache* const cache) {
+  memset(cache, 0, sizeof(*cache));
+  cache->allocator_.malloc_func = BlockCacheMalloc;
+  cache->allocator_.free_func = BlockCacheFree;
+  cache->allocator_.opaque = cache;
+}
+
+void WebPBlockCacheClear(WebPBlockCache* const cache) {
+  int i;
+  for (i = 0; i < cache->num_blocks_; ++i) WebPSafeFree(cache->blocks_[i]);
+  cache->num_blocks_ = 0;
+}
+
+//------------------------------------------------------------------------------
+// Memory counter
+
+static void* MemoryCounterMalloc(void* opaque, size_t size) {
+  WebPMemoryCounter* const counter = (WebPMemoryCounter*)opaque;
+  uint8_t* block;
+  if (!WebPMemoryCounterAdd(counter, size)) return NULL;
+  block = (uint8_t*)WebPAllocatorMalloc(counter->base_, 1ULL,
+                                        size + BLOCK_HEADER_SIZE);
+  if (block == NULL) {
+    WebPMemoryCounterRemove(counter, size);
+    return NULL;
+  }
+  memcpy(block, &size, sizeof(size));
+  return block + BLOCK_HEADER_SIZE;
+}
+
+static void MemoryCounterFree(void* opaque, void* ptr) {
+  WebPMemoryCounter* const counter = (WebPMemoryCounter*)opaque;
+  uint8_t* const block = (uint8_t*)ptr - BLOCK_HEADER_SIZE;
+  size_t size;
+  memcpy(&size, block, sizeof(size));
+  WebPMemoryCounterRemove(counter, size);
+  WebPAllocatorFree(counter->base_, block);
+}
+
+void WebPMemoryCounterInit(WebPMemoryCounter* const counter,
+                           const WebPAllocator* const base) {
+  memset(counter, 0, sizeof(*counter));
+  counter->allocator_.malloc_func = MemoryCounterMalloc;
+  counter->allocator_.free_func = MemoryCounterFree;
+  counter->allocator_.opaque = counter;
+  counter->base_ = base;
+}
+
+void WebPMemoryCounterReset(WebPMemoryCounter* const counter,
+                            uint64_t budget) {
+  counter->budget_ = budget;
+  counter->peak_ = counter->used_;
+  counter->over_budget_ = 0;
+}
+
+int WebPMemoryCounterAdd(WebPMemoryCounter* const counter, uint64_t size) {
+  if (counter->budget_ > 0 && counter->used_ + size > counter->budget_) {
+    counter->over_budget_ = 1;
+    return 0;
+  }
+  counter->used_ += size;
+  if (counter->used_ > counter->peak_) counter->peak_ = counter->used_;
+  return 1;
+}
+
+void WebPMemoryCounterRemove(WebPMemoryCounter* const counter, uint64_t size) {
+  assert(counter->used_ >= size);
+  counter->used_ -= size;
+}
+
+#undef BLOCK_HEADER_SIZE
+
+//------------------------------------------------------------------------------
+// Arena
+
+struct WebPArena {
+  WebPAllocator allocator_;
+  uint8_t* mem_;        // start of the block
+  size_t size_;
+  size_t used_;         // first free byte
+  size_t last_;         // offset of the latest allocation
+};
+
+static void* ArenaMalloc(void* opaque, size_t size) {
+  WebPArena* const arena = (WebPArena*)opaque;
+  const size_t start = (size_t)(WEBP_ALIGN(arena->mem_ + arena->used_) -
+                                (uintptr_t)arena->mem_);
+  if (start > arena->size_ || size > arena->size_ - start) return NULL;
+  arena->last_ = start;
+  arena->used_ = start + size;
+  return arena->mem_ + start;
+}
+
+static void ArenaFree(void* opaque, void* ptr) {
+  WebPArena* const arena = (WebPArena*)opaque;
+  assert((uint8_t*)ptr >= arena->mem_ &&
+         (uint8_t*)ptr < arena->mem_ + arena->size_);
+  if ((uint8_t*)ptr == arena->mem_ + arena->last_) {
+    arena->used_ = arena->last_;   // can't go further back than that
+  }
+}
+
+WebPArena* WebPArenaNew(size_t size) {
+  WebPArena* arena;
+  if (size == 0 || size > WEBP_MAX_ALLOCABLE_MEMORY) return NULL;
+  arena = (WebPArena*)WebPSafeCalloc(1ULL, sizeof(*arena));
+  if (arena == NULL) return NULL;
+  // Room for aligning the first allocation.
+  arena->mem_ = (uint8_t*)WebPSafeMalloc(1ULL, size + WEBP_ALIGN_CST);
+  if (arena->mem_ == NULL) {
+    WebPSafeFree(arena);
+    return NULL;
+  }
+  arena->size_ = size + WEBP_ALIGN_CST;
+  arena->allocator_.malloc_func = ArenaMalloc;
+  arena->allocator_.free_func = ArenaFree;
+  arena->allocator_.opaque = arena;
+  return arena;
+}
+
+void WebPArenaDelete(WebPArena* arena) {
+  if (arena != NULL) {
+    WebPSafeFree(arena->mem_);
+    WebPSafeFree(arena);
+  }
+}
+
+void WebPArenaReset(WebPArena* arena) {
+  if (arena != NULL) {
+    arena->used_ = 0;
+    arena->last_ = 0;
+  }
+}
+
+const WebPAllocator* WebPArenaGetAllocator(WebPArena* arena) {
+  return (arena != NULL) ? &arena->allocator_ : NULL;
+}
+
 //------------------------------------------------------------------------------
 
 void WebPCopyPlane(const uint8_t* src, int src_stride,
@@ -56,6 +56,57 @@ WEBP_EXTERN void* WebPSafeCalloc(uint64_t nmemb, size_t size);
 // Companion deallocation function to the above allocations.
 WEBP_EXTERN void WebPSafeFree(void* const ptr);
 
+// Same as above, but going through 'allocator' unless it is NULL. Memory must
+// be released with the allocator it was obtained from.
+WEBP_EXTERN void* WebPAllocatorMalloc(const WebPAllocator* const allocator,
+                                      uint64_t nmemb, size_t size);
+WEBP_EXTERN void* WebPAllocatorCalloc(const WebPAllocator* const allocator,
+                                      uint64_t nmemb, size_t size);
+WEBP_EXTERN void WebPAllocatorFree(const WebPAllocator* const allocator,
+                                   void* const ptr);
+
+// Allocator keeping up to WEBP_BLOCK_CACHE_SIZE released blocks for reuse, so
+// that repeating the same allocations doesn't call malloc() again. A request
+// is served by the smallest cached block that is large enough. Not
+// thread-safe. The struct must not be moved once initialized.
+#define WEBP_BLOCK_CACHE_SIZE 16
+typedef struct {
+  WebPAllocator allocator_;
+  void* blocks_[WEBP_BLOCK_CACHE_SIZE];
+  size_t sizes_[WEBP_BLOCK_CACHE_SIZE];   // usable size of each block
+  int num_blocks_;
+} WebPBlockCache;
+
+WEBP_EXTERN void WebPBlockCacheInit(WebPBlockCache* const cache);
+// Frees the cached blocks. The blocks in use must be released before.
+WEBP_EXTERN void WebPBlockCacheClear(WebPBlockCache* const cache);
+
+// Allocator forwarding to 'base_' (or WebPSafeMalloc() if NULL) while keeping
+// track of the memory in use and its peak. If 'budget_' is not zero, requests
+// that would bring the usage over it fail and set 'over_budget_'. Not
+// thread-safe. The struct must not be moved once initialized.
+typedef struct {
+  WebPAllocator allocator_;
+  const WebPAllocator* base_;
+  uint64_t budget_;
+  uint64_t used_;       // bytes currently allocated
+  uint64_t peak_;       // maximum of 'used_' since the last reset
+  int over_budget_;     // true if a request was refused because of 'budget_'
+} WebPMemoryCounter;
+
+WEBP_EXTERN void WebPMemoryCounterInit(WebPMemoryCounter* const counter,
+                                       const WebPAllocator* const base);
+// Starts a new measure: 'peak_' is reset to the memory still in use.
+WEBP_EXTERN void WebPMemoryCounterReset(WebPMemoryCounter* const counter,
+                                        uint64_t budget);
+// Accounts for 'size' bytes that were obtained elsewhere, for the remainder
+// of the measure. Returns false if this is over budget.
+WEBP_EXTERN int WebPMemoryCounterAdd(WebPMemoryCounter* const counter,
+                                     uint64_t size);
+// Releases 'size' bytes previously accounted for by WebPMemoryCounterAdd().
+WEBP_EXTERN void WebPMemoryCounterRemove(WebPMemoryCounter* const counter,
+                                         uint64_t size);
+
 //------------------------------------------------------------------------------
 // Alignment
 
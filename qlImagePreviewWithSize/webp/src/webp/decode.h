@@ -20,12 +20,18 @@
 extern "C" {
 #endif
 
-#define WEBP_DECODER_ABI_VERSION 0x0209    // MAJOR(8b) + MINOR(8b)
+// Note: version 3 enlarged WebPDecoderOptions, whose padding couldn't hold the
+// 'allocator' pointer and 'memory_budget', and WebPDecoderConfig, which had no
+// padding for 'peak_memory' (it now has some). The version-checked functions
+// (WebPInitDecoderConfig(), WebPInitDecBuffer(), WebPGetFeatures()) fail for
+// callers built against version 2 headers.
+#define WEBP_DECODER_ABI_VERSION 0x0302    // MAJOR(8b) + MINOR(8b)
 
 // Note: forward declaring enumerations is not allowed in (strict) C and C++,
 // the types are left here for reference.
 // typedef enum VP8StatusCode VP8StatusCode;
 // typedef enum WEBP_CSP_MODE WEBP_CSP_MODE;
+// typedef enum WEBP_SCALING_FILTER WEBP_SCALING_FILTER;
 typedef struct WebPRGBABuffer WebPRGBABuffer;
 typedef struct WebPYUVABuffer WebPYUVABuffer;
 typedef struct WebPDecBuffer WebPDecBuffer;
@@ -33,6 +39,9 @@ typedef struct WebPIDecoder WebPIDecoder;
 typedef struct WebPBitstreamFeatures WebPBitstreamFeatures;
 typedef struct WebPDecoderOptions WebPDecoderOptions;
 typedef struct WebPDecoderConfig WebPDecoderConfig;
+typedef struct WebPDecoderContext WebPDecoderContext;
+typedef struct WebPByteRange WebPByteRange;
+typedef struct WebPPullDecoder WebPPullDecoder;
 
 // Return the decoder's version number, packed in hexadecimal using 8bits for
 // each of major/minor/revision. E.g: v2.5.7 is 0x020507.
@@ -76,6 +85,18 @@ WEBP_EXTERN uint8_t* WebPDecodeRGB(const uint8_t* data, size_t data_size,
 WEBP_EXTERN uint8_t* WebPDecodeBGR(const uint8_t* data, size_t data_size,
                                    int* width, int* height);
 
+// Decodes a lossless image whose only transform is a color-indexing (palette)
+// one, and returns its palette indices, one byte per pixel, in scan order
+// (the stride is '*width'). The palette is stored in 'palette', which must
+// hold 256 * 4 bytes, as R, G, B, A, R, G, B, A... (non-premultiplied), and
+// the number of entries that indices can refer to is returned in
+// '*palette_size'. Avoids expanding the image to 32-bit samples.
+// The returned pointer should be deleted calling WebPFree().
+// Returns NULL in case of error, or if the image isn't palette-based.
+WEBP_EXTERN uint8_t* WebPDecodeIndexed(const uint8_t* data, size_t data_size,
+                                       int* width, int* height,
+                                       uint8_t* palette, int* palette_size);
+
 
 // Decode WebP images pointed to by 'data' to Y'UV format(*). The pointer
 // returned is the Y samples buffer. Upon return, *u and *v will point to
@@ -145,6 +166,9 @@ WEBP_EXTERN uint8_t* WebPDecodeYUVInto(
 // these two modes:
 // RGBA-4444: [b3 b2 b1 b0 a3 a2 a1 a0], [r3 r2 r1 r0 g3 g2 g1 g0], ...
 // RGB-565: [g2 g1 g0 b4 b3 b2 b1 b0], [r4 r3 r2 r1 r0 g5 g4 g3], ...
+// The 16b modes store R,G,B,A as native-endian uint16_t samples, either as
+// integers in [0..65535] or as IEEE half-floats in [0..1] (MODE_RGBA_F16).
+// The _LINEAR variants apply the inverse sRGB transfer function to R,G,B.
 
 typedef enum WEBP_CSP_MODE {
   MODE_RGB = 0, MODE_RGBA = 1,
@@ -156,9 +180,12 @@ typedef enum WEBP_CSP_MODE {
   MODE_bgrA = 8,
   MODE_Argb = 9,
   MODE_rgbA_4444 = 10,
-  // YUV modes must come after RGB ones.
+  // YUV modes must come after the 8b RGB ones.
   MODE_YUV = 11, MODE_YUVA = 12,  // yuv 4:2:0
-  MODE_LAST = 13
+  // 16b RGBA modes
+  MODE_RGBA_16 = 13, MODE_RGBA_F16 = 14,
+  MODE_RGBA_16_LINEAR = 15, MODE_RGBA_F16_LINEAR = 16,
+  MODE_LAST = 17
 } WEBP_CSP_MODE;
 
 // Some useful macros:
@@ -167,14 +194,18 @@ static WEBP_INLINE int WebPIsPremultipliedMode(WEBP_CSP_MODE mode) {
           mode == MODE_rgbA_4444);
 }
 
+static WEBP_INLINE int WebPIs16bMode(WEBP_CSP_MODE mode) {
+  return (mode >= MODE_RGBA_16 && mode < MODE_LAST);
+}
+
 static WEBP_INLINE int WebPIsAlphaMode(WEBP_CSP_MODE mode) {
   return (mode == MODE_RGBA || mode == MODE_BGRA || mode == MODE_ARGB ||
           mode == MODE_RGBA_4444 || mode == MODE_YUVA ||
-          WebPIsPremultipliedMode(mode));
+          WebPIsPremultipliedMode(mode) || WebPIs16bMode(mode));
 }
 
 static WEBP_INLINE int WebPIsRGBMode(WEBP_CSP_MODE mode) {
-  return (mode < MODE_YUV);
+  return (mode < MODE_YUV) || WebPIs16bMode(mode);
 }
 
 //------------------------------------------------------------------------------
@@ -239,7 +270,8 @@ typedef enum VP8StatusCode {
   VP8_STATUS_UNSUPPORTED_FEATURE,
   VP8_STATUS_SUSPENDED,
   VP8_STATUS_USER_ABORT,
-  VP8_STATUS_NOT_ENOUGH_DATA
+  VP8_STATUS_NOT_ENOUGH_DATA,
+  VP8_STATUS_OVER_MEMORY_BUDGET
 } VP8StatusCode;
 
 //------------------------------------------------------------------------------
@@ -338,6 +370,16 @@ WEBP_EXTERN VP8StatusCode WebPIAppend(
 WEBP_EXTERN VP8StatusCode WebPIUpdate(
     WebPIDecoder* idec, const uint8_t* data, size_t data_size);
 
+// A variant of WebPIAppend() for data split in several buffers owned by the
+// caller, such as network packets or file pages: each call adds the next
+// 'data_size' bytes of the input without copying them, and the image data is
+// read in place across the buffers. All the buffers must remain valid and
+// unchanged until WebPIDelete() is called. Only the chunks preceding the image
+// data may be copied, when they straddle several buffers.
+// Can't be mixed with calls to WebPIAppend() or WebPIUpdate().
+WEBP_EXTERN VP8StatusCode WebPIAppendSegment(
+    WebPIDecoder* idec, const uint8_t* data, size_t data_size);
+
 // Returns the RGB/A image decoded so far. Returns NULL if output params
 // are not initialized yet. The RGB/A output type corresponds to the colorspace
 // specified during call to WebPINewDecoder() or WebPINewRGB().
@@ -441,6 +483,16 @@ static WEBP_INLINE VP8StatusCode WebPGetFeatures(
                                  WEBP_DECODER_ABI_VERSION);
 }
 
+// Kernels available for the output rescaling (see 'scaling_filter' below).
+typedef enum WEBP_SCALING_FILTER {
+  WEBP_SCALING_DEFAULT = 0,   // fixed-point area-averaging when downscaling,
+                              // bilinear interpolation when upscaling
+  WEBP_SCALING_BOX,           // separable box filter
+  WEBP_SCALING_BILINEAR,      // separable triangle filter
+  WEBP_SCALING_LANCZOS3,      // separable 3-lobe Lanczos filter (sharpest)
+  WEBP_SCALING_FILTER_LAST
+} WEBP_SCALING_FILTER;
+
 // Decoding options
 struct WebPDecoderOptions {
   int bypass_filtering;               // if true, skip the in-loop filtering
@@ -455,8 +507,32 @@ struct WebPDecoderOptions {
   int dithering_strength;             // dithering strength (0=Off, 100=full)
   int flip;                           // flip output vertically
   int alpha_dithering_strength;       // alpha dithering strength in [0..100]
-
-  uint32_t pad[5];                    // padding for later use
+  int lossless_window_rows;           // if non-zero, lossless images are
+                                      // decoded keeping only a window of that
+                                      // many rows for back-references instead
+                                      // of the full image. If the bitstream
+                                      // refers further back, it is scanned
+                                      // first and decoded again with a large
+                                      // enough window. If negative, the scan
+                                      // is always done and the window is the
+                                      // smallest possible one. Not used for
+                                      // incremental decoding.
+  int scaling_filter;                 // rescaling kernel, one of
+                                      // WEBP_SCALING_FILTER
+  int linear_scaling;                 // if true, downscaling with the default
+                                      // filter averages in linear light
+  const WebPAllocator* allocator;     // if not NULL, allocates the decoder's
+                                      // working memory (but not the output
+                                      // buffer). See WebPArenaNew().
+  size_t memory_budget;               // if non-zero, maximum number of bytes
+                                      // of memory the decoding may use, as
+                                      // counted by 'peak_memory' below. The
+                                      // decoding fails with
+                                      // VP8_STATUS_OVER_MEMORY_BUDGET, before
+                                      // the large allocations if possible.
+                                      // Not used for incremental decoding.
+
+  uint32_t pad[2];                    // padding for later use
 };
 
 // Main object storing the configuration for advanced decoding.
@@ -464,6 +540,13 @@ struct WebPDecoderConfig {
   WebPBitstreamFeatures input;  // Immutable bitstream features (optional)
   WebPDecBuffer output;         // Output buffer (can point to external mem)
   WebPDecoderOptions options;   // Decoding options
+  size_t peak_memory;           // Set by WebPDecode(): the largest amount of
+                                // memory used at once, in bytes. This counts
+                                // the working memory of the decoder and the
+                                // output buffer allocated by the library, but
+                                // not the internal buffers of the alpha plane
+                                // decoding nor the decoder objects themselves.
+  uint32_t pad[4];              // padding for later use
 };
 
 // Internal, version-checked, entry point
@@ -496,6 +579,100 @@ WEBP_EXTERN WebPIDecoder* WebPIDecode(const uint8_t* data, size_t data_size,
 WEBP_EXTERN VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
                                      WebPDecoderConfig* config);
 
+// Computes in '*memory_size' the 'peak_memory' that WebPDecode() can reach when
+// decoding 'data' with 'config' (options, output colorspace and external
+// memory). Only the headers of the bitstream are decoded, and the result is an
+// upper bound. Returns VP8_STATUS_OK, or the error found in the headers.
+WEBP_EXTERN VP8StatusCode WebPEstimateDecodeMemory(
+    const uint8_t* data, size_t data_size,
+    const WebPDecoderConfig* config, size_t* memory_size);
+
+// Decoder context, keeping the decoders with their working memory and threads
+// from one call to WebPDecodeWithContext() to the next. Memory is only grown
+// when a picture needs more, so that decoding a series of similar pictures
+// doesn't allocate it again. A context is not thread-safe.
+// Returns NULL in case of memory error.
+WEBP_EXTERN WebPDecoderContext* WebPDecoderContextNew(void);
+
+// Releases the context and all it keeps.
+WEBP_EXTERN void WebPDecoderContextDelete(WebPDecoderContext* context);
+
+// Same as WebPDecode(), reusing 'context'. If config->options.allocator is set,
+// it serves the working memory instead of the context, and nothing allocated
+// from it is kept after the call.
+WEBP_EXTERN VP8StatusCode WebPDecodeWithContext(WebPDecoderContext* context,
+                                                const uint8_t* data,
+                                                size_t data_size,
+                                                WebPDecoderConfig* config);
+
+//------------------------------------------------------------------------------
+// Pull-based decoding
+//
+// Here the decoder tells which bytes of the file it needs next, instead of
+// being given the whole file or its successive parts. This suits event loops
+// and asynchronous I/O: the decoder never blocks and never reads by itself.
+// Code example:
+//
+//   WebPPullDecoder* const dec = WebPPullDecoderNew(&config, frame_num);
+//   WebPByteRange need;
+//   while (WebPPullDecoderStep(dec, &need) == VP8_STATUS_SUSPENDED) {
+//     // ... read up to 'need.size' bytes at 'need.offset' in the file, then:
+//     WebPPullDecoderProvide(dec, need.offset, bytes, num_bytes_read);
+//   }
+//   // config.output holds the picture if the last step returned
+//   // VP8_STATUS_OK.
+//   WebPPullDecoderDelete(dec);
+//
+// For an animation, one frame is decoded as it is stored, without blending
+// it onto the previous ones: only the chunk headers before it and its own
+// chunks are read, hence out of order.
+
+struct WebPByteRange {
+  uint64_t offset;   // position in the file
+  size_t size;       // number of bytes
+};
+
+// Creates a decoder for the picture, or for the frame 'frame_num' (starting
+// at 1) of an animation. 'frame_num' must be 0 or 1 for a still picture.
+// 'config' is used like with WebPIDecode() and must outlive the decoder.
+// Returns NULL in case of memory error or invalid parameter.
+WEBP_EXTERN WebPPullDecoder* WebPPullDecoderNew(WebPDecoderConfig* config,
+                                                int frame_num);
+
+// Releases the decoder. The decoded picture remains in config->output.
+WEBP_EXTERN void WebPPullDecoderDelete(WebPPullDecoder* dec);
+
+// Returns VP8_STATUS_OK once the picture is decoded, VP8_STATUS_SUSPENDED if
+// bytes are needed, in which case '*need' is set to the range to read next,
+// or the error that stopped decoding (VP8_STATUS_INVALID_PARAM if the frame
+// doesn't exist).
+WEBP_EXTERN VP8StatusCode WebPPullDecoderStep(WebPPullDecoder* dec,
+                                              WebPByteRange* need);
+
+// Hands over 'data_size' bytes read at position 'offset', which must be the
+// offset of the last range returned by WebPPullDecoderStep(). Fewer bytes than
+// requested may be provided, the rest is asked for again. A 'data_size' of 0
+// means the file ends there. The bytes are copied and decoded, and decoding
+// errors are returned by the next call to WebPPullDecoderStep(). Returns
+// VP8_STATUS_OK, or VP8_STATUS_INVALID_PARAM if the bytes aren't the expected
+// ones.
+WEBP_EXTERN VP8StatusCode WebPPullDecoderProvide(WebPPullDecoder* dec,
+                                                 uint64_t offset,
+                                                 const uint8_t* data,
+                                                 size_t data_size);
+
+// Reads up to 'size' bytes at position 'offset' in 'buffer'. Returns the
+// number of bytes read, or 0 at the end of the file or in case of error.
+typedef size_t (*WebPReadFunc)(void* user_data, uint64_t offset,
+                               uint8_t* buffer, size_t size);
+
+// Blocking version of the above: decodes the picture, or the frame 'frame_num'
+// of an animation, reading the file through 'read'. Returns the decoding
+// status, like WebPDecode().
+WEBP_EXTERN VP8StatusCode WebPDecodeFromReader(WebPReadFunc read,
+                                               void* user_data, int frame_num,
+                                               WebPDecoderConfig* config);
+
 #ifdef __cplusplus
 }    // extern "C"
 #endif
@@ -55,7 +55,7 @@
 extern "C" {
 #endif
 
-#define WEBP_DEMUX_ABI_VERSION 0x0107    // MAJOR(8b) + MINOR(8b)
+#define WEBP_DEMUX_ABI_VERSION 0x0108    // MAJOR(8b) + MINOR(8b)
 
 // Note: forward declaring enumerations is not allowed in (strict) C and C++,
 // the types are left here for reference.
@@ -66,6 +66,8 @@ typedef struct WebPIterator WebPIterator;
 typedef struct WebPChunkIterator WebPChunkIterator;
 typedef struct WebPAnimInfo WebPAnimInfo;
 typedef struct WebPAnimDecoderOptions WebPAnimDecoderOptions;
+typedef struct WebPDemuxIndex WebPDemuxIndex;
+typedef struct WebPFrameInfo WebPFrameInfo;
 
 //------------------------------------------------------------------------------
 
@@ -217,6 +219,63 @@ WEBP_EXTERN int WebPDemuxPrevChunk(WebPChunkIterator* iter);
 // WebPDemuxDelete().
 WEBP_EXTERN void WebPDemuxReleaseChunkIterator(WebPChunkIterator* iter);
 
+//------------------------------------------------------------------------------
+// Index-only demuxing.
+//
+// For large files that shouldn't be held in memory: only the chunk headers
+// (and the few bytes needed to get the frame dimensions) are read, through a
+// callback, to build an index of the frames. Each frame is then read on demand.
+// Metadata chunks (ICCP, EXIF, XMP) are not indexed.
+/*
+  WebPDemuxIndex* const index = WebPDemuxIndexNew(ReadFile, file);
+  WebPFrameInfo info;
+  WebPData frame;
+  if (WebPDemuxIndexGetFrame(index, frame_num, &info) &&
+      WebPDemuxIndexReadFrame(index, frame_num, &frame)) {
+    // ... (Decode 'frame' with WebPDecode() and compose it using 'info').
+    WebPDataClear(&frame);
+  }
+  WebPDemuxIndexDelete(index);
+*/
+
+struct WebPFrameInfo {
+  uint64_t offset;         // position of the frame data in the file.
+  size_t size;             // size of the frame data.
+  int x_offset, y_offset;  // offset relative to the canvas.
+  int width, height;       // dimensions of this frame.
+  int duration;            // display duration in milliseconds.
+  int has_alpha;           // True if the frame contains transparency.
+  WebPMuxAnimDispose dispose_method;  // dispose method for the frame.
+  WebPMuxAnimBlend blend_method;      // Blend operation for the frame.
+};
+
+// Indexes the WebP file read through 'read' (see WebPReadFunc in decode.h),
+// which is called with 'user_data'. Unlike WebPDemux(), the file must be in
+// the RIFF container and be complete.
+// Returns NULL in case of parsing or memory error.
+WEBP_EXTERN WebPDemuxIndex* WebPDemuxIndexNew(WebPReadFunc read,
+                                              void* user_data);
+
+// Frees memory associated with 'index'.
+WEBP_EXTERN void WebPDemuxIndexDelete(WebPDemuxIndex* index);
+
+// Get the 'feature' value from 'index', like WebPDemuxGetI().
+WEBP_EXTERN uint32_t WebPDemuxIndexGetI(const WebPDemuxIndex* index,
+                                        WebPFormatFeature feature);
+
+// Retrieves the description of frame 'frame_number' (starting at 1, 0 meaning
+// the last frame). Returns false if 'index' is NULL or the frame is not
+// present.
+WEBP_EXTERN int WebPDemuxIndexGetFrame(const WebPDemuxIndex* index,
+                                       int frame_number, WebPFrameInfo* info);
+
+// Reads the data of frame 'frame_number', as WebPIterator::fragment would
+// hold it, into 'data'. 'data' must be released with WebPDataClear().
+// Returns false if the frame is not present, or in case of read or memory
+// error.
+WEBP_EXTERN int WebPDemuxIndexReadFrame(const WebPDemuxIndex* index,
+                                        int frame_number, WebPData* data);
+
 //------------------------------------------------------------------------------
 // WebPAnimDecoder API
 //
@@ -61,6 +61,38 @@ WEBP_EXTERN void* WebPMalloc(size_t size);
 // Releases memory returned by the WebPDecode*() functions (from decode.h).
 WEBP_EXTERN void WebPFree(void* ptr);
 
+// Caller-provided memory allocator, used for the working memory of a decoder.
+// 'malloc_func' returns a block of at least 'size' bytes suitably aligned for
+// any type, or NULL. 'free_func' releases such a block (never NULL). Both are
+// passed 'opaque'. An allocator is only called from the thread running the
+// decoding, and must outlive it.
+typedef struct WebPAllocator WebPAllocator;
+struct WebPAllocator {
+  void* (*malloc_func)(void* opaque, size_t size);
+  void (*free_func)(void* opaque, void* ptr);
+  void* opaque;
+};
+
+// Bump allocator serving all the allocations from a single block of memory.
+// Releasing a block is a no-op unless it is the latest one: the memory is
+// reclaimed all at once with WebPArenaReset(). Allocations fail once the block
+// is exhausted, so that its size acts as a hard memory budget. An arena is not
+// thread-safe and is meant to serve one decoding at a time.
+typedef struct WebPArena WebPArena;
+
+// Creates an arena of 'size' bytes. Returns NULL in case of error.
+WEBP_EXTERN WebPArena* WebPArenaNew(size_t size);
+
+// Releases the arena and all the memory allocated from it.
+WEBP_EXTERN void WebPArenaDelete(WebPArena* arena);
+
+// Makes all the memory of the arena available again.
+WEBP_EXTERN void WebPArenaReset(WebPArena* arena);
+
+// Returns the allocator to set in the decoding options. It stays valid until
+// the arena is deleted.
+WEBP_EXTERN const WebPAllocator* WebPArenaGetAllocator(WebPArena* arena);
+
 #ifdef __cplusplus
 }    // extern "C"
 #endif
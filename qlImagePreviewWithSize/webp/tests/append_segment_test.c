@@ -0,0 +1,287 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Checks WebPIAppendSegment() against WebPIAppend(), for lossy and lossless
+// pictures with and without alpha. The input is split in segments of 1 to
+// 4097 bytes, and also at chosen positions so that segment boundaries fall
+// inside partition #0, inside each token partition and inside the lossless
+// bitstream. Each segment is copied to its own allocation, so that reading
+// past one doesn't go unnoticed (under a memory checker). The rows available
+// after each piece and the final pictures must match WebPDecodeRGBA(). See
+// README.txt for how to build and run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/webp/decode.h"
+#include "src/webp/encode.h"
+
+#define WIDTH  96
+#define HEIGHT 80
+#define LOG2_NUM_PARTITIONS 2
+#define MAX_CHUNK_SIZE 4097
+#define MAX_REGIONS 8     // partition #0, the token partitions or VP8L data
+
+typedef struct {
+  size_t start, end;      // byte range of a region of the bitstream
+} Region;
+
+static uint32_t GetLE24(const uint8_t* const data) {
+  return data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16);
+}
+
+static uint32_t GetLE32(const uint8_t* const data) {
+  return GetLE24(data) | ((uint32_t)data[3] << 24);
+}
+
+// Fills 'rgba' with a noisy pattern, opaque unless 'alpha' is true.
+static void MakePicture(uint8_t* const rgba, int alpha) {
+  uint32_t seed = 1;
+  int x, y;
+  for (y = 0; y < HEIGHT; ++y) {
+    for (x = 0; x < WIDTH; ++x) {
+      uint8_t* const p = rgba + 4 * (y * WIDTH + x);
+      seed = seed * 1103515245u + 12345u;
+      p[0] = (uint8_t)(x * 3 + y + ((seed >> 16) & 15));
+      p[1] = (uint8_t)(x ^ y) + ((seed >> 20) & 7);
+      p[2] = (uint8_t)(y * 5 - x);
+      p[3] = alpha ? (uint8_t)(x * 7 + (y & 8) * 16) : 0xff;
+    }
+  }
+}
+
+// Finds the image data of 'data': partition #0 and the token partitions
+// of a lossy bitstream, or the lossless bitstream. Returns the number of
+// regions, or 0 on error.
+static int FindRegions(const uint8_t* const data, size_t size,
+                       Region regions[MAX_REGIONS]) {
+  size_t pos = 12;    // skip the RIFF header
+  while (pos + 8 <= size) {
+    const size_t chunk_size = GetLE32(data + pos + 4);
+    const size_t payload = pos + 8;
+    if (chunk_size > size - payload) return 0;
+    if (!memcmp(data + pos, "VP8L", 4)) {
+      regions[0].start = payload;
+      regions[0].end = payload + chunk_size;
+      return 1;
+    }
+    if (!memcmp(data + pos, "VP8 ", 4)) {
+      const int num_parts = 1 << LOG2_NUM_PARTITIONS;
+      const size_t part0_size = GetLE24(data + payload) >> 5;
+      const size_t sizes = payload + 10 + part0_size;   // partition sizes
+      size_t start = sizes + 3 * (num_parts - 1);
+      int p;
+      if (start > payload + chunk_size) return 0;
+      regions[0].start = payload + 10;
+      regions[0].end = sizes;
+      for (p = 0; p < num_parts; ++p) {
+        const size_t end = (p < num_parts - 1)
+                         ? start + GetLE24(data + sizes + 3 * p)
+                         : payload + chunk_size;
+        if (end > payload + chunk_size) return 0;
+        regions[1 + p].start = start;
+        regions[1 + p].end = end;
+        start = end;
+      }
+      return 1 + num_parts;
+    }
+    pos = payload + chunk_size + (chunk_size & 1);
+  }
+  return 0;
+}
+
+// Decodes 'data' incrementally, in 'num_splits + 1' pieces separated by the
+// positions 'splits' (or, if 'splits' is NULL, in pieces of 'chunk_size'
+// bytes). The pieces are given to WebPIAppendSegment() if 'segmented' is
+// true, else to WebPIAppend(). The rows decoded after each piece must match
+// 'ref'. The final picture is stored in 'out'. Returns false on error.
+static int Decode(const uint8_t* const data, size_t size, int segmented,
+                  const size_t* const splits, int num_splits,
+                  size_t chunk_size, const uint8_t* const ref,
+                  uint8_t* const out) {
+  WebPIDecoder* const idec = WebPINewRGB(MODE_RGBA, NULL, 0, 0);
+  uint8_t** const copies =
+      (uint8_t**)calloc(size + 1, sizeof(*copies));
+  VP8StatusCode status = VP8_STATUS_SUSPENDED;
+  size_t pos = 0;
+  int num_pieces = 0;
+  int num_rows = 0;   // rows checked so far
+  int ok = 0;
+  if (idec == NULL || copies == NULL) goto End;
+  while (pos < size && status == VP8_STATUS_SUSPENDED) {
+    const size_t end = (splits == NULL) ? pos + chunk_size
+                     : (num_pieces < num_splits) ? splits[num_pieces]
+                     : size;
+    const size_t piece_size = ((end < size) ? end : size) - pos;
+    int last_y = 0;
+    if (segmented) {
+      uint8_t* const copy = (uint8_t*)malloc(piece_size);
+      if (copy == NULL) goto End;
+      memcpy(copy, data + pos, piece_size);
+      copies[num_pieces] = copy;
+      status = WebPIAppendSegment(idec, copy, piece_size);
+    } else {
+      status = WebPIAppend(idec, data + pos, piece_size);
+    }
+    ++num_pieces;
+    pos += piece_size;
+    if (status == VP8_STATUS_SUSPENDED) {
+      int stride;
+      const uint8_t* const rgba =
+          WebPIDecGetRGB(idec, &last_y, NULL, NULL, &stride);
+      for (; rgba != NULL && num_rows < last_y; ++num_rows) {
+        if (memcmp(rgba + stride * num_rows, ref + 4 * WIDTH * num_rows,
+                   4 * WIDTH)) {
+          goto End;
+        }
+      }
+    }
+  }
+  if (status == VP8_STATUS_OK) {
+    int width, height, stride, last_y, y;
+    const uint8_t* const rgba =
+        WebPIDecGetRGB(idec, &last_y, &width, &height, &stride);
+    if (rgba != NULL && width == WIDTH && height == HEIGHT &&
+        last_y == HEIGHT) {
+      for (y = 0; y < HEIGHT; ++y) {
+        memcpy(out + 4 * WIDTH * y, rgba + stride * y, 4 * WIDTH);
+      }
+      ok = 1;
+    }
+  }
+
+ End:
+  WebPIDelete(idec);    // before releasing the segments it references
+  if (copies != NULL) {
+    int i;
+    for (i = 0; i < num_pieces; ++i) free(copies[i]);
+    free(copies);
+  }
+  return ok;
+}
+
+// Decodes 'data' both ways, split at 'splits' or in pieces of 'chunk_size'
+// bytes, and compares with 'ref', the WebPDecodeRGBA() output.
+static int Compare(const char* const name, const uint8_t* const data,
+                   size_t size, const size_t* const splits, int num_splits,
+                   size_t chunk_size, const uint8_t* const ref,
+                   uint8_t* const out) {
+  const char* error = NULL;
+  if (!Decode(data, size, 0, splits, num_splits, chunk_size, ref, out)) {
+    error = "WebPIAppend() failed";
+  } else if (memcmp(out, ref, 4 * WIDTH * HEIGHT)) {
+    error = "WebPIAppend() output mismatch";
+  } else if (!Decode(data, size, 1, splits, num_splits, chunk_size, ref,
+                     out)) {
+    error = "WebPIAppendSegment() failed";
+  } else if (memcmp(out, ref, 4 * WIDTH * HEIGHT)) {
+    error = "WebPIAppendSegment() output mismatch";
+  }
+  if (error != NULL) {
+    if (splits != NULL) {
+      fprintf(stderr, "%s: split at %d", name, (int)splits[0]);
+      if (num_splits > 1) fprintf(stderr, " and %d", (int)splits[1]);
+      fprintf(stderr, ": %s\n", error);
+    } else {
+      fprintf(stderr, "%s: chunks of %d bytes: %s\n",
+              name, (int)chunk_size, error);
+    }
+    return 0;
+  }
+  return 1;
+}
+
+static int Check(const char* const name, const uint8_t* const data,
+                 size_t size, int expected_num_regions) {
+  Region regions[MAX_REGIONS];
+  const int num_regions = FindRegions(data, size, regions);
+  uint8_t* const out = (uint8_t*)malloc(4 * WIDTH * HEIGHT);
+  int width, height;
+  uint8_t* const ref = WebPDecodeRGBA(data, size, &width, &height);
+  int ok = 1;
+  int r;
+  size_t chunk_size;
+  if (out == NULL || ref == NULL) {
+    fprintf(stderr, "%s: memory or decoding error\n", name);
+    ok = 0;
+  } else if (num_regions != expected_num_regions) {
+    fprintf(stderr, "%s: %d regions found instead of %d\n",
+            name, num_regions, expected_num_regions);
+    ok = 0;
+  }
+  // Boundaries at the start, in the middle and at the end of each region,
+  // also with a 3-byte segment ending there.
+  for (r = 0; ok && r < num_regions; ++r) {
+    const size_t start = regions[r].start, end = regions[r].end;
+    const size_t mid = (start + end) / 2;
+    const size_t points[] = {
+      start, start + 1, start + 2, mid - 1, mid, mid + 1, end - 2, end - 1
+    };
+    int i;
+    if (end - start < 8) {
+      fprintf(stderr, "%s: region %d is too small\n", name, r);
+      ok = 0;
+      break;
+    }
+    for (i = 0; ok && i < (int)(sizeof(points) / sizeof(points[0])); ++i) {
+      const size_t pair[2] = { points[i] - 3, points[i] };
+      ok = Compare(name, data, size, &points[i], 1, 0, ref, out) &&
+           Compare(name, data, size, pair, 2, 0, ref, out);
+    }
+  }
+  for (chunk_size = 1; ok && chunk_size <= MAX_CHUNK_SIZE; ++chunk_size) {
+    ok = Compare(name, data, size, NULL, 0, chunk_size, ref, out);
+  }
+  WebPFree(ref);
+  free(out);
+  return ok;
+}
+
+int main(void) {
+  uint8_t* const rgba = (uint8_t*)malloc(4 * WIDTH * HEIGHT);
+  int ok = (rgba != NULL);
+  int lossless, alpha;
+  for (lossless = 0; ok && lossless <= 1; ++lossless) {
+    for (alpha = 0; ok && alpha <= 1; ++alpha) {
+      WebPConfig config;
+      WebPPicture pic;
+      WebPMemoryWriter writer;
+      char name[32];
+      snprintf(name, sizeof(name), "%s%s", lossless ? "lossless" : "lossy",
+               alpha ? " + alpha" : "");
+      MakePicture(rgba, alpha);
+      if (!WebPConfigInit(&config) || !WebPPictureInit(&pic)) return 1;
+      config.lossless = lossless;
+      config.quality = 90;
+      config.partitions = LOG2_NUM_PARTITIONS;
+      config.method = lossless ? 4 : 2;  // the token buffer of methods 3+
+                                         // only allows one partition
+      pic.use_argb = lossless;
+      pic.width = WIDTH;
+      pic.height = HEIGHT;
+      WebPMemoryWriterInit(&writer);
+      pic.writer = WebPMemoryWrite;
+      pic.custom_ptr = &writer;
+      if (!WebPPictureImportRGBA(&pic, rgba, 4 * WIDTH) ||
+          !WebPEncode(&config, &pic)) {
+        fprintf(stderr, "%s: encoding failed\n", name);
+        ok = 0;
+      } else {
+        ok = Check(name, writer.mem, writer.size,
+                   lossless ? 1 : 1 + (1 << LOG2_NUM_PARTITIONS));
+      }
+      WebPPictureFree(&pic);
+      WebPMemoryWriterClear(&writer);
+    }
+  }
+  free(rgba);
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
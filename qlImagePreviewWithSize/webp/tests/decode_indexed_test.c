@@ -0,0 +1,119 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Checks WebPDecodeIndexed() against WebPDecodeRGBA(): the indices mapped
+// through the returned palette must give the RGBA output, and images without
+// a palette must be rejected. See README.txt for how to build and run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/webp/decode.h"
+#include "src/webp/encode.h"
+
+#define WIDTH  123
+#define HEIGHT 45
+
+// Fills 'rgba' with a pattern using 'num_colors' colors (all different if 0).
+static void MakePicture(uint8_t* const rgba, int num_colors) {
+  int x, y;
+  for (y = 0; y < HEIGHT; ++y) {
+    for (x = 0; x < WIDTH; ++x) {
+      uint8_t* const p = rgba + 4 * (y * WIDTH + x);
+      const int c = (num_colors > 0) ? ((x / 3 + y * 7) ^ (x * y)) % num_colors
+                                     : y * WIDTH + x;
+      p[0] = (uint8_t)(c * 37);
+      p[1] = (uint8_t)(c * 91 + (c >> 8));
+      p[2] = (uint8_t)(c * 13 + 5);
+      p[3] = (uint8_t)((num_colors > 0) ? (c & 1) ? 0x80 : 0xff : 0xff);
+    }
+  }
+}
+
+// Returns true if the indexed decoding of 'data' matches its RGBA decoding.
+// 'expect_indexed' tells whether the image should be accepted at all.
+static int Check(const char* const name, const uint8_t* const data,
+                 size_t size, int expect_indexed) {
+  uint8_t palette[256 * 4];
+  int width = 0, height = 0, palette_size = 0;
+  int rgba_width, rgba_height;
+  int ok = 1;
+  uint8_t* const indices =
+      WebPDecodeIndexed(data, size, &width, &height, palette, &palette_size);
+  uint8_t* const rgba = WebPDecodeRGBA(data, size, &rgba_width, &rgba_height);
+
+  if (rgba == NULL) {
+    fprintf(stderr, "%s: WebPDecodeRGBA() failed\n", name);
+    ok = 0;
+  } else if (!expect_indexed) {
+    if (indices != NULL) {
+      fprintf(stderr, "%s: unexpectedly decoded as indexed\n", name);
+      ok = 0;
+    }
+  } else if (indices == NULL) {
+    fprintf(stderr, "%s: WebPDecodeIndexed() failed\n", name);
+    ok = 0;
+  } else if (width != rgba_width || height != rgba_height ||
+             palette_size < 1 || palette_size > 256) {
+    fprintf(stderr, "%s: bad dimensions or palette size\n", name);
+    ok = 0;
+  } else {
+    int i;
+    for (i = 0; i < width * height; ++i) {
+      if (indices[i] >= palette_size ||
+          memcmp(palette + 4 * indices[i], rgba + 4 * i, 4)) {
+        fprintf(stderr, "%s: mismatch at pixel %d\n", name, i);
+        ok = 0;
+        break;
+      }
+    }
+  }
+  WebPFree(indices);
+  WebPFree(rgba);
+  return ok;
+}
+
+int main(void) {
+  static const int kNumColors[] = { 2, 4, 16, 200 };
+  uint8_t* const rgba = (uint8_t*)malloc(WIDTH * HEIGHT * 4);
+  int ok = (rgba != NULL);
+  size_t i;
+
+  // Paletted lossless, covering the 1, 2, 4 and 8 bits-per-index packings.
+  for (i = 0; ok && i < sizeof(kNumColors) / sizeof(kNumColors[0]); ++i) {
+    uint8_t* out = NULL;
+    size_t size;
+    char name[32];
+    MakePicture(rgba, kNumColors[i]);
+    size = WebPEncodeLosslessRGBA(rgba, WIDTH, HEIGHT, WIDTH * 4, &out);
+    snprintf(name, sizeof(name), "lossless, %d colors", kNumColors[i]);
+    ok = (size > 0) && Check(name, out, size, 1);
+    WebPFree(out);
+  }
+  if (ok) {   // Lossless without palette.
+    uint8_t* out = NULL;
+    size_t size;
+    MakePicture(rgba, 0);
+    size = WebPEncodeLosslessRGBA(rgba, WIDTH, HEIGHT, WIDTH * 4, &out);
+    ok = (size > 0) && Check("lossless, no palette", out, size, 0);
+    WebPFree(out);
+  }
+  if (ok) {   // Lossy.
+    uint8_t* out = NULL;
+    size_t size;
+    MakePicture(rgba, 16);
+    size = WebPEncodeRGBA(rgba, WIDTH, HEIGHT, WIDTH * 4, 75.f, &out);
+    ok = (size > 0) && Check("lossy", out, size, 0);
+    WebPFree(out);
+  }
+  free(rgba);
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
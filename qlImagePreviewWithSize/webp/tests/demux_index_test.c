@@ -0,0 +1,171 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Checks that WebPDemuxIndexNew() accepts the same files as WebPDemux(),
+// in particular regarding the frame positions on the canvas. The files are
+// made of a lossless picture wrapped in hand-written VP8X, ANIM and ANMF
+// chunks. See README.txt for how to build and run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/webp/decode.h"
+#include "src/webp/demux.h"
+#include "src/webp/encode.h"
+
+#define FRAME_SIZE 40
+
+typedef struct {
+  uint8_t bytes[4096];
+  size_t size;
+} File;
+
+static void PutLE16(uint8_t* const data, int v) {
+  data[0] = (uint8_t)(v >> 0);
+  data[1] = (uint8_t)(v >> 8);
+}
+
+static void PutLE24(uint8_t* const data, int v) {
+  PutLE16(data, v & 0xffff);
+  data[2] = (uint8_t)(v >> 16);
+}
+
+static void PutLE32(uint8_t* const data, uint32_t v) {
+  PutLE16(data, (int)(v & 0xffff));
+  PutLE16(data + 2, (int)(v >> 16));
+}
+
+static uint8_t* AddChunk(File* const file, const char fourcc[4],
+                         size_t size) {
+  uint8_t* const chunk = file->bytes + file->size;
+  memcpy(chunk, fourcc, 4);
+  PutLE32(chunk + 4, (uint32_t)size);
+  file->size += 8 + size + (size & 1);
+  return chunk + 8;
+}
+
+// Makes a file with a canvas of 'canvas_width' x 'canvas_height' holding the
+// VP8L chunk 'image' of a FRAME_SIZE x FRAME_SIZE picture, at the given
+// offsets for an animation or as is for a still image.
+static void MakeFile(File* const file, const uint8_t* const image,
+                     size_t image_size, int canvas_width, int canvas_height,
+                     int animated, int x_offset, int y_offset) {
+  uint8_t* data;
+  memset(file, 0, sizeof(*file));
+  memcpy(file->bytes, "RIFF\0\0\0\0WEBP", 12);
+  file->size = 12;
+  data = AddChunk(file, "VP8X", 10);
+  data[0] = animated ? ANIMATION_FLAG : 0;
+  PutLE24(data + 4, canvas_width - 1);
+  PutLE24(data + 7, canvas_height - 1);
+  if (animated) {
+    data = AddChunk(file, "ANIM", 6);
+    PutLE32(data, 0xffffffffu);
+    data = AddChunk(file, "ANMF", 16 + image_size);
+    PutLE24(data + 0, x_offset / 2);
+    PutLE24(data + 3, y_offset / 2);
+    PutLE24(data + 6, FRAME_SIZE - 1);
+    PutLE24(data + 9, FRAME_SIZE - 1);
+    PutLE24(data + 12, 100);
+    memcpy(data + 16, image, image_size);
+  } else {
+    memcpy(file->bytes + file->size, image, image_size);
+    file->size += image_size;
+  }
+  PutLE32(file->bytes + 4, (uint32_t)(file->size - 8));
+}
+
+static size_t ReadFile(void* user_data, uint64_t offset, uint8_t* buffer,
+                       size_t size) {
+  const File* const file = (const File*)user_data;
+  if (offset >= file->size) return 0;
+  if (size > file->size - offset) size = (size_t)(file->size - offset);
+  memcpy(buffer, file->bytes + offset, size);
+  return size;
+}
+
+// Returns true if both demuxers accept the file, or both reject it, as
+// 'expect_valid' tells.
+static int Check(const char* const name, const File* const file,
+                 int expect_valid) {
+  WebPData data;
+  WebPDemuxer* demux;
+  WebPDemuxIndex* index;
+  int ok = 1;
+  data.bytes = file->bytes;
+  data.size = file->size;
+  demux = WebPDemux(&data);
+  index = WebPDemuxIndexNew(ReadFile, (void*)file);
+  if ((demux != NULL) != expect_valid) {
+    fprintf(stderr, "%s: WebPDemux() %s the file\n", name,
+            expect_valid ? "rejected" : "accepted");
+    ok = 0;
+  }
+  if ((index != NULL) != expect_valid) {
+    fprintf(stderr, "%s: WebPDemuxIndexNew() %s the file\n", name,
+            expect_valid ? "rejected" : "accepted");
+    ok = 0;
+  }
+  if (ok && expect_valid) {
+    WebPIterator iter;
+    WebPFrameInfo info;
+    if (!WebPDemuxGetFrame(demux, 1, &iter) ||
+        !WebPDemuxIndexGetFrame(index, 1, &info) ||
+        iter.x_offset != info.x_offset || iter.y_offset != info.y_offset ||
+        iter.width != info.width || iter.height != info.height ||
+        iter.fragment.bytes != file->bytes + info.offset ||
+        iter.fragment.size != info.size) {
+      fprintf(stderr, "%s: different frame descriptions\n", name);
+      ok = 0;
+    }
+    WebPDemuxReleaseIterator(&iter);
+  }
+  WebPDemuxDelete(demux);
+  WebPDemuxIndexDelete(index);
+  return ok;
+}
+
+int main(void) {
+  static File file;
+  uint8_t* const rgba = (uint8_t*)calloc(FRAME_SIZE * FRAME_SIZE, 4);
+  uint8_t* webp = NULL;
+  size_t webp_size = 0;
+  int ok = (rgba != NULL);
+
+  if (ok) {
+    webp_size = WebPEncodeLosslessRGBA(rgba, FRAME_SIZE, FRAME_SIZE,
+                                       FRAME_SIZE * 4, &webp);
+    // Only the VP8L chunk following the RIFF header is kept.
+    ok = (webp_size > 12 && !memcmp(webp + 12, "VP8L", 4));
+  }
+  if (ok) {
+    const uint8_t* const image = webp + 12;
+    const size_t image_size = webp_size - 12;
+    MakeFile(&file, image, image_size, FRAME_SIZE, FRAME_SIZE, 1, 0, 0);
+    ok &= Check("animation", &file, 1);
+    MakeFile(&file, image, image_size, FRAME_SIZE + 2, FRAME_SIZE + 4,
+             1, 2, 4);
+    ok &= Check("animation, offset frame", &file, 1);
+    MakeFile(&file, image, image_size, FRAME_SIZE, FRAME_SIZE, 1, 65534, 0);
+    ok &= Check("animation, x_offset 65534", &file, 0);
+    MakeFile(&file, image, image_size, FRAME_SIZE + 2, FRAME_SIZE, 1, 4, 0);
+    ok &= Check("animation, frame past the right edge", &file, 0);
+    MakeFile(&file, image, image_size, FRAME_SIZE, FRAME_SIZE + 2, 1, 0, 4);
+    ok &= Check("animation, frame past the bottom edge", &file, 0);
+    MakeFile(&file, image, image_size, FRAME_SIZE, FRAME_SIZE, 0, 0, 0);
+    ok &= Check("still image", &file, 1);
+    MakeFile(&file, image, image_size, FRAME_SIZE + 1, FRAME_SIZE, 0, 0, 0);
+    ok &= Check("still image, larger canvas", &file, 0);
+  }
+  WebPFree(webp);
+  free(rgba);
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,404 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Checks that the SSE2, SSE4.1 and AVX2 versions of the decoding dsp
+// functions are bit-exact with the C ones. VP8GetCPUInfo is replaced by
+// functions hiding some of the CPU features, so that each WebPInit*() call
+// sets up the functions of a given level. Levels the CPU doesn't support are
+// compared too, but only use the C code. Also checks that the premultiplied
+// samplers and upsamplers give the same result as converting to RGBA and then
+// premultiplying, and the in-place 16b conversions at each level. See
+// README.txt for how to build and run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/dsp.h"
+#include "src/dsp/lossless.h"
+#include "src/dsp/yuv.h"
+#include "src/webp/decode.h"
+#include "src/webp/encode.h"
+
+//------------------------------------------------------------------------------
+// CPU feature levels
+
+static VP8CPUInfo g_cpu_info = NULL;   // the real one
+
+static int CPUInfoC(CPUFeature feature) {
+  (void)feature;
+  return 0;
+}
+
+static int CPUInfoSSE2(CPUFeature feature) {
+  return (feature == kSSE2) && g_cpu_info(feature);
+}
+
+static int CPUInfoSSE41(CPUFeature feature) {
+  return (feature == kSSE2 || feature == kSSE3 || feature == kSSE4_1) &&
+         g_cpu_info(feature);
+}
+
+static int CPUInfoAVX2(CPUFeature feature) {
+  return g_cpu_info(feature);
+}
+
+static const struct {
+  const char* name;
+  VP8CPUInfo info;
+} kLevels[] = {
+  { "C", CPUInfoC }, { "SSE2", CPUInfoSSE2 }, { "SSE4.1", CPUInfoSSE41 },
+  { "AVX2", CPUInfoAVX2 }
+};
+#define NUM_LEVELS ((int)(sizeof(kLevels) / sizeof(kLevels[0])))
+
+//------------------------------------------------------------------------------
+// Samplers and upsamplers
+
+#define MAX_LEN 300
+#define NUM_TESTS 3000
+
+static const WEBP_CSP_MODE kModes[] = {
+  MODE_RGB, MODE_RGBA, MODE_BGR, MODE_BGRA, MODE_ARGB, MODE_RGBA_4444,
+  MODE_RGB_565, MODE_rgbA, MODE_bgrA, MODE_Argb, MODE_rgbA_4444
+};
+#define NUM_MODES ((int)(sizeof(kModes) / sizeof(kModes[0])))
+
+typedef struct {
+  uint8_t y[2][MAX_LEN];
+  uint8_t a[2][MAX_LEN];
+  uint8_t u[2][MAX_LEN / 2 + 1], v[2][MAX_LEN / 2 + 1];
+  uint8_t dst[2][MAX_LEN * 4 + 16];   // with some room to detect overwrites
+} Rows;
+
+static void RandomRows(Rows* const rows) {
+  int i, j;
+  for (j = 0; j < 2; ++j) {
+    for (i = 0; i < MAX_LEN; ++i) rows->y[j][i] = (uint8_t)rand();
+    for (i = 0; i < MAX_LEN; ++i) {
+      // mostly opaque or transparent pixels, as in real pictures
+      const int r = rand() % 4;
+      rows->a[j][i] = (r == 0) ? 0xff : (r == 1) ? 0 : (uint8_t)rand();
+    }
+    for (i = 0; i < MAX_LEN / 2 + 1; ++i) {
+      rows->u[j][i] = (uint8_t)rand();
+      rows->v[j][i] = (uint8_t)rand();
+    }
+  }
+}
+
+// Runs one of the row functions at the given level on 'in', to 'out'.
+static void Convert(int level, int func, WEBP_CSP_MODE mode, int len,
+                    int with_bottom, const Rows* const in, Rows* const out) {
+  VP8GetCPUInfo = kLevels[level].info;
+  memset(out->dst, 0x5a, sizeof(out->dst));
+  if (func == 0) {
+    WebPInitSamplers();
+    WebPSamplers[mode](in->y[0], in->u[0], in->v[0], out->dst[0], len);
+  } else if (func == 1) {
+    WebPInitYUV444Converters();
+    if (WebPYUV444Converters[mode] != NULL) {
+      WebPYUV444Converters[mode](in->y[0], in->y[1], in->u[1], out->dst[0],
+                                 len / 2 + 1);
+    }
+  } else if (func == 2) {
+    WebPInitUpsamplers();
+    WebPUpsamplers[mode](in->y[0], with_bottom ? in->y[1] : NULL,
+                         in->u[0], in->v[0], in->u[1], in->v[1],
+                         out->dst[0], with_bottom ? out->dst[1] : NULL, len);
+  } else if (func == 3) {
+    WebPInitSamplers();
+    if (WebPPremultipliedSamplers[mode] != NULL) {
+      WebPPremultipliedSamplers[mode](in->y[0], in->u[0], in->v[0], in->a[0],
+                                      out->dst[0], len);
+    }
+  } else {
+    WebPInitUpsamplers();
+    if (WebPPremultipliedUpsamplers[mode] != NULL) {
+      WebPPremultipliedUpsamplers[mode](
+          in->y[0], with_bottom ? in->y[1] : NULL,
+          in->u[0], in->v[0], in->u[1], in->v[1],
+          in->a[0], with_bottom ? in->a[1] : NULL,
+          out->dst[0], with_bottom ? out->dst[1] : NULL, len);
+    }
+  }
+}
+
+// Converts with the sampler (func 3) or upsampler (func 4) of the
+// non-premultiplied 'mode', then stores the alpha values and premultiplies.
+static void ConvertInTwoPasses(int func, WEBP_CSP_MODE mode, int len,
+                               int with_bottom, const Rows* const in,
+                               Rows* const out) {
+  const int alpha_first = (mode == MODE_Argb);
+  const WEBP_CSP_MODE plain_mode = (mode == MODE_rgbA) ? MODE_RGBA
+                                 : (mode == MODE_bgrA) ? MODE_BGRA
+                                 : MODE_ARGB;
+  const int num_rows = (func == 4 && with_bottom) ? 2 : 1;
+  int i, j;
+  Convert(0, (func == 3) ? 0 : 2, plain_mode, len, with_bottom, in, out);
+  WebPInitAlphaProcessing();
+  for (j = 0; j < num_rows; ++j) {
+    for (i = 0; i < len; ++i) {
+      out->dst[j][4 * i + (alpha_first ? 0 : 3)] = in->a[j][i];
+    }
+    WebPApplyAlphaMultiply(out->dst[j], alpha_first, len, 1, 4 * len);
+  }
+}
+
+static int CheckRowFunctions(void) {
+  static const char* const kFuncs[] = {
+    "WebPSamplers", "WebPYUV444Converters", "WebPUpsamplers",
+    "WebPPremultipliedSamplers", "WebPPremultipliedUpsamplers"
+  };
+  static const WEBP_CSP_MODE kPremultipliedModes[] = {
+    MODE_rgbA, MODE_bgrA, MODE_Argb
+  };
+  static Rows in, ref, out;
+  int n, level;
+  for (n = 0; n < NUM_TESTS; ++n) {
+    const int func = n % 5;
+    const WEBP_CSP_MODE mode = (func < 3) ? kModes[rand() % NUM_MODES]
+                                          : kPremultipliedModes[rand() % 3];
+    const int len = 1 + rand() % MAX_LEN;
+    const int with_bottom = rand() & 1;
+    RandomRows(&in);
+    Convert(0, func, mode, len, with_bottom, &in, &ref);
+    if (func >= 3) {
+      ConvertInTwoPasses(func, mode, len, with_bottom, &in, &out);
+      if (memcmp(ref.dst, out.dst, sizeof(ref.dst))) {
+        fprintf(stderr, "%s[%d]: mismatch with the two-pass conversion for "
+                "length %d\n", kFuncs[func], mode, len);
+        return 0;
+      }
+    }
+    for (level = 1; level < NUM_LEVELS; ++level) {
+      Convert(level, func, mode, len, with_bottom, &in, &out);
+      if (memcmp(ref.dst, out.dst, sizeof(ref.dst))) {
+        fprintf(stderr, "%s[%d] (%s): mismatch for length %d\n",
+                kFuncs[func], mode, kLevels[level].name, len);
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+// Rescaling, through the whole decoding
+
+#define WIDTH  257
+#define HEIGHT 131
+
+static uint8_t* Decode(int level, const uint8_t* const data, size_t size,
+                       WEBP_CSP_MODE mode, int filter, int width, int height) {
+  WebPDecoderConfig config;
+  if (!WebPInitDecoderConfig(&config)) return NULL;
+  VP8GetCPUInfo = kLevels[level].info;
+  config.output.colorspace = mode;
+  config.options.use_scaling = 1;
+  config.options.scaled_width = width;
+  config.options.scaled_height = height;
+  config.options.scaling_filter = filter;
+  if (WebPDecode(data, size, &config) != VP8_STATUS_OK) return NULL;
+  // The Y, U and V planes are contiguous in memory.
+  return WebPIsRGBMode(mode) ? config.output.u.RGBA.rgba
+                             : config.output.u.YUVA.y;
+}
+
+static size_t OutputSize(WEBP_CSP_MODE mode, int width, int height) {
+  const int uv_width = (width + 1) / 2, uv_height = (height + 1) / 2;
+  return WebPIsRGBMode(mode) ? (size_t)width * height * 4
+                             : (size_t)width * height +
+                               2 * (size_t)uv_width * uv_height;
+}
+
+static int CheckRescaling(void) {
+  static const int kSizes[][2] = {
+    { 100, 50 }, { 17, 200 }, { 400, 260 }, { 1, 1 }
+  };
+  static const WEBP_CSP_MODE kScaledModes[] = { MODE_RGBA, MODE_YUV };
+  uint8_t* const rgba = (uint8_t*)malloc(WIDTH * HEIGHT * 4);
+  uint8_t* data[2] = { NULL, NULL };
+  size_t size[2];
+  int ok = (rgba != NULL);
+  int i, x, y, filter, s, m, level;
+
+  if (ok) {
+    for (y = 0; y < HEIGHT; ++y) {
+      for (x = 0; x < WIDTH; ++x) {
+        uint8_t* const p = rgba + 4 * (y * WIDTH + x);
+        p[0] = (uint8_t)(x * y);
+        p[1] = (uint8_t)((x ^ y) * 3);
+        p[2] = (uint8_t)rand();
+        p[3] = (uint8_t)(x + 2 * y);
+      }
+    }
+    size[0] = WebPEncodeRGBA(rgba, WIDTH, HEIGHT, WIDTH * 4, 80.f, &data[0]);
+    size[1] = WebPEncodeLosslessRGBA(rgba, WIDTH, HEIGHT, WIDTH * 4, &data[1]);
+    ok = (size[0] > 0 && size[1] > 0);
+  }
+  for (i = 0; ok && i < 2; ++i) {
+    for (filter = WEBP_SCALING_DEFAULT; ok && filter < WEBP_SCALING_FILTER_LAST;
+         ++filter) {
+      for (s = 0; ok && s < (int)(sizeof(kSizes) / sizeof(kSizes[0])); ++s) {
+        for (m = 0; ok && m < 2; ++m) {
+          const WEBP_CSP_MODE mode = kScaledModes[m];
+          const int w = kSizes[s][0], h = kSizes[s][1];
+          uint8_t* const ref = Decode(0, data[i], size[i], mode, filter, w, h);
+          ok = (ref != NULL);
+          for (level = 1; ok && level < NUM_LEVELS; ++level) {
+            uint8_t* const out =
+                Decode(level, data[i], size[i], mode, filter, w, h);
+            if (out == NULL ||
+                memcmp(ref, out, OutputSize(mode, w, h))) {
+              fprintf(stderr, "%s rescaling (%s, filter %d, %dx%d, mode %d)"
+                      ": mismatch\n", i ? "lossless" : "lossy",
+                      kLevels[level].name, filter, w, h, mode);
+              ok = 0;
+            }
+            WebPFree(out);
+          }
+          WebPFree(ref);
+        }
+      }
+    }
+  }
+  WebPFree(data[0]);
+  WebPFree(data[1]);
+  free(rgba);
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// Premultiplied output, through the whole decoding
+
+static uint8_t* DecodeRGB(int level, const uint8_t* const data, size_t size,
+                          WEBP_CSP_MODE mode, int fancy, int crop) {
+  WebPDecoderConfig config;
+  if (!WebPInitDecoderConfig(&config)) return NULL;
+  VP8GetCPUInfo = kLevels[level].info;
+  config.output.colorspace = mode;
+  config.options.no_fancy_upsampling = !fancy;
+  if (crop) {
+    config.options.use_cropping = 1;
+    config.options.crop_left = 6;
+    config.options.crop_top = 17;
+    config.options.crop_width = 201;
+    config.options.crop_height = 97;
+  }
+  if (WebPDecode(data, size, &config) != VP8_STATUS_OK) return NULL;
+  return config.output.u.RGBA.rgba;
+}
+
+static int CheckPremultipliedDecoding(void) {
+  static const WEBP_CSP_MODE kPlainModes[] = {
+    MODE_RGBA, MODE_BGRA, MODE_ARGB
+  };
+  static const WEBP_CSP_MODE kPremultipliedModes[] = {
+    MODE_rgbA, MODE_bgrA, MODE_Argb
+  };
+  uint8_t* const rgba = (uint8_t*)malloc(WIDTH * HEIGHT * 4);
+  uint8_t* data = NULL;
+  size_t size = 0;
+  int ok = (rgba != NULL);
+  int x, y, m, fancy, crop, level;
+
+  if (ok) {
+    for (y = 0; y < HEIGHT; ++y) {
+      for (x = 0; x < WIDTH; ++x) {
+        uint8_t* const p = rgba + 4 * (y * WIDTH + x);
+        p[0] = (uint8_t)(x * y);
+        p[1] = (uint8_t)((x ^ y) * 3);
+        p[2] = (uint8_t)rand();
+        p[3] = (x < 40) ? 0 : (x >= 200) ? 0xff : (uint8_t)(x + 2 * y);
+      }
+    }
+    size = WebPEncodeRGBA(rgba, WIDTH, HEIGHT, WIDTH * 4, 80.f, &data);
+    ok = (size > 0);
+  }
+  for (m = 0; ok && m < 3; ++m) {
+    for (fancy = 0; ok && fancy <= 1; ++fancy) {
+      for (crop = 0; ok && crop <= 1; ++crop) {
+        const int w = crop ? 201 : WIDTH, h = crop ? 97 : HEIGHT;
+        uint8_t* const ref = DecodeRGB(0, data, size, kPlainModes[m],
+                                       fancy, crop);
+        ok = (ref != NULL);
+        if (ok) {
+          WebPInitAlphaProcessing();
+          WebPApplyAlphaMultiply(ref, kPlainModes[m] == MODE_ARGB, w, h, w * 4);
+        }
+        for (level = 0; ok && level < NUM_LEVELS; ++level) {
+          uint8_t* const out = DecodeRGB(level, data, size,
+                                         kPremultipliedModes[m], fancy, crop);
+          if (out == NULL || memcmp(ref, out, (size_t)w * h * 4)) {
+            fprintf(stderr, "premultiplied decoding (%s, mode %d%s%s): "
+                    "mismatch\n", kLevels[level].name, kPremultipliedModes[m],
+                    fancy ? ", fancy" : "", crop ? ", cropped" : "");
+            ok = 0;
+          }
+          WebPFree(out);
+        }
+        WebPFree(ref);
+      }
+    }
+  }
+  WebPFree(data);
+  free(rgba);
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// 8b -> 16b RGBA conversions, in place
+
+static int CheckConversionsTo16b(void) {
+  static const WEBP_CSP_MODE k16bModes[] = {
+    MODE_RGBA_16, MODE_RGBA_F16, MODE_RGBA_16_LINEAR, MODE_RGBA_F16_LINEAR
+  };
+  static uint8_t src[MAX_LEN * 4];
+  // with some room to detect overwrites
+  static uint16_t ref[MAX_LEN * 4 + 8], out[MAX_LEN * 4 + 8];
+  int len, m, level, i;
+  for (len = 1; len <= MAX_LEN; ++len) {
+    for (m = 0; m < 4; ++m) {
+      for (i = 0; i < 4 * len; ++i) src[i] = (uint8_t)rand();
+      for (level = 0; level < NUM_LEVELS; ++level) {
+        uint16_t* const dst = (level == 0) ? ref : out;
+        // the RGBA samples are in the second half of the destination row
+        memset(dst, 0x5a, sizeof(ref));
+        memcpy(dst + 2 * len, src, 4 * len);
+        VP8GetCPUInfo = kLevels[level].info;
+        WebPInitAlphaProcessing();
+        WebPConvertRGBATo16b((const uint8_t*)(dst + 2 * len), len,
+                             k16bModes[m], dst);
+        if (level > 0 && memcmp(ref, out, sizeof(ref))) {
+          fprintf(stderr, "16b conversion (%s, mode %d): mismatch for "
+                  "length %d\n", kLevels[level].name, k16bModes[m], len);
+          return 0;
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+
+int main(void) {
+  int ok;
+  g_cpu_info = VP8GetCPUInfo;
+  if (g_cpu_info == NULL) {
+    printf("PASS (no CPU detection, nothing to compare)\n");
+    return 0;
+  }
+  ok = CheckRowFunctions() && CheckRescaling() &&
+       CheckPremultipliedDecoding() && CheckConversionsTo16b();
+  VP8GetCPUInfo = g_cpu_info;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Checks that the SSE2 and AVX2 alpha filters and unfilters are bit-exact
+// with the C ones, for every row width up to MAX_WIDTH and several kinds of
+// data, in place or not. The CPU features are hidden as in dsp_test.c. See
+// README.txt for how to build and run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/dsp.h"
+
+static VP8CPUInfo g_cpu_info = NULL;   // the real one
+
+static int CPUInfoC(CPUFeature feature) {
+  (void)feature;
+  return 0;
+}
+
+static int CPUInfoSSE2(CPUFeature feature) {
+  return (feature == kSSE2) && g_cpu_info(feature);
+}
+
+static int CPUInfoAVX2(CPUFeature feature) {
+  return g_cpu_info(feature);
+}
+
+static const struct {
+  const char* name;
+  VP8CPUInfo info;
+} kLevels[] = {
+  { "C", CPUInfoC }, { "SSE2", CPUInfoSSE2 }, { "AVX2", CPUInfoAVX2 }
+};
+#define NUM_LEVELS ((int)(sizeof(kLevels) / sizeof(kLevels[0])))
+
+static const char* const kFilterNames[WEBP_FILTER_LAST] = {
+  "none", "horizontal", "vertical", "gradient"
+};
+
+#define MAX_WIDTH 1100
+#define HEIGHT 4
+#define NUM_KINDS 4
+
+// Fills 'data' with one of the NUM_KINDS kinds of samples: noise, smooth
+// gradients, values near 0 and 255 (where the gradient predictor clips), and
+// small deltas around a constant.
+static void FillData(uint8_t* const data, int size, int kind) {
+  int i;
+  for (i = 0; i < size; ++i) {
+    const int r = rand();
+    switch (kind) {
+      case 0: data[i] = (uint8_t)r; break;
+      case 1: data[i] = (uint8_t)((i * 3) / 7 + (r & 3)); break;
+      case 2: data[i] = (r & 1) ? (uint8_t)(r >> 8) % 4
+                                : (uint8_t)(255 - (r >> 8) % 4); break;
+      default: data[i] = (uint8_t)(128 + (r & 7) - 4); break;
+    }
+  }
+}
+
+static void SetLevel(int level) {
+  VP8GetCPUInfo = kLevels[level].info;
+  VP8FiltersInit();
+}
+
+// Unfilters each row of 'in' into 'out', or in place if 'in_place' is true.
+static void Unfilter(WEBP_FILTER_TYPE filter, const uint8_t* const in,
+                     uint8_t* const out, int width, int in_place) {
+  const uint8_t* prev = NULL;
+  int y;
+  if (in_place) memcpy(out, in, width * HEIGHT);
+  for (y = 0; y < HEIGHT; ++y) {
+    uint8_t* const dst = out + y * width;
+    WebPUnfilters[filter](prev, in_place ? dst : in + y * width, dst, width);
+    prev = dst;
+  }
+}
+
+static int CheckUnfilters(void) {
+  static uint8_t in[MAX_WIDTH * HEIGHT];
+  static uint8_t ref[MAX_WIDTH * HEIGHT], out[MAX_WIDTH * HEIGHT];
+  int width, kind, filter, level, in_place;
+  for (width = 1; width <= MAX_WIDTH; ++width) {
+    for (kind = 0; kind < NUM_KINDS; ++kind) {
+      FillData(in, width * HEIGHT, kind);
+      for (filter = WEBP_FILTER_HORIZONTAL; filter < WEBP_FILTER_LAST;
+           ++filter) {
+        SetLevel(0);
+        Unfilter((WEBP_FILTER_TYPE)filter, in, ref, width, 0);
+        for (level = 0; level < NUM_LEVELS; ++level) {
+          SetLevel(level);
+          for (in_place = 0; in_place <= 1; ++in_place) {
+            memset(out, 0, sizeof(out));
+            Unfilter((WEBP_FILTER_TYPE)filter, in, out, width, in_place);
+            if (memcmp(ref, out, width * HEIGHT)) {
+              fprintf(stderr, "%s unfilter (%s%s): mismatch for width %d, "
+                      "data kind %d\n", kFilterNames[filter],
+                      kLevels[level].name, in_place ? ", in place" : "",
+                      width, kind);
+              return 0;
+            }
+          }
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+// Filters the picture at each level, and checks that unfiltering it gives the
+// original picture back.
+static int CheckFilters(void) {
+  static uint8_t in[MAX_WIDTH * HEIGHT];
+  static uint8_t ref[MAX_WIDTH * HEIGHT], out[MAX_WIDTH * HEIGHT];
+  static uint8_t back[MAX_WIDTH * HEIGHT];
+  int width, kind, filter, level;
+  for (width = 1; width <= MAX_WIDTH; ++width) {
+    for (kind = 0; kind < NUM_KINDS; ++kind) {
+      FillData(in, width * HEIGHT, kind);
+      for (filter = WEBP_FILTER_HORIZONTAL; filter < WEBP_FILTER_LAST;
+           ++filter) {
+        SetLevel(0);
+        WebPFilters[filter](in, width, HEIGHT, width, ref);
+        for (level = 0; level < NUM_LEVELS; ++level) {
+          SetLevel(level);
+          WebPFilters[filter](in, width, HEIGHT, width, out);
+          Unfilter((WEBP_FILTER_TYPE)filter, out, back, width, 0);
+          if (memcmp(ref, out, width * HEIGHT) ||
+              memcmp(in, back, width * HEIGHT)) {
+            fprintf(stderr, "%s filter (%s): mismatch for width %d, "
+                    "data kind %d\n", kFilterNames[filter],
+                    kLevels[level].name, width, kind);
+            return 0;
+          }
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+int main(void) {
+  int ok;
+  g_cpu_info = VP8GetCPUInfo;
+  if (g_cpu_info == NULL) {
+    printf("PASS (no CPU detection, nothing to compare)\n");
+    return 0;
+  }
+  ok = CheckUnfilters() && CheckFilters();
+  VP8GetCPUInfo = g_cpu_info;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
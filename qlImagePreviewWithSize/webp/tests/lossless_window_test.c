@@ -0,0 +1,221 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Checks the windowed lossless decoding ('lossless_window_rows') against
+// WebPDecodeRGBA(). The pictures repeat rows from far above, so that windows
+// of 1 and 3 rows are exceeded and the decoder has to scan the image and
+// restart with a larger window, with and without threads. Negative values
+// (scan first) and rescaled output are checked too. See README.txt for how to
+// build and run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/webp/decode.h"
+#include "src/webp/encode.h"
+
+#define WIDTH  64
+#define HEIGHT 400
+
+static uint32_t Random(uint32_t* const seed) {
+  *seed = *seed * 1103515245u + 12345u;
+  return *seed >> 16;
+}
+
+// Rows of noise, each one repeating the row 'period' rows above once past
+// the first 'period' rows. Only back-references 'period' rows away can
+// compress it. If 'alpha' is false, the picture is opaque.
+static void MakePicture(uint8_t* const rgba, int period, int alpha) {
+  uint32_t seed = (uint32_t)period;
+  int x, y;
+  for (y = 0; y < HEIGHT; ++y) {
+    for (x = 0; x < WIDTH; ++x) {
+      uint8_t* const p = rgba + 4 * (y * WIDTH + x);
+      if (y >= period && (Random(&seed) & 63) != 0) {
+        memcpy(p, p - 4 * period * WIDTH, 4);
+      } else {
+        p[0] = (uint8_t)Random(&seed);
+        p[1] = (uint8_t)Random(&seed);
+        p[2] = (uint8_t)Random(&seed);
+        p[3] = alpha ? (uint8_t)Random(&seed) : 0xff;
+      }
+    }
+  }
+}
+
+// Decodes 'data' to RGBA with the given options. Returns the output (to be
+// released with WebPFreeDecBuffer()) in 'output' and the peak memory use in
+// '*peak_memory', or false on error.
+static int Decode(const uint8_t* const data, size_t size, int window_rows,
+                  int use_threads, int scaled_width, int scaled_height,
+                  WebPDecBuffer* const output, size_t* const peak_memory) {
+  WebPDecoderConfig config;
+  if (!WebPInitDecoderConfig(&config)) return 0;
+  config.output.colorspace = MODE_RGBA;
+  config.options.lossless_window_rows = window_rows;
+  config.options.use_threads = use_threads;
+  if (scaled_width > 0) {
+    config.options.use_scaling = 1;
+    config.options.scaled_width = scaled_width;
+    config.options.scaled_height = scaled_height;
+  }
+  if (WebPDecode(data, size, &config) != VP8_STATUS_OK) {
+    WebPFreeDecBuffer(&config.output);
+    return 0;
+  }
+  *output = config.output;
+  *peak_memory = config.peak_memory;
+  return 1;
+}
+
+static int SameRGBA(const WebPDecBuffer* const a,
+                    const WebPDecBuffer* const b) {
+  const WebPRGBABuffer* const ra = &a->u.RGBA;
+  const WebPRGBABuffer* const rb = &b->u.RGBA;
+  int y;
+  if (a->width != b->width || a->height != b->height) return 0;
+  for (y = 0; y < a->height; ++y) {
+    if (memcmp(ra->rgba + y * ra->stride, rb->rgba + y * rb->stride,
+               4 * a->width)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Decodes 'data' with each window and thread setting, and compares with the
+// plain decoding. Returns the peak memory use with the scanned window in
+// '*scan_peak_memory'.
+static int Check(const char* const name, const uint8_t* const data,
+                 size_t size, size_t* const scan_peak_memory) {
+  static const int kWindows[] = { -1, 1, 3, -5, HEIGHT + 10 };
+  int width, height;
+  int ok = 1;
+  int w, t;
+  uint8_t* const ref = WebPDecodeRGBA(data, size, &width, &height);
+  if (ref == NULL || width != WIDTH || height != HEIGHT) {
+    fprintf(stderr, "%s: WebPDecodeRGBA() failed\n", name);
+    WebPFree(ref);
+    return 0;
+  }
+  for (t = 0; ok && t <= 1; ++t) {
+    WebPDecBuffer full, scaled_ref;
+    size_t full_peak, scan_peak = 0, unused;
+    if (!Decode(data, size, 0, t, 0, 0, &full, &full_peak)) {
+      fprintf(stderr, "%s: decoding failed (threads: %d)\n", name, t);
+      ok = 0;
+      break;
+    }
+    WebPFreeDecBuffer(&full);
+    if (!Decode(data, size, 0, t, WIDTH / 3, HEIGHT / 3, &scaled_ref,
+                &unused)) {
+      fprintf(stderr, "%s: scaled decoding failed (threads: %d)\n", name, t);
+      ok = 0;
+      break;
+    }
+    for (w = 0; w < (int)(sizeof(kWindows) / sizeof(kWindows[0])); ++w) {
+      const int window_rows = kWindows[w];
+      WebPDecBuffer out, scaled;
+      size_t peak;
+      if (!Decode(data, size, window_rows, t, 0, 0, &out, &peak)) {
+        fprintf(stderr, "%s: window %d, threads %d: decoding failed\n",
+                name, window_rows, t);
+        ok = 0;
+        break;
+      }
+      if (out.width != WIDTH || out.height != HEIGHT ||
+          memcmp(out.u.RGBA.rgba, ref, 4 * WIDTH * HEIGHT)) {
+        fprintf(stderr, "%s: window %d, threads %d: output mismatch\n",
+                name, window_rows, t);
+        ok = 0;
+      }
+      WebPFreeDecBuffer(&out);
+      // The scanned window is smaller than the picture. Windows that are too
+      // small are replaced with it, so they use as much memory.
+      if (window_rows == -1) {
+        scan_peak = peak;
+        if (peak >= full_peak) {
+          fprintf(stderr, "%s: threads %d: no window\n", name, t);
+          ok = 0;
+        }
+      } else if (window_rows > 0 && window_rows <= 3 && peak < scan_peak) {
+        fprintf(stderr, "%s: window %d, threads %d: no restart\n",
+                name, window_rows, t);
+        ok = 0;
+      }
+      if (!Decode(data, size, window_rows, t, WIDTH / 3, HEIGHT / 3,
+                  &scaled, &unused)) {
+        fprintf(stderr, "%s: window %d, threads %d: scaled decoding failed\n",
+                name, window_rows, t);
+        ok = 0;
+        break;
+      }
+      if (!SameRGBA(&scaled, &scaled_ref)) {
+        fprintf(stderr, "%s: window %d, threads %d: scaled output mismatch\n",
+                name, window_rows, t);
+        ok = 0;
+      }
+      WebPFreeDecBuffer(&scaled);
+    }
+    WebPFreeDecBuffer(&scaled_ref);
+    *scan_peak_memory = scan_peak;
+  }
+  WebPFree(ref);
+  return ok;
+}
+
+int main(void) {
+  // Back-references of 2 rows (more than window 1, less than window 3) and
+  // of 150 rows (more than both).
+  static const int kPeriods[] = { 2, 150 };
+  size_t scan_peak[2][2];
+  uint8_t* const rgba = (uint8_t*)malloc(4 * WIDTH * HEIGHT);
+  int ok = (rgba != NULL);
+  int p, alpha;
+  for (p = 0; ok && p < (int)(sizeof(kPeriods) / sizeof(kPeriods[0])); ++p) {
+    for (alpha = 0; ok && alpha <= 1; ++alpha) {
+      WebPConfig config;
+      WebPPicture pic;
+      WebPMemoryWriter writer;
+      char name[32];
+      snprintf(name, sizeof(name), "period %d%s", kPeriods[p],
+               alpha ? " (alpha)" : "");
+      MakePicture(rgba, kPeriods[p], alpha);
+      if (!WebPConfigInit(&config) || !WebPPictureInit(&pic)) return 1;
+      config.lossless = 1;
+      config.quality = 100;
+      config.exact = 1;
+      pic.use_argb = 1;
+      pic.width = WIDTH;
+      pic.height = HEIGHT;
+      WebPMemoryWriterInit(&writer);
+      pic.writer = WebPMemoryWrite;
+      pic.custom_ptr = &writer;
+      if (!WebPPictureImportRGBA(&pic, rgba, 4 * WIDTH) ||
+          !WebPEncode(&config, &pic)) {
+        fprintf(stderr, "%s: encoding failed\n", name);
+        ok = 0;
+      } else {
+        ok = Check(name, writer.mem, writer.size, &scan_peak[p][alpha]);
+      }
+      WebPPictureFree(&pic);
+      WebPMemoryWriterClear(&writer);
+    }
+  }
+  // Makes sure the encoder did use the long back-references.
+  if (ok && (scan_peak[1][0] <= scan_peak[0][0] ||
+             scan_peak[1][1] <= scan_peak[0][1])) {
+    fprintf(stderr, "no long back-references\n");
+    ok = 0;
+  }
+  free(rgba);
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
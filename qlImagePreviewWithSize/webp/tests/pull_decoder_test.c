@@ -0,0 +1,396 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Checks the pull-based decoder (WebPPullDecoder*() and WebPDecodeFromReader())
+// on still pictures against WebPDecodeRGBA(), and on each frame of an
+// animation against WebPDemux() + WebPDecodeRGBA(). The bytes are provided in
+// pieces smaller than asked for, bytes at wrong offsets are refused, truncated
+// files end with data_size == 0 and VP8_STATUS_NOT_ENOUGH_DATA, and decoding
+// a frame only reads the chunk headers before it and its own chunk. The
+// animation is made of lossy, lossless and lossy + alpha frames wrapped in
+// hand-written VP8X, ANIM and ANMF chunks. See README.txt for how to build and
+// run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/webp/decode.h"
+#include "src/webp/demux.h"
+#include "src/webp/encode.h"
+
+#define NUM_FRAMES 3
+#define CANVAS_SIZE 64
+#define ANMF_HEADER_SIZE (8 + 16)   // chunk header and ANMF fields
+#define MAX_STEPS 1000000           // to catch decoders not making progress
+
+typedef struct {
+  uint8_t bytes[65536];
+  size_t size;
+} File;
+
+typedef struct {
+  size_t start, end;     // byte range of an ANMF chunk
+} Range;
+
+static const int kFrameSizes[NUM_FRAMES][2] = {
+  { 40, 30 }, { 24, 36 }, { 48, 20 }
+};
+
+static void PutLE16(uint8_t* const data, int v) {
+  data[0] = (uint8_t)(v >> 0);
+  data[1] = (uint8_t)(v >> 8);
+}
+
+static void PutLE24(uint8_t* const data, int v) {
+  PutLE16(data, v & 0xffff);
+  data[2] = (uint8_t)(v >> 16);
+}
+
+static void PutLE32(uint8_t* const data, uint32_t v) {
+  PutLE16(data, (int)(v & 0xffff));
+  PutLE16(data + 2, (int)(v >> 16));
+}
+
+static uint8_t* AddChunk(File* const file, const char fourcc[4],
+                         size_t size) {
+  uint8_t* const chunk = file->bytes + file->size;
+  memcpy(chunk, fourcc, 4);
+  PutLE32(chunk + 4, (uint32_t)size);
+  file->size += 8 + size + (size & 1);
+  return chunk + 8;
+}
+
+// Fills 'rgba' with a pattern depending on 'seed', opaque unless 'alpha'.
+static void MakePicture(uint8_t* const rgba, int width, int height, int seed,
+                        int alpha) {
+  int x, y;
+  for (y = 0; y < height; ++y) {
+    for (x = 0; x < width; ++x) {
+      uint8_t* const p = rgba + 4 * (y * width + x);
+      p[0] = (uint8_t)(x * 5 + seed * 40);
+      p[1] = (uint8_t)(y * 7 + (x ^ seed));
+      p[2] = (uint8_t)((x + y) * 3 * seed);
+      p[3] = alpha ? (uint8_t)(x * 9 + y) : 0xff;
+    }
+  }
+}
+
+// Encodes a picture into 'file'. Frame 0 is lossy, 1 lossless with alpha,
+// and 2 lossy with alpha.
+static int Encode(int frame, File* const file) {
+  const int width = kFrameSizes[frame][0], height = kFrameSizes[frame][1];
+  uint8_t rgba[48 * 36 * 4];
+  uint8_t* webp = NULL;
+  size_t size;
+  MakePicture(rgba, width, height, frame + 1, frame > 0);
+  size = (frame == 1) ? WebPEncodeLosslessRGBA(rgba, width, height, 4 * width,
+                                               &webp)
+                      : WebPEncodeRGBA(rgba, width, height, 4 * width, 80,
+                                       &webp);
+  if (size == 0 || size > sizeof(file->bytes)) {
+    WebPFree(webp);
+    return 0;
+  }
+  memcpy(file->bytes, webp, size);
+  file->size = size;
+  WebPFree(webp);
+  return 1;
+}
+
+// Appends the chunks of the still picture 'pic' to 'file', without the RIFF
+// header and the VP8X chunk.
+static void AddFrameChunks(File* const file, const File* const pic) {
+  size_t start = 12;
+  if (!memcmp(pic->bytes + start, "VP8X", 4)) start += 8 + 10;
+  memcpy(file->bytes + file->size, pic->bytes + start, pic->size - start);
+  file->size += pic->size - start;
+}
+
+// Makes an animation of the pictures, and stores the positions of the ANMF
+// chunks in 'frames'.
+static void MakeAnimation(File* const file, const File pics[NUM_FRAMES],
+                          Range frames[NUM_FRAMES]) {
+  uint8_t* data;
+  int i;
+  memset(file, 0, sizeof(*file));
+  memcpy(file->bytes, "RIFF\0\0\0\0WEBP", 12);
+  file->size = 12;
+  data = AddChunk(file, "VP8X", 10);
+  data[0] = ANIMATION_FLAG | ALPHA_FLAG;
+  PutLE24(data + 4, CANVAS_SIZE - 1);
+  PutLE24(data + 7, CANVAS_SIZE - 1);
+  data = AddChunk(file, "ANIM", 6);
+  PutLE32(data, 0xffffffffu);
+  for (i = 0; i < NUM_FRAMES; ++i) {
+    const size_t start = file->size;
+    data = AddChunk(file, "ANMF", 16);
+    PutLE24(data + 0, i * 4 / 2);
+    PutLE24(data + 3, i * 8 / 2);
+    PutLE24(data + 6, kFrameSizes[i][0] - 1);
+    PutLE24(data + 9, kFrameSizes[i][1] - 1);
+    PutLE24(data + 12, 100);
+    AddFrameChunks(file, &pics[i]);
+    PutLE32(file->bytes + start + 4, (uint32_t)(file->size - start - 8));
+    frames[i].start = start;
+    frames[i].end = file->size;
+  }
+  PutLE32(file->bytes + 4, (uint32_t)(file->size - 8));
+}
+
+// Returns true if the RGBA output of 'config' is the 'width' x 'height'
+// picture 'ref'.
+static int SameRGBA(const WebPDecoderConfig* const config,
+                    const uint8_t* const ref, int width, int height) {
+  const WebPRGBABuffer* const buf = &config->output.u.RGBA;
+  int y;
+  if (ref == NULL || config->output.width != width ||
+      config->output.height != height) {
+    return 0;
+  }
+  for (y = 0; y < height; ++y) {
+    if (memcmp(buf->rgba + y * buf->stride, ref + 4 * width * y, 4 * width)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Returns true if the range [start, end) can be read to decode frame
+// 'frame_num': the frame's chunk and the headers of the chunks before it.
+// 'frames' is NULL for a still picture.
+static int MayRead(size_t start, size_t end, const Range* const frames,
+                   int frame_num) {
+  int i;
+  if (frames == NULL) return 1;
+  if (frame_num == 0) frame_num = 1;
+  for (i = 0; i < NUM_FRAMES; ++i) {
+    const Range* const frame = &frames[i];
+    if (end <= frame->start || start >= frame->end) continue;
+    if (i == frame_num - 1) continue;
+    if (i > frame_num - 1 || end > frame->start + ANMF_HEADER_SIZE) return 0;
+  }
+  return 1;
+}
+
+// Decodes the frame 'frame_num' of 'data', which is cut after 'size' bytes,
+// with the pull decoder. At most 'max_provide' bytes are provided at a time,
+// 0 at the end of the data. Bytes at wrong offsets are provided first and
+// must be refused. Returns the status of the last step, or
+// VP8_STATUS_USER_ABORT if the decoder misbehaves. The caller releases
+// config->output.
+static VP8StatusCode PullDecode(const char* const name,
+                                const uint8_t* const data, size_t size,
+                                int frame_num, size_t max_provide,
+                                const Range* const frames,
+                                WebPDecoderConfig* const config) {
+  WebPPullDecoder* const dec = WebPPullDecoderNew(config, frame_num);
+  VP8StatusCode status = VP8_STATUS_OUT_OF_MEMORY;
+  WebPByteRange need;
+  int num_steps = 0;
+  if (dec == NULL) return status;
+  while ((status = WebPPullDecoderStep(dec, &need)) == VP8_STATUS_SUSPENDED) {
+    const size_t offset = (size_t)need.offset;
+    size_t num_bytes = need.size;
+    if (++num_steps > MAX_STEPS || need.size == 0 ||
+        need.offset + need.size < need.offset) {
+      fprintf(stderr, "%s: no progress\n", name);
+      status = VP8_STATUS_USER_ABORT;
+      break;
+    }
+    if (!MayRead(offset, offset + need.size, frames, frame_num)) {
+      fprintf(stderr, "%s: frame %d: asked for %d bytes at %d\n",
+              name, frame_num, (int)need.size, (int)offset);
+      status = VP8_STATUS_USER_ABORT;
+      break;
+    }
+    if (WebPPullDecoderProvide(dec, need.offset + 1, data, 0) !=
+            VP8_STATUS_INVALID_PARAM ||
+        (offset > 0 &&
+         WebPPullDecoderProvide(dec, need.offset - 1, data, 1) !=
+             VP8_STATUS_INVALID_PARAM)) {
+      fprintf(stderr, "%s: bytes at a wrong offset accepted\n", name);
+      status = VP8_STATUS_USER_ABORT;
+      break;
+    }
+    if (num_bytes > max_provide) num_bytes = max_provide;
+    if (offset >= size) {
+      num_bytes = 0;
+    } else if (num_bytes > size - offset) {
+      num_bytes = size - offset;
+    }
+    if (WebPPullDecoderProvide(dec, need.offset, data + offset, num_bytes) !=
+            VP8_STATUS_OK) {
+      fprintf(stderr, "%s: bytes refused\n", name);
+      status = VP8_STATUS_USER_ABORT;
+      break;
+    }
+  }
+  if (status == VP8_STATUS_OK &&
+      WebPPullDecoderProvide(dec, 0, data, 1) != VP8_STATUS_INVALID_PARAM) {
+    fprintf(stderr, "%s: bytes accepted after decoding\n", name);
+    status = VP8_STATUS_USER_ABORT;
+  }
+  WebPPullDecoderDelete(dec);
+  return status;
+}
+
+typedef struct {
+  const File* file;
+  size_t max_read;         // at most that many bytes per call
+} Reader;
+
+static size_t Read(void* user_data, uint64_t offset, uint8_t* buffer,
+                   size_t size) {
+  const Reader* const reader = (const Reader*)user_data;
+  const File* const file = reader->file;
+  if (offset >= file->size) return 0;
+  if (size > reader->max_read) size = reader->max_read;
+  if (size > file->size - offset) size = (size_t)(file->size - offset);
+  memcpy(buffer, file->bytes + offset, size);
+  return size;
+}
+
+// Checks the decoding of the frame 'frame_num' of 'file' against 'ref', a
+// 'width' x 'height' picture (or against a failure with 'expected_status').
+static int Check(const char* const name, const File* const file,
+                 int frame_num, const Range* const frames,
+                 const uint8_t* const ref, int width, int height,
+                 VP8StatusCode expected_status) {
+  static const size_t kMaxProvides[] = { 1, 7, 100, 1 << 20 };
+  WebPDecoderConfig config;
+  Reader reader;
+  VP8StatusCode status;
+  int ok = 1;
+  int i;
+  for (i = 0; ok && i < (int)(sizeof(kMaxProvides) / sizeof(*kMaxProvides));
+       ++i) {
+    if (!WebPInitDecoderConfig(&config)) return 0;
+    config.output.colorspace = MODE_RGBA;
+    status = PullDecode(name, file->bytes, file->size, frame_num,
+                        kMaxProvides[i], frames, &config);
+    if (status != expected_status ||
+        (status == VP8_STATUS_OK && !SameRGBA(&config, ref, width, height))) {
+      fprintf(stderr, "%s: frame %d, %d bytes at a time: status %d\n",
+              name, frame_num, (int)kMaxProvides[i], status);
+      ok = 0;
+    }
+    WebPFreeDecBuffer(&config.output);
+
+    if (!WebPInitDecoderConfig(&config)) return 0;
+    config.output.colorspace = MODE_RGBA;
+    reader.file = file;
+    reader.max_read = kMaxProvides[i];
+    status = WebPDecodeFromReader(Read, &reader, frame_num, &config);
+    if (status != expected_status ||
+        (status == VP8_STATUS_OK && !SameRGBA(&config, ref, width, height))) {
+      fprintf(stderr, "%s: frame %d, reading %d bytes at a time: status %d\n",
+              name, frame_num, (int)kMaxProvides[i], status);
+      ok = 0;
+    }
+    WebPFreeDecBuffer(&config.output);
+  }
+  return ok;
+}
+
+// Decodes 'file' cut at several places: decoding must fail cleanly.
+static int CheckTruncated(const char* const name, const File* const file,
+                          int frame_num, const Range* const frames) {
+  const size_t end = (frames != NULL) ? frames[frame_num - 1].end : file->size;
+  const size_t sizes[] = { 0, 5, 12, 20, 29, end / 2, end * 3 / 4 };
+  int ok = 1;
+  int i;
+  for (i = 0; ok && i < (int)(sizeof(sizes) / sizeof(sizes[0])); ++i) {
+    WebPDecoderConfig config;
+    VP8StatusCode status;
+    if (!WebPInitDecoderConfig(&config)) return 0;
+    status = PullDecode(name, file->bytes, sizes[i], frame_num, 1 << 20,
+                        frames, &config);
+    if (status != VP8_STATUS_NOT_ENOUGH_DATA) {
+      fprintf(stderr, "%s: frame %d cut at %d bytes: status %d\n",
+              name, frame_num, (int)sizes[i], status);
+      ok = 0;
+    }
+    WebPFreeDecBuffer(&config.output);
+  }
+  return ok;
+}
+
+int main(void) {
+  static const char* const kNames[NUM_FRAMES] = {
+    "lossy", "lossless + alpha", "lossy + alpha"
+  };
+  static File pics[NUM_FRAMES];
+  static File anim;
+  Range frames[NUM_FRAMES];
+  WebPData data;
+  WebPDemuxer* demux = NULL;
+  int ok = 1;
+  int i;
+
+  // Still pictures.
+  for (i = 0; ok && i < NUM_FRAMES; ++i) {
+    const int width = kFrameSizes[i][0], height = kFrameSizes[i][1];
+    uint8_t* ref;
+    if (!Encode(i, &pics[i])) {
+      fprintf(stderr, "%s: encoding failed\n", kNames[i]);
+      ok = 0;
+      break;
+    }
+    ref = WebPDecodeRGBA(pics[i].bytes, pics[i].size, NULL, NULL);
+    ok = Check(kNames[i], &pics[i], 0, NULL, ref, width, height,
+               VP8_STATUS_OK) &&
+         Check(kNames[i], &pics[i], 1, NULL, ref, width, height,
+               VP8_STATUS_OK) &&
+         Check(kNames[i], &pics[i], 2, NULL, NULL, 0, 0,
+               VP8_STATUS_INVALID_PARAM) &&
+         CheckTruncated(kNames[i], &pics[i], 1, NULL);
+    WebPFree(ref);
+  }
+
+  // Each frame of the animation, the last ones being found without reading
+  // the data of the first ones.
+  if (ok) {
+    MakeAnimation(&anim, pics, frames);
+    data.bytes = anim.bytes;
+    data.size = anim.size;
+    demux = WebPDemux(&data);
+    if (demux == NULL ||
+        WebPDemuxGetI(demux, WEBP_FF_FRAME_COUNT) != NUM_FRAMES) {
+      fprintf(stderr, "animation: WebPDemux() failed\n");
+      ok = 0;
+    }
+  }
+  for (i = 1; ok && i <= NUM_FRAMES; ++i) {
+    WebPIterator iter;
+    uint8_t* ref = NULL;
+    if (!WebPDemuxGetFrame(demux, i, &iter)) {
+      fprintf(stderr, "animation: no frame %d\n", i);
+      ok = 0;
+      break;
+    }
+    ref = WebPDecodeRGBA(iter.fragment.bytes, iter.fragment.size, NULL, NULL);
+    ok = Check("animation", &anim, i, frames, ref, iter.width, iter.height,
+               VP8_STATUS_OK) &&
+         CheckTruncated("animation", &anim, i, frames);
+    if (ok && i == 1) {
+      ok = Check("animation", &anim, 0, frames, ref, iter.width, iter.height,
+                 VP8_STATUS_OK);
+    }
+    WebPFree(ref);
+    WebPDemuxReleaseIterator(&iter);
+  }
+  if (ok) {
+    ok = Check("animation", &anim, NUM_FRAMES + 1, frames, NULL, 0, 0,
+               VP8_STATUS_INVALID_PARAM);
+  }
+  WebPDemuxDelete(demux);
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Checks the fork/join task scheduler of thread_utils.h, for a NULL scheduler
+// and for several numbers of threads: each task of a group runs exactly once,
+// also when the group holds more tasks than a deque, groups can be nested,
+// failing hooks are reported, and WebPParallelFor() covers its range exactly
+// once with any grain. Several client threads share the scheduler at the same
+// time. Then checks that the threaded decoding, which filters chroma with the
+// scheduler, matches the single-threaded one. See README.txt for how to build
+// and run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/utils/thread_utils.h"
+#include "src/webp/decode.h"
+#include "src/webp/encode.h"
+
+#define NUM_CLIENTS 3     // threads using the scheduler at the same time
+#define NUM_TASKS 1000    // more than a deque can hold
+#define NUM_CHILDREN 3    // nested tasks created by each task
+#define DEPTH 4           // levels of nested groups
+#define RANGE_SIZE 1001
+#define NUM_ROUNDS 20
+
+typedef struct {
+  WebPTaskScheduler* scheduler;
+  int depth;              // levels of nested groups still to create
+  int fail;               // if true, the hook returns false
+  int num_runs;           // number of calls of the hook
+  int ok;                 // false if a nested group misbehaved
+} Job;
+
+static void InitJob(Job* const job, WebPTaskScheduler* const scheduler,
+                    int depth, int fail) {
+  memset(job, 0, sizeof(*job));
+  job->scheduler = scheduler;
+  job->depth = depth;
+  job->fail = fail;
+  job->ok = 1;
+}
+
+static int JobHook(void* data1, void* data2) {
+  Job* const job = (Job*)data1;
+  (void)data2;
+  ++job->num_runs;
+  if (job->depth > 0) {
+    Job children[NUM_CHILDREN];
+    WebPTaskGroup group;
+    int expected_ok = 1;
+    int i;
+    if (!WebPTaskGroupInit(&group, job->scheduler)) {
+      job->ok = 0;
+      return !job->fail;
+    }
+    for (i = 0; i < NUM_CHILDREN; ++i) {
+      InitJob(&children[i], job->scheduler, job->depth - 1,
+              (job->depth + i) % 4 == 0);
+      expected_ok &= !children[i].fail;
+      WebPTaskGroupRun(&group, JobHook, &children[i], NULL);
+    }
+    if (WebPTaskGroupWait(&group) != expected_ok) job->ok = 0;
+    for (i = 0; i < NUM_CHILDREN; ++i) {
+      if (children[i].num_runs != 1 || !children[i].ok) job->ok = 0;
+    }
+  }
+  return !job->fail;
+}
+
+// Runs NUM_TASKS flat tasks, one of them failing if 'fail' is true, and then
+// a tree of nested groups.
+static int CheckGroups(WebPTaskScheduler* const scheduler, int fail) {
+  Job* const jobs = (Job*)malloc(NUM_TASKS * sizeof(*jobs));
+  Job root;
+  WebPTaskGroup group;
+  int ok = (jobs != NULL);
+  int i;
+  if (ok && WebPTaskGroupInit(&group, scheduler)) {
+    for (i = 0; i < NUM_TASKS; ++i) {
+      InitJob(&jobs[i], scheduler, 0, fail && i == NUM_TASKS / 2);
+      WebPTaskGroupRun(&group, JobHook, &jobs[i], NULL);
+    }
+    if (WebPTaskGroupWait(&group) != !fail || group.had_error != fail) ok = 0;
+    for (i = 0; i < NUM_TASKS; ++i) {
+      if (jobs[i].num_runs != 1) ok = 0;
+    }
+  } else {
+    ok = 0;
+  }
+  free(jobs);
+  InitJob(&root, scheduler, DEPTH, 0);
+  if (!JobHook(&root, NULL) || !root.ok) ok = 0;
+  return ok;
+}
+
+typedef struct {
+  int counts[RANGE_SIZE];
+  int fail_at;            // the band holding this row fails
+} Range;
+
+static int RangeHook(void* data, int start, int end) {
+  Range* const range = (Range*)data;
+  int y;
+  for (y = start; y < end; ++y) ++range->counts[y];
+  return !(start <= range->fail_at && range->fail_at < end);
+}
+
+static int CheckParallelFor(WebPTaskScheduler* const scheduler) {
+  static const int kGrains[] = { -1, 0, 1, 7, 64, RANGE_SIZE, 2 * RANGE_SIZE };
+  static const int kStarts[] = { 0, 1, 500, RANGE_SIZE - 1, RANGE_SIZE };
+  Range* const range = (Range*)malloc(sizeof(*range));
+  int ok = (range != NULL);
+  int g, s, y;
+  for (g = 0; ok && g < (int)(sizeof(kGrains) / sizeof(kGrains[0])); ++g) {
+    for (s = 0; ok && s < (int)(sizeof(kStarts) / sizeof(kStarts[0])); ++s) {
+      const int start = kStarts[s];
+      const int fail = (start < RANGE_SIZE) && (g & 1);
+      memset(range, 0, sizeof(*range));
+      range->fail_at = fail ? RANGE_SIZE - 1 : -1;
+      if (WebPParallelFor(scheduler, start, RANGE_SIZE, kGrains[g],
+                          RangeHook, range) != !fail) {
+        ok = 0;
+      }
+      for (y = 0; y < RANGE_SIZE; ++y) {
+        if (range->counts[y] != (y >= start)) ok = 0;
+      }
+    }
+  }
+  free(range);
+  return ok;
+}
+
+static int ClientHook(void* data1, void* data2) {
+  WebPTaskScheduler* const scheduler = (WebPTaskScheduler*)data1;
+  int round;
+  (void)data2;
+  for (round = 0; round < NUM_ROUNDS; ++round) {
+    if (!CheckGroups(scheduler, round & 1) || !CheckParallelFor(scheduler)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int CheckScheduler(int num_threads) {
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  WebPTaskScheduler* const scheduler =
+      (num_threads > 0) ? WebPTaskSchedulerNew(num_threads) : NULL;
+  WebPWorker clients[NUM_CLIENTS];
+  int ok = 1;
+  int i;
+#ifdef WEBP_USE_THREAD
+  if (num_threads > 0 && scheduler == NULL) {
+    fprintf(stderr, "can't create a scheduler of %d threads\n", num_threads);
+    return 0;
+  }
+#endif
+  if (WebPTaskSchedulerNumThreads(scheduler) !=
+      ((scheduler != NULL) ? (num_threads < 64 ? num_threads : 64) : 0)) {
+    fprintf(stderr, "%d threads: wrong number of threads\n", num_threads);
+    ok = 0;
+  }
+  for (i = 0; i < NUM_CLIENTS; ++i) {
+    winterface->Init(&clients[i]);
+    if (!winterface->Reset(&clients[i])) {
+      fprintf(stderr, "can't start client %d\n", i);
+      return 0;
+    }
+    clients[i].hook = ClientHook;
+    clients[i].data1 = scheduler;
+    winterface->Launch(&clients[i]);
+  }
+  for (i = 0; i < NUM_CLIENTS; ++i) {
+    if (!winterface->Sync(&clients[i])) {
+      fprintf(stderr, "%d threads: client %d failed\n", num_threads, i);
+      ok = 0;
+    }
+    winterface->End(&clients[i]);
+  }
+  WebPTaskSchedulerDelete(scheduler);
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// Threaded decoding
+
+#define WIDTH  768    // wide enough for the threaded decoding
+#define HEIGHT 160
+
+static int CheckDecoding(void) {
+  static const int kCrops[][4] = {   // left, top, width, height
+    { 0, 0, WIDTH, HEIGHT }, { 37, 21, 500, 90 }, { 600, 100, 168, 60 }
+  };
+  uint8_t* const rgba = (uint8_t*)malloc(4 * WIDTH * HEIGHT);
+  WebPConfig config;
+  WebPPicture pic;
+  WebPMemoryWriter writer;
+  uint32_t seed = 1;
+  int ok = (rgba != NULL);
+  int x, y, c;
+  if (!ok) return 0;
+  for (y = 0; y < HEIGHT; ++y) {
+    for (x = 0; x < WIDTH; ++x) {
+      uint8_t* const p = rgba + 4 * (y * WIDTH + x);
+      seed = seed * 1103515245u + 12345u;
+      p[0] = (uint8_t)(x + ((seed >> 16) & 31));
+      p[1] = (uint8_t)((x ^ y) + ((seed >> 21) & 15));
+      p[2] = (uint8_t)(y * 3 - x / 2);
+      p[3] = 0xff;
+    }
+  }
+  if (!WebPConfigInit(&config) || !WebPPictureInit(&pic)) return 0;
+  config.quality = 30;          // strong in-loop filtering
+  config.filter_type = 1;       // complex filter
+  config.filter_strength = 80;
+  pic.width = WIDTH;
+  pic.height = HEIGHT;
+  WebPMemoryWriterInit(&writer);
+  pic.writer = WebPMemoryWrite;
+  pic.custom_ptr = &writer;
+  if (!WebPPictureImportRGBA(&pic, rgba, 4 * WIDTH) ||
+      !WebPEncode(&config, &pic)) {
+    fprintf(stderr, "encoding failed\n");
+    ok = 0;
+  }
+  for (c = 0; ok && c < (int)(sizeof(kCrops) / sizeof(kCrops[0])); ++c) {
+    WebPDecoderConfig dconfig[2];
+    int t;
+    for (t = 0; t <= 1; ++t) {
+      if (!WebPInitDecoderConfig(&dconfig[t])) return 0;
+      dconfig[t].output.colorspace = MODE_RGBA;
+      dconfig[t].options.use_threads = t;
+      dconfig[t].options.use_cropping = 1;
+      dconfig[t].options.crop_left = kCrops[c][0];
+      dconfig[t].options.crop_top = kCrops[c][1];
+      dconfig[t].options.crop_width = kCrops[c][2];
+      dconfig[t].options.crop_height = kCrops[c][3];
+      if (WebPDecode(writer.mem, writer.size, &dconfig[t]) != VP8_STATUS_OK) {
+        fprintf(stderr, "crop %d, threads %d: decoding failed\n", c, t);
+        ok = 0;
+      }
+    }
+    if (ok) {
+      const WebPRGBABuffer* const a = &dconfig[0].output.u.RGBA;
+      const WebPRGBABuffer* const b = &dconfig[1].output.u.RGBA;
+      for (y = 0; y < kCrops[c][3]; ++y) {
+        if (memcmp(a->rgba + y * a->stride, b->rgba + y * b->stride,
+                   4 * kCrops[c][2])) {
+          fprintf(stderr, "crop %d: threaded output mismatch\n", c);
+          ok = 0;
+          break;
+        }
+      }
+    }
+    WebPFreeDecBuffer(&dconfig[0].output);
+    WebPFreeDecBuffer(&dconfig[1].output);
+  }
+  WebPPictureFree(&pic);
+  WebPMemoryWriterClear(&writer);
+  free(rgba);
+  return ok;
+}
+
+int main(void) {
+  static const int kNumThreads[] = { 0, 1, 3, 100 };
+  int ok = 1;
+  int i;
+  for (i = 0; ok && i < (int)(sizeof(kNumThreads) / sizeof(kNumThreads[0]));
+       ++i) {
+    ok = CheckScheduler(kNumThreads[i]);
+  }
+  if (ok && !CheckDecoding()) ok = 0;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Stress test of the interface returned by WebPGetWorkerPoolInterface().
+// Several client threads (made with the default interface) launch, wait for
+// and end pooled workers at the same time. The hooks of these workers launch
+// nested workers in turn, so that pool threads wait for each other. Checks
+// that each launch runs its hook exactly once, that Sync() reports the
+// errors, and that ending a worker without waiting for it is safe, for
+// several pool sizes. See README.txt for how to build and run.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "src/utils/thread_utils.h"
+
+#define NUM_CLIENTS 4     // threads using the pool at the same time
+#define NUM_WORKERS 6     // pooled workers of each client
+#define NUM_CHILDREN 2    // nested workers launched by each hook
+#define DEPTH 2           // levels of nested workers
+#define NUM_ROUNDS 1000
+
+typedef struct {
+  int depth;              // levels of nested workers still to launch
+  int fail;               // if true, the hook returns false
+  int num_runs;           // number of calls of the hook
+  int ok;                 // false if a nested worker misbehaved
+} Job;
+
+static void InitJob(Job* const job, int depth, int fail) {
+  memset(job, 0, sizeof(*job));
+  job->depth = depth;
+  job->fail = fail;
+  job->ok = 1;
+}
+
+static int JobHook(void* data1, void* data2) {
+  Job* const job = (Job*)data1;
+  (void)data2;
+  ++job->num_runs;
+  if (job->depth > 0) {
+    const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+    WebPWorker workers[NUM_CHILDREN];
+    Job children[NUM_CHILDREN];
+    int i;
+    for (i = 0; i < NUM_CHILDREN; ++i) {
+      InitJob(&children[i], job->depth - 1, i & 1);
+      winterface->Init(&workers[i]);
+      if (!winterface->Reset(&workers[i])) {
+        job->ok = 0;
+        children[i].num_runs = 1;   // not launched
+        continue;
+      }
+      workers[i].hook = JobHook;
+      workers[i].data1 = &children[i];
+      winterface->Launch(&workers[i]);
+    }
+    for (i = 0; i < NUM_CHILDREN; ++i) {
+      if (winterface->Sync(&workers[i]) != !children[i].fail ||
+          children[i].num_runs != 1 || !children[i].ok) {
+        job->ok = 0;
+      }
+      winterface->End(&workers[i]);
+    }
+  }
+  return !job->fail;
+}
+
+// Even rounds wait for the workers with Sync(), odd ones directly end them.
+// The workers are reset at each round.
+static int ClientHook(void* data1, void* data2) {
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  WebPWorker workers[NUM_WORKERS];
+  Job jobs[NUM_WORKERS];
+  int ok = 1;
+  int round, i;
+  (void)data1;
+  (void)data2;
+  for (i = 0; i < NUM_WORKERS; ++i) winterface->Init(&workers[i]);
+  for (round = 0; ok && round < NUM_ROUNDS; ++round) {
+    const int end_only = (round & 1);
+    for (i = 0; i < NUM_WORKERS; ++i) {
+      InitJob(&jobs[i], DEPTH, (round + i) % 5 == 0);
+      if (!winterface->Reset(&workers[i])) return 0;
+      workers[i].hook = JobHook;
+      workers[i].data1 = &jobs[i];
+      winterface->Launch(&workers[i]);
+    }
+    for (i = 0; i < NUM_WORKERS; ++i) {
+      if (end_only) {
+        winterface->End(&workers[i]);
+      } else if (winterface->Sync(&workers[i]) != !jobs[i].fail) {
+        ok = 0;
+      }
+      if (jobs[i].num_runs != 1 || !jobs[i].ok) ok = 0;
+    }
+  }
+  for (i = 0; i < NUM_WORKERS; ++i) winterface->End(&workers[i]);
+  return ok;
+}
+
+int main(void) {
+  static const int kPoolSizes[] = { 1, 3, 64 };
+  // The clients are plain worker threads, using a copy of the default
+  // interface made before installing the pool.
+  const WebPWorkerInterface threads = *WebPGetWorkerInterface();
+  int ok = 1;
+  int p, i;
+  for (p = 0; ok && p < (int)(sizeof(kPoolSizes) / sizeof(kPoolSizes[0]));
+       ++p) {
+    const WebPWorkerInterface* const pool =
+        WebPGetWorkerPoolInterface(kPoolSizes[p]);
+    WebPWorker clients[NUM_CLIENTS];
+    if (pool == NULL || !WebPSetWorkerInterface(pool)) {
+      fprintf(stderr, "can't install a pool of %d threads\n", kPoolSizes[p]);
+      ok = 0;
+      break;
+    }
+    for (i = 0; i < NUM_CLIENTS; ++i) {
+      threads.Init(&clients[i]);
+      if (!threads.Reset(&clients[i])) {
+        fprintf(stderr, "can't start client %d\n", i);
+        return 1;
+      }
+      clients[i].hook = ClientHook;
+      threads.Launch(&clients[i]);
+    }
+    for (i = 0; i < NUM_CLIENTS; ++i) {
+      if (!threads.Sync(&clients[i])) {
+        fprintf(stderr, "pool of %d threads: client %d failed\n",
+                kPoolSizes[p], i);
+        ok = 0;
+      }
+      threads.End(&clients[i]);
+    }
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}